@@ -35,7 +35,9 @@
 #include <cxxtools/arg.h>
 #include <cxxtools/thread.h>
 #include <sys/time.h>
+#include <time.h>
 #include <iomanip>
+#include <algorithm>
 
 namespace bench
 {
@@ -83,6 +85,93 @@ namespace bench
           log_debug("info message");
     }
   }
+
+  // measures the time of each log call
+  class LatencyTester : public cxxtools::RefCounted
+  {
+      cxxtools::AttachedThread thread;
+      unsigned long count;
+      bool structured;
+
+    public:
+      std::vector<unsigned long> latencies;   // in nanoseconds
+
+      LatencyTester(unsigned long count_, bool structured_)
+        : thread( cxxtools::callable(*this, &LatencyTester::run) ),
+          count(count_),
+          structured(structured_)
+      { latencies.reserve(count); }
+
+      void start()
+      { thread.start(); }
+
+      void join()
+      { thread.join(); }
+
+      void run();
+  };
+
+  unsigned long nsecs(const struct timespec& t0, const struct timespec& t1)
+  {
+    return (t1.tv_sec - t0.tv_sec) * 1000000000ul + t1.tv_nsec - t0.tv_nsec;
+  }
+
+  void LatencyTester::run()
+  {
+    struct timespec t0;
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (unsigned long i = 0; i < count; ++i)
+    {
+      t0 = t1;
+      if (structured)
+        log_fatal_s("fatal message " << i << " value " << i * 0.5);
+      else
+        log_fatal("fatal message " << i << " value " << i * 0.5);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      latencies.push_back(nsecs(t0, t1));
+    }
+  }
+
+  // runs the latency test with 1, 2, 4 ... maxThreads threads
+  void latencyBench(unsigned maxThreads, unsigned long count, bool structured)
+  {
+    std::cout << "threads\tmsg/s\t\tp50 ns\tp99 ns\tmax ns" << std::endl;
+
+    for (unsigned numthreads = 1; numthreads <= maxThreads; numthreads <<= 1)
+    {
+      typedef std::vector<cxxtools::SmartPtr<LatencyTester> > Threads;
+      Threads threads;
+      for (unsigned t = 0; t < numthreads; ++t)
+        threads.push_back(new LatencyTester(count / numthreads, structured));
+
+      struct timespec t0;
+      struct timespec t1;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+
+      for (Threads::iterator it = threads.begin(); it != threads.end(); ++it)
+        (*it)->start();
+      for (Threads::iterator it = threads.begin(); it != threads.end(); ++it)
+        (*it)->join();
+
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+
+      std::vector<unsigned long> latencies;
+      for (Threads::iterator it = threads.begin(); it != threads.end(); ++it)
+        latencies.insert(latencies.end(), (*it)->latencies.begin(), (*it)->latencies.end());
+
+      std::sort(latencies.begin(), latencies.end());
+
+      double T = nsecs(t0, t1) / 1e9;
+      std::cout.precision(6);
+      std::cout << numthreads << '\t'
+                << std::setprecision(8) << (latencies.size() / T) << '\t'
+                << latencies[latencies.size() / 2] << '\t'
+                << latencies[latencies.size() * 99 / 100] << '\t'
+                << latencies.back() << std::endl;
+    }
+  }
 }
 
 int main(int argc, char* argv[])
@@ -93,12 +182,39 @@ int main(int argc, char* argv[])
     cxxtools::Arg<double> total(argc, argv, 'T', 5.0); // minimum runtime
     cxxtools::Arg<long> loops(argc, argv, 'l', 1000);
     cxxtools::Arg<unsigned> numthreads(argc, argv, 't', 1);
+    cxxtools::Arg<bool> async(argc, argv, 'a');
+    cxxtools::Arg<bool> drop(argc, argv, 'd');
+    cxxtools::Arg<unsigned> buffer(argc, argv, 'b', 65536);
+    cxxtools::Arg<std::string> file(argc, argv, 'f');
+    cxxtools::Arg<unsigned> latency(argc, argv, 'L', 0);   // max number of threads for latency test
+    cxxtools::Arg<unsigned long> latencyCount(argc, argv, 'n', 1000000);
+    cxxtools::Arg<bool> structured(argc, argv, 's');  // use log_fatal_s in latency test
+    cxxtools::Arg<bool> binary(argc, argv, 'y');      // binary log format
 
     unsigned long count = 1;
     double T;
 
     log_init();
 
+    if (async || file.isSet() || binary)
+    {
+      cxxtools::LogConfiguration config = cxxtools::LogManager::getInstance().getLogConfiguration();
+      if (file.isSet())
+        config.setFile(file);
+      if (async)
+        config.setAsync(true, buffer,
+          drop ? cxxtools::LogConfiguration::Drop : cxxtools::LogConfiguration::Block);
+      if (binary)
+        config.setFormat(cxxtools::LogConfiguration::Binary);
+      log_init(config);
+    }
+
+    if (latency > 0)
+    {
+      bench::latencyBench(latency, latencyCount, structured);
+      return 0;
+    }
+
     typedef std::vector<cxxtools::SmartPtr<bench::Logtester> > Threads;
     Threads threads;
     for (unsigned t = 0; t < numthreads; ++t)
@@ -31,6 +31,7 @@
 
 #include <cxxtools/bin/formatter.h>
 #include <cxxtools/decomposer.h>
+#include <cxxtools/serializationwriter.h>
 
 namespace cxxtools
 {
@@ -130,19 +131,17 @@ namespace cxxtools
                 template <typename T>
                 Serializer& serialize(const T& v, const std::string& name)
                 {
-                    Decomposer<T> s;
-                    s.begin(v);
-                    s.setName(name);
-                    s.format(_formatter);
+                    SerializationWriter w(_formatter);
+                    w.setName(name);
+                    w <<= v;
                     return *this;
                 }
 
                 template <typename T>
                 Serializer& serialize(const T& v)
                 {
-                    Decomposer<T> s;
-                    s.begin(v);
-                    s.format(_formatter);
+                    SerializationWriter w(_formatter);
+                    w <<= v;
                     return *this;
                 }
 
@@ -29,8 +29,8 @@
 #ifndef CXXTOOLS_CACHE_H
 #define CXXTOOLS_CACHE_H
 
-#include <map>
-#include <limits>
+#include <cxxtools/hashtable.h>
+#include <utility>
 
 #ifdef DEBUG
 #include <iostream>
@@ -57,96 +57,141 @@ namespace cxxtools
        - when getting a value and the value is found, it is put to the
          beginning of the list
 
-     When elements are searched, a linear search is done using the ==-operator
-     of the key type.
+     The elements are held in a hash table, so the key type needs a Hash
+     specialization (or a hash function object as third template argument)
+     and the ==-operator. Other keys are found in an ordered index with the
+     <-operator. Both halves of the list are intrusive lists, so that
+     all operations take constant time with a hash table.
 
      The caching algorithm keeps elements, which are fetched more than once in
      the first half of the list. In the second half the elements are either new
      or the elements are pushed from the first half to the second half by other
      elements, which are found in the cache.
 
-     You should be aware, that the key type should be simple. Comparing keys
-     must be cheap. Copying elements (both key and value) must be possible and
-     should be cheap, since they are moved in the underlying container.
+     Copying elements (both key and value) must be possible.
 
    */
-  template <typename Key, typename Value>
+  template <typename Key, typename Value, typename HashFn = Hash<Key> >
   class Cache
   {
-      struct Data
+      struct Node
       {
-        bool winner;
-        unsigned serial;
+        Key key;
         Value value;
-        Data() { }
-        Data(bool winner_, unsigned serial_, const Value& value_)
-          : winner(winner_),
-            serial(serial_),
-            value(value_)
+        bool winner;
+        std::size_t hash;
+        Node* hashNext;
+        Node* prev;
+        Node* next;
+
+        Node(const Key& key_, const Value& value_, bool winner_)
+          : key(key_),
+            value(value_),
+            winner(winner_),
+            hash(0),
+            hashNext(0),
+            prev(0),
+            next(0)
             { }
       };
 
-      typedef std::map<Key, Data> DataType;
+      typedef HashTable<Node, Key, HashFn> DataType;
       DataType data;
+      RecencyList<Node> winnerList;
+      RecencyList<Node> looserList;
 
       typename DataType::size_type maxElements;
-      unsigned serial;
       unsigned hits;
       unsigned misses;
 
-      unsigned _nextSerial()
-      {
-        if (serial == std::numeric_limits<unsigned>::max())
-        {
-          for (typename DataType::iterator it = data.begin(); it != data.end(); ++it)
-            it->second.serial = 0;
-          serial = 1;
-        }
+      RecencyList<Node>& _list(Node* node)
+      { return node->winner ? winnerList : looserList; }
 
-        return serial++;
+      Node* _insert(const Key& key, const Value& value, bool winner)
+      {
+        Node* node = new Node(key, value, winner);
+        data.insert(node);
+        _list(node).pushNewest(node);
+        return node;
       }
 
-      typename DataType::iterator _getOldest(bool winner)
+      void _erase(Node* node)
       {
-        typename DataType::iterator foundElement = data.begin();
-
-        typename DataType::iterator it = data.begin();
-
-        for (++it; it != data.end(); ++it)
-          if (it->second.winner == winner
-            && (foundElement->second.winner != winner || it->second.serial < foundElement->second.serial))
-              foundElement = it;
+        data.remove(node);
+        _list(node).remove(node);
+        delete node;
+      }
 
-        return foundElement;
+      // drop one element
+      void _dropLooser()
+      {
+        // drop the oldest element in the list of loosers
+        if (!looserList.empty())
+          _erase(looserList.oldest());
+        else if (!winnerList.empty())
+          _erase(winnerList.oldest());
       }
 
-      typename DataType::iterator _getNewest(bool winner)
+      void _makeLooser()
       {
-        typename DataType::iterator foundElement = data.begin();
+        // the oldest element in the list of winners becomes the newest looser
+        Node* node = winnerList.oldest();
+        if (node)
+        {
+          winnerList.remove(node);
+          node->winner = false;
+          looserList.pushNewest(node);
+        }
+      }
 
-        typename DataType::iterator it = data.begin();
+      // moves the newest looser to the end of the winners
+      bool _makeWinner()
+      {
+        Node* node = looserList.newest();
+        if (node == 0)
+          return false;
 
-        for (++it; it != data.end(); ++it)
-          if (it->second.winner == winner
-            && (foundElement->second.winner != winner || it->second.serial > foundElement->second.serial))
-              foundElement = it;
+        looserList.remove(node);
+        node->winner = true;
+        winnerList.pushOldest(node);
+        return true;
+      }
 
-        return foundElement;
+      // a element is found in the cache
+      void _hit(Node* node)
+      {
+        if (node->winner)
+        {
+          winnerList.moveToNewest(node);
+        }
+        else
+        {
+          // move element to the winner part
+          looserList.remove(node);
+          node->winner = true;
+          winnerList.pushNewest(node);
+          _makeLooser();
+        }
       }
 
-      // drop one element
-      void _dropLooser()
+      void _copy(const Cache& c)
       {
-        // look for the oldest element in the list of loosers to drop it
-        data.erase(_getOldest(false));
+        for (Node* node = c.winnerList.oldest(); node; node = node->prev)
+          _insert(node->key, node->value, true);
+        for (Node* node = c.looserList.oldest(); node; node = node->prev)
+          _insert(node->key, node->value, false);
       }
 
-      void _makeLooser()
+      void _clear(RecencyList<Node>& list)
       {
-        // look for the oldest element in the list of winners to make it a looser
-        typename DataType::iterator it = _getOldest(true);
-        it->second.winner = false;
-        it->second.serial = _nextSerial();
+        Node* node = list.newest();
+        while (node)
+        {
+          Node* next = node->next;
+          delete node;
+          node = next;
+        }
+        list.clear();
       }
 
     public:
@@ -155,11 +200,36 @@ namespace cxxtools
 
       explicit Cache(size_type maxElements_)
         : maxElements(maxElements_ + (maxElements_ & 1)),
-          serial(0),
           hits(0),
           misses(0)
         { }
 
+      Cache(const Cache& c)
+        : maxElements(c.maxElements),
+          hits(c.hits),
+          misses(c.misses)
+      {
+        _copy(c);
+      }
+
+      Cache& operator= (const Cache& c)
+      {
+        if (this != &c)
+        {
+          clear();
+          maxElements = c.maxElements;
+          hits = c.hits;
+          misses = c.misses;
+          _copy(c);
+        }
+        return *this;
+      }
+
+      ~Cache()
+      {
+        clear();
+      }
+
       /// returns the number of elements currently in the cache
       size_type size() const        { return data.size(); }
 
@@ -168,29 +238,20 @@ namespace cxxtools
 
       void setMaxElements(size_type maxElements_)
       {
-        size_type numWinners = winners();
-
         maxElements_ += (maxElements_ & 1);
 
         if (maxElements_ > maxElements)
         {
-          while (numWinners < maxElements_ / 2)
-          {
-            _getNewest(false)->second.winner = true;
-            ++numWinners;
-          }
+          while (winnerList.size() < maxElements_ / 2 && _makeWinner())
+            ;
         }
         else
         {
           while (size() > maxElements_)
             _dropLooser();
 
-          numWinners = winners();
-          while (numWinners > maxElements_ / 2)
-          {
+          while (winnerList.size() > maxElements_ / 2)
             _makeLooser();
-            --numWinners;
-          }
         }
 
         maxElements = maxElements_;
@@ -199,20 +260,22 @@ namespace cxxtools
       /// removes a element from the cache and returns true, if found
       bool erase(const Key& key)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
           return false;
 
-        if (it->second.winner)
-          _getNewest(false)->second.winner = true;
+        if (node->winner)
+          _makeWinner();
 
-        data.erase(it);
+        _erase(node);
         return true;
       }
 
       /// clears the cache.
       void clear(bool stats = false)
       {
+        _clear(winnerList);
+        _clear(looserList);
         data.clear();
         if (stats)
           hits = misses = 0;
@@ -223,38 +286,28 @@ namespace cxxtools
       /// list.
       Value& put(const Key& key, const Value& value)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
         {
           if (data.size() < maxElements)
           {
-            it = data.insert(data.begin(),
-              typename DataType::value_type(key,
-                Data(data.size() < maxElements / 2, _nextSerial(), value)));
+            node = _insert(key, value, data.size() < maxElements / 2);
           }
           else
           {
             // element not found
             _dropLooser();
-            it = data.insert(data.begin(),
-              typename DataType::value_type(key,
-                Data(false, _nextSerial(), value)));
+            node = _insert(key, value, false);
           }
         }
         else
         {
           // element found
-          it->second.serial = _nextSerial();
-          if (!it->second.winner)
-          {
-            // move element to the winner part
-            it->second.winner = true;
-            _makeLooser();
-          }
-          it->second.value = value;
+          _hit(node);
+          node->value = value;
         }
 
-        return it->second.value;
+        return node->value;
       }
 
       /// puts a new element on the top of the cache. If the element is already
@@ -263,58 +316,42 @@ namespace cxxtools
       /// needs a hit to get to the top of the cache.
       void put_top(const Key& key, const Value& value)
       {
-        typename DataType::iterator it;
+        Node* node;
         if (data.size() < maxElements)
         {
           if (data.size() >= maxElements / 2)
             _makeLooser();
 
-          data.insert(data.begin(),
-            typename DataType::value_type(key,
-              Data(true, _nextSerial(), value)));
+          if (data.find(key) == 0)
+            _insert(key, value, true);
         }
-        else if ((it = data.find(key)) == data.end())
+        else if ((node = data.find(key)) == 0)
         {
           // element not found
           _dropLooser();
           _makeLooser();
-          data.insert(data.begin(),
-            typename DataType::value_type(key,
-              Data(true, _nextSerial(), value)));
+          _insert(key, value, true);
         }
         else
         {
           // element found
-          it->second.serial = _nextSerial();
-          if (!it->second.winner)
-          {
-            // move element to the winner part
-            it->second.winner = true;
-            _makeLooser();
-          }
+          _hit(node);
         }
       }
 
       Value* getptr(const Key& key)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
         {
           ++misses;
           return 0;
         }
 
-        it->second.serial = _nextSerial();
-
-        if (!it->second.winner)
-        {
-          // move element to the winner part
-          it->second.winner = true;
-          _makeLooser();
-        }
+        _hit(node);
 
         ++hits;
-        return &it->second.value;
+        return &node->value;
       }
 
       /// returns a pair of values - a flag, if the value was found and the
@@ -345,31 +382,19 @@ namespace cxxtools
       double fillfactor() const   { return static_cast<double>(data.size()) / static_cast<double>(maxElements); }
 
       unsigned winners() const
-      {
-        unsigned w = 0;
-        for (typename DataType::const_iterator it = data.begin(); it != data.end(); ++it)
-          if (it->second.winner)
-            ++w;
-        return w;
-      }
+      { return winnerList.size(); }
 
       unsigned loosers() const
-      {
-        unsigned l = 0;
-        for (typename DataType::const_iterator it = data.begin(); it != data.end(); ++it)
-          if (!it->second.winner)
-            ++l;
-        return l;
-      }
+      { return looserList.size(); }
 
 #ifdef DEBUG
       void dump(std::ostream& out) const
       {
         out << "cache max size=" << maxElements << " current size=" << size() << '\n';
-        for (typename DataType::const_iterator it = data.begin(); it != data.end(); ++it)
-        {
-          out << "\tkey=\"" << it->first << "\" value=\"" << it->second.value << "\" serial=" << it->second.serial << " winner=" << it->second.winner << '\n';
-        }
+        for (Node* node = winnerList.newest(); node; node = node->next)
+          out << "\tkey=\"" << node->key << "\" value=\"" << node->value << "\" winner=1\n";
+        for (Node* node = looserList.newest(); node; node = node->next)
+          out << "\tkey=\"" << node->key << "\" value=\"" << node->value << "\" winner=0\n";
         out << "--------\n";
       }
 #endif
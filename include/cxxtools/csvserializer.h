@@ -31,6 +31,7 @@
 
 #include <cxxtools/csvformatter.h>
 #include <cxxtools/decomposer.h>
+#include <cxxtools/serializationwriter.h>
 
 namespace cxxtools
 {
@@ -81,9 +82,8 @@ namespace cxxtools
             template <typename T>
             void serialize(const T& type)
             {
-                Decomposer<T> decomposer;
-                decomposer.begin(type);
-                decomposer.format(*_formatter);
+                SerializationWriter w(*_formatter);
+                w <<= type;
                 _formatter->finish();
             }
 
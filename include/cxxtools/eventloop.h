@@ -37,11 +37,11 @@
 #include <cxxtools/selector.h>
 #include <cxxtools/eventsink.h>
 #include <cxxtools/timespan.h>
-#include <deque>
 
 namespace cxxtools {
 
     class Selectable;
+    class EventQueue;
 
     /** @brief Thread-safe event loop supporting I/O multiplexing and Timers.
     */
@@ -148,6 +148,12 @@ namespace cxxtools {
              */
             virtual ~EventLoop();
 
+            /** @brief Returns the counters of wakeup requests and system calls
+
+                Events committed in a batch cause a single wakeup request.
+            */
+            WakeCounters wakeCounters() const;
+
         protected:
             virtual void onAdd( Selectable& s );
 
@@ -157,6 +163,8 @@ namespace cxxtools {
 
             virtual void onChanged(Selectable& s);
 
+            virtual void onClose(Selectable& s);
+
             virtual void onRun();
 
             virtual bool onWait(std::size_t msecs);
@@ -172,8 +180,7 @@ namespace cxxtools {
         private:
             bool _exitLoop;
             SelectorImpl* _selector;
-            Allocator _allocator;
-            std::deque<Event* > _eventQueue;
+            EventQueue* _eventQueue;
             RecursiveMutex _queueMutex;
     };
 
@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_HASHTABLE_H
+#define CXXTOOLS_HASHTABLE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+namespace cxxtools
+{
+  /// Base of hash function objects, which do not hash their keys.
+  struct OrderedHash
+  { };
+
+  /**
+     Hash function object used by the cache containers.
+
+     Specializations are provided for the builtin integral types, pointers,
+     strings and pairs of those. Other key types get a specialization or
+     a hash function object passed as template argument to the container.
+     Without one the containers keep the keys in an ordered index using the
+     <-operator as before.
+   */
+  template <typename T>
+  struct Hash : public OrderedHash
+  {
+    std::size_t operator() (const T&) const
+    { return 0; }
+  };
+
+  template <typename HashFn>
+  struct IsOrderedHash
+  {
+    static char test(const OrderedHash*);
+    static long test(...);
+    enum { value = sizeof(test(static_cast<HashFn*>(0))) == 1 };
+  };
+
+#define CXXTOOLS_HASH_INTEGRAL(T) \
+  template <> \
+  struct Hash<T> \
+  { \
+    std::size_t operator() (T v) const \
+    { return static_cast<std::size_t>(v); } \
+  };
+
+  CXXTOOLS_HASH_INTEGRAL(bool)
+  CXXTOOLS_HASH_INTEGRAL(char)
+  CXXTOOLS_HASH_INTEGRAL(signed char)
+  CXXTOOLS_HASH_INTEGRAL(unsigned char)
+  CXXTOOLS_HASH_INTEGRAL(wchar_t)
+  CXXTOOLS_HASH_INTEGRAL(short)
+  CXXTOOLS_HASH_INTEGRAL(unsigned short)
+  CXXTOOLS_HASH_INTEGRAL(int)
+  CXXTOOLS_HASH_INTEGRAL(unsigned int)
+  CXXTOOLS_HASH_INTEGRAL(long)
+  CXXTOOLS_HASH_INTEGRAL(unsigned long)
+  CXXTOOLS_HASH_INTEGRAL(long long)
+  CXXTOOLS_HASH_INTEGRAL(unsigned long long)
+
+#undef CXXTOOLS_HASH_INTEGRAL
+
+  template <typename T>
+  struct Hash<T*>
+  {
+    std::size_t operator() (T* p) const
+    { return reinterpret_cast<std::size_t>(p); }
+  };
+
+  template <typename CharT, typename Traits, typename Alloc>
+  struct Hash<std::basic_string<CharT, Traits, Alloc> >
+  {
+    // FNV-1a
+    std::size_t operator() (const std::basic_string<CharT, Traits, Alloc>& s) const
+    {
+      std::size_t h = 2166136261u;
+      for (typename std::basic_string<CharT, Traits, Alloc>::const_iterator it = s.begin(); it != s.end(); ++it)
+      {
+        h ^= static_cast<std::size_t>(Traits::to_int_type(*it));
+        h *= 16777619u;
+      }
+      return h;
+    }
+  };
+
+  template <typename A, typename B>
+  struct Hash<std::pair<A, B> >
+  {
+    std::size_t operator() (const std::pair<A, B>& p) const
+    {
+      std::size_t h = Hash<A>()(p.first);
+      return h ^ (Hash<B>()(p.second) + 0x9e3779b9 + (h << 6) + (h >> 2));
+    }
+  };
+
+  /**
+     Intrusive hash table with separate chaining.
+
+     The table does not own the nodes. A node needs the members `key`,
+     `hash` (std::size_t) and `hashNext` (Node*). Keys are compared with
+     the ==-operator. Keys without a hash function are kept in a std::map
+     instead.
+   */
+  template <typename Node, typename Key, typename HashFn = Hash<Key>,
+            bool ordered = IsOrderedHash<HashFn>::value>
+  class HashTable
+  {
+      std::vector<Node*> _buckets;
+      std::size_t _size;
+      HashFn _hashFn;
+
+      // spread the bits, since the bucket is selected by the lower bits
+      static std::size_t _mix(std::size_t h)
+      {
+        h ^= h >> 16;
+        h *= 0x45d9f3b;
+        h ^= h >> 16;
+        return h;
+      }
+
+      void _rehash(std::size_t buckets)
+      {
+        std::vector<Node*> b(buckets);
+        for (typename std::vector<Node*>::iterator it = _buckets.begin(); it != _buckets.end(); ++it)
+        {
+          Node* node = *it;
+          while (node)
+          {
+            Node* next = node->hashNext;
+            Node*& bucket = b[node->hash & (buckets - 1)];
+            node->hashNext = bucket;
+            bucket = node;
+            node = next;
+          }
+        }
+        _buckets.swap(b);
+      }
+
+    public:
+      typedef std::size_t size_type;
+
+      HashTable()
+        : _size(0)
+        { }
+
+      explicit HashTable(const HashFn& hashFn)
+        : _size(0),
+          _hashFn(hashFn)
+        { }
+
+      size_type size() const   { return _size; }
+      bool empty() const       { return _size == 0; }
+
+      std::size_t hash(const Key& key) const
+      { return _mix(_hashFn(key)); }
+
+      Node* find(const Key& key) const
+      {
+        if (_size == 0)
+          return 0;
+
+        std::size_t h = hash(key);
+        for (Node* node = _buckets[h & (_buckets.size() - 1)]; node; node = node->hashNext)
+          if (node->hash == h && node->key == key)
+            return node;
+
+        return 0;
+      }
+
+      /// Inserts a node; the key must not be in the table yet.
+      void insert(Node* node)
+      {
+        if (_size >= _buckets.size())
+          _rehash(_buckets.empty() ? 16 : _buckets.size() * 2);
+
+        node->hash = hash(node->key);
+        Node*& bucket = _buckets[node->hash & (_buckets.size() - 1)];
+        node->hashNext = bucket;
+        bucket = node;
+        ++_size;
+      }
+
+      void remove(Node* node)
+      {
+        for (Node** n = &_buckets[node->hash & (_buckets.size() - 1)]; *n; n = &(*n)->hashNext)
+        {
+          if (*n == node)
+          {
+            *n = node->hashNext;
+            node->hashNext = 0;
+            --_size;
+            return;
+          }
+        }
+      }
+
+      /// Removes all nodes without releasing them.
+      void clear()
+      {
+        _buckets.clear();
+        _size = 0;
+      }
+
+      void swap(HashTable& other)
+      {
+        _buckets.swap(other._buckets);
+        std::swap(_size, other._size);
+        std::swap(_hashFn, other._hashFn);
+      }
+  };
+
+  template <typename Node, typename Key, typename HashFn>
+  class HashTable<Node, Key, HashFn, true>
+  {
+      typedef std::map<Key, Node*> Index;
+      Index _index;
+
+    public:
+      typedef std::size_t size_type;
+
+      HashTable()
+        { }
+
+      explicit HashTable(const HashFn&)
+        { }
+
+      size_type size() const   { return _index.size(); }
+      bool empty() const       { return _index.empty(); }
+
+      std::size_t hash(const Key&) const
+      { return 0; }
+
+      Node* find(const Key& key) const
+      {
+        typename Index::const_iterator it = _index.find(key);
+        return it == _index.end() ? 0 : it->second;
+      }
+
+      void insert(Node* node)
+      {
+        _index.insert(typename Index::value_type(node->key, node));
+      }
+
+      void remove(Node* node)
+      {
+        _index.erase(node->key);
+      }
+
+      void clear()
+      {
+        _index.clear();
+      }
+
+      void swap(HashTable& other)
+      {
+        _index.swap(other._index);
+      }
+  };
+
+  /**
+     Intrusive doubly linked list ordered from newest to oldest node.
+
+     The list does not own the nodes. A node needs the members `prev` and
+     `next` (Node*).
+   */
+  template <typename Node>
+  class RecencyList
+  {
+      Node* _newest;
+      Node* _oldest;
+      std::size_t _size;
+
+    public:
+      RecencyList()
+        : _newest(0),
+          _oldest(0),
+          _size(0)
+        { }
+
+      Node* newest() const      { return _newest; }
+      Node* oldest() const      { return _oldest; }
+      std::size_t size() const  { return _size; }
+      bool empty() const        { return _size == 0; }
+
+      void pushNewest(Node* node)
+      {
+        node->prev = 0;
+        node->next = _newest;
+        if (_newest)
+          _newest->prev = node;
+        else
+          _oldest = node;
+        _newest = node;
+        ++_size;
+      }
+
+      void pushOldest(Node* node)
+      {
+        node->next = 0;
+        node->prev = _oldest;
+        if (_oldest)
+          _oldest->next = node;
+        else
+          _newest = node;
+        _oldest = node;
+        ++_size;
+      }
+
+      void remove(Node* node)
+      {
+        if (node->prev)
+          node->prev->next = node->next;
+        else
+          _newest = node->next;
+
+        if (node->next)
+          node->next->prev = node->prev;
+        else
+          _oldest = node->prev;
+
+        node->prev = node->next = 0;
+        --_size;
+      }
+
+      void moveToNewest(Node* node)
+      {
+        if (node != _newest)
+        {
+          remove(node);
+          pushNewest(node);
+        }
+      }
+
+      void clear()
+      {
+        _newest = _oldest = 0;
+        _size = 0;
+      }
+
+      void swap(RecencyList& other)
+      {
+        std::swap(_newest, other._newest);
+        std::swap(_oldest, other._oldest);
+        std::swap(_size, other._size);
+      }
+  };
+
+}
+
+#endif // CXXTOOLS_HASHTABLE_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_Http_BodyBuffer_h
+#define cxxtools_Http_BodyBuffer_h
+
+#include <cxxtools/http/api.h>
+#include <streambuf>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cxxtools {
+
+namespace http {
+
+/**
+ * Stream buffer, which collects a http message body in a chain of blocks.
+ *
+ * The body is never copied into a contiguous buffer. The size is tracked
+ * while writing, so that size() is cheap and the blocks can be passed to
+ * writev directly. The first block has 8k and each following block is twice
+ * as large as its predecessor up to a maximum of 1MB.
+ *
+ * When a sink is set, the sink is notified on each flush of the stream and
+ * whenever the collected data exceeds the threshold. The sink may then send
+ * the collected data and discard it with clear().
+ */
+class CXXTOOLS_HTTP_API BodyBuffer : public std::streambuf
+{
+    public:
+        class Sink
+        {
+            public:
+                virtual ~Sink() { }
+                virtual void onBodyData(BodyBuffer& buffer) = 0;
+        };
+
+        BodyBuffer();
+        ~BodyBuffer();
+
+        /// Returns the number of bytes collected.
+        std::size_t size() const
+        { return _size + (pptr() - pbase()); }
+
+        bool empty() const
+        { return size() == 0; }
+
+        /// Returns the number of blocks with data.
+        unsigned blocks() const
+        { return _blocks.empty() ? 0 : _current + 1; }
+
+        const char* blockData(unsigned n) const
+        { return _blocks[n].data; }
+
+        std::size_t blockSize(unsigned n) const
+        { return n == _current ? static_cast<std::size_t>(pptr() - pbase()) : _blocks[n].size; }
+
+        /// Returns a copy of the collected data.
+        std::string str() const;
+
+        /// Discards the data. The first block is kept for reuse.
+        void clear();
+
+        void setSink(Sink* sink, std::size_t threshold = 65536)
+        {
+            _sink = sink;
+            _threshold = threshold;
+        }
+
+        Sink* sink() const
+        { return _sink; }
+
+    protected:
+        int_type overflow(int_type ch);
+        std::streamsize xsputn(const char* s, std::streamsize n);
+        int sync();
+
+    private:
+        struct Block
+        {
+            char* data;
+            std::size_t capacity;
+            std::size_t size;
+        };
+
+        void nextBlock();
+
+        std::vector<Block> _blocks;
+        unsigned _current;
+        std::size_t _size;  // bytes in blocks before _current
+        Sink* _sink;
+        std::size_t _threshold;
+
+        // disable copy and assignment
+        BodyBuffer(const BodyBuffer&);
+        BodyBuffer& operator=(const BodyBuffer&);
+};
+
+class CXXTOOLS_HTTP_API BodyStream : public std::ostream
+{
+        BodyBuffer _buffer;
+
+    public:
+        BodyStream()
+            : std::ostream(0)
+        { init(&_buffer); }
+
+        BodyBuffer& buffer()
+        { return _buffer; }
+
+        const BodyBuffer& buffer() const
+        { return _buffer; }
+
+        std::size_t size() const
+        { return _buffer.size(); }
+
+        std::string str() const
+        { return _buffer.str(); }
+
+        /// Discards the data and resets the stream state.
+        void reset()
+        {
+            std::ostream::clear();
+            _buffer.clear();
+        }
+
+        /// Writes the collected data to the passed stream.
+        void send(std::ostream& out) const;
+};
+
+} // namespace http
+
+} // namespace cxxtools
+
+#endif
@@ -33,6 +33,7 @@
 #include <cxxtools/selectable.h>
 #include <cxxtools/signal.h>
 #include <cxxtools/delegate.h>
+#include <cxxtools/callable.h>
 #include <string>
 
 namespace cxxtools
@@ -52,6 +53,7 @@ namespace http
 {
 
 class ClientImpl;
+class ConnectionPool;
 class ReplyHeader;
 class Request;
 
@@ -149,6 +151,22 @@ class CXXTOOLS_HTTP_API Client
         void connect(const net::Uri& uri)
         { prepareConnect(uri); connect(); }
 
+        /** Takes connections from the passed pool instead of using an own
+            connection.
+
+            A syncronous request gives the connection back to the pool,
+            when the body is read with readBody. When the reply is read
+            from in() or the request is asyncronous, the client keeps the
+            connection until it is closed, connected to another server or
+            destroyed.
+
+            The pool must outlive the client.
+         */
+        void setConnectionPool(ConnectionPool& pool);
+
+        /// Stops using a connection pool.
+        void clearConnectionPool();
+
         /** Sends the passed request to the server and parses the headers.
 
             The body must be read with readBody.
@@ -189,6 +207,49 @@ class CXXTOOLS_HTTP_API Client
             std::size_t timeout = Selectable::WaitInfinite,
             std::size_t connectTimeout = Selectable::WaitInfinite);
 
+        /** Queues a request for pipelined execution with executePipeline.
+
+            The callback is called with this client, when the reply header
+            is received. The reply header is available with header() and
+            the body may be read with readBody. When the callback does not
+            read the body, it is skipped. The request object must be valid
+            until it is executed.
+
+            example:
+            \code
+              cxxtools::http::Request r1("/a");
+              cxxtools::http::Request r2("/b");
+              client.pipelineRequest(r1, cxxtools::callable(handler, &Handler::onReply));
+              client.pipelineRequest(r2, cxxtools::callable(handler, &Handler::onReply));
+              client.executePipeline();
+            \endcode
+         */
+        void pipelineRequest(const Request& request, const Callable<void, Client&>& onReply);
+
+        /** Executes the queued requests using HTTP/1.1 pipelining.
+
+            Up to pipelineDepth requests are sent back to back without
+            waiting for the replies. The replies are read in order and
+            passed to the callbacks. For each reply read, the next queued
+            request is sent. When the server closes the connection before
+            all replies are received, the unanswered requests are sent again
+            on a new connection. Since requests may be repeated, only
+            idempotent requests should be pipelined.
+
+            This method blocks until all replies are processed. On error
+            the remaining queued requests are discarded.
+         */
+        void executePipeline(std::size_t timeout = Selectable::WaitInfinite,
+            std::size_t connectTimeout = Selectable::WaitInfinite);
+
+        /// Sets the maximum number of requests sent ahead (default 16).
+        void pipelineDepth(unsigned n);
+
+        unsigned pipelineDepth() const;
+
+        /// Returns the number of requests queued for pipelined execution.
+        std::size_t pipelinedRequests() const;
+
         /** Starts a new request.
 
             This method does not block. To actually process the request, the
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_Http_ConnectionPool_h
+#define cxxtools_Http_ConnectionPool_h
+
+#include <cxxtools/http/api.h>
+#include <cxxtools/noncopyable.h>
+#include <cxxtools/timespan.h>
+
+namespace cxxtools
+{
+
+class SelectorBase;
+
+namespace http
+{
+
+class ConnectionPoolImpl;
+
+/**
+    Pool of keep alive connections shared by http clients.
+
+    Clients, which use a pool, take an idle connection to the same host and
+    port from the pool instead of connecting again and give it back, when
+    the reply is read completely. The pool is thread safe and may be shared
+    by clients running in different threads.
+
+    The number of connections to a host (in use and idle) is limited. A
+    syncronous request waits up to its connect timeout for a connection to
+    become free; an asyncronous request fails with an IOError, when the
+    limit is reached.
+
+    Idle connections are checked before they are reused. Connections, which
+    were closed by the server or have unexpected data pending, are dropped.
+    Connections idle for longer than the idle timeout are closed. This is
+    done whenever the pool is used and, when a selector is set, periodically
+    by a timer.
+
+    The pool must outlive all clients using it.
+
+    Example:
+    @code
+      cxxtools::http::ConnectionPool pool;
+
+      cxxtools::http::Client client("www.tntnet.org", 80);
+      client.setConnectionPool(pool);
+      std::string indexPage = client.get("/");
+    @endcode
+ */
+class CXXTOOLS_HTTP_API ConnectionPool : private NonCopyable
+{
+        friend class Client;
+
+    public:
+        struct Statistics
+        {
+            unsigned long hits;       // requests served with an idle connection
+            unsigned long connects;   // new connections
+            unsigned long evictions;  // idle connections closed because of timeout or failed check
+            unsigned idle;            // idle connections in the pool
+            unsigned active;          // connections currently used by clients
+
+            Statistics()
+                : hits(0),
+                  connects(0),
+                  evictions(0),
+                  idle(0),
+                  active(0)
+            { }
+        };
+
+        explicit ConnectionPool(unsigned maxPerHost = 8,
+                                Milliseconds idleTimeout = 30000);
+        ~ConnectionPool();
+
+        /// Sets the maximum number of connections to a single host.
+        void maxPerHost(unsigned n);
+        unsigned maxPerHost() const;
+
+        /// Sets the time after which idle connections are closed.
+        void idleTimeout(Milliseconds t);
+        Milliseconds idleTimeout() const;
+
+        /// Sets the selector, which runs the timer for closing expired idle
+        /// connections.
+        void setSelector(SelectorBase& selector);
+
+        /// Closes all idle connections.
+        void clear();
+
+        Statistics statistics() const;
+
+    private:
+        ConnectionPoolImpl* _impl;
+};
+
+} // namespace http
+
+} // namespace cxxtools
+
+#endif
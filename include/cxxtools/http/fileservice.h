@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_Http_FileService_h
+#define cxxtools_Http_FileService_h
+
+#include <cxxtools/http/api.h>
+#include <cxxtools/http/service.h>
+#include <cxxtools/noncopyable.h>
+#include <string>
+
+namespace cxxtools
+{
+
+namespace http
+{
+
+class FileServiceImpl;
+
+/**
+    Service, which serves static files from a directory.
+
+    The url of the request without the url prefix is taken as path relative
+    to the document root. Urls containing ".." are rejected. Only GET and HEAD
+    requests are accepted.
+
+    The file content is transferred from the file to the socket with
+    sendfile(2) without copying it through user space. Single byte ranges
+    (Range header) and conditional requests with ETag and Last-Modified
+    are supported. Open file descriptors are kept in a cache of limited size
+    and reopened when the file changes on disk.
+
+    Example:
+    @code
+      cxxtools::http::FileService files("/var/www/static", "/static");
+      server.addService(cxxtools::Regex("^/static/"), files);
+    @endcode
+ */
+class CXXTOOLS_HTTP_API FileService : public Service, private NonCopyable
+{
+    public:
+        explicit FileService(const std::string& docroot,
+                             const std::string& urlPrefix = std::string(),
+                             unsigned maxOpenFiles = 64);
+        ~FileService();
+
+        const std::string& docroot() const;
+        const std::string& urlPrefix() const;
+
+        /// Sets the content type, which is sent for files with the
+        /// extension ext (without the dot).
+        void setContentType(const std::string& ext, const std::string& contentType);
+
+    protected:
+        Responder* createResponder(const Request&);
+        void releaseResponder(Responder*);
+
+    private:
+        FileServiceImpl* _impl;
+};
+
+} // namespace http
+
+} // namespace cxxtools
+
+#endif
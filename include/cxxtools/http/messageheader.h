@@ -37,6 +37,8 @@
 namespace cxxtools
 {
 
+class DateTime;
+
 namespace http
 {
 
@@ -46,11 +48,31 @@ class CXXTOOLS_HTTP_API MessageHeader
         static const unsigned MAXHEADERSIZE = 4096;
 
     private:
+        // Number of slots in the key index. Up to MAXINDEXED different keys
+        // are indexed; larger headers are searched linearly.
+        static const unsigned INDEXSIZE = 64;
+        static const unsigned MAXINDEXED = 48;
+
+        struct IndexEntry
+        {
+            unsigned short tag;     // upper bits of the key hash
+            unsigned short offset;  // offset of the key in _rawdata + 1; 0 = free slot
+        };
+
         char _rawdata[MAXHEADERSIZE];  // key_1\0value_1\0key_2\0value_2\0...key_n\0value_n\0\0
         unsigned _endOffset;
         char* eptr() { return _rawdata + _endOffset; }
         unsigned _httpVersionMajor;
         unsigned _httpVersionMinor;
+        IndexEntry _index[INDEXSIZE];
+        unsigned _indexed;             // number of indexed keys; > MAXINDEXED when full
+
+        void clearIndex();
+        void indexKey(const char* key);
+        void rebuildIndex();
+
+        // looks up a header with the precalculated hash value of the key
+        const char* getHeader(const char* key, unsigned hash) const;
 
     public:
         typedef std::pair<const char*, const char*> value_type;
@@ -116,6 +138,7 @@ class CXXTOOLS_HTTP_API MessageHeader
               _httpVersionMinor(1)
         {
             _rawdata[0] = _rawdata[1] = '\0';
+            clearIndex();
         }
 
         virtual ~MessageHeader()  {}
@@ -127,8 +150,16 @@ class CXXTOOLS_HTTP_API MessageHeader
         void addHeader(const char* key, const char* value)
         { setHeader(key, value, false); }
 
+        /// Appends a header given as key and value, which need not be zero
+        /// terminated.
+        void addHeader(const char* key, std::size_t keyLength,
+                       const char* value, std::size_t valueLength);
+
         void removeHeader(const char* key);
 
+        /// Returns the value of the first header with the given key or a
+        /// null pointer if there is none. Keys are compared case
+        /// insensitive.
         const char* getHeader(const char* key) const;
 
         bool hasHeader(const char* key) const
@@ -164,6 +195,10 @@ class CXXTOOLS_HTTP_API MessageHeader
         /// The buffer must have at least 30 bytes.
         static char* htdateCurrent(char* buffer);
 
+        /// Returns the passed time formatted as needed in http.
+        /// The buffer must have at least 30 bytes.
+        static char* htdate(const DateTime& dt, char* buffer);
+
 };
 
 } // namespace http
@@ -31,8 +31,10 @@
 
 #include <cxxtools/http/api.h>
 #include <cxxtools/http/replyheader.h>
+#include <cxxtools/http/bodybuffer.h>
+#include <cxxtools/refcounted.h>
+#include <cxxtools/smartptr.h>
 #include <string>
-#include <sstream>
 
 namespace cxxtools {
 
@@ -43,10 +45,20 @@ class Request;
 class Reply
 {
         ReplyHeader _header;
-        std::ostringstream _body;
+        BodyStream _body;
+        bool _chunkedTransfer;
+
+        int _bodyFd;
+        std::size_t _bodyFileOffset;
+        std::size_t _bodyFileSize;
+        SmartPtr<AtomicRefCounted> _bodyFileHolder;
 
     public:
         Reply()
+            : _chunkedTransfer(false),
+              _bodyFd(-1),
+              _bodyFileOffset(0),
+              _bodyFileSize(0)
             { }
 
         ReplyHeader& header()
@@ -83,8 +95,12 @@ class Reply
         void clear()
         {
             _header.clear();
-            _body.clear();
-            _body.str(std::string());
+            _body.reset();
+            _chunkedTransfer = false;
+            _bodyFd = -1;
+            _bodyFileOffset = 0;
+            _bodyFileSize = 0;
+            _bodyFileHolder = 0;
         }
 
         unsigned httpReturnCode() const
@@ -103,10 +119,50 @@ class Reply
         { return _body; }
 
         std::size_t bodySize() const
-        { return _body.str().size(); }
+        { return _bodyFd >= 0 ? _bodyFileSize : _body.size(); }
+
+        BodyBuffer& bodyBuffer()
+        { return _body.buffer(); }
+
+        const BodyBuffer& bodyBuffer() const
+        { return _body.buffer(); }
 
         void sendBody(std::ostream& out) const
-        { out << _body.str(); }
+        { _body.send(out); }
+
+        /// Enables streaming of the body with chunked transfer encoding.
+        ///
+        /// The server starts sending the reply when the body stream is
+        /// flushed or has collected a larger amount of data, so that the
+        /// responder need not build the whole body in memory. The header
+        /// must be complete before the body is flushed the first time.
+        /// Clients speaking HTTP/1.0 get the body unchunked as usual.
+        void setChunkedTransfer(bool sw = true)
+        { _chunkedTransfer = sw; }
+
+        bool chunkedTransfer() const
+        { return _chunkedTransfer; }
+
+        /// Sends size bytes of the open file fd starting at offset as body.
+        ///
+        /// The server transfers the data from the file to the socket in the
+        /// kernel where possible. Data written to the body stream is ignored.
+        /// The holder is released after the reply is sent and may be used to
+        /// keep the file descriptor open until then.
+        void setBodyFile(int fd, std::size_t offset, std::size_t size,
+                         AtomicRefCounted* holder = 0)
+        {
+            _bodyFd = fd;
+            _bodyFileOffset = offset;
+            _bodyFileSize = size;
+            _bodyFileHolder = holder;
+        }
+
+        int bodyFd() const
+        { return _bodyFd; }
+
+        std::size_t bodyFileOffset() const
+        { return _bodyFileOffset; }
 
 };
 
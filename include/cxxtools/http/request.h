@@ -31,8 +31,10 @@
 
 #include <cxxtools/http/api.h>
 #include <cxxtools/http/requestheader.h>
+#include <cxxtools/http/bodybuffer.h>
 #include <string>
-#include <sstream>
+#include <vector>
+#include <utility>
 
 namespace cxxtools {
 
@@ -41,7 +43,7 @@ namespace http {
 class Request
 {
         RequestHeader _header;
-        std::ostringstream _body;
+        BodyStream _body;
 
     public:
         struct Auth
@@ -50,6 +52,13 @@ class Request
             std::string password;
         };
 
+        typedef std::vector<std::pair<std::string, std::string> > PathParams;
+
+    private:
+        PathParams _pathParams;
+
+    public:
+
         explicit Request(const std::string& url = std::string())
         : _header(url)
         { }
@@ -88,8 +97,8 @@ class Request
         void clear()
         {
             _header.clear();
-            _body.clear();
-            _body.str(std::string());
+            _body.reset();
+            _pathParams.clear();
         }
 
         const std::string& url() const
@@ -117,13 +126,30 @@ class Request
         { return _body; }
 
         std::size_t bodySize() const
-        { return _body.str().size(); }
+        { return _body.size(); }
+
+        BodyBuffer& bodyBuffer()
+        { return _body.buffer(); }
+
+        const BodyBuffer& bodyBuffer() const
+        { return _body.buffer(); }
 
         void sendBody(std::ostream& out) const
-        { out << _body.str(); }
+        { _body.send(out); }
 
         Auth auth() const;
 
+        /// Returns the value of the parameter name, when the request was
+        /// mapped to a service with a url pattern like "/user/{name}".
+        /// An empty string is returned for unknown parameters.
+        std::string pathParam(const std::string& name) const;
+
+        const PathParams& pathParams() const
+        { return _pathParams; }
+
+        void pathParams(const PathParams& p)
+        { _pathParams = p; }
+
 };
 
 } // namespace http
@@ -51,7 +51,26 @@ class ServerImplBase;
 class CXXTOOLS_HTTP_API Server : private cxxtools::NonCopyable
 {
     public:
+        /** @brief Processing model of the server
+
+            In mode ThreadPool the event loop waits for input on idle
+            connections and passes active connections to a pool of worker
+            threads.
+
+            In mode Reactor the server runs a number of reactor threads (see
+            reactorThreads). Each of them has its own event loop and its own
+            listening socket on the same address (SO_REUSEPORT) and processes
+            the connections it accepted itself, so connections are never
+            passed between threads. Responders run in the reactor thread and
+            should not block.
+         */
+        enum Mode {
+          ThreadPool,
+          Reactor
+        };
+
         explicit Server(EventLoopBase& eventLoop);
+        Server(EventLoopBase& eventLoop, Mode mode);
         Server(EventLoopBase& eventLoop, const std::string& ip, unsigned short int port, int backlog = 64);
         Server(EventLoopBase& eventLoop, unsigned short int port, int backlog = 64);
         ~Server();
@@ -59,8 +78,27 @@ class CXXTOOLS_HTTP_API Server : private cxxtools::NonCopyable
         void listen(const std::string& ip, unsigned short int port, int backlog = 64);
         void listen(unsigned short int port, int backlog = 64);
 
+        /** @brief Adds a service for a url
+
+            The url may be a pattern with segments "{name}", which match any
+            non empty path segment and are passed to the request as path
+            parameters (see Request::pathParam), and a trailing segment "*",
+            which matches the rest of the url, e.g. "/user/{id}/files/\*".
+            When multiple services match, the first registered is used.
+
+            A segment starting with a backslash is matched literally without
+            the backslash, so "/files/\\{id}" matches only the url
+            "/files/{id}" and "/files/\\*" only the url "/files/\*".
+         */
         void addService(const std::string& url, Service& service);
+
+        /** @brief Adds a service for urls matching a regular expression
+
+            Regular expressions are tested only, when no url registered
+            before matches.
+         */
         void addService(const Regex& url, Service& service);
+
         void removeService(Service& service);
 
         std::size_t readTimeout() const;
@@ -77,6 +115,10 @@ class CXXTOOLS_HTTP_API Server : private cxxtools::NonCopyable
         unsigned maxThreads() const;
         void maxThreads(unsigned m);
 
+        /// Number of reactor threads in mode Reactor; 0 (the default) uses one thread per processor.
+        unsigned reactorThreads() const;
+        void reactorThreads(unsigned n);
+
         enum Runmode {
           Stopped,
           Starting,
@@ -42,6 +42,11 @@ namespace net
     class AddrInfo;
 }
 
+namespace http
+{
+    class ConnectionPool;
+}
+
 namespace json
 {
 
@@ -100,6 +105,11 @@ namespace json
 
             void clearAuth();
 
+            /// Takes connections from the passed pool; see http::Client::setConnectionPool.
+            void setConnectionPool(http::ConnectionPool& pool);
+
+            void clearConnectionPool();
+
             void setSelector(SelectorBase& selector);
 
             void beginCall(IComposer& r, IRemoteProcedure& method, IDecomposer** argv, unsigned argc);
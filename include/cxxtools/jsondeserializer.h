@@ -105,6 +105,13 @@ namespace cxxtools
     class CXXTOOLS_API JsonDeserializer : public Deserializer
     {
         public:
+            /**
+             * Reads json from a byte stream. When the codec is a Utf8Codec,
+             * the bytes are parsed directly without decoding them to
+             * cxxtools::Char first, which is much faster. Then exactly one
+             * value is consumed from the stream, so that following values
+             * can be read with another deserializer.
+             */
             JsonDeserializer(std::istream& in, TextCodec<Char, char>* codec = new Utf8Codec());
 
             JsonDeserializer(std::basic_istream<Char>& in);
@@ -117,6 +124,7 @@ namespace cxxtools
         private:
             TextIStream* _ts;
             std::basic_istream<Char>& _in;
+            std::istream* _utf8in;
     };
 }
 
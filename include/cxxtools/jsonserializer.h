@@ -31,6 +31,7 @@
 
 #include <cxxtools/textstream.h>
 #include <cxxtools/decomposer.h>
+#include <cxxtools/serializationwriter.h>
 #include <cxxtools/jsonformatter.h>
 #include <sstream>
 #include <stdexcept>
@@ -150,17 +151,15 @@ namespace cxxtools
             template <typename T>
             JsonSerializer& serialize(const T& v, const std::string& name)
             {
-                Decomposer<T> s;
-                s.begin(v);
-                s.setName(name);
-
                 if (!_inObject)
                 {
                     _formatter.beginObject(std::string(), std::string());
                     _inObject = true;
                 }
 
-                s.format(_formatter);
+                SerializationWriter w(_formatter);
+                w.setName(name);
+                w <<= v;
                 return *this;
             }
 
@@ -170,9 +169,8 @@ namespace cxxtools
                 if (_inObject)
                     throw std::logic_error("can't serialize object without name into another object");
 
-                Decomposer<T> s;
-                s.begin(v);
-                s.format(_formatter);
+                SerializationWriter w(_formatter);
+                w <<= v;
                 _ts->flush();
                 return *this;
             }
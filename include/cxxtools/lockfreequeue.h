@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_LOCKFREEQUEUE_H
+#define CXXTOOLS_LOCKFREEQUEUE_H
+
+#include <cxxtools/atomicity.h>
+#include <cxxtools/membar.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/noncopyable.h>
+#include <utility>
+#include <cstddef>
+
+namespace cxxtools
+{
+    /** @brief A bounded thread safe queue, which does not lock as long as it is neither empty nor full.
+
+        The queue is a ring buffer with a fixed capacity, which may be
+        accessed by multiple producers and consumers at the same time.
+        Elements are put and fetched with atomic operations only. A thread
+        takes a lock only when it has to block in get, because the queue is
+        empty, or in put, because the queue is full, and when it has to wake
+        a blocked thread.
+
+        The interface is similar to Queue but the maximum size is fixed at
+        construction and there is no way to put a element into a full queue
+        without blocking.
+     */
+    template <typename T>
+    class LockFreeQueue : private NonCopyable
+    {
+        public:
+            typedef T value_type;
+            typedef std::size_t size_type;
+            typedef const T& const_reference;
+
+        private:
+            struct Cell
+            {
+                volatile atomic_t sequence;
+                value_type data;
+            };
+
+            enum { CacheLine = 64 };
+
+            Cell* _buffer;
+            size_type _mask;
+
+            // the positions are modified by different threads, so they are
+            // kept on separate cache lines
+            char _pad0[CacheLine];
+            volatile atomic_t _enqueuePos;
+            char _pad1[CacheLine - sizeof(atomic_t)];
+            volatile atomic_t _dequeuePos;
+            char _pad2[CacheLine - sizeof(atomic_t)];
+
+            volatile atomic_t _waitingConsumers;
+            volatile atomic_t _waitingProducers;
+            Mutex _mutex;
+            Condition _notEmpty;
+            Condition _notFull;
+
+            bool _tryPut(const_reference element);
+            bool _tryGet(value_type& element);
+
+            // Called after publishing a cell with an atomic exchange, which is a
+            // full memory barrier, so the counter can be read without a fence.
+            void _wake(volatile atomic_t& waiting, Condition& cond)
+            {
+                if (waiting > 0)
+                {
+                    MutexLock lock(_mutex);
+                    cond.signal();
+                }
+            }
+
+        public:
+            /// Creates a queue, which holds at least capacity elements.
+            /// The capacity is rounded up to the next power of 2.
+            explicit LockFreeQueue(size_type capacity = 1024);
+
+            ~LockFreeQueue()
+            { delete[] _buffer; }
+
+            /** @brief Returns the next element.
+
+                If the queue is empty, the thread will be blocked until a
+                element is available.
+             */
+            value_type get();
+
+            /** @brief Returns the next element if the queue is not empty.
+
+                If the queue is empty, a default constructed value_type is returned.
+                The returned flag is set to false, if the queue was empty.
+             */
+            std::pair<value_type, bool> tryGet();
+
+            /** @brief Adds a element to the queue.
+
+                If the queue is full, the method blocks until there is space
+                available.
+             */
+            void put(const_reference element);
+
+            /// @brief Adds a element to the queue if it is not full and returns true on success.
+            bool tryPut(const_reference element);
+
+            /// @brief Returns true, if the queue is empty.
+            bool empty() const
+            { return size() == 0; }
+
+            /// @brief Returns the number of elements currently in queue.
+            /// The result is a snapshot, which may be outdated when other threads access the queue.
+            size_type size() const
+            {
+                atomic_t d = _enqueuePos - _dequeuePos;
+                return d > 0 ? static_cast<size_type>(d) : 0;
+            }
+
+            /// @brief returns the maximum size of the queue.
+            size_type maxSize() const
+            { return _mask + 1; }
+
+            /// @brief returns the number of threads blocked in the get method.
+            size_type numWaiting() const
+            { return static_cast<size_type>(_waitingConsumers); }
+    };
+
+    template <typename T>
+    LockFreeQueue<T>::LockFreeQueue(size_type capacity)
+        : _enqueuePos(0),
+          _dequeuePos(0),
+          _waitingConsumers(0),
+          _waitingProducers(0)
+    {
+        size_type size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        _buffer = new Cell[size];
+        _mask = size - 1;
+
+        for (size_type n = 0; n < size; ++n)
+            _buffer[n].sequence = n;
+
+        membar_rw();
+    }
+
+    template <typename T>
+    bool LockFreeQueue<T>::_tryPut(const_reference element)
+    {
+        Cell* cell;
+        atomic_t pos = _enqueuePos;
+        while (true)
+        {
+            cell = &_buffer[pos & _mask];
+            atomic_t seq = cell->sequence;
+            membar_read();
+
+            atomic_t diff = seq - pos;
+            if (diff == 0)
+            {
+                if (atomicCompareExchange(_enqueuePos, pos + 1, pos) == pos)
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;  // full
+            }
+
+            pos = _enqueuePos;
+        }
+
+        cell->data = element;
+        atomicExchange(cell->sequence, pos + 1);
+
+        return true;
+    }
+
+    template <typename T>
+    bool LockFreeQueue<T>::_tryGet(value_type& element)
+    {
+        Cell* cell;
+        atomic_t pos = _dequeuePos;
+        while (true)
+        {
+            cell = &_buffer[pos & _mask];
+            atomic_t seq = cell->sequence;
+            membar_read();
+
+            atomic_t diff = seq - (pos + 1);
+            if (diff == 0)
+            {
+                if (atomicCompareExchange(_dequeuePos, pos + 1, pos) == pos)
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;  // empty
+            }
+
+            pos = _dequeuePos;
+        }
+
+        element = cell->data;
+        cell->data = value_type();
+        atomicExchange(cell->sequence, pos + _mask + 1);
+
+        return true;
+    }
+
+    template <typename T>
+    typename LockFreeQueue<T>::value_type LockFreeQueue<T>::get()
+    {
+        value_type element;
+
+        if (!_tryGet(element))
+        {
+            MutexLock lock(_mutex);
+
+            // A producer checks _waitingConsumers after putting a element,
+            // so the queue must be checked again after incrementing it.
+            atomicIncrement(_waitingConsumers);
+            while (!_tryGet(element))
+                _notEmpty.wait(lock);
+            atomicDecrement(_waitingConsumers);
+        }
+
+        _wake(_waitingProducers, _notFull);
+
+        return element;
+    }
+
+    template <typename T>
+    std::pair<typename LockFreeQueue<T>::value_type, bool> LockFreeQueue<T>::tryGet()
+    {
+        typedef std::pair<value_type, bool> return_type;
+
+        value_type element;
+        if (!_tryGet(element))
+            return return_type(value_type(), false);
+
+        _wake(_waitingProducers, _notFull);
+
+        return return_type(element, true);
+    }
+
+    template <typename T>
+    void LockFreeQueue<T>::put(const_reference element)
+    {
+        if (!_tryPut(element))
+        {
+            MutexLock lock(_mutex);
+
+            atomicIncrement(_waitingProducers);
+            while (!_tryPut(element))
+                _notFull.wait(lock);
+            atomicDecrement(_waitingProducers);
+        }
+
+        _wake(_waitingConsumers, _notEmpty);
+    }
+
+    template <typename T>
+    bool LockFreeQueue<T>::tryPut(const_reference element)
+    {
+        if (!_tryPut(element))
+            return false;
+
+        _wake(_waitingConsumers, _notEmpty);
+
+        return true;
+    }
+}
+
+#endif // CXXTOOLS_LOCKFREEQUEUE_H
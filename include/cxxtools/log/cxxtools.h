@@ -31,6 +31,7 @@
 
 #include <string>
 #include <iostream>
+#include <sstream>
 
 #define _cxxtools_log_enabled(impl, level)   \
   (getLogger ## impl() != 0 && getLogger ## impl()->isEnabled(::cxxtools::Logger::level))
@@ -57,6 +58,22 @@
     } \
   } while (false)
 
+// Structured log statements take the same expressions as the log_* macros but
+// store the values in a binary record instead of formatting them. The record
+// is formatted later by the background thread in asynchronous mode or not at
+// all, when the binary log format is used. Manipulators are not supported.
+#define _cxxtools_log_s(impl, level, expr)   \
+  do { \
+    ::cxxtools::Logger* _cxxtools_logger = getLogger ## impl(); \
+    if (_cxxtools_logger != 0 && _cxxtools_logger->isEnabled(::cxxtools::Logger::level)) \
+    { \
+      static ::cxxtools::LogSite _cxxtools_logSite = { __FILE__, __LINE__, #level, 0 }; \
+      ::cxxtools::LogRecord _cxxtools_logRecord(_cxxtools_logger, _cxxtools_logSite); \
+      _cxxtools_logRecord << expr; \
+      _cxxtools_logRecord.finish(); \
+    } \
+  } while (false)
+
 #define log_fatal_enabled()     _cxxtools_log_enabled(_default, FATAL)
 #define log_error_enabled()     _cxxtools_log_enabled(_default, ERROR)
 #define log_warn_enabled()      _cxxtools_log_enabled(_default, WARN)
@@ -83,6 +100,18 @@
 #define log_info_to(impl, expr)      _cxxtools_log(impl, INFO, expr)
 #define log_debug_to(impl, expr)     _cxxtools_log(impl, DEBUG, expr)
 
+#define log_fatal_s(expr)     _cxxtools_log_s(_default, FATAL, expr)
+#define log_error_s(expr)     _cxxtools_log_s(_default, ERROR, expr)
+#define log_warn_s(expr)      _cxxtools_log_s(_default, WARN, expr)
+#define log_info_s(expr)      _cxxtools_log_s(_default, INFO, expr)
+#define log_debug_s(expr)     _cxxtools_log_s(_default, DEBUG, expr)
+
+#define log_fatal_s_to(impl, expr)     _cxxtools_log_s(impl, FATAL, expr)
+#define log_error_s_to(impl, expr)     _cxxtools_log_s(impl, ERROR, expr)
+#define log_warn_s_to(impl, expr)      _cxxtools_log_s(impl, WARN, expr)
+#define log_info_s_to(impl, expr)      _cxxtools_log_s(impl, INFO, expr)
+#define log_debug_s_to(impl, expr)     _cxxtools_log_s(impl, DEBUG, expr)
+
 #define log_fatal_if(cond, expr)     _cxxtools_log_if(_default, FATAL, cond, expr)
 #define log_error_if(cond, expr)     _cxxtools_log_if(_default, ERROR, cond, expr)
 #define log_warn_if(cond, expr)      _cxxtools_log_if(_default, WARN, cond, expr)
@@ -145,7 +174,7 @@ namespace cxxtools
 
     private:
       std::string category;
-      log_level_type level;
+      volatile log_level_type level;  // updated by LogManager::configure without locking
 
       Logger(const Logger&);
       Logger& operator=(const Logger&);
@@ -179,6 +208,18 @@ namespace cxxtools
     public:
       typedef Logger::log_level_type log_level_type;
 
+      /// Behaviour of asynchronous logging, when the buffer of a thread is full.
+      enum OverflowPolicy {
+        Block,  ///< wait until the writer thread has processed the buffer
+        Drop    ///< discard the message; the number of dropped messages is logged
+      };
+
+      /// Format of the log output.
+      enum Format {
+        Text,   ///< formatted log lines
+        Binary  ///< binary records, which are converted to text by BinaryLogDecoder
+      };
+
       LogConfiguration();
       LogConfiguration(const LogConfiguration&);
       LogConfiguration& operator=(const LogConfiguration&);
@@ -199,6 +240,27 @@ namespace cxxtools
       void setLoghost(const std::string& host, unsigned short port, bool broadcast = false);
       void setStdout();
       void setStderr();
+
+      bool async() const;
+
+      /** Enables or disables asynchronous logging.
+
+          In asynchronous mode log messages are formatted by the calling
+          thread and put into a ring buffer of \a bufferSize bytes per
+          thread. A background thread passes them to the file, console or
+          udp output.
+       */
+      void setAsync(bool sw = true, unsigned bufferSize = 65536, OverflowPolicy policy = Block);
+
+      Format format() const;
+
+      /** Sets the format of the log output.
+
+          In binary format the values passed to the structured log macros
+          (log_debug_s and friends) are written unformatted. Output of the
+          other log macros is written as text records.
+       */
+      void setFormat(Format format);
   };
 
   void operator>>= (const SerializationInfo& si, LogConfiguration& logConfiguration);
@@ -270,6 +332,85 @@ namespace cxxtools
       void finish();
   };
 
+  //////////////////////////////////////////////////////////////////////
+  // static description of a structured log statement
+  //
+  struct LogSite
+  {
+    const char* file;
+    unsigned line;
+    const char* level;
+    volatile unsigned id;
+  };
+
+  //////////////////////////////////////////////////////////////////////
+  // collects the values of a structured log statement
+  //
+  class LogRecord
+  {
+    public:
+      class Impl;
+
+    private:
+      Impl* _impl;
+
+      LogRecord(const LogRecord&);
+      LogRecord& operator=(const LogRecord&);
+
+    public:
+      LogRecord(Logger* logger, LogSite& site);
+      ~LogRecord();
+
+      LogRecord& operator<< (const std::string& s);
+      LogRecord& operator<< (const char* s);
+      LogRecord& operator<< (char* s)
+      { return *this << static_cast<const char*>(s); }
+      LogRecord& operator<< (char c);
+      LogRecord& operator<< (bool b);
+      LogRecord& operator<< (short i);
+      LogRecord& operator<< (unsigned short i);
+      LogRecord& operator<< (int i);
+      LogRecord& operator<< (unsigned i);
+      LogRecord& operator<< (long i);
+      LogRecord& operator<< (unsigned long i);
+      LogRecord& operator<< (float d);
+      LogRecord& operator<< (double d);
+      LogRecord& operator<< (const void* p);
+
+      /// Other types are formatted immediately using their output operator.
+      template <typename T>
+      LogRecord& operator<< (const T& value)
+      {
+        std::ostringstream s;
+        s << value;
+        return *this << s.str();
+      }
+
+      void finish();
+  };
+
+  //////////////////////////////////////////////////////////////////////
+  // converts log output in binary format to text
+  //
+  class BinaryLogDecoder
+  {
+    public:
+      class Impl;
+
+    private:
+      Impl* _impl;
+
+      BinaryLogDecoder(const BinaryLogDecoder&);
+      BinaryLogDecoder& operator=(const BinaryLogDecoder&);
+
+    public:
+      explicit BinaryLogDecoder(std::istream& in);
+      ~BinaryLogDecoder();
+
+      /// Reads the next log line. Returns false at end of input.
+      bool getLine(std::string& line);
+  };
+
   //////////////////////////////////////////////////////////////////////
   //
   class LogTracer
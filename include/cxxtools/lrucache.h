@@ -29,60 +29,67 @@
 #ifndef CXXTOOLS_LRUCACHE_H
 #define CXXTOOLS_LRUCACHE_H
 
-#include <map>
-#include <limits>
+#include <cxxtools/hashtable.h>
+#include <utility>
 
 namespace cxxtools
 {
   /**
      Implements a lru cache
+
+     The elements are held in a hash table and in a list ordered by the last
+     access, so that lookup, insert and dropping the least recently used
+     element take constant time. The key type needs a Hash specialization
+     (or a hash function object as third template argument) and the
+     ==-operator. Other keys are found in an ordered index with the
+     <-operator in logarithmic time.
    */
 
-  template <typename Key, typename Value>
+  template <typename Key, typename Value, typename HashFn = Hash<Key> >
   class LruCache
   {
-      struct Data
+      struct Node
       {
-        unsigned serial;
+        Key key;
         Value value;
-        Data() { }
-        Data(unsigned serial_, const Value& value_)
-          : serial(serial_),
-            value(value_)
+        std::size_t hash;
+        Node* hashNext;
+        Node* prev;
+        Node* next;
+
+        Node(const Key& key_, const Value& value_)
+          : key(key_),
+            value(value_),
+            hash(0),
+            hashNext(0),
+            prev(0),
+            next(0)
             { }
       };
 
-      typedef std::map<Key, Data> DataType;
+      typedef HashTable<Node, Key, HashFn> DataType;
       DataType data;
+      RecencyList<Node> recency;
 
       typename DataType::size_type maxElements;
-      unsigned serial;
       unsigned hits;
       unsigned misses;
 
-      unsigned _nextSerial()
+      void _erase(Node* node)
       {
-        if (serial == std::numeric_limits<unsigned>::max())
-        {
-          for (typename DataType::iterator it = data.begin(); it != data.end(); ++it)
-            it->second.serial = 0;
-          serial = 1;
-        }
-
-        return serial++;
+        data.remove(node);
+        recency.remove(node);
+        delete node;
       }
 
-      typename DataType::iterator _getOldest()
+      void _copy(const LruCache& c)
       {
-        typename DataType::iterator foundElement = data.begin();
-
-        typename DataType::iterator it = data.begin();
-
-        for (++it; it != data.end(); ++it)
-          if (it->second.serial < foundElement->second.serial)
-            foundElement = it;
-
-        return foundElement;
+        for (Node* node = c.recency.oldest(); node; node = node->prev)
+        {
+          Node* n = new Node(node->key, node->value);
+          data.insert(n);
+          recency.pushNewest(n);
+        }
       }
 
     public:
@@ -91,11 +98,36 @@ namespace cxxtools
 
       explicit LruCache(size_type maxElements_)
         : maxElements(maxElements_),
-          serial(0),
           hits(0),
           misses(0)
         { }
 
+      LruCache(const LruCache& c)
+        : maxElements(c.maxElements),
+          hits(c.hits),
+          misses(c.misses)
+      {
+        _copy(c);
+      }
+
+      LruCache& operator= (const LruCache& c)
+      {
+        if (this != &c)
+        {
+          clear();
+          maxElements = c.maxElements;
+          hits = c.hits;
+          misses = c.misses;
+          _copy(c);
+        }
+        return *this;
+      }
+
+      ~LruCache()
+      {
+        clear();
+      }
+
       /// returns the number of elements currently in the cache
       size_type size() const        { return data.size(); }
 
@@ -106,24 +138,34 @@ namespace cxxtools
       {
         maxElements = maxElements_;
         while (data.size() > maxElements)
-          data.erase(_getOldest());
+          _erase(recency.oldest());
       }
 
       /// removes a element from the cache and returns true, if found
       bool erase(const Key& key)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
           return false;
 
-        data.erase(it);
+        _erase(node);
         return true;
       }
 
       /// clears the cache.
       void clear(bool stats = false)
       {
+        Node* node = recency.newest();
+        while (node)
+        {
+          Node* next = node->next;
+          delete node;
+          node = next;
+        }
+
         data.clear();
+        recency.clear();
+
         if (stats)
           hits = misses = 0;
       }
@@ -133,38 +175,46 @@ namespace cxxtools
       /// list.
       Value& put(const Key& key, const Value& value)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
         {
-          if (data.size() >= maxElements)
-            data.erase(_getOldest());
+          if (data.size() >= maxElements && !recency.empty())
+            _erase(recency.oldest());
 
-          it = data.insert(data.begin(),
-            typename DataType::value_type(key,
-              Data(_nextSerial(), value)));
+          node = new Node(key, value);
+          data.insert(node);
+          recency.pushNewest(node);
         }
         else
         {
           // element found
-          it->second.serial = _nextSerial();
+          recency.moveToNewest(node);
         }
 
-        return it->second.value;
+        return node->value;
       }
 
       Value* getptr(const Key& key)
       {
-        typename DataType::iterator it = data.find(key);
-        if (it == data.end())
+        Node* node = data.find(key);
+        if (node == 0)
         {
           ++misses;
           return 0;
         }
 
-        it->second.serial = _nextSerial();
+        recency.moveToNewest(node);
 
         ++hits;
-        return &it->second.value;
+        return &node->value;
+      }
+
+      /// returns a pointer to the value or 0 if not found. Unlike getptr it
+      /// neither counts a hit or miss nor changes the order of the elements.
+      const Value* peek(const Key& key) const
+      {
+        Node* node = data.find(key);
+        return node ? &node->value : 0;
       }
 
       /// returns a pair of values - a flag, if the value was found and the
@@ -64,7 +64,13 @@ namespace net
     class TcpServerImpl* _impl;
 
     public:
-      enum { INHERIT = 1, DEFER_ACCEPT = 2 };
+      /** @brief Flags for listen
+
+          REUSEPORT sets SO_REUSEPORT, so that multiple servers, e.g. one per
+          thread, can listen on the same address and the kernel distributes
+          the incoming connections between them.
+       */
+      enum { INHERIT = 1, DEFER_ACCEPT = 2, REUSEPORT = 4 };
 
       TcpServer();
 
@@ -39,10 +39,27 @@
 namespace cxxtools {
 
     class Timer;
+    class TimerWheel;
     class Selectable;
     class Application;
     class SelectorImpl;
 
+    /** @brief Counters about wakeups of a selector
+
+        A call to wake marks a wakeup as pending. Only the first call after
+        the selector processed the last wakeup needs a system call; further
+        calls are coalesced. The ratio of both counters shows how well this
+        works for an application.
+    */
+    struct WakeCounters
+    {
+        //! number of calls to wake
+        unsigned long requests;
+
+        //! number of system calls issued to wake the selector
+        unsigned long syscalls;
+    };
+
     /** @brief Reports activity on a set of devices.
 
         A Selector can be used to monitor a set of Selectables and Timers
@@ -115,6 +132,20 @@ namespace cxxtools {
             */
             void remove(Timer& timer);
 
+            /** @brief Sets the granularity of timers
+
+                Timers are kept in a timing wheel, which advances in ticks
+                of the given length. A timer fires at the end of the tick,
+                in which it expires. Coarser ticks reduce the number of
+                wakeups, when many timers expire at slightly different times.
+                The default is 1 millisecond.
+            */
+            void setTimerGranularity(const Milliseconds& granularity);
+
+            /** @brief Returns the granularity of timers
+            */
+            Milliseconds timerGranularity() const;
+
             /** @brief Wait for activity
 
                 This method will wait for activity on the registered
@@ -168,6 +199,12 @@ namespace cxxtools {
             */
             virtual void onChanged(Selectable& s) = 0;
 
+            /** @brief A Selectable in this %Selector is about to close its file descriptors
+
+                Do not throw exceptions.
+            */
+            virtual void onClose(Selectable& s);
+
             virtual bool onWait(std::size_t msecs) = 0;
 
             virtual void onWake() = 0;
@@ -180,10 +217,7 @@ namespace cxxtools {
             bool updateTimer(size_t& timeout);
 
             //! @internal
-            typedef std::multimap<Timespan, Timer*> TimerMap;
-
-            //! @internal
-            TimerMap _timers;
+            TimerWheel* _timerWheel;
 
             void* _reserved;
     };
@@ -197,6 +231,10 @@ namespace cxxtools {
 
             SelectorImpl& impl();
 
+            /** @brief Returns the counters of wakeup requests and system calls
+            */
+            WakeCounters wakeCounters() const;
+
         protected:
             void onAdd( Selectable& dev );
 
@@ -206,6 +244,8 @@ namespace cxxtools {
 
             void onChanged(Selectable&);
 
+            void onClose(Selectable&);
+
             bool onWait(std::size_t msecs = WaitInfinite);
 
             void onWake();
@@ -135,7 +135,13 @@ class CXXTOOLS_API SerializationInfo
         SerializationInfo(const SerializationInfo& si);
 
         ~SerializationInfo()
-        { _releaseValue(); }
+        {
+            _releaseValue();
+            if (_typeOwned)
+                delete _type;
+            if (_index)
+                _releaseIndex();
+        }
 
         void reserve(size_t n);
 
@@ -161,13 +167,15 @@ class CXXTOOLS_API SerializationInfo
 
         const std::string& typeName() const
         {
-            return _type;
+            return *_type;
         }
 
-        void setTypeName(const std::string& type)
-        {
-            _type = type;
-        }
+        /** @brief Sets the type name
+
+            Type names are interned in the global table of TypeNames, so
+            the node keeps just a pointer to the name.
+         */
+        void setTypeName(const std::string& type);
 
         const std::string& name() const
         {
@@ -177,6 +185,7 @@ class CXXTOOLS_API SerializationInfo
         void setName(const std::string& name)
         {
             _name = name;
+            _nameChanged();
         }
 
         /** @brief Serialization of flat data-types
@@ -262,6 +271,10 @@ class CXXTOOLS_API SerializationInfo
 
         /** @brief Deserialization of member data
 
+            Objects with many members build an index of the member names
+            on the first lookup, so that the lookup does not need to
+            compare all names.
+
             @throws SerializationError when member is not found.
         */
         const SerializationInfo& getMember(const std::string& name) const;
@@ -348,12 +361,23 @@ class CXXTOOLS_API SerializationInfo
         { _parent = &si; }
 
     private:
+        class NameIndex;
+
         SerializationInfo* _parent;
         Category _category;
+        bool _typeOwned;            // _type is not interned
         std::string _name;
-        std::string _type;
+        const std::string* _type;
+        mutable void* volatile _index;  // NameIndex of member names, built on demand
+
+        const SerializationInfo* _findMember(const std::string& name) const;
+        void _releaseIndex() const;
+        void _nameChanged();
 
         void _releaseValue();
+        void _relocate(SerializationInfo& si);
+        void _reserveNodes(size_t n);
+        void _adoptNodes();
         void _setString(const String& value);
         void _setString8(const std::string& value);
         void _setString8(const char* value);
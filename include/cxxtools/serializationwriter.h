@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_SerializationWriter_h
+#define cxxtools_SerializationWriter_h
+
+#include <cxxtools/api.h>
+#include <cxxtools/formatter.h>
+#include <cxxtools/serializationinfo.h>
+#include <cxxtools/typenames.h>
+#include <cxxtools/noncopyable.h>
+#include <vector>
+#include <list>
+#include <deque>
+#include <set>
+#include <map>
+
+namespace cxxtools
+{
+
+/**
+    @brief Serializes objects directly into a formatter.
+
+    The decomposer first converts an object into a tree of
+    SerializationInfo objects and then passes that tree to the
+    formatter. The writer skips the tree: types that define a
+    serialization operator for the writer pass their values straight
+    to the formatter.
+
+    The writer operator is defined like this:
+
+    @code
+    void operator <<= (cxxtools::SerializationWriter& w, const YourType& object)
+    {
+        w.beginObject("YourType");
+        w.addMember("intValue", object.intValue);
+        w.addMember("stringValue", object.stringValue);
+        w.finishObject();
+    }
+    @endcode
+
+    Unlike the SerializationInfo, the writer must know the type name
+    before the members are added. Types that only define the
+    SerializationInfo operator are still serialized: the writer builds
+    a SerializationInfo for just that value and formats it. The
+    SerializationInfo operator is also still needed for the rpc
+    framework, which keeps the arguments as SerializationInfo.
+
+    Standard containers and pairs are written directly only when their
+    elements are types of the library like numbers and strings. Other
+    containers are serialized with their SerializationInfo operator, so
+    that an application may define its own operator for a container of
+    its types. To write such a container directly, the application
+    defines a writer operator for it.
+ */
+class CXXTOOLS_API SerializationWriter : private NonCopyable
+{
+    public:
+        typedef Formatter::int_type int_type;
+        typedef Formatter::unsigned_type unsigned_type;
+
+        explicit SerializationWriter(Formatter& formatter)
+            : _formatter(formatter)
+            { }
+
+        Formatter& formatter()
+            { return _formatter; }
+
+        /// Returns the name of the current value.
+        const std::string& name() const
+            { return _name; }
+
+        /// Sets the name of the top level value.
+        void setName(const std::string& name)
+            { _name = name; }
+
+        void addBool(bool value);
+        void addInt(int_type value);
+        void addUnsigned(unsigned_type value);
+        void addFloat(long double value);
+        void addString(const std::string& value);
+        void addString(const String& value);
+        void addNull();
+
+        void beginObject(const std::string& type);
+
+        /// Serializes the value as a member of the current object.
+        template <typename T>
+        void addMember(const std::string& name, const T& value)
+        {
+            _formatter.beginMember(name);
+            _name = name;
+            *this <<= value;
+            _formatter.finishMember();
+        }
+
+        void finishObject()
+            { _formatter.finishObject(); }
+
+        void beginArray(const std::string& type);
+
+        /// Serializes the value as an element of the current array.
+        template <typename T>
+        void addElement(const T& value)
+        {
+            _name.clear();
+            *this <<= value;
+        }
+
+        void finishArray()
+            { _formatter.finishArray(); }
+
+        /// Formats a SerializationInfo using the name of the current value.
+        void add(const SerializationInfo& si);
+
+        /// Serializes the value with its SerializationInfo operator.
+        template <typename T>
+        void addInfo(const T& value)
+        {
+            SerializationInfo si;
+            si.setName(_name);
+            si <<= value;
+            add(si);
+        }
+
+    private:
+        Formatter& _formatter;
+        std::string _name;
+};
+
+/**
+    Serializes a type, which does not define a serialization operator for
+    the writer, using its SerializationInfo operator.
+ */
+template <typename T>
+inline void operator <<=(SerializationWriter& w, const T& value)
+{
+    w.addInfo(value);
+}
+
+
+inline void operator <<=(SerializationWriter& w, const SerializationInfo& si)
+{
+    w.add(si);
+}
+
+
+inline void operator <<=(SerializationWriter& w, bool n)
+{
+    w.addBool(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, short n)
+{
+    w.addInt(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, unsigned short n)
+{
+    w.addUnsigned(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, int n)
+{
+    w.addInt(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, unsigned int n)
+{
+    w.addUnsigned(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, long n)
+{
+    w.addInt(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, unsigned long n)
+{
+    w.addUnsigned(n);
+}
+
+
+#ifdef HAVE_LONG_LONG
+
+inline void operator <<=(SerializationWriter& w, long long n)
+{
+    w.addInt(n);
+}
+
+#endif
+
+
+#ifdef HAVE_UNSIGNED_LONG_LONG
+
+inline void operator <<=(SerializationWriter& w, unsigned long long n)
+{
+    w.addUnsigned(n);
+}
+
+#endif
+
+
+inline void operator <<=(SerializationWriter& w, float n)
+{
+    w.addFloat(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, double n)
+{
+    w.addFloat(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, const std::string& n)
+{
+    w.addString(n);
+}
+
+
+inline void operator <<=(SerializationWriter& w, const char* n)
+{
+    w.addString(std::string(n));
+}
+
+
+inline void operator <<=(SerializationWriter& w, const cxxtools::String& n)
+{
+    w.addString(n);
+}
+
+
+//! @cond internal
+
+// Types of the library, for which an application can not define a
+// SerializationInfo operator of its own. Containers of these are written
+// directly.
+template <typename T> struct WriterDirect { enum { value = false }; };
+template <typename T> struct WriterDirect<const T> { enum { value = WriterDirect<T>::value }; };
+template <> struct WriterDirect<bool> { enum { value = true }; };
+template <> struct WriterDirect<short> { enum { value = true }; };
+template <> struct WriterDirect<unsigned short> { enum { value = true }; };
+template <> struct WriterDirect<int> { enum { value = true }; };
+template <> struct WriterDirect<unsigned int> { enum { value = true }; };
+template <> struct WriterDirect<long> { enum { value = true }; };
+template <> struct WriterDirect<unsigned long> { enum { value = true }; };
+#ifdef HAVE_LONG_LONG
+template <> struct WriterDirect<long long> { enum { value = true }; };
+#endif
+#ifdef HAVE_UNSIGNED_LONG_LONG
+template <> struct WriterDirect<unsigned long long> { enum { value = true }; };
+#endif
+template <> struct WriterDirect<float> { enum { value = true }; };
+template <> struct WriterDirect<double> { enum { value = true }; };
+template <> struct WriterDirect<std::string> { enum { value = true }; };
+template <> struct WriterDirect<const char*> { enum { value = true }; };
+template <> struct WriterDirect<cxxtools::String> { enum { value = true }; };
+
+template <typename T, typename A>
+struct WriterDirect<std::vector<T, A> > { enum { value = WriterDirect<T>::value }; };
+
+template <typename T, typename A>
+struct WriterDirect<std::list<T, A> > { enum { value = WriterDirect<T>::value }; };
+
+template <typename T, typename A>
+struct WriterDirect<std::deque<T, A> > { enum { value = WriterDirect<T>::value }; };
+
+template <typename T, typename C, typename A>
+struct WriterDirect<std::set<T, C, A> > { enum { value = WriterDirect<T>::value }; };
+
+template <typename T, typename C, typename A>
+struct WriterDirect<std::multiset<T, C, A> > { enum { value = WriterDirect<T>::value }; };
+
+template <typename A, typename B>
+struct WriterDirect<std::pair<A, B> > { enum { value = WriterDirect<A>::value && WriterDirect<B>::value }; };
+
+template <typename K, typename V, typename P, typename A>
+struct WriterDirect<std::map<K, V, P, A> > { enum { value = WriterDirect<K>::value && WriterDirect<V>::value }; };
+
+template <typename K, typename V, typename P, typename A>
+struct WriterDirect<std::multimap<K, V, P, A> > { enum { value = WriterDirect<K>::value && WriterDirect<V>::value }; };
+
+template <bool direct>
+struct WriterContainer
+{
+    template <typename C>
+    static void write(SerializationWriter& w, const C& c, TypeNames::Id type)
+    {
+        w.beginArray(TypeNames::name(type));
+        for (typename C::const_iterator it = c.begin(); it != c.end(); ++it)
+            w.addElement(*it);
+        w.finishArray();
+    }
+
+    template <typename A, typename B>
+    static void write(SerializationWriter& w, const std::pair<A, B>& p)
+    {
+        w.beginObject(TypeNames::name(TypeNames::Pair));
+        w.addMember("first", p.first);
+        w.addMember("second", p.second);
+        w.finishObject();
+    }
+};
+
+template <>
+struct WriterContainer<false>
+{
+    template <typename C>
+    static void write(SerializationWriter& w, const C& c, TypeNames::Id)
+    {
+        w.addInfo(c);
+    }
+
+    template <typename A, typename B>
+    static void write(SerializationWriter& w, const std::pair<A, B>& p)
+    {
+        w.addInfo(p);
+    }
+};
+
+//! @endcond internal
+
+template <typename T, typename A>
+inline void operator <<=(SerializationWriter& w, const std::vector<T, A>& vec)
+{
+    WriterContainer<WriterDirect<T>::value>::write(w, vec, TypeNames::Array);
+}
+
+
+template <typename T, typename A>
+inline void operator <<=(SerializationWriter& w, const std::list<T, A>& list)
+{
+    WriterContainer<WriterDirect<T>::value>::write(w, list, TypeNames::List);
+}
+
+
+template <typename T, typename A>
+inline void operator <<=(SerializationWriter& w, const std::deque<T, A>& deque)
+{
+    WriterContainer<WriterDirect<T>::value>::write(w, deque, TypeNames::Deque);
+}
+
+
+template <typename T, typename C, typename A>
+inline void operator <<=(SerializationWriter& w, const std::set<T, C, A>& set)
+{
+    WriterContainer<WriterDirect<T>::value>::write(w, set, TypeNames::Set);
+}
+
+
+template <typename T, typename C, typename A>
+inline void operator <<=(SerializationWriter& w, const std::multiset<T, C, A>& multiset)
+{
+    WriterContainer<WriterDirect<T>::value>::write(w, multiset, TypeNames::Multiset);
+}
+
+
+template <typename A, typename B>
+inline void operator <<=(SerializationWriter& w, const std::pair<A, B>& p)
+{
+    WriterContainer<WriterDirect<std::pair<A, B> >::value>::write(w, p);
+}
+
+
+template <typename K, typename V, typename P, typename A>
+inline void operator <<=(SerializationWriter& w, const std::map<K, V, P, A>& map)
+{
+    WriterContainer<WriterDirect<std::map<K, V, P, A> >::value>::write(w, map, TypeNames::Map);
+}
+
+
+template <typename K, typename V, typename P, typename A>
+inline void operator <<=(SerializationWriter& w, const std::multimap<K, V, P, A>& multimap)
+{
+    WriterContainer<WriterDirect<std::multimap<K, V, P, A> >::value>::write(w, multimap, TypeNames::Multimap);
+}
+
+} // namespace cxxtools
+
+#endif
@@ -38,10 +38,18 @@
 namespace cxxtools
 {
 
+class ServiceRegistryEntry;
+
 class ServiceProcedure
 {
+        friend class ServiceRegistry;
+
+        // registry entry, which pools this instance
+        ServiceRegistryEntry* _entry;
+
     public:
         ServiceProcedure()
+        : _entry(0)
         {}
 
         virtual ~ServiceProcedure()
@@ -49,6 +57,17 @@ class ServiceProcedure
 
         virtual ServiceProcedure* clone() const = 0;
 
+        /** Prepares the instance for the next call.
+
+            The ServiceRegistry keeps released instances for later calls,
+            when this returns true. Otherwise the instance is deleted and
+            the next call gets a fresh clone. The default returns false, so
+            that state of derived classes does not leak from one call into
+            the next one.
+         */
+        virtual bool reset()
+        { return false; }
+
         virtual IComposer** beginCall() = 0;
 
         virtual IDecomposer* endCall() = 0;
@@ -100,6 +119,22 @@ class BasicServiceProcedure : public ServiceProcedure
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _v6 = V6();
+            _v7 = V7();
+            _v8 = V8();
+            _v9 = V9();
+            _v10 = V10();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -207,6 +242,21 @@ class BasicServiceProcedure<R, A1, A2, A3, A4, A5, A6, A7, A8, A9,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _v6 = V6();
+            _v7 = V7();
+            _v8 = V8();
+            _v9 = V9();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -309,6 +359,20 @@ class BasicServiceProcedure<R, A1, A2, A3, A4, A5, A6, A7, A8,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _v6 = V6();
+            _v7 = V7();
+            _v8 = V8();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -406,6 +470,19 @@ class BasicServiceProcedure<R, A1, A2, A3, A4, A5, A6, A7,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _v6 = V6();
+            _v7 = V7();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -498,6 +575,18 @@ class BasicServiceProcedure<R, A1, A2, A3, A4, A5, A6,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _v6 = V6();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -585,6 +674,17 @@ class BasicServiceProcedure<R, A1, A2, A3, A4, A5,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _v5 = V5();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -667,6 +767,16 @@ class BasicServiceProcedure<R, A1, A2, A3, A4,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _v4 = V4();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -744,6 +854,15 @@ class BasicServiceProcedure<R, A1, A2, A3,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _v3 = V3();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -816,6 +935,14 @@ class BasicServiceProcedure<R, A1, A2,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _v2 = V2();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -883,6 +1010,13 @@ class BasicServiceProcedure<R, A1,
             return new BasicServiceProcedure(*_cb);
         }
 
+        bool reset()
+        {
+            _v1 = V1();
+            _rv = RV();
+            return true;
+        }
+
         IComposer** beginCall()
         {
             _a1.begin(_v1);
@@ -945,9 +1079,14 @@ class BasicServiceProcedure<R,
             return new BasicServiceProcedure(*_cb);
         }
 
-        IComposer** beginCall()
+        bool reset()
         {
+            _rv = RV();
+            return true;
+        }
 
+        IComposer** beginCall()
+        {
             return _args;
         }
 
@@ -34,7 +34,6 @@
 #include <cxxtools/callable.h>
 #include <string>
 #include <vector>
-#include <map>
 
 namespace cxxtools
 {
@@ -45,6 +44,7 @@ namespace cxxtools
 
         public:
             ServiceRegistry()
+            : _size(0)
             { }
 
             ~ServiceRegistry();
@@ -280,6 +280,14 @@ namespace cxxtools
                 this->registerProcedure(name, proc);
             }
 
+            /** @brief Returns a procedure instance for a call or 0 if there is no such procedure
+
+                The instance is taken from a pool if possible and must be
+                returned with releaseProcedure, so that a repeated call of
+                the same procedure does not allocate a new instance. Only
+                instances, which accept ServiceProcedure::reset, are pooled;
+                the others are cloned for each call.
+             */
             ServiceProcedure* getProcedure(const std::string& name) const;
 
             void releaseProcedure(ServiceProcedure* proc) const;
@@ -290,8 +298,12 @@ namespace cxxtools
             void registerProcedure(const std::string& name, ServiceProcedure* proc);
 
         private:
-            typedef std::map<std::string, ServiceProcedure*> ProcedureMap;
-            ProcedureMap _procedures;
+            ServiceRegistryEntry* findEntry(const std::string& name, unsigned hash) const;
+            void rehash(std::size_t size);
+
+            // hash table of registered procedures with separate chaining
+            std::vector<ServiceRegistryEntry*> _buckets;
+            std::size_t _size;
     };
 
 }
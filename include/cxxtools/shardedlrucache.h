@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_SHARDEDLRUCACHE_H
+#define CXXTOOLS_SHARDEDLRUCACHE_H
+
+#include <cxxtools/lrucache.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/atomicity.h>
+#include <cxxtools/noncopyable.h>
+#include <vector>
+
+namespace cxxtools
+{
+  /**
+     Implements a thread safe lru cache.
+
+     The cache is split into shards. Each shard is an independent LruCache
+     with its own lock and a fraction of the maximum number of elements. The
+     shard of a key is selected by its hash, so threads accessing different
+     keys rarely wait for each other. The least recently used element is
+     dropped per shard, not globally.
+
+     Keys without a hash function (see Hash) can't be distributed, so the
+     cache uses a single shard with the full number of elements for them.
+     Pass a hash function object as HashFn to get more shards.
+
+     By default a lookup takes the write lock of the shard, since a hit
+     changes the order of the elements. When a sampling rate n is passed to
+     the constructor, lookups take a read lock only and just every n-th hit
+     of a shard updates the order under the write lock. The cache is then an
+     approximation of lru, but concurrent readers of a shard do not block
+     each other.
+
+     The interface is the same as of LruCache, so code can switch by type,
+     except that there is no getptr. A pointer into a shard would be left
+     dangling, when another thread drops the element, so values are only
+     returned by copy.
+   */
+  template <typename Key, typename Value, typename HashFn = Hash<Key> >
+  class ShardedLruCache : private NonCopyable
+  {
+    public:
+      typedef typename LruCache<Key, Value, HashFn>::size_type size_type;
+      typedef Value value_type;
+
+    private:
+      struct Shard
+      {
+        LruCache<Key, Value, HashFn> cache;
+        ReadWriteMutex mutex;
+
+        // statistics of lookups, which took the read lock only
+        volatile atomic_t hits;
+        volatile atomic_t misses;
+        volatile atomic_t samples;
+
+        explicit Shard(size_type maxElements)
+          : cache(maxElements),
+            hits(0),
+            misses(0),
+            samples(0)
+            { }
+      };
+
+      std::vector<Shard*> _shards;
+      HashFn _hashFn;
+      unsigned _sampling;
+
+      Shard& _shard(const Key& key) const
+      {
+        // use other bits than the bucket selection of the shard's hash table
+        std::size_t h = _hashFn(key);
+        h = (h >> 16) ^ (h * 0x9e3779b1);
+        return *_shards[h % _shards.size()];
+      }
+
+      static size_type _shardSize(size_type maxElements, size_type shards)
+      { return (maxElements + shards - 1) / shards; }
+
+      // Looks up a value. The shard stays locked by one of the passed locks,
+      // so that the value can be copied safely.
+      Value* _lookup(Shard& shard, const Key& key, ReadLock& readLock, WriteLock& writeLock)
+      {
+        if (_sampling > 0)
+        {
+          readLock.lock();
+
+          const Value* v = shard.cache.peek(key);
+          if (v == 0)
+          {
+            atomicIncrement(shard.misses);
+            return 0;
+          }
+
+          if (atomicIncrement(shard.samples) % _sampling != 0)
+          {
+            atomicIncrement(shard.hits);
+            return const_cast<Value*>(v);
+          }
+
+          readLock.unlock();
+        }
+
+        writeLock.lock();
+        return shard.cache.getptr(key);
+      }
+
+    public:
+      /// Creates a cache with the number of shards. A sampling rate greater
+      /// than 0 enables lookups under the read lock (see class description).
+      explicit ShardedLruCache(size_type maxElements, unsigned shards = 16, unsigned sampling = 0)
+        : _sampling(sampling)
+      {
+        if (shards == 0 || IsOrderedHash<HashFn>::value)
+          shards = 1;
+
+        _shards.reserve(shards);
+        for (unsigned n = 0; n < shards; ++n)
+          _shards.push_back(new Shard(_shardSize(maxElements, shards)));
+      }
+
+      ~ShardedLruCache()
+      {
+        for (typename std::vector<Shard*>::iterator it = _shards.begin(); it != _shards.end(); ++it)
+          delete *it;
+      }
+
+      /// returns the number of shards
+      unsigned shards() const   { return _shards.size(); }
+
+      /// returns the number of elements currently in the cache
+      size_type size() const
+      {
+        size_type s = 0;
+        for (typename std::vector<Shard*>::const_iterator it = _shards.begin(); it != _shards.end(); ++it)
+        {
+          ReadLock lock((*it)->mutex);
+          s += (*it)->cache.size();
+        }
+        return s;
+      }
+
+      /// returns the maximum number of elements in the cache
+      size_type getMaxElements() const
+      {
+        ReadLock lock(_shards[0]->mutex);
+        return _shards[0]->cache.getMaxElements() * _shards.size();
+      }
+
+      void setMaxElements(size_type maxElements)
+      {
+        for (typename std::vector<Shard*>::iterator it = _shards.begin(); it != _shards.end(); ++it)
+        {
+          WriteLock lock((*it)->mutex);
+          (*it)->cache.setMaxElements(_shardSize(maxElements, _shards.size()));
+        }
+      }
+
+      /// removes a element from the cache and returns true, if found
+      bool erase(const Key& key)
+      {
+        Shard& shard = _shard(key);
+        WriteLock lock(shard.mutex);
+        return shard.cache.erase(key);
+      }
+
+      /// clears the cache.
+      void clear(bool stats = false)
+      {
+        for (typename std::vector<Shard*>::iterator it = _shards.begin(); it != _shards.end(); ++it)
+        {
+          WriteLock lock((*it)->mutex);
+          (*it)->cache.clear(stats);
+          if (stats)
+          {
+            atomicSet((*it)->hits, 0);
+            atomicSet((*it)->misses, 0);
+          }
+        }
+      }
+
+      /// puts a new element in the cache and returns a copy of the cached value.
+      /// If the element is already found in the cache, it is considered a cache
+      /// hit and pushed to the top of the list of its shard.
+      Value put(const Key& key, const Value& value)
+      {
+        Shard& shard = _shard(key);
+        WriteLock lock(shard.mutex);
+        return shard.cache.put(key, value);
+      }
+
+      /// returns a pair of values - a flag, if the value was found and the
+      /// value if found or the passed default otherwise.
+      std::pair<bool, Value> getx(const Key& key, Value def = Value())
+      {
+        Shard& shard = _shard(key);
+        ReadLock readLock(shard.mutex, false);
+        WriteLock writeLock(shard.mutex, false);
+        Value* v = _lookup(shard, key, readLock, writeLock);
+        return v ? std::pair<bool, Value>(true, *v)
+                 : std::pair<bool, Value>(false, def);
+      }
+
+      /// returns the value to a key or the passed default value if not found.
+      Value get(const Key& key, Value def = Value())
+      {
+        return getx(key, def).second;
+      }
+
+      /// returns the number of hits of a shard.
+      unsigned getHits(unsigned shard) const
+      {
+        Shard& s = *_shards[shard];
+        ReadLock lock(s.mutex);
+        return s.cache.getHits() + static_cast<unsigned>(atomicGet(s.hits));
+      }
+
+      /// returns the number of misses of a shard.
+      unsigned getMisses(unsigned shard) const
+      {
+        Shard& s = *_shards[shard];
+        ReadLock lock(s.mutex);
+        return s.cache.getMisses() + static_cast<unsigned>(atomicGet(s.misses));
+      }
+
+      /// returns the number of hits.
+      unsigned getHits() const
+      {
+        unsigned h = 0;
+        for (unsigned n = 0; n < _shards.size(); ++n)
+          h += getHits(n);
+        return h;
+      }
+
+      /// returns the number of misses.
+      unsigned getMisses() const
+      {
+        unsigned m = 0;
+        for (unsigned n = 0; n < _shards.size(); ++n)
+          m += getMisses(n);
+        return m;
+      }
+
+      /// returns the cache hit ratio between 0 and 1.
+      double hitRatio() const
+      {
+        unsigned hits = getHits();
+        unsigned misses = getMisses();
+        return hits+misses > 0 ? static_cast<double>(hits)/static_cast<double>(hits+misses) : 0;
+      }
+
+      /// returns the ratio, between held elements and maximum elements.
+      double fillfactor() const   { return static_cast<double>(size()) / static_cast<double>(getMaxElements()); }
+  };
+
+}
+
+#endif // CXXTOOLS_SHARDEDLRUCACHE_H
@@ -30,14 +30,41 @@
 #define CXXTOOLS_THREADPOOL_H
 
 #include <cxxtools/callable.h>
+#include <new>
 
 namespace cxxtools
 {
-    class ThreadPoolImpl;
+    class ThreadPoolImplBase;
 
     class ThreadPool
     {
         public:
+            /** @brief Scheduling strategy of the pool.
+
+                In \a SharedQueue mode all threads take their tasks from one
+                common queue.
+
+                In \a WorkStealing mode every thread has its own deque of
+                tasks. Tasks scheduled from a pool thread are pushed to the
+                deque of that thread and are processed last in first out,
+                which keeps recursive fork/join work cache local. Tasks
+                scheduled from other threads go to a global injector queue.
+                Idle threads take tasks from the injector or steal the oldest
+                task of another thread.
+             */
+            enum Mode {
+                SharedQueue,
+                WorkStealing
+            };
+
+            /** @brief Size of callables, which are stored without a heap allocation.
+
+                In \a WorkStealing mode callables up to this size, which are
+                passed to the template version of schedule from a pool thread,
+                are copied into pooled task objects instead of being cloned.
+             */
+            enum { InlineTaskSize = 48 };
+
             /** @brief Creates a thread pool structure.
 
                 When the argument \a doStart is set to true (which is the
@@ -45,6 +72,10 @@ namespace cxxtools
              */
             explicit ThreadPool(unsigned size, bool doStart = true);
 
+            /** @brief Creates a thread pool structure with the given scheduling mode.
+             */
+            ThreadPool(unsigned size, Mode mode, bool doStart = true);
+
             /** @brief Destroys a thread pool structure.
 
                 Before destruction all jobs are processed and the threads are
@@ -70,6 +101,41 @@ namespace cxxtools
              */
             void schedule(const Callable<void>& cb);
 
+            /** @brief Schedules a task to be processed.
+
+                Same as schedule(const Callable<void>&) but in \a WorkStealing
+                mode small callables scheduled by a running task are copied
+                into preallocated task storage, so that scheduling does not
+                need to allocate memory.
+             */
+            template <typename CallableType>
+            void schedule(const CallableType& cb)
+            {
+                void* p = sizeof(CallableType) <= InlineTaskSize ? _allocTask() : 0;
+                if (p)
+                {
+                    Callable<void>* task;
+                    try
+                    {
+                        task = new (p) CallableType(cb);
+                    }
+                    catch (...)
+                    {
+                        _freeTask(p);
+                        throw;
+                    }
+
+                    _scheduleTask(p, task);
+                }
+                else
+                    schedule(static_cast<const Callable<void>&>(cb));
+            }
+
+            /** @brief Returns the scheduling mode of the pool.
+             */
+            Mode mode() const
+            { return _mode; }
+
             /** @brief Returns true, if the threadpool is in running state.
              */
             bool running() const;
@@ -79,7 +145,12 @@ namespace cxxtools
             bool stopped() const;
 
         private:
-            ThreadPoolImpl* _impl;
+            void* _allocTask();
+            void _scheduleTask(void* p, Callable<void>* cb);
+            void _freeTask(void* p);
+
+            ThreadPoolImplBase* _impl;
+            Mode _mode;
     };
 }
 
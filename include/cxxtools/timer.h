@@ -36,6 +36,7 @@ namespace cxxtools {
 
     class DateTime;
     class SelectorBase;
+    class TimerWheel;
 
     /** @brief Notifies clients in constant intervals
 
@@ -72,6 +73,7 @@ namespace cxxtools {
     class CXXTOOLS_API Timer
     {
         class Sentry;
+        friend class TimerWheel;
 
         public:
             /** @brief Default constructor
@@ -180,6 +182,11 @@ namespace cxxtools {
             Timespan      _interval;
             Timespan      _finished;
             bool          _once;
+
+            // links of the timer wheel of the selector
+            Timer*        _prevTimer;
+            Timer*        _nextTimer;
+            int           _timerSlot;
     };
 
 }
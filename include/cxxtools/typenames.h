@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_TypeNames_h
+#define cxxtools_TypeNames_h
+
+#include <cxxtools/api.h>
+#include <string>
+
+namespace cxxtools
+{
+
+/**
+    @brief Global table of interned type names for the serialization.
+
+    The serialization passes the same few type names for millions of
+    values. The table keeps one copy of each name, so that
+    SerializationInfo nodes store only a pointer. Formatters map the
+    predefined names to an Id by checking the address of the string,
+    without comparing strings.
+
+    All methods are thread safe.
+ */
+class CXXTOOLS_API TypeNames
+{
+    public:
+        enum Id
+        {
+            Empty,
+            Bool,
+            Char,
+            String,
+            Int,
+            Double,
+            Null,
+            Pair,
+            Array,
+            List,
+            Deque,
+            Set,
+            Multiset,
+            Map,
+            Multimap,
+            Other
+        };
+
+        /// Returns the predefined name of the id. The id must not be Other.
+        static const std::string& name(Id id);
+
+        /// Returns the id of a type name or Other if it is not predefined.
+        static Id id(const std::string& type);
+
+        /**
+            Returns the interned copy of the type name.
+
+            Since interned names are never released, the number of names,
+            which are not predefined, is limited. When the table is full,
+            0 is returned.
+         */
+        static const std::string* intern(const std::string& type);
+};
+
+}
+
+#endif
@@ -30,6 +30,7 @@
 
 #include <cxxtools/xml/xmlformatter.h>
 #include <cxxtools/decomposer.h>
+#include <cxxtools/serializationwriter.h>
 #include <sstream>
 
 namespace cxxtools
@@ -143,10 +144,9 @@ class XmlSerializer
         template <typename T>
         void serialize(const T& type, const std::string& name)
         {
-            Decomposer<T> decomposer;
-            decomposer.begin(type);
-            decomposer.setName(name);
-            decomposer.format(_formatter);
+            SerializationWriter w(_formatter);
+            w.setName(name);
+            w <<= type;
             _formatter.finish();
             _formatter.flush();
         }
@@ -41,6 +41,11 @@ namespace net
     class Uri;
 }
 
+namespace http
+{
+    class ConnectionPool;
+}
+
 namespace xmlrpc
 {
 
@@ -95,6 +100,11 @@ class CXXTOOLS_XMLRPC_API HttpClient : public Client
 
         void clearAuth();
 
+        /// Takes connections from the passed pool; see http::Client::setConnectionPool.
+        void setConnectionPool(http::ConnectionPool& pool);
+
+        void clearConnectionPool();
+
         void setSelector(SelectorBase& selector);
 
         void wait(Milliseconds msecs = WaitInfinite);
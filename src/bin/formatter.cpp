@@ -30,6 +30,7 @@
 #include <cxxtools/bin/serializer.h>
 #include <cxxtools/utf8codec.h>
 #include <cxxtools/convert.h>
+#include <cxxtools/typenames.h>
 #include <cxxtools/log.h>
 #include <limits>
 #include <stdint.h>
@@ -46,36 +47,29 @@ namespace
 {
     void printTypeCode(std::ostream& out, const std::string& type, bool plain)
     {
-        if (type.empty())
-            out << static_cast<char>(plain ? Serializer::TypePlainEmpty : Serializer::TypeEmpty);
-        else if (type == "bool")
-            out << static_cast<char>(plain ? Serializer::TypePlainBool : Serializer::TypeBool);
-        else if (type == "char")
-            out << static_cast<char>(plain ? Serializer::TypePlainChar : Serializer::TypeChar);
-        else if (type == "string")
-            out << static_cast<char>(plain ? Serializer::TypePlainString : Serializer::TypeString);
-        else if (type == "int")
-            out << static_cast<char>(plain ? Serializer::TypePlainInt : Serializer::TypeInt);
-        else if (type == "double")
-            out << static_cast<char>(plain ? Serializer::TypePlainBcdFloat : Serializer::TypeBcdFloat);
-        else if (type == "pair")
-            out << static_cast<char>(plain ? Serializer::TypePlainPair : Serializer::TypePair);
-        else if (type == "array")
-            out << static_cast<char>(plain ? Serializer::TypePlainArray : Serializer::TypeArray);
-        else if (type == "list")
-            out << static_cast<char>(plain ? Serializer::TypePlainList : Serializer::TypeList);
-        else if (type == "deque")
-            out << static_cast<char>(plain ? Serializer::TypePlainDeque : Serializer::TypeDeque);
-        else if (type == "set")
-            out << static_cast<char>(plain ? Serializer::TypePlainSet : Serializer::TypeSet);
-        else if (type == "multiset")
-            out << static_cast<char>(plain ? Serializer::TypePlainMultiset : Serializer::TypeMultiset);
-        else if (type == "map")
-            out << static_cast<char>(plain ? Serializer::TypePlainMap : Serializer::TypeMap);
-        else if (type == "multimap")
-            out << static_cast<char>(plain ? Serializer::TypePlainMultimap : Serializer::TypeMultimap);
-        else
+        static const Serializer::TypeCode codes[TypeNames::Other][2] = {
+            { Serializer::TypeEmpty, Serializer::TypePlainEmpty },          // Empty
+            { Serializer::TypeBool, Serializer::TypePlainBool },            // Bool
+            { Serializer::TypeChar, Serializer::TypePlainChar },            // Char
+            { Serializer::TypeString, Serializer::TypePlainString },        // String
+            { Serializer::TypeInt, Serializer::TypePlainInt },              // Int
+            { Serializer::TypeBcdFloat, Serializer::TypePlainBcdFloat },    // Double
+            { Serializer::TypeOther, Serializer::TypePlainOther },          // Null
+            { Serializer::TypePair, Serializer::TypePlainPair },            // Pair
+            { Serializer::TypeArray, Serializer::TypePlainArray },          // Array
+            { Serializer::TypeList, Serializer::TypePlainList },            // List
+            { Serializer::TypeDeque, Serializer::TypePlainDeque },          // Deque
+            { Serializer::TypeSet, Serializer::TypePlainSet },              // Set
+            { Serializer::TypeMultiset, Serializer::TypePlainMultiset },    // Multiset
+            { Serializer::TypeMap, Serializer::TypePlainMap },              // Map
+            { Serializer::TypeMultimap, Serializer::TypePlainMultimap }     // Multimap
+        };
+
+        TypeNames::Id id = TypeNames::id(type);
+        if (id == TypeNames::Other || id == TypeNames::Null)
             out << static_cast<char>(plain ? Serializer::TypePlainOther : Serializer::TypeOther) << type << '\0';
+        else
+            out << static_cast<char>(codes[id][plain]);
     }
 
     void printUInt(std::ostream& out, uint64_t v, const std::string& name)
@@ -215,8 +209,9 @@ void Formatter::addValueString(const std::string& name, const std::string& type,
     log_trace("addValueString(\"" << name << "\", \"" << type << "\", \"" << value << "\")");
 
     bool plain = name.empty();
+    TypeNames::Id id = TypeNames::id(type);
 
-    if (type == "int")
+    if (id == TypeNames::Int)
     {
         if (value.size() > 0 && (value[0] == L'-' || value[0] == L'+'))
         {
@@ -229,7 +224,7 @@ void Formatter::addValueString(const std::string& name, const std::string& type,
             printUInt(*_out, v, name);
         }
     }
-    else if (type == "double")
+    else if (id == TypeNames::Double)
     {
         static const char d[257] = "                " // 00-0f
                                    "                " // 10-1f
@@ -288,7 +283,7 @@ void Formatter::addValueString(const std::string& name, const std::string& type,
 
         *_out << '\xff';
     }
-    else if (type == "bool")
+    else if (id == TypeNames::Bool)
     {
         *_out << static_cast<char>(plain ? Serializer::TypePlainBool : Serializer::TypeBool);
 
@@ -317,8 +312,9 @@ void Formatter::addValueStdString(const std::string& name, const std::string& ty
     log_trace("addValueStdString(\"" << name << "\", \"" << type << "\", \"" << value << "\")");
 
     bool plain = name.empty();
+    TypeNames::Id id = TypeNames::id(type);
 
-    if (type == "int")
+    if (id == TypeNames::Int)
     {
         if (value.size() > 0 && (value[0] == L'-' || value[0] == L'+'))
         {
@@ -331,7 +327,7 @@ void Formatter::addValueStdString(const std::string& name, const std::string& ty
             printUInt(*_out, v, name);
         }
     }
-    else if (type == "double")
+    else if (id == TypeNames::Double)
     {
         static const char d[257] = "                " // 00-0f
                                    "                " // 10-1f
@@ -391,7 +387,7 @@ void Formatter::addValueStdString(const std::string& name, const std::string& ty
         *_out << '\xff';
 
     }
-    else if (type == "bool")
+    else if (id == TypeNames::Bool)
     {
         *_out << static_cast<char>(plain ? Serializer::TypePlainBool : Serializer::TypeBool);
 
@@ -67,7 +67,7 @@ bool ConditionImpl::wait(Mutex& mtx, const Timespan& ts)
     struct timespec tv;
 
     tv.tv_sec = tt.totalUSecs() / 1000000;
-    tv.tv_nsec = tt.totalUSecs() % 1000000;
+    tv.tv_nsec = tt.totalUSecs() % 1000000 * 1000;
 
     do
     {
@@ -27,15 +27,18 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include "selectorimpl.h"
+#include "eventqueue.h"
 #include "cxxtools/eventloop.h"
 
 namespace cxxtools {
 
 EventLoop::EventLoop()
 : _exitLoop(false)
-, _allocator(/*255, 64*/)
+, _selector(0)
+, _eventQueue(0)
 {
     _selector = new SelectorImpl();
+    _eventQueue = new EventQueue();
 }
 
 
@@ -43,12 +46,7 @@ EventLoop::~EventLoop()
 {
     try
     {
-        while ( ! _eventQueue.empty() )
-        {
-            Event* ev = _eventQueue.front();
-            _eventQueue.pop_front();
-            ev->destroy(_allocator);
-        }
+        delete _eventQueue;
     }
     catch(...)
     {}
@@ -71,6 +69,7 @@ void EventLoop::onRemove( Selectable& s )
 
 void EventLoop::onReinit(Selectable& s)
 {
+    _selector->reinit(s);
 }
 
 
@@ -80,6 +79,12 @@ void EventLoop::onChanged(Selectable& s)
 }
 
 
+void EventLoop::onClose(Selectable& s)
+{
+    _selector->closing(s);
+}
+
+
 void EventLoop::onRun()
 {
     while( true )
@@ -92,14 +97,10 @@ void EventLoop::onRun()
             break;
         }
 
-        if( !_eventQueue.empty() )
-        {
-            lock.unlock();
-            this->processEvents();
-        }
-
         lock.unlock();
 
+        this->processEvents();
+
         bool active = this->wait( this->idleTimeout() );
         if( ! active )
             timeout.send();
@@ -113,14 +114,9 @@ bool EventLoop::onWait(std::size_t msecs)
 {
     if( _selector->wait(msecs) )
     {
-        RecursiveLock lock(_queueMutex);
-
-        if( !_eventQueue.empty() )
-        {
-            lock.unlock();
-            this->processEvents();
-        }
-
+        // the queue requests a wakeup only for the first event of a batch,
+        // so it is always drained after a wakeup
+        this->processEvents();
         return true;
     }
 
@@ -128,6 +124,12 @@ bool EventLoop::onWait(std::size_t msecs)
 }
 
 
+WakeCounters EventLoop::wakeCounters() const
+{
+    return _selector->wakeCounters();
+}
+
+
 void EventLoop::onWake()
 {
     _selector->wake();
@@ -146,52 +148,33 @@ void EventLoop::onExit()
 
 void EventLoop::onCommitEvent(const Event& ev)
 {
-    {
-        RecursiveLock lock( _queueMutex );
-
-        // TODO: use a continuous block of memory to store events
-        // this avoids new/delete
-        Event& clonedEvent = ev.clone(_allocator);
-
-        try
-        {
-            _eventQueue.push_back(&clonedEvent);
-        }
-        catch(...)
-        {
-            clonedEvent.destroy(_allocator);
-            throw;
-        }
-    }
-
-    this->wake();
+    if (_eventQueue->commit(ev))
+        this->wake();
 }
 
 
 void EventLoop::onProcessEvents()
 {
+    _eventQueue->resetWakeup();
+
     while( false == _exitLoop )
     {
-        RecursiveLock lock(_queueMutex);
-
-        if ( _eventQueue.empty() || _exitLoop )
+        bool inArena;
+        Event* ev = _eventQueue->pop(inArena);
+        if (ev == 0)
             break;
 
-        Event* ev = _eventQueue.front();
-        _eventQueue.pop_front();
-
         try
         {
-            lock.unlock();
             event.send(*ev);
         }
         catch(...)
         {
-            ev->destroy(_allocator);
+            _eventQueue->release(ev, inArena);
             throw;
         }
 
-        ev->destroy(_allocator);
+        _eventQueue->release(ev, inArena);
     }
 }
 
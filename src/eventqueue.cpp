@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "eventqueue.h"
+#include "cxxtools/event.h"
+#include "cxxtools/allocator.h"
+#include "cxxtools/thread.h"
+#include <cxxtools/membar.h>
+#include <stdexcept>
+#include <cstring>
+
+namespace cxxtools
+{
+
+namespace
+{
+    enum RecordKind
+    {
+        Writing = 0,
+        InArena = 1,
+        OnHeap = 2,
+        Skip = 3
+    };
+
+    const std::size_t HeaderSize = 16;
+
+    inline std::size_t align(std::size_t size)
+    { return (size + 15) & ~std::size_t(15); }
+
+    // destroys events in the arena without releasing memory
+    class ArenaAllocator : public Allocator
+    {
+        public:
+            void deallocate(void*, std::size_t)
+            { }
+    };
+
+    ArenaAllocator arenaAllocator;
+    Allocator heapAllocator;
+}
+
+struct EventQueue::Segment
+{
+    atomic_t reserved;              // bytes reserved by producers; may exceed the size
+    atomic_t users;                 // producers working in this segment
+    Segment* volatile next;
+    volatile unsigned generation;   // incremented on reuse to invalidate old records
+    Segment* freeNext;
+    Segment* chain;
+    char* data;
+};
+
+struct EventQueue::Record
+{
+    volatile unsigned state;        // generation << 2 | RecordKind
+    unsigned size;
+    Event* event;
+};
+
+////////////////////////////////////////////////////////////////////////
+// EventQueue::Writer
+//
+// Allocator passed to Event::clone. It reserves the record, when the event
+// requests its memory.
+//
+class EventQueue::Writer : public Allocator
+{
+        EventQueue& _queue;
+        Segment* _segment;
+        Record* _record;
+        unsigned _generation;
+        void* _heap;
+
+    public:
+        explicit Writer(EventQueue& queue)
+            : _queue(queue),
+              _segment(0),
+              _record(0),
+              _generation(0),
+              _heap(0)
+        { }
+
+        void* allocate(std::size_t size)
+        {
+            if (_record)
+                throw std::logic_error("event allocates memory more than once");
+
+            std::size_t need = HeaderSize;
+            if (size <= _queue._segmentSize / 8)
+                need += align(size);
+
+            _record = _queue.reserve(need, _segment);
+            _generation = _segment->generation;
+            _record->size = need;
+
+            if (need > HeaderSize)
+                return reinterpret_cast<char*>(_record) + HeaderSize;
+
+            _heap = Allocator::allocate(size);
+            return _heap;
+        }
+
+        void publish(Event* ev)
+        {
+            if (_record == 0)
+            {
+                // the event does not use the allocator; keep a reference to it
+                _record = _queue.reserve(HeaderSize, _segment);
+                _generation = _segment->generation;
+                _record->size = HeaderSize;
+                _heap = ev;
+            }
+
+            _record->event = ev;
+            finish(_heap ? OnHeap : InArena);
+        }
+
+        void abort()
+        {
+            if (_record == 0)
+                return;
+
+            if (_heap)
+                Allocator::deallocate(_heap, 0);
+
+            finish(Skip);
+        }
+
+    private:
+        void finish(RecordKind kind)
+        {
+            membar_write();
+            _record->state = (_generation << 2) | kind;
+            atomicDecrement(_segment->users);
+        }
+};
+
+////////////////////////////////////////////////////////////////////////
+// EventQueue
+//
+EventQueue::EventQueue(std::size_t segmentSize)
+    : _segmentSize(align(segmentSize < 1024 ? 1024 : segmentSize)),
+      _free(0),
+      _wakeup(0),
+      _headPos(0),
+      _delivering(0),
+      _segments(0)
+{
+    _head = newSegment();
+    _tail = _head;
+}
+
+
+EventQueue::~EventQueue()
+{
+    bool inArena;
+    while (Event* ev = pop(inArena))
+        release(ev, inArena);
+
+    while (_segments)
+    {
+        Segment* s = _segments;
+        _segments = s->chain;
+        delete[] s->data;
+        delete s;
+    }
+}
+
+
+bool EventQueue::commit(const Event& ev)
+{
+    Writer writer(*this);
+
+    Event* clonedEvent;
+    try
+    {
+        clonedEvent = &ev.clone(writer);
+    }
+    catch (...)
+    {
+        writer.abort();
+        throw;
+    }
+
+    writer.publish(clonedEvent);
+
+    return atomicExchange(_wakeup, 1) == 0;
+}
+
+
+Event* EventQueue::pop(bool& inArena)
+{
+    while (true)
+    {
+        Segment* s = _head;
+
+        if (_headPos < _segmentSize)
+        {
+            if (static_cast<std::size_t>(atomicGet(s->reserved)) <= _headPos)
+                return 0;
+
+            Record* r = reinterpret_cast<Record*>(s->data + _headPos);
+            unsigned state = r->state;
+            if ((state & 3) == Writing || (state & ~3u) != (s->generation << 2))
+                return 0;  // reserved but not ready yet
+
+            membar_read();
+            _headPos += r->size;
+
+            if ((state & 3) == Skip)
+                continue;
+
+            inArena = (state & 3) == InArena;
+            ++_delivering;
+            return r->event;
+        }
+
+        // the segment is consumed; move on when the next one is linked
+        Segment* next = s->next;
+        if (next == 0)
+            return 0;
+
+        membar_read();
+        _head = next;
+        _headPos = 0;
+        retire(s);
+    }
+}
+
+
+void EventQueue::release(Event* ev, bool inArena)
+{
+    --_delivering;
+
+    ev->destroy(inArena ? static_cast<Allocator&>(arenaAllocator) : heapAllocator);
+
+    if (_delivering == 0 && !_retired.empty())
+        recycle();
+}
+
+
+EventQueue::Segment* EventQueue::newSegment()
+{
+    Segment* s = new Segment();
+    s->reserved = 0;
+    s->users = 0;
+    s->next = 0;
+    s->generation = 1;
+    s->freeNext = 0;
+    s->data = new char[_segmentSize];
+
+    // a zero state marks a record as not written yet
+    std::memset(s->data, 0, _segmentSize);
+
+    // segments are created by one producer at a time (or the constructor)
+    s->chain = _segments;
+    _segments = s;
+
+    return s;
+}
+
+
+EventQueue::Segment* EventQueue::takeFreeSegment()
+{
+    // only the producer, which overflows the current segment, pops, so
+    // there is no ABA problem
+    while (true)
+    {
+        Segment* top = static_cast<Segment*>(_free);
+        if (top == 0)
+            return newSegment();
+
+        if (atomicCompareExchange(_free, top->freeNext, top) == top)
+            return top;
+    }
+}
+
+
+EventQueue::Record* EventQueue::reserve(std::size_t size, Segment*& segment)
+{
+    while (true)
+    {
+        Segment* s = static_cast<Segment*>(_tail);
+
+        // announce the use of the segment, so that it is not reused meanwhile
+        atomicIncrement(s->users);
+        if (s != _tail)
+        {
+            atomicDecrement(s->users);
+            continue;
+        }
+
+        std::size_t pos = static_cast<std::size_t>(atomicExchangeAdd(s->reserved, size));
+        if (pos + size <= _segmentSize)
+        {
+            segment = s;
+            return reinterpret_cast<Record*>(s->data + pos);
+        }
+
+        if (pos <= _segmentSize)
+        {
+            // this producer overflows the segment: mark the unused rest and link the next segment
+            if (pos < _segmentSize)
+            {
+                Record* r = reinterpret_cast<Record*>(s->data + pos);
+                r->size = _segmentSize - pos;
+                membar_write();
+                r->state = (s->generation << 2) | Skip;
+            }
+
+            Segment* next = takeFreeSegment();
+            membar_write();
+            s->next = next;
+            _tail = next;
+        }
+        else
+        {
+            while (s->next == 0)
+                Thread::yield();
+        }
+
+        atomicDecrement(s->users);
+    }
+}
+
+
+void EventQueue::retire(Segment* segment)
+{
+    _retired.push_back(segment);
+    if (_delivering == 0)
+        recycle();
+}
+
+
+void EventQueue::recycle()
+{
+    // Events of retired segments may be in delivery and producers may still
+    // hold a pointer to them, so they are reused only when both are finished.
+    std::vector<Segment*>::iterator out = _retired.begin();
+    for (std::vector<Segment*>::iterator it = _retired.begin(); it != _retired.end(); ++it)
+    {
+        Segment* s = *it;
+
+        membar_rw();
+        if (s == _tail || atomicGet(s->users) != 0)
+        {
+            *out++ = s;
+            continue;
+        }
+
+        // Clear the old records and payload, so that no leftover bytes at
+        // the position of a new record look like a ready state.
+        std::memset(s->data, 0, _segmentSize);
+        s->reserved = 0;
+        s->next = 0;
+        ++s->generation;
+        membar_write();
+
+        while (true)
+        {
+            Segment* top = static_cast<Segment*>(_free);
+            s->freeNext = top;
+            if (atomicCompareExchange(_free, s, top) == top)
+                break;
+        }
+    }
+
+    _retired.erase(out, _retired.end());
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CXXTOOLS_EVENTQUEUE_H
+#define CXXTOOLS_EVENTQUEUE_H
+
+#include <cxxtools/atomicity.h>
+#include <cxxtools/noncopyable.h>
+#include <vector>
+#include <cstddef>
+
+namespace cxxtools
+{
+    class Event;
+
+    /** @internal Queue of events with lock free enqueue from many threads
+
+        Events are copied into segments of contiguous memory. A producer
+        reserves space for its record with an atomic add on the fill level
+        of the current segment, clones the event into it and marks the
+        record ready. The producer, which overflows a segment, links the
+        next one. Events, which do not fit into a segment, are allocated
+        on the heap and only referenced by their record.
+
+        A single consumer (the event loop) drains the ready records in
+        order. Consumed segments are reused, so that in a steady state
+        committing an event does not allocate memory.
+
+        commit reports, whether the consumer needs to be woken up. This is
+        the case only for the first event after the consumer called
+        resetWakeup, so that a batch of events costs one wakeup.
+     */
+    class EventQueue : private NonCopyable
+    {
+        public:
+            explicit EventQueue(std::size_t segmentSize = 65536);
+
+            ~EventQueue();
+
+            /** Adds a copy of the event to the queue. Thread safe.
+
+                Returns true, if the consumer has to be woken up.
+             */
+            bool commit(const Event& ev);
+
+            /// Requests a wakeup for the next committed event. Called by the consumer before draining.
+            void resetWakeup()
+            { atomicExchange(_wakeup, 0); }
+
+            /** Removes the next event from the queue or returns 0 if there is
+                none. The event must be passed to release after processing.
+             */
+            Event* pop(bool& inArena);
+
+            /// Destroys an event returned by pop.
+            void release(Event* ev, bool inArena);
+
+        private:
+            struct Segment;
+            struct Record;
+            class Writer;
+
+            Segment* newSegment();
+            Segment* takeFreeSegment();
+            Record* reserve(std::size_t size, Segment*& segment);
+            void retire(Segment* segment);
+            void recycle();
+
+            std::size_t _segmentSize;
+
+            // producer side
+            void* volatile _tail;
+            void* volatile _free;       // stack of reusable segments
+            atomic_t _wakeup;
+
+            // consumer side
+            Segment* _head;
+            std::size_t _headPos;
+            unsigned _delivering;       // popped but not yet released events
+            std::vector<Segment*> _retired;
+
+            Segment* _segments;         // all segments for cleanup
+    };
+
+}
+
+#endif // CXXTOOLS_EVENTQUEUE_H
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/http/bodybuffer.h>
+#include <algorithm>
+#include <cstring>
+
+namespace cxxtools {
+
+namespace http {
+
+namespace
+{
+    const std::size_t firstBlockSize = 8192;
+    const std::size_t maxBlockSize = 1024 * 1024;
+}
+
+BodyBuffer::BodyBuffer()
+    : _current(0),
+      _size(0),
+      _sink(0),
+      _threshold(65536)
+{
+}
+
+BodyBuffer::~BodyBuffer()
+{
+    for (unsigned n = 0; n < _blocks.size(); ++n)
+        delete[] _blocks[n].data;
+}
+
+std::string BodyBuffer::str() const
+{
+    std::string ret;
+    ret.reserve(size());
+    for (unsigned n = 0; n < blocks(); ++n)
+        ret.append(blockData(n), blockSize(n));
+    return ret;
+}
+
+void BodyBuffer::clear()
+{
+    for (unsigned n = 1; n < _blocks.size(); ++n)
+        delete[] _blocks[n].data;
+
+    if (_blocks.size() > 1)
+        _blocks.resize(1);
+
+    _current = 0;
+    _size = 0;
+
+    if (_blocks.empty())
+        setp(0, 0);
+    else
+        setp(_blocks[0].data, _blocks[0].data + _blocks[0].capacity);
+}
+
+void BodyBuffer::nextBlock()
+{
+    if (!_blocks.empty())
+    {
+        _blocks[_current].size = pptr() - pbase();
+        _size += _blocks[_current].size;
+        ++_current;
+    }
+
+    if (_current >= _blocks.size())
+    {
+        Block block;
+        block.capacity = _blocks.empty() ? firstBlockSize
+                       : std::min(_blocks.back().capacity * 2, maxBlockSize);
+        block.data = new char[block.capacity];
+        block.size = 0;
+        _blocks.push_back(block);
+    }
+
+    Block& block = _blocks[_current];
+    block.size = 0;
+    setp(block.data, block.data + block.capacity);
+}
+
+BodyBuffer::int_type BodyBuffer::overflow(int_type ch)
+{
+    if (_sink && size() >= _threshold)
+        _sink->onBodyData(*this);
+
+    if (pptr() == epptr())
+        nextBlock();
+
+    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize BodyBuffer::xsputn(const char* s, std::streamsize n)
+{
+    std::streamsize count = 0;
+    while (count < n)
+    {
+        if (pptr() == epptr())
+            overflow(traits_type::eof());
+
+        std::size_t c = std::min(static_cast<std::size_t>(n - count),
+                                 static_cast<std::size_t>(epptr() - pptr()));
+        std::memcpy(pptr(), s + count, c);
+        pbump(c);
+        count += c;
+    }
+
+    return count;
+}
+
+int BodyBuffer::sync()
+{
+    if (_sink)
+        _sink->onBodyData(*this);
+    return 0;
+}
+
+void BodyStream::send(std::ostream& out) const
+{
+    for (unsigned n = 0; n < _buffer.blocks(); ++n)
+        out.write(_buffer.blockData(n), _buffer.blockSize(n));
+}
+
+} // namespace http
+
+} // namespace cxxtools
@@ -27,6 +27,7 @@
  */
 
 #include <cxxtools/http/client.h>
+#include <cxxtools/http/connectionpool.h>
 #include <cxxtools/net/addrinfo.h>
 #include <cxxtools/net/uri.h>
 #include "clientimpl.h"
@@ -168,6 +169,31 @@ std::string Client::get(const std::string& url, std::size_t timeout, std::size_t
     return getImpl()->get(url, timeout, connectTimeout);
 }
 
+void Client::pipelineRequest(const Request& request, const Callable<void, Client&>& onReply)
+{
+    getImpl()->pipelineRequest(request, onReply);
+}
+
+void Client::executePipeline(std::size_t timeout, std::size_t connectTimeout)
+{
+    getImpl()->executePipeline(timeout, connectTimeout);
+}
+
+void Client::pipelineDepth(unsigned n)
+{
+    getImpl()->pipelineDepth(n);
+}
+
+unsigned Client::pipelineDepth() const
+{
+    return getImpl()->pipelineDepth();
+}
+
+std::size_t Client::pipelinedRequests() const
+{
+    return getImpl()->pipelinedRequests();
+}
+
 void Client::beginExecute(const Request& request)
 {
     _impl->beginExecute(request);
@@ -218,6 +244,16 @@ void Client::clearAuth()
     getImpl()->clearAuth();
 }
 
+void Client::setConnectionPool(ConnectionPool& pool)
+{
+    getImpl()->setConnectionPool(pool._impl);
+}
+
+void Client::clearConnectionPool()
+{
+    getImpl()->setConnectionPool(0);
+}
+
 void Client::cancel()
 {
     if (_impl)
@@ -27,6 +27,7 @@
  */
 
 #include "clientimpl.h"
+#include "connectionpoolimpl.h"
 #include <cxxtools/http/client.h>
 #include <cxxtools/net/uri.h>
 #include "parser.h"
@@ -54,6 +55,8 @@ ClientImpl::ClientImpl(Client* client)
 , _parseEvent(_replyHeader)
 , _parser(_parseEvent, true)
 , _request(0)
+, _socket(&_ownSocket)
+, _pool(0)
 , _stream(8192, true)
 , _chunkedIStream(_stream.rdbuf())
 , _contentLength(0)
@@ -61,17 +64,114 @@ ClientImpl::ClientImpl(Client* client)
 , _chunkedEncoding(false)
 , _reconnectOnError(false)
 , _errorPending(false)
+, _pipelineDepth(16)
+, _inPipeline(false)
+, _bodyRead(false)
 {
-    _stream.attachDevice(_socket);
-    cxxtools::connect(_socket.connected, *this, &ClientImpl::onConnect);
+    _stream.attachDevice(_ownSocket);
+    cxxtools::connect(_ownSocket.connected, *this, &ClientImpl::onConnect);
     cxxtools::connect(_stream.buffer().outputReady, *this, &ClientImpl::onOutput);
     cxxtools::connect(_stream.buffer().inputReady, *this, &ClientImpl::onInput);
 }
 
+ClientImpl::~ClientImpl()
+{
+    clearPipeline();
+    releaseSocket(reusable());
+}
+
+void ClientImpl::prepareConnect(const net::AddrInfo& addrinfo)
+{
+    releaseSocket(reusable());
+    _addrInfo = addrinfo;
+    _socket->close();
+}
+
+void ClientImpl::connect()
+{
+    if (_pool)
+    {
+        acquireSocket(_socket->timeout());
+        if (_socket->isConnected())
+            return;
+    }
+    else
+        _socket->close();
+
+    _socket->connect(_addrInfo);
+}
+
+void ClientImpl::setConnectionPool(ConnectionPoolImpl* pool)
+{
+    releaseSocket(reusable());
+    _ownSocket.close();
+    _pool = pool;
+}
+
+void ClientImpl::acquireSocket(std::size_t timeout)
+{
+    if (_pool == 0 || _socket != &_ownSocket)
+        return;
+
+    net::TcpSocket* socket = _pool->acquire(_addrInfo.host(), _addrInfo.port(), timeout);
+
+    _stream.clear();
+    _stream.buffer().discard();
+    switchSocket(*socket);
+}
+
+void ClientImpl::releaseSocket(bool keep)
+{
+    if (_socket == &_ownSocket)
+        return;
+
+    net::TcpSocket* socket = _socket;
+    if (!keep)
+        socket->close();
+
+    _stream.clear();
+    _stream.buffer().discard();
+    switchSocket(_ownSocket);
+
+    _pool->release(_addrInfo.host(), _addrInfo.port(), socket, keep);
+}
+
+void ClientImpl::switchSocket(net::TcpSocket& socket)
+{
+    if (_socket != &_ownSocket)
+    {
+        cxxtools::disconnect(_socket->connected, *this, &ClientImpl::onConnect);
+        _socket->setSelector(0);
+    }
+
+    _socket = &socket;
+    _stream.attachDevice(socket);
+
+    if (_socket != &_ownSocket)
+    {
+        cxxtools::connect(_socket->connected, *this, &ClientImpl::onConnect);
+        _socket->setSelector(_ownSocket.selector());
+    }
+}
+
+bool ClientImpl::reusable() const
+{
+    // The connection can be used for the next request, when the reply is
+    // complete and nothing is left unread in the buffer.
+    return _socket->isConnected()
+        && !_socket->reading()
+        && !_socket->writing()
+        && _parser.end()
+        && !_parser.fail()
+        && _replyHeader.keepAlive()
+        && _stream.buffer().in_avail() == 0;
+}
 
 void ClientImpl::setSelector(SelectorBase& selector)
 {
-    selector.add(_socket);
+    selector.add(_ownSocket);
+    if (_socket != &_ownSocket)
+        selector.add(*_socket);
 }
 
 
@@ -82,7 +182,7 @@ void ClientImpl::reexecute(const Request& request)
     _stream.clear();
     _stream.buffer().discard();
 
-    _socket.connect(_addrInfo);
+    _socket->connect(_addrInfo);
 
     sendRequest(request);
     _stream.flush();
@@ -95,7 +195,7 @@ void ClientImpl::reexecuteBegin(const Request& request)
     _stream.clear();
     _stream.buffer().discard();
 
-    _socket.beginConnect(_addrInfo);
+    _socket->beginConnect(_addrInfo);
     _reconnectOnError = false;
 }
 
@@ -116,58 +216,70 @@ const ReplyHeader& ClientImpl::execute(const Request& request, std::size_t timeo
 
     _replyHeader.clear();
 
-    _socket.setTimeout(connectTimeout);
+    acquireSocket(connectTimeout);
 
-    bool shouldReconnect = _socket.isConnected();
-    if (!shouldReconnect)
-    {
-        log_debug("connect");
-        _socket.connect(_addrInfo);
-    }
-
-    _socket.setTimeout(timeout);
-
-    log_debug("send request");
-    sendRequest(request);
-    _stream.flush();
-
-    if (!_stream && shouldReconnect)
+    try
     {
-        // sending failed and we were not connected before, so try again
-        reexecute(request);
-        shouldReconnect = false;
-    }
+        _socket->setTimeout(connectTimeout);
 
-    if (!_stream)
-        throw IOError("error sending HTTP request");
+        bool shouldReconnect = _socket->isConnected();
+        if (!shouldReconnect)
+        {
+            log_debug("connect");
+            _socket->connect(_addrInfo);
+        }
 
-    log_debug("read reply");
+        _socket->setTimeout(timeout);
 
-    _parser.reset(true);
-    _readHeader = true;
-    doparse();
+        log_debug("send request");
+        sendRequest(request);
+        _stream.flush();
 
-    if (_parser.begin() && shouldReconnect)
-    {
-        // reading failed and we were not connected before, so try again
-        reexecute(request);
+        if (!_stream && shouldReconnect)
+        {
+            // sending failed and we were not connected before, so try again
+            reexecute(request);
+            shouldReconnect = false;
+        }
 
         if (!_stream)
             throw IOError("error sending HTTP request");
 
+        log_debug("read reply");
+
+        _parser.reset(true);
+        _readHeader = true;
         doparse();
-    }
 
-    log_debug("reply ready");
+        if (_parser.begin() && shouldReconnect)
+        {
+            // reading failed and we were not connected before, so try again
+            reexecute(request);
 
-    if (_stream.fail())
-        throw IOError("failed to read HTTP reply");
+            if (!_stream)
+                throw IOError("error sending HTTP request");
 
-    if (_parser.fail())
-        throw IOError("invalid HTTP reply");
+            doparse();
+        }
+
+        log_debug("reply ready");
+
+        if (_stream.fail())
+            throw IOError("failed to read HTTP reply");
 
-    if (!_parser.end())
-        throw IOError("incomplete HTTP reply header");
+        if (_parser.fail())
+            throw IOError("invalid HTTP reply");
+
+        if (!_parser.end())
+            throw IOError("incomplete HTTP reply header");
+    }
+    catch (...)
+    {
+        // the connection is in an undefined state; give it back to the
+        // pool, so that it is not counted as active any more
+        releaseSocket(false);
+        throw;
+    }
 
     return _replyHeader;
 }
@@ -214,12 +326,17 @@ void ClientImpl::readBody(std::string& s)
     if (!_replyHeader.keepAlive())
     {
         log_debug("close socket - no keep alive");
-        _socket.close();
+        _socket->close();
     }
     else
     {
         log_debug("do not close socket - keep alive");
     }
+
+    _bodyRead = true;
+
+    if (!_inPipeline)
+        releaseSocket(reusable());
 }
 
 
@@ -233,15 +350,19 @@ std::string ClientImpl::get(const std::string& url, std::size_t timeout, std::si
 
 void ClientImpl::beginExecute(const Request& request)
 {
-    if (_socket.selector() == 0)
+    if (_ownSocket.selector() == 0)
         throw std::logic_error("cannot run async http request without a selector");
 
     log_trace("beginExecute");
 
+    // asyncronous requests must not block, so fail if the pool has no
+    // connection available
+    acquireSocket(0);
+
     _errorPending = false;
     _request = &request;
     _replyHeader.clear();
-    if (_socket.isConnected())
+    if (_socket->isConnected())
     {
         log_debug("we are connected already");
         sendRequest(*_request);
@@ -256,14 +377,14 @@ void ClientImpl::beginExecute(const Request& request)
 
             _stream.clear();
             _stream.buffer().discard();
-            _socket.beginConnect(_addrInfo);
+            _socket->beginConnect(_addrInfo);
             _reconnectOnError = false;
         }
     }
     else
     {
         log_debug("not yet connected - do it now");
-        _socket.beginConnect(_addrInfo);
+        _socket->beginConnect(_addrInfo);
         _reconnectOnError = false;
     }
 }
@@ -281,13 +402,13 @@ void ClientImpl::endExecute()
 
 bool ClientImpl::wait(std::size_t msecs)
 {
-    return _socket.wait(msecs);
+    return _socket->wait(msecs);
 }
 
 
 SelectorBase* ClientImpl::selector()
 {
-    return _socket.selector();
+    return _ownSocket.selector();
 }
 
 
@@ -414,7 +535,7 @@ void ClientImpl::onOutput(StreamBuffer& sb)
             if (_reconnectOnError && _request != 0)
             {
                 log_debug("reconnect on error");
-                _socket.close();
+                _socket->close();
                 _reconnectOnError = false;
                 reexecuteBegin(*_request);
                 return;
@@ -470,7 +591,7 @@ void ClientImpl::onInput(StreamBuffer& sb)
             if (_readHeader && _reconnectOnError && _request != 0)
             {
                 log_debug("reconnect on error");
-                _socket.close();
+                _socket->close();
                 _reconnectOnError = false;
                 reexecuteBegin(*_request);
                 return;
@@ -539,7 +660,7 @@ void ClientImpl::processHeaderAvailable(StreamBuffer& sb)
                 if (!_replyHeader.keepAlive())
                 {
                     log_debug("close socket - no keep alive");
-                    _socket.close();
+                    _socket->close();
                 }
 
                 _client->replyFinished(*_client);
@@ -594,7 +715,7 @@ void ClientImpl::processBodyAvailable(StreamBuffer& sb)
                     if (!_replyHeader.keepAlive())
                     {
                         log_debug("close socket - no keep alive");
-                        _socket.close();
+                        _socket->close();
                     }
 
                     _client->replyFinished(*_client);
@@ -612,7 +733,7 @@ void ClientImpl::processBodyAvailable(StreamBuffer& sb)
                 _client->replyFinished(*_client);
         }
 
-        if (_socket.enabled())
+        if (_socket->enabled())
         {
             if ((!_chunkedIStream.eod() || !_parser.end()))
             {
@@ -645,12 +766,12 @@ void ClientImpl::processBodyAvailable(StreamBuffer& sb)
             if (!_replyHeader.keepAlive())
             {
                 log_debug("close socket - no keep alive");
-                _socket.close();
+                _socket->close();
             }
 
             _client->replyFinished(*_client);
         }
-        else if (_socket.enabled() && _stream.good())
+        else if (_socket->enabled() && _stream.good())
         {
             sb.beginRead();
         }
@@ -661,9 +782,150 @@ void ClientImpl::processBodyAvailable(StreamBuffer& sb)
     }
 }
 
+namespace
+{
+    class PipelineSentry
+    {
+            bool& _flag;
+
+        public:
+            explicit PipelineSentry(bool& flag)
+                : _flag(flag)
+            { _flag = true; }
+
+            ~PipelineSentry()
+            { _flag = false; }
+    };
+}
+
+void ClientImpl::pipelineRequest(const Request& request, const Callable<void, Client&>& onReply)
+{
+    PipelinedRequest r;
+    r.request = &request;
+    r.onReply = onReply.clone();
+    _pipeline.push_back(r);
+}
+
+void ClientImpl::clearPipeline()
+{
+    for (unsigned n = 0; n < _pipeline.size(); ++n)
+        delete _pipeline[n].onReply;
+    _pipeline.clear();
+}
+
+void ClientImpl::executePipeline(std::size_t timeout, std::size_t connectTimeout)
+{
+    log_trace("execute " << _pipeline.size() << " pipelined requests");
+
+    if (connectTimeout == Selectable::WaitInfinite)
+        connectTimeout = timeout;
+
+    try
+    {
+        PipelineSentry sentry(_inPipeline);
+
+        acquireSocket(connectTimeout);
+
+        while (!_pipeline.empty())
+        {
+            _socket->setTimeout(connectTimeout);
+
+            bool reused = _socket->isConnected();
+            if (!reused)
+            {
+                log_debug("connect");
+                _stream.clear();
+                _stream.buffer().discard();
+                _socket->connect(_addrInfo);
+            }
+
+            _socket->setTimeout(timeout);
+
+            // fill the pipeline
+            unsigned sent = 0;
+            while (sent < _pipeline.size() && sent < _pipelineDepth)
+                sendRequest(*_pipeline[sent++].request);
+            _stream.flush();
+
+            log_debug(sent << " requests sent");
+
+            unsigned received = 0;
+            while (_stream && received < sent)
+            {
+                _replyHeader.clear();
+                _parser.reset(true);
+                doparse();
+
+                if (_parser.begin())
+                    break;   // connection closed by server
+
+                if (_parser.fail())
+                    throw IOError("invalid HTTP reply");
+
+                if (!_parser.end())
+                    throw IOError("incomplete HTTP reply header");
+
+                PipelinedRequest r = _pipeline.front();
+                _pipeline.pop_front();
+                ++received;
+
+                _bodyRead = false;
+                try
+                {
+                    r.onReply->invoke(*_client);
+                }
+                catch (...)
+                {
+                    delete r.onReply;
+                    throw;
+                }
+
+                delete r.onReply;
+
+                if (!_bodyRead)
+                {
+                    std::string body;
+                    readBody(body);
+                }
+
+                // readBody closes the connection, when the server does not
+                // keep it alive; the requests sent after are repeated
+                if (!_socket->isConnected())
+                    break;
+
+                if (sent - received < _pipeline.size())
+                {
+                    sendRequest(*_pipeline[sent - received].request);
+                    _stream.flush();
+                    ++sent;
+                }
+            }
+
+            if (received < sent)
+            {
+                log_debug("connection closed after " << received << " of " << sent << " replies");
+
+                if (received == 0 && !reused)
+                    throw IOError("connection closed by server without reply");
+
+                _socket->close();
+            }
+        }
+    }
+    catch (...)
+    {
+        clearPipeline();
+        releaseSocket(false);
+        _socket->close();
+        throw;
+    }
+
+    releaseSocket(reusable());
+}
+
 void ClientImpl::cancel()
 {
-    _socket.close();
+    _socket->close();
     _stream.clear();
     _stream.buffer().discard();
 
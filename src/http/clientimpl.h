@@ -40,6 +40,8 @@
 #include <cxxtools/connectable.h>
 #include <cxxtools/delegate.h>
 #include <cxxtools/refcounted.h>
+#include <cxxtools/callable.h>
+#include <deque>
 #include <string>
 #include <sstream>
 #include <cstddef>
@@ -57,6 +59,7 @@ namespace http
 {
 
 class Client;
+class ConnectionPoolImpl;
 
 class ClientImpl : public RefCounted, public Connectable
 {
@@ -84,8 +87,10 @@ class ClientImpl : public RefCounted, public Connectable
         ReplyHeader _replyHeader;
 
         net::AddrInfo _addrInfo;
-        net::TcpSocket _socket;
-        IOStream _stream;
+        net::TcpSocket _ownSocket;
+        net::TcpSocket* _socket;       // _ownSocket or a socket from _pool
+        ConnectionPoolImpl* _pool;
+        mutable IOStream _stream;      // in_avail() in reusable() is not const
         ChunkedIStream _chunkedIStream;
         std::string _username;
         std::string _password;
@@ -96,6 +101,17 @@ class ClientImpl : public RefCounted, public Connectable
         bool _reconnectOnError;
         bool _errorPending;
 
+        struct PipelinedRequest
+        {
+            const Request* request;
+            Callable<void, Client&>* onReply;
+        };
+
+        std::deque<PipelinedRequest> _pipeline;
+        unsigned _pipelineDepth;
+        bool _inPipeline;
+        bool _bodyRead;
+
         void sendRequest(const Request& request);
         void processHeaderAvailable(StreamBuffer& sb);
         void processBodyAvailable(StreamBuffer& sb);
@@ -104,6 +120,14 @@ class ClientImpl : public RefCounted, public Connectable
         void reexecuteBegin(const Request& request);
         void doparse();
 
+        // connection pool handling
+        void acquireSocket(std::size_t timeout);
+        void releaseSocket(bool keep);
+        void switchSocket(net::TcpSocket& socket);
+        bool reusable() const;
+
+        void clearPipeline();
+
         // make non copyable
         ClientImpl(const ClientImpl& client);
         ClientImpl& operator=(const ClientImpl& client);
@@ -115,25 +139,23 @@ class ClientImpl : public RefCounted, public Connectable
 
     public:
         ClientImpl(Client* client);
+        ~ClientImpl();
 
         // Sets the server and port. No actual network connect is done.
-        void prepareConnect(const net::AddrInfo& addrinfo)
-        {
-            _addrInfo = addrinfo;
-            _socket.close();
-        }
+        void prepareConnect(const net::AddrInfo& addrinfo);
 
-        void connect()
-        {
-            _socket.close();
-            _socket.connect(_addrInfo);
-        }
+        void connect();
 
         void close()
         {
-            _socket.close();
+            releaseSocket(false);
+            _socket->close();
         }
 
+        // Takes connections from the pool instead of using an own
+        // connection; a null pointer disables pooling.
+        void setConnectionPool(ConnectionPoolImpl* pool);
+
         // Sends the passed request to the server and parses the headers.
         // The body must be read with readBody.
         // This method blocks or times out until the body is parsed.
@@ -205,6 +227,22 @@ class ClientImpl : public RefCounted, public Connectable
         { _username.clear(); _password.clear(); }
 
         void cancel();
+
+        // Queues a request for pipelined execution.
+        void pipelineRequest(const Request& request, const Callable<void, Client&>& onReply);
+
+        // Sends the queued requests back to back and reads the replies in
+        // order.
+        void executePipeline(std::size_t timeout, std::size_t connectTimeout);
+
+        void pipelineDepth(unsigned n)
+        { _pipelineDepth = n > 0 ? n : 1; }
+
+        unsigned pipelineDepth() const
+        { return _pipelineDepth; }
+
+        std::size_t pipelinedRequests() const
+        { return _pipeline.size(); }
 };
 
 } // namespace http
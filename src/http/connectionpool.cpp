@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "connectionpoolimpl.h"
+#include <cxxtools/selectable.h>
+#include <cxxtools/ioerror.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+#include <sstream>
+#include <poll.h>
+
+log_define("cxxtools.http.connectionpool")
+
+namespace cxxtools
+{
+
+namespace http
+{
+
+ConnectionPoolImpl::ConnectionPoolImpl(unsigned maxPerHost, Milliseconds idleTimeout)
+    : _maxPerHost(maxPerHost > 0 ? maxPerHost : 1),
+      _idleTimeout(idleTimeout)
+{
+    cxxtools::connect(_timer.timeout, *this, &ConnectionPoolImpl::evictIdle);
+}
+
+ConnectionPoolImpl::~ConnectionPoolImpl()
+{
+    clear();
+}
+
+std::string ConnectionPoolImpl::key(const std::string& host, unsigned short port)
+{
+    std::ostringstream s;
+    s << host << ':' << port;
+    return s.str();
+}
+
+bool ConnectionPoolImpl::healthy(const net::TcpSocket& socket)
+{
+    if (!socket.isConnected())
+        return false;
+
+    // An idle connection must not be readable. Otherwise the server has
+    // closed it or sent data, which nobody asked for.
+    pollfd pfd;
+    pfd.fd = socket.getFd();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, 0) == 0;
+}
+
+void ConnectionPoolImpl::evictExpired(Host& host, const Timespan& now)
+{
+    std::vector<IdleConnection>::iterator it = host.idle.begin();
+    for ( ; it != host.idle.end() && now - it->since >= _idleTimeout; ++it)
+    {
+        log_debug("close connection idle for " << (now - it->since).totalMSecs() << " ms");
+        delete it->socket;
+        ++_statistics.evictions;
+    }
+
+    host.idle.erase(host.idle.begin(), it);
+}
+
+net::TcpSocket* ConnectionPoolImpl::acquire(const std::string& host, unsigned short port,
+                                            std::size_t timeout)
+{
+    std::string k = key(host, port);
+    Timespan deadline = Clock::getSystemTicks();
+    if (timeout != Selectable::WaitInfinite)
+        deadline += Milliseconds(timeout);
+
+    MutexLock lock(_mutex);
+    Host& h = _hosts[k];
+
+    while (true)
+    {
+        Timespan now = Clock::getSystemTicks();
+        evictExpired(h, now);
+
+        while (!h.idle.empty())
+        {
+            net::TcpSocket* socket = h.idle.back().socket;
+            h.idle.pop_back();
+
+            if (healthy(*socket))
+            {
+                log_debug("reuse connection to " << k);
+                ++h.active;
+                ++_statistics.hits;
+                return socket;
+            }
+
+            log_debug("drop broken idle connection to " << k);
+            delete socket;
+            ++_statistics.evictions;
+        }
+
+        if (h.active < _maxPerHost)
+        {
+            log_debug("new connection to " << k);
+            ++h.active;
+            ++_statistics.connects;
+            return new net::TcpSocket();
+        }
+
+        log_debug("connection limit " << _maxPerHost << " to " << k << " reached");
+
+        if (timeout == Selectable::WaitInfinite)
+            _released.wait(lock);
+        else if (now < deadline)
+            _released.wait(lock, Milliseconds(deadline - now));
+        else
+            throw IOError("connection limit to " + k + " reached");
+    }
+}
+
+void ConnectionPoolImpl::release(const std::string& host, unsigned short port,
+                                 net::TcpSocket* socket, bool keep)
+{
+    MutexLock lock(_mutex);
+
+    Host& h = _hosts[key(host, port)];
+    if (h.active > 0)
+        --h.active;
+
+    if (keep && socket->isConnected() && h.active + h.idle.size() < _maxPerHost)
+    {
+        IdleConnection c;
+        c.socket = socket;
+        c.since = Clock::getSystemTicks();
+        h.idle.push_back(c);
+    }
+    else
+    {
+        delete socket;
+    }
+
+    _released.signal();
+}
+
+void ConnectionPoolImpl::maxPerHost(unsigned n)
+{
+    MutexLock lock(_mutex);
+    _maxPerHost = n > 0 ? n : 1;
+    _released.broadcast();
+}
+
+void ConnectionPoolImpl::idleTimeout(Milliseconds t)
+{
+    // The timer belongs to the thread running the selector, so it is not
+    // touched here. evictIdle picks up the new interval on its next run.
+    MutexLock lock(_mutex);
+    _idleTimeout = t;
+}
+
+void ConnectionPoolImpl::setSelector(SelectorBase& selector)
+{
+    _timer.setSelector(&selector);
+    _timer.start(_idleTimeout);
+}
+
+void ConnectionPoolImpl::evictIdle()
+{
+    MutexLock lock(_mutex);
+
+    Timespan now = Clock::getSystemTicks();
+    Hosts::iterator it = _hosts.begin();
+    while (it != _hosts.end())
+    {
+        evictExpired(it->second, now);
+        if (it->second.idle.empty() && it->second.active == 0)
+            _hosts.erase(it++);
+        else
+            ++it;
+    }
+
+    if (_timer.interval() != Timespan(_idleTimeout))
+        _timer.start(_idleTimeout);
+}
+
+void ConnectionPoolImpl::clear()
+{
+    MutexLock lock(_mutex);
+
+    for (Hosts::iterator it = _hosts.begin(); it != _hosts.end(); ++it)
+    {
+        for (unsigned n = 0; n < it->second.idle.size(); ++n)
+            delete it->second.idle[n].socket;
+        it->second.idle.clear();
+    }
+}
+
+ConnectionPool::Statistics ConnectionPoolImpl::statistics() const
+{
+    MutexLock lock(_mutex);
+
+    ConnectionPool::Statistics s = _statistics;
+    for (Hosts::const_iterator it = _hosts.begin(); it != _hosts.end(); ++it)
+    {
+        s.idle += it->second.idle.size();
+        s.active += it->second.active;
+    }
+
+    return s;
+}
+
+ConnectionPool::ConnectionPool(unsigned maxPerHost, Milliseconds idleTimeout)
+    : _impl(new ConnectionPoolImpl(maxPerHost, idleTimeout))
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    delete _impl;
+}
+
+void ConnectionPool::maxPerHost(unsigned n)
+{
+    _impl->maxPerHost(n);
+}
+
+unsigned ConnectionPool::maxPerHost() const
+{
+    return _impl->maxPerHost();
+}
+
+void ConnectionPool::idleTimeout(Milliseconds t)
+{
+    _impl->idleTimeout(t);
+}
+
+Milliseconds ConnectionPool::idleTimeout() const
+{
+    return _impl->idleTimeout();
+}
+
+void ConnectionPool::setSelector(SelectorBase& selector)
+{
+    _impl->setSelector(selector);
+}
+
+void ConnectionPool::clear()
+{
+    _impl->clear();
+}
+
+ConnectionPool::Statistics ConnectionPool::statistics() const
+{
+    return _impl->statistics();
+}
+
+} // namespace http
+
+} // namespace cxxtools
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef cxxtools_Http_ConnectionPoolImpl_h
+#define cxxtools_Http_ConnectionPoolImpl_h
+
+#include <cxxtools/http/connectionpool.h>
+#include <cxxtools/net/tcpsocket.h>
+#include <cxxtools/connectable.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/timer.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cxxtools
+{
+
+namespace http
+{
+
+class ConnectionPoolImpl : public Connectable
+{
+        struct IdleConnection
+        {
+            net::TcpSocket* socket;
+            Timespan since;
+        };
+
+        struct Host
+        {
+            std::vector<IdleConnection> idle;   // most recently used last
+            unsigned active;
+
+            Host()
+                : active(0)
+            { }
+        };
+
+        typedef std::map<std::string, Host> Hosts;
+
+        mutable Mutex _mutex;
+        Condition _released;
+        Hosts _hosts;
+        unsigned _maxPerHost;
+        Milliseconds _idleTimeout;
+        Timer _timer;
+        ConnectionPool::Statistics _statistics;
+
+        static std::string key(const std::string& host, unsigned short port);
+        static bool healthy(const net::TcpSocket& socket);
+
+        void evictExpired(Host& host, const Timespan& now);
+
+    public:
+        ConnectionPoolImpl(unsigned maxPerHost, Milliseconds idleTimeout);
+        ~ConnectionPoolImpl();
+
+        // Returns an idle connection to the host or a new, unconnected
+        // socket. Waits up to timeout milliseconds, when the limit of
+        // connections to the host is reached.
+        net::TcpSocket* acquire(const std::string& host, unsigned short port,
+                                std::size_t timeout);
+
+        // Gives the socket back to the pool. If keep is not set, the
+        // connection is closed.
+        void release(const std::string& host, unsigned short port,
+                     net::TcpSocket* socket, bool keep);
+
+        void maxPerHost(unsigned n);
+        unsigned maxPerHost() const
+        { return _maxPerHost; }
+
+        void idleTimeout(Milliseconds t);
+        Milliseconds idleTimeout() const
+        { return _idleTimeout; }
+
+        void setSelector(SelectorBase& selector);
+
+        void evictIdle();
+        void clear();
+
+        ConnectionPool::Statistics statistics() const;
+};
+
+} // namespace http
+
+} // namespace cxxtools
+
+#endif
@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/http/fileservice.h>
+#include <cxxtools/http/responder.h>
+#include <cxxtools/http/request.h>
+#include <cxxtools/http/reply.h>
+#include <cxxtools/lrucache.h>
+#include <cxxtools/smartptr.h>
+#include <cxxtools/refcounted.h>
+#include <cxxtools/datetime.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/log.h>
+#include <map>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+log_define("cxxtools.http.fileservice")
+
+namespace cxxtools
+{
+
+namespace http
+{
+
+namespace
+{
+    class OpenFile : public AtomicRefCounted
+    {
+        public:
+            explicit OpenFile(int fd_, const struct stat& st);
+            ~OpenFile()
+            { ::close(fd); }
+
+            bool unchanged(const struct stat& st) const
+            {
+                return st.st_ino == ino
+                    && st.st_dev == dev
+                    && st.st_mtime == mtime
+                    && static_cast<std::size_t>(st.st_size) == size;
+            }
+
+            int fd;
+            std::size_t size;
+            ino_t ino;
+            dev_t dev;
+            time_t mtime;
+            std::string etag;
+            std::string lastModified;
+    };
+
+    OpenFile::OpenFile(int fd_, const struct stat& st)
+        : fd(fd_),
+          size(st.st_size),
+          ino(st.st_ino),
+          dev(st.st_dev),
+          mtime(st.st_mtime)
+    {
+        std::ostringstream s;
+        s << std::hex << '"' << ino << '-' << size << '-' << mtime << '"';
+        etag = s.str();
+
+        char buffer[50];
+        lastModified = MessageHeader::htdate(
+            DateTime::fromMSecsSinceEpoch(static_cast<int64_t>(mtime) * 1000), buffer);
+    }
+
+    typedef SmartPtr<OpenFile> OpenFilePtr;
+
+    // Parses a http date like "Sun, 06 Nov 1994 08:49:37 GMT" into seconds
+    // since the epoch. Returns false, when the date is not in that format.
+    bool parseHttpDate(const char* s, time_t& t)
+    {
+        static const char* monthn[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+        const char* p = std::strchr(s, ',');
+        if (p == 0)
+            return false;
+
+        char mon[4];
+        int day, year, hour, min, sec, n = 0;
+        if (std::sscanf(p + 1, " %2d %3s %4d %2d:%2d:%2d GMT%n",
+                        &day, mon, &year, &hour, &min, &sec, &n) != 6
+            || n == 0)
+            return false;
+
+        unsigned month = 0;
+        while (month < 12 && std::strcmp(mon, monthn[month]) != 0)
+            ++month;
+        if (month >= 12)
+            return false;
+
+        try
+        {
+            DateTime dt(year, month + 1, day, hour, min, sec);
+            t = static_cast<time_t>(dt.msecsSinceEpoch() / 1000);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    enum RangeResult
+    {
+        NoRange,
+        Satisfiable,
+        Unsatisfiable
+    };
+
+    // Parses a Range header value. Only a single byte range is supported;
+    // other or invalid ranges are ignored, so that the whole file is sent.
+    RangeResult parseRange(const char* s, std::size_t size,
+                           std::size_t& first, std::size_t& last)
+    {
+        if (std::strncmp(s, "bytes=", 6) != 0 || std::strchr(s, ',') != 0)
+            return NoRange;
+
+        s += 6;
+        while (*s == ' ')
+            ++s;
+
+        char* end;
+        if (*s == '-')
+        {
+            // suffix range: the last n bytes
+            if (!std::isdigit(s[1]))
+                return NoRange;
+
+            unsigned long n = std::strtoul(s + 1, &end, 10);
+            if (*end != '\0' && *end != ' ')
+                return NoRange;
+
+            if (n == 0 || size == 0)
+                return Unsatisfiable;
+
+            first = n >= size ? 0 : size - n;
+            last = size - 1;
+            return Satisfiable;
+        }
+
+        if (!std::isdigit(*s))
+            return NoRange;
+
+        first = std::strtoul(s, &end, 10);
+        if (*end != '-')
+            return NoRange;
+
+        s = end + 1;
+        if (std::isdigit(*s))
+        {
+            last = std::strtoul(s, &end, 10);
+            if ((*end != '\0' && *end != ' ') || last < first)
+                return NoRange;
+        }
+        else if (*s == '\0' || *s == ' ')
+            last = size - 1;
+        else
+            return NoRange;
+
+        if (first >= size)
+            return Unsatisfiable;
+
+        if (last >= size)
+            last = size - 1;
+
+        return Satisfiable;
+    }
+
+    bool etagMatches(const char* header, const std::string& etag)
+    {
+        return std::strcmp(header, "*") == 0
+            || std::strstr(header, etag.c_str()) != 0;
+    }
+}
+
+class FileResponder : public Responder
+{
+        FileServiceImpl& _impl;
+
+    public:
+        FileResponder(Service& service, FileServiceImpl& impl)
+            : Responder(service),
+              _impl(impl)
+            { }
+
+        void reply(std::ostream& out, Request& request, Reply& reply);
+};
+
+class FileServiceImpl
+{
+    public:
+        FileServiceImpl(FileService& service, const std::string& docroot,
+                        const std::string& urlPrefix, unsigned maxOpenFiles);
+
+        bool translate(const std::string& url, std::string& path) const;
+        OpenFilePtr getFile(const std::string& path);
+        const std::string& contentType(const std::string& path) const;
+
+        std::string docroot;
+        std::string urlPrefix;
+        std::map<std::string, std::string> contentTypes;
+        FileResponder responder;
+
+    private:
+        Mutex _mutex;
+        LruCache<std::string, OpenFilePtr> _files;
+};
+
+FileServiceImpl::FileServiceImpl(FileService& service, const std::string& docroot_,
+                                 const std::string& urlPrefix_, unsigned maxOpenFiles)
+    : docroot(docroot_),
+      urlPrefix(urlPrefix_),
+      responder(service, *this),
+      _files(maxOpenFiles)
+{
+    static const char* types[][2] = {
+        { "css", "text/css" },
+        { "gif", "image/gif" },
+        { "htm", "text/html" },
+        { "html", "text/html" },
+        { "ico", "image/x-icon" },
+        { "jpeg", "image/jpeg" },
+        { "jpg", "image/jpeg" },
+        { "js", "application/javascript" },
+        { "json", "application/json" },
+        { "pdf", "application/pdf" },
+        { "png", "image/png" },
+        { "svg", "image/svg+xml" },
+        { "txt", "text/plain" },
+        { "woff", "application/font-woff" },
+        { "xml", "application/xml" }
+    };
+
+    for (unsigned n = 0; n < sizeof(types) / sizeof(types[0]); ++n)
+        contentTypes[types[n][0]] = types[n][1];
+}
+
+bool FileServiceImpl::translate(const std::string& url, std::string& path) const
+{
+    if (url.compare(0, urlPrefix.size(), urlPrefix) != 0)
+        return false;
+
+    // the prefix must match whole path components
+    if (!urlPrefix.empty() && urlPrefix[urlPrefix.size() - 1] != '/'
+        && url.size() > urlPrefix.size() && url[urlPrefix.size()] != '/')
+        return false;
+
+    path = docroot;
+
+    std::string::size_type b = urlPrefix.size();
+    while (b < url.size())
+    {
+        std::string::size_type e = url.find('/', b);
+        if (e == std::string::npos)
+            e = url.size();
+
+        std::string::size_type len = e - b;
+        if (len == 2 && url[b] == '.' && url[b + 1] == '.')
+        {
+            log_warn("url <" << url << "> rejected");
+            return false;
+        }
+
+        if (len > 0 && !(len == 1 && url[b] == '.'))
+        {
+            path += '/';
+            path.append(url, b, len);
+        }
+
+        b = e + 1;
+    }
+
+    return path.size() > docroot.size();
+}
+
+OpenFilePtr FileServiceImpl::getFile(const std::string& path)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return OpenFilePtr();
+
+    {
+        MutexLock lock(_mutex);
+        OpenFilePtr* f = _files.getptr(path);
+        if (f && (*f)->unchanged(st))
+            return *f;
+    }
+
+    int flags = O_RDONLY;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0)
+        return OpenFilePtr();
+
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return OpenFilePtr();
+    }
+
+    log_debug("open file " << path << " fd=" << fd);
+
+    OpenFilePtr file(new OpenFile(fd, st));
+
+    MutexLock lock(_mutex);
+    _files.put(path, file);
+
+    return file;
+}
+
+const std::string& FileServiceImpl::contentType(const std::string& path) const
+{
+    static const std::string defaultType = "application/octet-stream";
+
+    std::string::size_type p = path.rfind('.');
+    if (p == std::string::npos || path.find('/', p) != std::string::npos)
+        return defaultType;
+
+    std::string ext;
+    for (std::string::size_type n = p + 1; n < path.size(); ++n)
+        ext += static_cast<char>(std::tolower(path[n]));
+
+    std::map<std::string, std::string>::const_iterator it = contentTypes.find(ext);
+    return it == contentTypes.end() ? defaultType : it->second;
+}
+
+void FileResponder::reply(std::ostream& /*out*/, Request& request, Reply& reply)
+{
+    bool head = request.method() == "HEAD";
+    if (!head && request.method() != "GET")
+    {
+        reply.httpReturn(405, "Method not allowed");
+        reply.setHeader("Allow", "GET, HEAD");
+        return;
+    }
+
+    std::string path;
+    OpenFilePtr file;
+    if (!_impl.translate(request.url(), path) || !(file = _impl.getFile(path)))
+    {
+        log_debug("file " << path << " not found");
+        reply.httpReturn(404, "Not found");
+        return;
+    }
+
+    reply.setHeader("Content-Type", _impl.contentType(path).c_str());
+    reply.setHeader("ETag", file->etag.c_str());
+    reply.setHeader("Last-Modified", file->lastModified.c_str());
+    reply.setHeader("Accept-Ranges", "bytes");
+
+    const char* ifNoneMatch = request.getHeader("If-None-Match");
+    const char* ifModifiedSince = request.getHeader("If-Modified-Since");
+    time_t since;
+    if (ifNoneMatch ? etagMatches(ifNoneMatch, file->etag)
+                    : ifModifiedSince && parseHttpDate(ifModifiedSince, since)
+                                      && file->mtime <= since)
+    {
+        reply.httpReturn(304, "Not modified");
+        return;
+    }
+
+    std::size_t first = 0;
+    std::size_t last = file->size - 1;
+    RangeResult range = NoRange;
+
+    const char* rangeHeader = request.getHeader("Range");
+    const char* ifRange = request.getHeader("If-Range");
+    if (rangeHeader
+        && (ifRange == 0 || file->etag == ifRange || file->lastModified == ifRange))
+        range = parseRange(rangeHeader, file->size, first, last);
+
+    if (range == Unsatisfiable)
+    {
+        std::ostringstream contentRange;
+        contentRange << "bytes */" << file->size;
+        reply.httpReturn(416, "Requested range not satisfiable");
+        reply.setHeader("Content-Range", contentRange.str().c_str());
+        return;
+    }
+
+    std::size_t size = file->size;
+    if (range == Satisfiable)
+    {
+        std::ostringstream contentRange;
+        contentRange << "bytes " << first << '-' << last << '/' << file->size;
+        reply.httpReturn(206, "Partial content");
+        reply.setHeader("Content-Range", contentRange.str().c_str());
+        size = last - first + 1;
+    }
+
+    if (head)
+    {
+        std::ostringstream contentLength;
+        contentLength << size;
+        reply.setHeader("Content-Length", contentLength.str().c_str());
+    }
+    else
+    {
+        reply.setBodyFile(file->fd, first, size, file.getPointer());
+    }
+}
+
+FileService::FileService(const std::string& docroot, const std::string& urlPrefix,
+                         unsigned maxOpenFiles)
+    : _impl(new FileServiceImpl(*this, docroot, urlPrefix, maxOpenFiles))
+{
+}
+
+FileService::~FileService()
+{
+    delete _impl;
+}
+
+const std::string& FileService::docroot() const
+{
+    return _impl->docroot;
+}
+
+const std::string& FileService::urlPrefix() const
+{
+    return _impl->urlPrefix;
+}
+
+void FileService::setContentType(const std::string& ext, const std::string& contentType)
+{
+    _impl->contentTypes[ext] = contentType;
+}
+
+Responder* FileService::createResponder(const Request&)
+{
+    return &_impl->responder;
+}
+
+void FileService::releaseResponder(Responder*)
+{
+}
+
+} // namespace http
+
+} // namespace cxxtools
@@ -30,6 +30,8 @@
 #include <cxxtools/http/request.h>
 #include <cxxtools/log.h>
 #include "mapper.h"
+#include <algorithm>
+#include <vector>
 
 log_define("cxxtools.http.mapper")
 
@@ -38,66 +40,368 @@ namespace cxxtools
 namespace http
 {
 
-void Mapper::addService(const std::string& url, Service& service)
+namespace
 {
-    log_debug("add service for url <" << url << '>');
+    struct Route
+    {
+        unsigned order;
+        Service* service;
+        std::string url;
+        Regex regex;
+        std::vector<std::string> params;  // names of "{name}" segments
+    };
+
+    // Node of the trie of path segments.
+    class Node
+    {
+            typedef std::vector<std::pair<std::string, Node*> > Children;
+
+            Children _children;  // sorted by segment
+            Node* _param;        // child for a "{name}" segment
+
+            Node(const Node&);
+            Node& operator=(const Node&);
+
+            static bool less(const Children::value_type& c, const std::string& s)
+            { return c.first < s; }
+
+        public:
+            std::vector<const Route*> exact;  // routes ending at this node
+            std::vector<const Route*> rest;   // routes ending with "*" at this node
 
-    WriteLock serviceLock(_serviceMutex);
-    _services.push_back(ServicesType::value_type(url, &service));
+            Node()
+                : _param(0)
+                { }
+
+            ~Node()
+            {
+                for (Children::iterator it = _children.begin(); it != _children.end(); ++it)
+                    delete it->second;
+                delete _param;
+            }
+
+            Node* child(const std::string& segment)
+            {
+                Children::iterator it = std::lower_bound(_children.begin(), _children.end(), segment, less);
+                if (it == _children.end() || it->first != segment)
+                    it = _children.insert(it, Children::value_type(segment, new Node()));
+                return it->second;
+            }
+
+            Node* paramChild()
+            {
+                if (_param == 0)
+                    _param = new Node();
+                return _param;
+            }
+
+            // Finds the child for the segment url[b..e) without creating a string.
+            const Node* find(const std::string& url, std::string::size_type b, std::string::size_type e) const
+            {
+                std::string::size_type len = e - b;
+                Children::size_type lo = 0;
+                Children::size_type hi = _children.size();
+                while (lo < hi)
+                {
+                    Children::size_type mid = (lo + hi) / 2;
+                    int c = _children[mid].first.compare(0, std::string::npos, url, b, len);
+                    if (c == 0)
+                        return _children[mid].second;
+                    if (c < 0)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                return 0;
+            }
+
+            const Node* param() const
+            { return _param; }
+    };
+
+    struct Match
+    {
+        const Route* route;
+        std::vector<std::pair<std::string::size_type, std::string::size_type> > captures;
+
+        bool operator< (const Match& m) const
+        { return route->order < m.route->order; }
+    };
+
+    typedef std::vector<std::pair<std::string::size_type, std::string::size_type> > Captures;
+
+    bool isParam(const std::string& segment)
+    {
+        return segment.size() > 2
+            && segment[0] == '{'
+            && segment[segment.size() - 1] == '}';
+    }
 }
 
-void Mapper::addService(const Regex& url, Service& service)
+class Mapper::RouteTable
 {
-    log_debug("add service for regex");
+        std::vector<Route*> _routes;       // all routes in order of registration
+        std::vector<const Route*> _regex;  // regex routes in order of registration
+        Node _root;
+        unsigned _nextOrder;
+
+        RouteTable(const RouteTable&);
+        RouteTable& operator=(const RouteTable&);
 
-    WriteLock serviceLock(_serviceMutex);
-    _services.push_back(ServicesType::value_type(url, &service));
+        void insert(Route* route);
+
+        void match(const Node& node, const std::string& url, std::string::size_type pos,
+                   Captures& captures, std::vector<Match>& matches) const;
+
+        void addMatches(const std::vector<const Route*>& routes, const Captures& captures,
+                        std::vector<Match>& matches) const;
+
+    public:
+        RouteTable()
+            : _nextOrder(0)
+            { }
+
+        // creates a copy of the table, where the passed service is removed
+        RouteTable(const RouteTable& table, Service* remove);
+
+        ~RouteTable();
+
+        void add(const std::string& url, Service& service);
+        void add(const Regex& regex, Service& service);
+
+        Responder* getResponder(Request& request, NotAuthenticatedService& noAuthService) const;
+};
+
+Mapper::RouteTable::RouteTable(const RouteTable& table, Service* remove)
+    : _nextOrder(table._nextOrder)
+{
+    for (std::vector<Route*>::const_iterator it = table._routes.begin(); it != table._routes.end(); ++it)
+    {
+        if ((*it)->service == remove)
+            continue;
+
+        Route* route = new Route(**it);
+        _routes.push_back(route);
+        if (route->regex.empty())
+            insert(route);
+        else
+            _regex.push_back(route);
+    }
 }
 
-void Mapper::removeService(Service& service)
+Mapper::RouteTable::~RouteTable()
 {
-    WriteLock serviceLock(_serviceMutex);
-    service.waitIdle();
+    for (std::vector<Route*>::iterator it = _routes.begin(); it != _routes.end(); ++it)
+        delete *it;
+}
 
-    ServicesType::size_type n = 0;
-    while (n < _services.size())
+void Mapper::RouteTable::add(const std::string& url, Service& service)
+{
+    Route* route = new Route();
+    route->order = _nextOrder++;
+    route->service = &service;
+    route->url = url;
+    _routes.push_back(route);
+    insert(route);
+}
+
+void Mapper::RouteTable::add(const Regex& regex, Service& service)
+{
+    Route* route = new Route();
+    route->order = _nextOrder++;
+    route->service = &service;
+    route->regex = regex;
+    _routes.push_back(route);
+    _regex.push_back(route);
+}
+
+void Mapper::RouteTable::insert(Route* route)
+{
+    const std::string& url = route->url;
+    route->params.clear();
+    Node* node = &_root;
+
+    std::string::size_type b = 0;
+    while (true)
     {
-        if (_services[n].second == &service)
+        std::string::size_type e = url.find('/', b);
+        std::string segment = url.substr(b, e == std::string::npos ? std::string::npos : e - b);
+
+        if (e == std::string::npos && segment == "*")
         {
-            _services.erase(_services.begin() + n);
+            node->rest.push_back(route);
+            break;
+        }
+
+        if (segment.size() > 1 && segment[0] == '\\')
+        {
+            // escaped literal segment
+            node = node->child(segment.substr(1));
+        }
+        else if (isParam(segment))
+        {
+            route->params.push_back(segment.substr(1, segment.size() - 2));
+            node = node->paramChild();
         }
         else
         {
-            ++n;
+            node = node->child(segment);
+        }
+
+        if (e == std::string::npos)
+        {
+            node->exact.push_back(route);
+            break;
         }
+
+        b = e + 1;
     }
 }
 
-Responder* Mapper::getResponder(const Request& request)
+void Mapper::RouteTable::addMatches(const std::vector<const Route*>& routes,
+    const Captures& captures, std::vector<Match>& matches) const
 {
-    log_debug("get responder for url <" << request.url() << '>');
+    for (std::vector<const Route*>::const_iterator it = routes.begin(); it != routes.end(); ++it)
+    {
+        matches.push_back(Match());
+        matches.back().route = *it;
+        matches.back().captures = captures;
+    }
+}
+
+// Collects all routes of the trie below node, which match url from pos on.
+// pos is the start of the next segment or npos, when the url is consumed.
+void Mapper::RouteTable::match(const Node& node, const std::string& url,
+    std::string::size_type pos, Captures& captures, std::vector<Match>& matches) const
+{
+    if (pos == std::string::npos)
+    {
+        addMatches(node.exact, captures, matches);
+        return;
+    }
 
-    ReadLock serviceLock(_serviceMutex);
+    addMatches(node.rest, captures, matches);
 
-    for (ServicesType::const_iterator it = _services.begin();
-         it != _services.end(); ++it)
+    std::string::size_type e = url.find('/', pos);
+    std::string::size_type end = e == std::string::npos ? url.size() : e;
+    std::string::size_type next = e == std::string::npos ? std::string::npos : e + 1;
+
+    const Node* child = node.find(url, pos, end);
+    if (child)
+        match(*child, url, next, captures, matches);
+
+    if (node.param() && end > pos)
     {
-        if (it->first.match(request.url()))
+        captures.push_back(Captures::value_type(pos, end - pos));
+        match(*node.param(), url, next, captures, matches);
+        captures.pop_back();
+    }
+}
+
+Responder* Mapper::RouteTable::getResponder(Request& request, NotAuthenticatedService& noAuthService) const
+{
+    const std::string& url = request.url();
+
+    std::vector<Match> matches;
+    Captures captures;
+    match(_root, url, 0, captures, matches);
+    std::sort(matches.begin(), matches.end());
+
+    // Merge the matches of the trie with the regular expressions in order
+    // of registration. Regular expressions registered after a matching route
+    // are tested only when that route does not deliver a responder.
+    std::vector<Match>::const_iterator mit = matches.begin();
+    std::vector<const Route*>::const_iterator rit = _regex.begin();
+    while (mit != matches.end() || rit != _regex.end())
+    {
+        const Route* route;
+        if (rit == _regex.end() || (mit != matches.end() && mit->route->order < (*rit)->order))
         {
-            if (!it->second->checkAuth(request))
-            {
-                return _noAuthService.createResponder(request, it->second->realm(), it->second->authContent());
-            }
+            route = mit->route;
 
-            Responder* resp = it->second->doCreateResponder(request);
-            if (resp)
-            {
-                log_debug("got responder");
-                return resp;
-            }
+            Request::PathParams params;
+            for (unsigned n = 0; n < route->params.size(); ++n)
+                params.push_back(Request::PathParams::value_type(route->params[n],
+                    url.substr(mit->captures[n].first, mit->captures[n].second)));
+            request.pathParams(params);
+
+            ++mit;
+        }
+        else
+        {
+            route = *rit++;
+            if (!route->regex.match(url))
+                continue;
+
+            request.pathParams(Request::PathParams());
+        }
+
+        if (!route->service->checkAuth(request))
+        {
+            return noAuthService.createResponder(request, route->service->realm(), route->service->authContent());
+        }
+
+        Responder* resp = route->service->doCreateResponder(request);
+        if (resp)
+        {
+            log_debug("got responder");
+            return resp;
         }
     }
 
+    return 0;
+}
+
+Mapper::Mapper()
+    : _routes(new RouteTable())
+{
+}
+
+Mapper::~Mapper()
+{
+}
+
+void Mapper::addService(const std::string& url, Service& service)
+{
+    log_debug("add service for url <" << url << '>');
+
+    MutexLock lock(_writeMutex);
+    RouteTable* routes = new RouteTable(_routes.current(), 0);
+    routes->add(url, service);
+    _routes.publish(routes);
+}
+
+void Mapper::addService(const Regex& url, Service& service)
+{
+    log_debug("add service for regex");
+
+    MutexLock lock(_writeMutex);
+    RouteTable* routes = new RouteTable(_routes.current(), 0);
+    routes->add(url, service);
+    _routes.publish(routes);
+}
+
+void Mapper::removeService(Service& service)
+{
+    MutexLock lock(_writeMutex);
+
+    // after publishing no lookup uses the service any more
+    _routes.publish(new RouteTable(_routes.current(), &service));
+
+    service.waitIdle();
+}
+
+Responder* Mapper::getResponder(Request& request)
+{
+    log_debug("get responder for url <" << request.url() << '>');
+
+    Snapshot<RouteTable>::Reader routes(_routes);
+
+    Responder* resp = routes->getResponder(request, _noAuthService);
+    if (resp)
+        return resp;
+
     log_debug("use default responder");
     return _defaultService.createResponder(request);
 }
@@ -31,7 +31,8 @@
 
 #include "notfoundservice.h"
 #include "notauthenticatedservice.h"
-#include <map>
+#include "snapshot.h"
+#include <cxxtools/mutex.h>
 #include <cxxtools/regex.h>
 
 namespace cxxtools
@@ -39,36 +40,39 @@ namespace cxxtools
 namespace http
 {
 
+/**
+    Maps urls to services.
+
+    Urls are mapped with a route table, which is compiled into a trie of
+    path segments. Literal urls and url patterns are matched by walking
+    the trie. A pattern may contain segments "{name}", which match any
+    non empty segment and pass it as path parameter to the request, and
+    a trailing segment "*", which matches the rest of the url. Regular
+    expressions are tested only when no earlier registered route in the
+    trie matches.
+
+    The route table is replaced by a new one on each change, so that
+    lookups need no lock.
+ */
 class Mapper
 {
     public:
+        Mapper();
+        ~Mapper();
+
         void addService(const std::string& url, Service& service);
         void addService(const Regex& url, Service& service);
         void removeService(Service& service);
 
-        Responder* getResponder(const Request& request);
+        Responder* getResponder(Request& request);
         Responder* getDefaultResponder(const Request& request)
             { return _defaultService.createResponder(request); }
 
     private:
-        struct Key
-        {
-          Regex regex;
-          std::string url;
-          Key() { }
-          Key(const Regex& regex_)
-            : regex(regex_)
-          { }
-          Key(const std::string& url_)
-            : url(url_)
-          { }
-          bool match(const std::string& u) const
-          { return regex.empty() ? url == u
-                                 : regex.match(u); }
-        };
-        typedef std::vector<std::pair<Key, Service*> > ServicesType;
-        ReadWriteMutex _serviceMutex;
-        ServicesType _services;
+        class RouteTable;
+
+        Mutex _writeMutex;
+        Snapshot<RouteTable> _routes;
         NotFoundService _defaultService;
         NotAuthenticatedService _noAuthService;
 };
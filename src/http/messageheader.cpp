@@ -68,20 +68,99 @@ int compareIgnoreCase(const char* s1, const char* s2)
                 : *it2 ? -1 : 0;
 }
 
-} 
+// FNV-1a over the key folded to lower case
+unsigned hashKey(const char* key)
+{
+    unsigned h = 2166136261u;
+    for ( ; *key; ++key)
+    {
+        unsigned char ch = static_cast<unsigned char>(*key);
+        if (ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
+        h = (h ^ ch) * 16777619u;
+    }
+    return h;
+}
+
+const unsigned contentLengthHash = hashKey("Content-Length");
+const unsigned connectionHash = hashKey("Connection");
+const unsigned transferEncodingHash = hashKey("Transfer-Encoding");
 
+} 
 
 const char* MessageHeader::getHeader(const char* key) const
 {
-    for (const_iterator it = begin(); it != end(); ++it)
+    return getHeader(key, hashKey(key));
+}
+
+const char* MessageHeader::getHeader(const char* key, unsigned hash) const
+{
+    if (_indexed > MAXINDEXED)
     {
-        if (compareIgnoreCase(key, it->first) == 0)
-            return it->second;
+        for (const_iterator it = begin(); it != end(); ++it)
+        {
+            if (compareIgnoreCase(key, it->first) == 0)
+                return it->second;
+        }
+
+        return 0;
+    }
+
+    unsigned short tag = static_cast<unsigned short>(hash >> 16);
+    for (unsigned n = hash; _index[n % INDEXSIZE].offset != 0; ++n)
+    {
+        const IndexEntry& e = _index[n % INDEXSIZE];
+        if (e.tag == tag)
+        {
+            const char* k = _rawdata + e.offset - 1;
+            if (compareIgnoreCase(key, k) == 0)
+                return k + std::strlen(k) + 1;
+        }
     }
 
     return 0;
 }
 
+void MessageHeader::clearIndex()
+{
+    std::memset(_index, 0, sizeof(_index));
+    _indexed = 0;
+}
+
+void MessageHeader::indexKey(const char* key)
+{
+    if (_indexed > MAXINDEXED)
+        return;
+
+    unsigned hash = hashKey(key);
+    unsigned short tag = static_cast<unsigned short>(hash >> 16);
+    unsigned n = hash;
+    for ( ; _index[n % INDEXSIZE].offset != 0; ++n)
+    {
+        // only the first header with a key is indexed
+        const IndexEntry& e = _index[n % INDEXSIZE];
+        if (e.tag == tag && compareIgnoreCase(key, _rawdata + e.offset - 1) == 0)
+            return;
+    }
+
+    if (++_indexed > MAXINDEXED)
+    {
+        log_debug("more than " << MAXINDEXED << " keys in header; index disabled");
+        return;
+    }
+
+    IndexEntry& e = _index[n % INDEXSIZE];
+    e.tag = tag;
+    e.offset = static_cast<unsigned short>(key - _rawdata + 1);
+}
+
+void MessageHeader::rebuildIndex()
+{
+    clearIndex();
+    for (const_iterator it = begin(); it != end(); ++it)
+        indexKey(it->first);
+}
+
 bool MessageHeader::isHeaderValue(const char* key, const char* value) const
 {
     const char* h = getHeader(key);
@@ -96,6 +175,7 @@ void MessageHeader::clear()
     _endOffset = 0;
     _httpVersionMajor = 1;
     _httpVersionMinor = 1;
+    clearIndex();
 }
 
 void MessageHeader::setHeader(const char* key, const char* value, bool replace)
@@ -117,6 +197,7 @@ void MessageHeader::setHeader(const char* key, const char* value, bool replace)
         throw std::runtime_error("message header too big");
 
     std::strcpy(p, key);   // copy key
+    indexKey(p);
     p += lk + 1;
     std::strcpy(p, value); // copy value
     p[lv + 1] = '\0';      // put new message end marker in place
@@ -124,11 +205,42 @@ void MessageHeader::setHeader(const char* key, const char* value, bool replace)
     _endOffset = (p + lv + 1) - _rawdata;
 }
 
+void MessageHeader::addHeader(const char* key, std::size_t keyLength,
+                              const char* value, std::size_t valueLength)
+{
+    if (keyLength == 0)
+        throw std::runtime_error("empty key not allowed in messageheader");
+
+    // the header is stored as null terminated strings, so an embedded null
+    // character would silently truncate the field
+    if (std::memchr(key, '\0', keyLength) || std::memchr(value, '\0', valueLength))
+        throw std::runtime_error("null character not allowed in messageheader");
+
+    char* p = eptr();
+
+    if (p - _rawdata + keyLength + valueLength + 3 > MAXHEADERSIZE)
+        throw std::runtime_error("message header too big");
+
+    std::memcpy(p, key, keyLength);
+    p[keyLength] = '\0';
+    indexKey(p);
+    p += keyLength + 1;
+    std::memcpy(p, value, valueLength);
+    p += valueLength;
+    p[0] = '\0';
+    p[1] = '\0';      // message end marker
+
+    _endOffset = (p + 1) - _rawdata;
+}
+
 void MessageHeader::removeHeader(const char* key)
 {
     if (!*key)
         throw std::runtime_error("empty key not allowed in messageheader");
 
+    if (getHeader(key) == 0)
+        return;
+
     char* p = eptr();
 
     const_iterator it = begin();
@@ -152,16 +264,19 @@ void MessageHeader::removeHeader(const char* key)
     }
 
     _endOffset = p - _rawdata;
+
+    rebuildIndex();
 }
 
 bool MessageHeader::chunkedTransferEncoding() const
 {
-    return isHeaderValue("Transfer-Encoding", "chunked");
+    const char* h = getHeader("Transfer-Encoding", transferEncodingHash);
+    return h != 0 && compareIgnoreCase(h, "chunked") == 0;
 }
 
 std::size_t MessageHeader::contentLength() const
 {
-    const char* s = getHeader("Content-Length");
+    const char* s = getHeader("Content-Length", contentLengthHash);
     if (s == 0)
         return 0;
 
@@ -174,7 +289,7 @@ std::size_t MessageHeader::contentLength() const
 
 bool MessageHeader::keepAlive() const
 {
-    const char* ch = getHeader("Connection");
+    const char* ch = getHeader("Connection", connectionHash);
 
     if (ch == 0)
         return httpVersionMajor() == 1
@@ -184,6 +299,11 @@ bool MessageHeader::keepAlive() const
 }
 
 char* MessageHeader::htdateCurrent(char* buffer)
+{
+    return htdate(Clock::getSystemTime(), buffer);
+}
+
+char* MessageHeader::htdate(const DateTime& dt, char* buffer)
 {
     int year = 0;
     unsigned month = 0;
@@ -193,7 +313,6 @@ char* MessageHeader::htdateCurrent(char* buffer)
     unsigned sec = 0;
     unsigned msec = 0;
 
-    DateTime dt = Clock::getSystemTime();
     dt.get(year, month, day, hour, min, sec, msec);
     unsigned dayOfWeek = dt.date().dayOfWeek();
 
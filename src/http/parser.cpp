@@ -33,6 +33,10 @@
 #include <algorithm>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 log_define("cxxtools.http.parser")
 
 namespace cxxtools {
@@ -70,6 +74,84 @@ namespace http {
                  : ch >= 'A' && ch <= 'Z' ? ch - 'A' + 10
                  : 0;
         }
+
+        // Returns the first character in [b, e), which is a colon or not
+        // valid in a field name.
+        const char* scanFieldName(const char* b, const char* e)
+        {
+#ifdef __SSE2__
+            const __m128i colon = _mm_set1_epi8(':');
+            const __m128i lo = _mm_set1_epi8(32);
+            const __m128i hi = _mm_set1_epi8(127);
+            for ( ; e - b >= 16; b += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                __m128i valid = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, colon))
+                         | (~_mm_movemask_epi8(valid) & 0xffff);
+                if (mask)
+                    return b + __builtin_ctz(mask);
+            }
+#endif
+            for ( ; b < e; ++b)
+            {
+                unsigned char ch = static_cast<unsigned char>(*b);
+                if (ch == ':' || ch <= 32 || ch >= 127)
+                    break;
+            }
+            return b;
+        }
+
+        // Returns the first control character other than HTAB in [b, e). This
+        // is normally the CR or LF of the line end; any other control
+        // character (NUL included) is left to the state machine, which
+        // rejects it.
+        const char* scanLineEnd(const char* b, const char* e)
+        {
+#ifdef __SSE2__
+            const __m128i ctl = _mm_set1_epi8(0x1f);
+            const __m128i tab = _mm_set1_epi8('\t');
+            for ( ; e - b >= 16; b += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                int mask = _mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi8(v, tab),
+                                                              _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v)));
+                if (mask)
+                    return b + __builtin_ctz(mask);
+            }
+#endif
+            for ( ; b < e; ++b)
+            {
+                unsigned char ch = static_cast<unsigned char>(*b);
+                if (ch < 32 && ch != '\t')
+                    break;
+            }
+            return b;
+        }
+
+        inline bool isFieldSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t';
+        }
+
+        inline bool isInvalidFieldChar(char ch)
+        {
+            return static_cast<unsigned char>(ch) < 32 && ch != '\t';
+        }
+
+        // Gives access to the get area of a stream buffer.
+        class GetArea : public std::streambuf
+        {
+            public:
+                static const char* begin(std::streambuf& sb)
+                { return (sb.*(&GetArea::gptr))(); }
+
+                static const char* end(std::streambuf& sb)
+                { return (sb.*(&GetArea::egptr))(); }
+
+                static void consume(std::streambuf& sb, std::size_t n)
+                { (sb.*(&GetArea::gbump))(static_cast<int>(n)); }
+        };
     }
 
     void HeaderParser::Event::onMethod(const std::string& method)
@@ -104,6 +186,13 @@ namespace http {
     {
     }
 
+    void HeaderParser::Event::onField(const char* key, std::size_t keyLength,
+                                      const char* value, std::size_t valueLength)
+    {
+        onKey(std::string(key, keyLength));
+        onValue(std::string(value, valueLength));
+    }
+
     void HeaderParser::MessageHeaderEvent::onHttpVersion(unsigned major, unsigned minor)
     {
          _header.httpVersion(major, minor);
@@ -119,12 +208,45 @@ namespace http {
         _header.addHeader(_key, value.c_str());
     }
 
+    void HeaderParser::MessageHeaderEvent::onField(const char* key, std::size_t keyLength,
+                                                   const char* value, std::size_t valueLength)
+    {
+        _header.addHeader(key, keyLength, value, valueLength);
+    }
+
     std::size_t HeaderParser::advance(std::streambuf& sb)
     {
         std::size_t ret = 0;
 
         while (sb.in_avail() > 0)
         {
+            // Header fields are parsed line by line directly from the get
+            // area of the stream buffer as long as they are complete and
+            // simple; everything else is left to the state machine.
+            if (state == &HeaderParser::state_hfieldbody_crlf)
+            {
+                const char* b = GetArea::begin(sb);
+                if (b < GetArea::end(sb) && *b > 32 && *b < 127)
+                {
+                    ev.onValue(token);
+                    state = &HeaderParser::state_h0;
+                }
+            }
+
+            if (state == &HeaderParser::state_h0)
+            {
+                std::size_t n = parseFields(GetArea::begin(sb), GetArea::end(sb));
+                if (n > 0)
+                {
+                    GetArea::consume(sb, n);
+                    ret += n;
+                    if (end())
+                        return ret;
+                    if (sb.in_avail() <= 0)
+                        break;
+                }
+            }
+
             ++ret;
             if (parse(sb.sbumpc()))
                 return ret;
@@ -133,6 +255,51 @@ namespace http {
         return ret;
     }
 
+    std::size_t HeaderParser::parseFields(const char* b, const char* e)
+    {
+        const char* p = b;
+        while (p < e)
+        {
+            if (*p == '\n' || (*p == '\r' && p + 1 < e && p[1] == '\n'))
+            {
+                // empty line - end of header
+                p += (*p == '\r' ? 2 : 1);
+                ev.onEnd();
+                state = &HeaderParser::state_end;
+                break;
+            }
+
+            const char* colon = scanFieldName(p, e);
+            if (colon == p || colon == e || *colon != ':')
+                break;
+
+            const char* v = colon + 1;
+            while (v < e && isFieldSpace(*v))
+                ++v;
+
+            const char* eol = scanLineEnd(v, e);
+            if (eol == v || eol == e || (*eol != '\r' && *eol != '\n'))
+                break;
+
+            const char* next = eol + 1;
+            if (*eol == '\r')
+            {
+                if (next == e || *next != '\n')
+                    break;
+                ++next;
+            }
+
+            // we need to see, that the next line is not a continuation
+            if (next == e || *next == ' ' || *next == '\t')
+                break;
+
+            ev.onField(p, colon - p, v, eol - v);
+            p = next;
+        }
+
+        return p - b;
+    }
+
     void HeaderParser::state_cmd0(char ch)
     {
         if (istokenchar(ch))
@@ -605,11 +772,17 @@ namespace http {
             state = &HeaderParser::state_hfieldbody_crlf;
             return;
         }
-        else if (std::isspace(ch))
+        else if (isFieldSpace(ch))
+        {
+            return;
+        }
+        else if (isInvalidFieldChar(ch))
         {
+            log_warn("invalid character " << chartoprint(ch) << " in fieldbody");
+            state = &HeaderParser::state_error;
             return;
         }
-        else if (!std::isspace(ch))
+        else
         {
             token.reserve(32);
             token = ch;
@@ -630,6 +803,12 @@ namespace http {
             state = &HeaderParser::state_hfieldbody_crlf;
             return;
         }
+        else if (isInvalidFieldChar(ch))
+        {
+            log_warn("invalid character " << chartoprint(ch) << " in fieldbody");
+            state = &HeaderParser::state_error;
+            return;
+        }
         else
         {
             token += ch;
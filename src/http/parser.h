@@ -55,6 +55,12 @@ class CXXTOOLS_HTTP_API HeaderParser
                 virtual void onValue(const std::string& value);
                 virtual void onHttpReturn(unsigned ret, const std::string& text);
                 virtual void onEnd();
+
+                /// Receives a complete header field found by the fast path
+                /// of the parser. The default implementation passes key and
+                /// value to onKey and onValue.
+                virtual void onField(const char* key, std::size_t keyLength,
+                                     const char* value, std::size_t valueLength);
         };
 
         class CXXTOOLS_HTTP_API MessageHeaderEvent : public Event
@@ -70,6 +76,8 @@ class CXXTOOLS_HTTP_API HeaderParser
                 virtual void onHttpVersion(unsigned major, unsigned minor);
                 virtual void onKey(const std::string& key);
                 virtual void onValue(const std::string& value);
+                virtual void onField(const char* key, std::size_t keyLength,
+                                     const char* value, std::size_t valueLength);
         };
 
     private:
@@ -115,6 +123,8 @@ class CXXTOOLS_HTTP_API HeaderParser
         void state_end(char ch);
         void state_error(char ch);
 
+        std::size_t parseFields(const char* b, const char* e);
+
         state_type state;
         Event& ev;
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "reactor.h"
+#include "socket.h"
+#include "serverimplbase.h"
+#include <cxxtools/net/tcpserver.h>
+#include <cxxtools/log.h>
+
+log_define("cxxtools.http.reactor")
+
+namespace cxxtools
+{
+namespace http
+{
+
+class AddListenerEvent : public BasicEvent<AddListenerEvent>
+{
+        net::TcpServer* _listener;
+
+    public:
+        explicit AddListenerEvent(net::TcpServer* listener)
+            : _listener(listener)
+            { }
+
+        net::TcpServer* listener() const   { return _listener; }
+};
+
+class ReleaseSocketsEvent : public BasicEvent<ReleaseSocketsEvent>
+{
+};
+
+Reactor::Reactor(ServerImplBase& server)
+    : _server(server),
+      _thread(callable(*this, &Reactor::run))
+{
+    _loop.event.subscribe(slot(*this, &Reactor::onAddListener));
+    _loop.event.subscribe(slot(*this, &Reactor::onReleaseSockets));
+}
+
+Reactor::~Reactor()
+{
+    for (std::set<Socket*>::iterator it = _sockets.begin(); it != _sockets.end(); ++it)
+    {
+        (*it)->removeSelector();
+        delete *it;
+    }
+
+    for (std::vector<Socket*>::iterator it = _released.begin(); it != _released.end(); ++it)
+        delete *it;
+
+    for (std::vector<net::TcpServer*>::iterator it = _listeners.begin(); it != _listeners.end(); ++it)
+        delete *it;
+}
+
+void Reactor::addListener(net::TcpServer* listener)
+{
+    _loop.commitEvent(AddListenerEvent(listener));
+}
+
+void Reactor::start()
+{
+    _thread.start();
+}
+
+void Reactor::terminate()
+{
+    _loop.exit();
+    if (_thread.state() != Thread::Ready)
+        _thread.join();
+}
+
+void Reactor::run()
+{
+    log_info("reactor thread running");
+
+    try
+    {
+        _loop.run();
+    }
+    catch (const std::exception& e)
+    {
+        log_error("reactor terminated with exception: " << e.what());
+    }
+
+    log_info("reactor thread terminated");
+}
+
+void Reactor::onAddListener(const AddListenerEvent& event)
+{
+    net::TcpServer* listener = event.listener();
+    _listeners.push_back(listener);
+    _loop.add(*listener);
+    connect(listener->connectionPending, *this, &Reactor::onConnectionPending);
+}
+
+void Reactor::onReleaseSockets(const ReleaseSocketsEvent& /*event*/)
+{
+    log_debug("delete " << _released.size() << " sockets");
+
+    for (std::vector<Socket*>::iterator it = _released.begin(); it != _released.end(); ++it)
+        delete *it;
+    _released.clear();
+}
+
+void Reactor::onConnectionPending(net::TcpServer& listener)
+{
+    Socket* socket = new Socket(_server, listener);
+
+    try
+    {
+        socket->accept();
+    }
+    catch (const std::exception& e)
+    {
+        log_warn("failed to accept connection: " << e.what());
+        delete socket;
+        return;
+    }
+
+    log_debug("connection accepted from " << socket->getPeerAddr());
+
+    _sockets.insert(socket);
+    socket->setSelector(&_loop);
+    connect(socket->inputReady, *this, &Reactor::onInput);
+    connect(socket->timeout, *this, &Reactor::onTimeout);
+    connect(socket->closed, *this, &Reactor::onClosed);
+}
+
+void Reactor::onInput(Socket& socket)
+{
+    try
+    {
+        socket.onInput(socket.buffer());
+    }
+    catch (const std::exception& e)
+    {
+        log_debug("error occured in device: " << e.what());
+        socket.close();
+    }
+
+    if (!socket.isConnected())
+        release(&socket);
+}
+
+void Reactor::onTimeout(Socket& socket)
+{
+    log_debug("timeout; socket " << static_cast<void*>(&socket));
+    socket.close();
+    release(&socket);
+}
+
+void Reactor::onClosed(net::TcpSocket& socket)
+{
+    release(static_cast<Socket*>(&socket));
+}
+
+void Reactor::release(Socket* socket)
+{
+    // The socket may be in the middle of a signal emission, so it is
+    // deleted later, when the event loop processes the release event.
+    if (_sockets.erase(socket) == 0)
+        return;
+
+    log_debug("release socket " << static_cast<void*>(socket));
+
+    socket->removeSelector();
+
+    if (_released.empty())
+        _loop.commitEvent(ReleaseSocketsEvent());
+
+    _released.push_back(socket);
+}
+
+}
+}
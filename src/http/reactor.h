@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_HTTP_REACTOR_H
+#define CXXTOOLS_HTTP_REACTOR_H
+
+#include <cxxtools/eventloop.h>
+#include <cxxtools/thread.h>
+#include <cxxtools/connectable.h>
+#include <set>
+#include <vector>
+
+namespace cxxtools
+{
+
+namespace net
+{
+    class TcpServer;
+    class TcpSocket;
+}
+
+namespace http
+{
+
+class ServerImplBase;
+class Socket;
+class AddListenerEvent;
+class ReleaseSocketsEvent;
+
+/**
+ A reactor runs an event loop in its own thread. It accepts connections on
+ its own listeners and processes them until they are closed. Sockets never
+ leave the thread, which accepted them.
+ */
+class Reactor : public Connectable
+{
+    public:
+        explicit Reactor(ServerImplBase& server);
+        ~Reactor();
+
+        /// Passes the ownership of the listener to the reactor; may be called from any thread.
+        void addListener(net::TcpServer* listener);
+
+        void start();
+        void terminate();
+
+    private:
+        void run();
+
+        void onAddListener(const AddListenerEvent& event);
+        void onReleaseSockets(const ReleaseSocketsEvent& event);
+        void onConnectionPending(net::TcpServer& listener);
+        void onInput(Socket& socket);
+        void onTimeout(Socket& socket);
+        void onClosed(net::TcpSocket& socket);
+
+        void release(Socket* socket);
+
+        ServerImplBase& _server;
+        EventLoop _loop;
+        AttachedThread _thread;
+
+        std::vector<net::TcpServer*> _listeners;
+        std::set<Socket*> _sockets;
+        std::vector<Socket*> _released;
+};
+
+}
+}
+
+#endif // CXXTOOLS_HTTP_REACTOR_H
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "reactorserverimpl.h"
+#include "reactor.h"
+
+#include <cxxtools/eventloop.h>
+#include <cxxtools/log.h>
+#include <cxxtools/net/tcpserver.h>
+
+#include <unistd.h>
+
+log_define("cxxtools.http.server.reactor")
+
+namespace cxxtools
+{
+namespace http
+{
+
+class ReactorServerStartEvent : public BasicEvent<ReactorServerStartEvent>
+{
+        const ReactorServerImpl* _server;
+
+    public:
+        explicit ReactorServerStartEvent(const ReactorServerImpl* server)
+            : _server(server)
+            { }
+
+        const ReactorServerImpl* server() const   { return _server; }
+
+};
+
+ReactorServerImpl::ReactorServerImpl(EventLoopBase& eventLoop, Signal<Server::Runmode>& runmodeChanged)
+    : ServerImplBase(eventLoop, runmodeChanged)
+{
+    _eventLoop.event.subscribe(slot(*this, &ReactorServerImpl::onServerStart));
+
+    connect(_eventLoop.exited, *this, &ReactorServerImpl::terminate);
+
+    _eventLoop.commitEvent(ReactorServerStartEvent(this));
+}
+
+ReactorServerImpl::~ReactorServerImpl()
+{
+    try
+    {
+        terminate();
+    }
+    catch (const std::exception& e)
+    {
+        log_fatal("exception in http-server termination occured: " << e.what());
+    }
+}
+
+net::TcpServer* ReactorServerImpl::createListener(const ListenParams& params)
+{
+    return new net::TcpServer(params.ip, params.port, params.backlog,
+        net::TcpServer::DEFER_ACCEPT | net::TcpServer::REUSEPORT);
+}
+
+void ReactorServerImpl::listen(const std::string& ip, unsigned short int port, int backlog)
+{
+    log_debug("listen on " << ip << " port " << port);
+
+    ListenParams params;
+    params.ip = ip;
+    params.port = port;
+    params.backlog = backlog;
+
+    MutexLock lock(_mutex);
+
+    // create the first listener immediately, so that errors are reported to the caller
+    net::TcpServer* listener = createListener(params);
+
+    if (_reactors.empty())
+    {
+        _listeners.push_back(listener);
+    }
+    else
+    {
+        _reactors[0]->addListener(listener);
+        for (unsigned n = 1; n < _reactors.size(); ++n)
+            _reactors[n]->addListener(createListener(params));
+    }
+
+    _listenParams.push_back(params);
+}
+
+void ReactorServerImpl::start()
+{
+    log_trace("start server");
+    runmode(Server::Starting);
+
+    MutexLock lock(_mutex);
+
+    unsigned count = reactorThreads();
+    if (count == 0)
+    {
+        long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+        count = n > 0 ? static_cast<unsigned>(n) : 1;
+    }
+
+    log_debug("start " << count << " reactors");
+
+    try
+    {
+        for (unsigned n = 0; n < count; ++n)
+        {
+            Reactor* reactor = new Reactor(*this);
+            _reactors.push_back(reactor);
+
+            if (n == 0)
+            {
+                for (unsigned l = 0; l < _listeners.size(); ++l)
+                    reactor->addListener(_listeners[l]);
+                _listeners.clear();
+            }
+            else
+            {
+                for (unsigned l = 0; l < _listenParams.size(); ++l)
+                    reactor->addListener(createListener(_listenParams[l]));
+            }
+
+            reactor->start();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        log_error("failed to start reactors: " << e.what());
+        runmode(Server::Failed);
+        throw;
+    }
+
+    runmode(Server::Running);
+}
+
+void ReactorServerImpl::terminate()
+{
+    log_trace("terminate");
+
+    MutexLock lock(_mutex);
+
+    if (runmode() == Server::Stopped && _reactors.empty() && _listeners.empty())
+        return;
+
+    runmode(Server::Terminating);
+
+    try
+    {
+        log_debug("terminate " << _reactors.size() << " reactors");
+        for (std::vector<Reactor*>::iterator it = _reactors.begin(); it != _reactors.end(); ++it)
+        {
+            (*it)->terminate();
+            delete *it;
+        }
+        _reactors.clear();
+
+        for (std::vector<net::TcpServer*>::iterator it = _listeners.begin(); it != _listeners.end(); ++it)
+            delete *it;
+        _listeners.clear();
+
+        runmode(Server::Stopped);
+    }
+    catch (const std::exception& e)
+    {
+        runmode(Server::Failed);
+    }
+}
+
+void ReactorServerImpl::onServerStart(const ReactorServerStartEvent& event)
+{
+    if (event.server() == this)
+    {
+        start();
+    }
+}
+
+}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_HTTP_REACTORSERVERIMPL_H
+#define CXXTOOLS_HTTP_REACTORSERVERIMPL_H
+
+#include "serverimplbase.h"
+#include <cxxtools/connectable.h>
+#include <cxxtools/mutex.h>
+#include <vector>
+
+namespace cxxtools
+{
+
+namespace net
+{
+    class TcpServer;
+}
+
+namespace http
+{
+
+class Reactor;
+class ReactorServerStartEvent;
+
+/**
+ Server implementation for Server::Reactor mode. Each reactor thread listens
+ with its own SO_REUSEPORT socket on each address and processes the
+ connections it accepts without handing them to other threads.
+ */
+class ReactorServerImpl : public ServerImplBase, public Connectable
+{
+    public:
+        ReactorServerImpl(EventLoopBase& eventLoop, Signal<Server::Runmode>& runmodeChanged);
+        ~ReactorServerImpl();
+
+        // override from ServerImplBase
+        void listen(const std::string& ip, unsigned short int port, int backlog);
+
+        // override from ServerImplBase
+        void terminate();
+
+    private:
+        struct ListenParams
+        {
+            std::string ip;
+            unsigned short int port;
+            int backlog;
+        };
+
+        net::TcpServer* createListener(const ListenParams& params);
+
+        void onServerStart(const ReactorServerStartEvent& event);
+        void start();
+
+        std::vector<ListenParams> _listenParams;
+
+        // listeners created before start; they are passed to the first reactor
+        std::vector<net::TcpServer*> _listeners;
+
+        std::vector<Reactor*> _reactors;
+        Mutex _mutex;
+};
+
+}
+}
+
+#endif // CXXTOOLS_HTTP_REACTORSERVERIMPL_H
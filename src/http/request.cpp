@@ -30,6 +30,7 @@
 #include <cxxtools/textstream.h>
 #include <cxxtools/base64codec.h>
 #include <string>
+#include <sstream>
 
 namespace cxxtools {
 
@@ -58,6 +59,14 @@ Request::Auth Request::auth() const
     return ret;
 }
 
+std::string Request::pathParam(const std::string& name) const
+{
+    for (PathParams::const_iterator it = _pathParams.begin(); it != _pathParams.end(); ++it)
+        if (it->first == name)
+            return it->second;
+    return std::string();
+}
+
 }
 
 }
@@ -29,6 +29,7 @@
 #include <cxxtools/http/responder.h>
 #include <cxxtools/http/reply.h>
 #include <cxxtools/http/request.h>
+#include <istream>
 
 namespace cxxtools
 {
@@ -30,6 +30,7 @@
 #include <cxxtools/eventloop.h>
 #include <cxxtools/log.h>
 #include "serverimpl.h"
+#include "reactorserverimpl.h"
 
 log_define("cxxtools.http.server")
 
@@ -42,6 +43,12 @@ Server::Server(EventLoopBase& eventLoop)
 {
 }
 
+Server::Server(EventLoopBase& eventLoop, Mode mode)
+    : _impl(mode == Reactor ? static_cast<ServerImplBase*>(new ReactorServerImpl(eventLoop, runmodeChanged))
+                            : static_cast<ServerImplBase*>(new ServerImpl(eventLoop, runmodeChanged)))
+{
+}
+
 Server::Server(EventLoopBase& eventLoop, const std::string& ip, unsigned short int port, int backlog)
     : _impl(new ServerImpl(eventLoop, runmodeChanged))
 {
@@ -142,6 +149,16 @@ void Server::maxThreads(unsigned m)
     _impl->maxThreads(m);
 }
 
+unsigned Server::reactorThreads() const
+{
+    return _impl->reactorThreads();
+}
+
+void Server::reactorThreads(unsigned n)
+{
+    _impl->reactorThreads(n);
+}
+
 } // namespace http
 
 } // namespace cxxtools
@@ -51,6 +51,7 @@ class ServerImplBase : private NonCopyable
               _keepAliveTimeout(30000),
               _minThreads(5),
               _maxThreads(200),
+              _reactorThreads(0),
               _runmodeChanged(runmodeChanged),
               _runmode(Server::Stopped)
         { }
@@ -66,7 +67,7 @@ class ServerImplBase : private NonCopyable
         void removeService(Service& service)
         { _mapper.removeService(service); }
 
-        Responder* getResponder(const Request& request)
+        Responder* getResponder(Request& request)
             { return _mapper.getResponder(request); }
         Responder* getDefaultResponder(const Request& request)
             { return _mapper.getDefaultResponder(request); }
@@ -85,6 +86,9 @@ class ServerImplBase : private NonCopyable
         unsigned maxThreads() const           { return _maxThreads; }
         void maxThreads(unsigned m)           { _maxThreads = m; }
 
+        unsigned reactorThreads() const       { return _reactorThreads; }
+        void reactorThreads(unsigned n)       { _reactorThreads = n; }
+
         virtual void terminate()              { }
         Server::Runmode runmode() const
         { return _runmode; }
@@ -105,6 +109,7 @@ class ServerImplBase : private NonCopyable
 
         unsigned _minThreads;
         unsigned _maxThreads;
+        unsigned _reactorThreads;
 
         Signal<Server::Runmode>& _runmodeChanged;
         Server::Runmode _runmode;
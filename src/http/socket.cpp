@@ -27,13 +27,47 @@
  */
 
 #include "socket.h"
-#include "serverimpl.h"
+#include "serverimplbase.h"
+#include <cxxtools/ioerror.h>
+#include <cxxtools/selectable.h>
 #include <cxxtools/log.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
 #include <cassert>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+#include "error.h"
 #include "config.h"
 
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
 log_define("cxxtools.http.socket")
 
+namespace
+{
+    // bodies of at least this size are sent directly from the body buffer
+    // instead of copying them into the socket stream
+    const std::size_t zeroCopySize = 8192;
+
+    // number of iovecs passed to a single sendmsg call
+    const unsigned maxIov = 64;
+
+    // size of the file parts read into memory when the socket would block
+    const std::size_t fileChunkSize = 8192;
+
+    // A streamed reply waits for the client, when more than pendingHighWater
+    // bytes are pending, until less than pendingLowWater are left.
+    const std::size_t pendingHighWater = 262144;
+    const std::size_t pendingLowWater = 65536;
+}
+
 namespace cxxtools
 {
 
@@ -55,14 +89,20 @@ void Socket::ParseEvent::onUrlParam(const std::string& q)
     _request.qparams(q);
 }
 
-Socket::Socket(ServerImpl& server, net::TcpServer& tcpServer)
+Socket::Socket(ServerImplBase& server, net::TcpServer& tcpServer)
     : inputSlot(slot(*this, &Socket::onInput)),
       _tcpServer(tcpServer),
       _server(server),
       _parseEvent(_request),
       _parser(_parseEvent, false),
       _responder(0),
-      _accepted(false)
+      _accepted(false),
+      _chunkedReply(false),
+      _replyFailed(false),
+      _pendingWrite(false),
+      _pendingFd(-1),
+      _pendingFileOffset(0),
+      _pendingFileSize(0)
 {
     _stream.attachDevice(*this);
     cxxtools::connect(IODevice::inputReady, *this, &Socket::onIODeviceInput);
@@ -77,7 +117,13 @@ Socket::Socket(Socket& socket)
       _parseEvent(_request),
       _parser(_parseEvent, false),
       _responder(0),
-      _accepted(false)
+      _accepted(false),
+      _chunkedReply(false),
+      _replyFailed(false),
+      _pendingWrite(false),
+      _pendingFd(-1),
+      _pendingFileOffset(0),
+      _pendingFileSize(0)
 {
     _stream.attachDevice(*this);
     cxxtools::connect(IODevice::inputReady, *this, &Socket::onIODeviceInput);
@@ -129,6 +175,7 @@ void Socket::onInput(StreamBuffer& sb)
     if (sb.in_avail() == 0 || sb.device()->eof())
     {
         close();
+        closed(*this);
         return;
     }
 
@@ -226,6 +273,9 @@ void Socket::onInput(StreamBuffer& sb)
 bool Socket::doReply()
 {
     log_trace("http::Socket::doReply");
+
+    _reply.bodyBuffer().setSink(this);
+
     try
     {
         _responder->reply(_reply.body(), _request, _reply);
@@ -233,14 +283,45 @@ bool Socket::doReply()
     catch (const std::exception& e)
     {
         log_warn("responder reported error: " << e.what());
-        _reply.clear();
-        _responder->replyError(_reply.body(), _request, _reply, e);
+        if (_chunkedReply || _replyFailed)
+        {
+            // the header is sent already, so we can just drop the connection
+            _replyFailed = true;
+        }
+        else
+        {
+            _reply.clear();
+            _responder->replyError(_reply.body(), _request, _reply, e);
+        }
     }
 
+    _reply.bodyBuffer().setSink(0);
+
     _responder->release();
     _responder = 0;
 
-    sendReply();
+    if (!_replyFailed)
+    {
+        try
+        {
+            sendReply();
+        }
+        catch (const std::exception& e)
+        {
+            log_warn("failed to send reply: " << e.what());
+            _replyFailed = true;
+        }
+    }
+
+    if (_replyFailed)
+    {
+        _replyFailed = false;
+        _chunkedReply = false;
+        discardPending();
+        close();
+        timeout(*this);
+        return false;
+    }
 
     return onOutput(_stream.buffer());
 }
@@ -253,6 +334,18 @@ bool Socket::onOutput(StreamBuffer& sb)
 
     try
     {
+        if (_pendingWrite)
+        {
+            _pendingWrite = false;
+            _pendingData.erase(0, endWrite());
+        }
+
+        if (!sendPending())
+        {
+            _timer.start(_server.writeTimeout());
+            return true;
+        }
+
         sb.endWrite();
 
         if ( sb.out_avail() )
@@ -281,6 +374,7 @@ bool Socket::onOutput(StreamBuffer& sb)
             {
                 log_debug("don't do keep alive");
                 close();
+                closed(*this);
                 return false;
             }
         }
@@ -288,6 +382,7 @@ bool Socket::onOutput(StreamBuffer& sb)
     catch (const std::exception& e)
     {
         log_warn("exception occured when processing request: " << e.what());
+        discardPending();
         close();
         timeout(*this);
         return false;
@@ -303,17 +398,99 @@ void Socket::onTimeout()
 }
 
 void Socket::sendReply()
+{
+    log_info("request " << _request.method() << ' ' << _request.header().query()
+        << " ready, returncode " << _reply.httpReturnCode() << ' '
+        << _reply.httpReturnText());
+
+    BodyBuffer& body = _reply.bodyBuffer();
+
+    if (_chunkedReply)
+    {
+        // send the rest of the body and the terminating chunk
+        std::ostringstream prefix;
+        if (!body.empty())
+            prefix << std::hex << body.size() << "\r\n";
+        writeBody(prefix.str(), body, body.empty() ? "0\r\n\r\n" : "\r\n0\r\n\r\n");
+        _chunkedReply = false;
+    }
+    else if (_reply.bodyFd() >= 0)
+    {
+        std::ostringstream header;
+        writeReplyHeader(header, false);
+        std::string h = header.str();
+
+        iovec v;
+        v.iov_base = const_cast<char*>(h.data());
+        v.iov_len = h.size();
+        writeBuffers(&v, 1, true);
+
+        // the file is sent by sendPending from onOutput
+        _pendingFd = _reply.bodyFd();
+        _pendingFileOffset = _reply.bodyFileOffset();
+        _pendingFileSize = _reply.bodySize();
+    }
+    else if (body.size() < zeroCopySize)
+    {
+        writeReplyHeader(_stream, false);
+        _reply.sendBody(_stream);
+    }
+    else
+    {
+        std::ostringstream header;
+        writeReplyHeader(header, false);
+        writeBody(header.str(), body, "");
+    }
+}
+
+void Socket::onBodyData(BodyBuffer& body)
+{
+    const RequestHeader& rh = _request.header();
+    bool http11 = rh.httpVersionMajor() > 1
+               || (rh.httpVersionMajor() == 1 && rh.httpVersionMinor() >= 1);
+
+    if (_replyFailed
+        || !http11
+        || !_reply.chunkedTransfer()
+        || _reply.header().hasHeader("Content-Length")
+        || (_chunkedReply && body.empty()))
+        return;
+
+    std::ostringstream prefix;
+    if (!_chunkedReply)
+    {
+        log_debug("start chunked reply");
+        writeReplyHeader(prefix, true);
+    }
+
+    if (!body.empty())
+        prefix << std::hex << body.size() << "\r\n";
+
+    try
+    {
+        writeBody(prefix.str(), body, body.empty() ? "" : "\r\n");
+        _chunkedReply = true;
+        body.clear();
+
+        if (_pendingData.size() > pendingHighWater)
+            drainPending();
+    }
+    catch (const std::exception& e)
+    {
+        log_warn("failed to send chunk: " << e.what());
+        _replyFailed = true;
+        throw;
+    }
+}
+
+void Socket::writeReplyHeader(std::ostream& out, bool chunked)
 {
     const char* contentLength = "Content-Length";
     const char* server = "Server";
     const char* connection = "Connection";
     const char* date = "Date";
 
-    log_info("request " << _request.method() << ' ' << _request.header().query()
-        << " ready, returncode " << _reply.httpReturnCode() << ' '
-        << _reply.httpReturnText());
-
-    _stream << "HTTP/"
+    out << "HTTP/"
         << _reply.header().httpVersionMajor() << '.'
         << _reply.header().httpVersionMinor() << ' '
         << _reply.header().httpReturnCode() << ' '
@@ -322,36 +499,272 @@ void Socket::sendReply()
     for (ReplyHeader::const_iterator it = _reply.header().begin();
         it != _reply.header().end(); ++it)
     {
-        _stream << it->first << ": " << it->second << "\r\n";
+        out << it->first << ": " << it->second << "\r\n";
     }
 
-    if (!_reply.header().hasHeader(contentLength))
+    if (chunked)
+    {
+        out << "Transfer-Encoding: chunked\r\n";
+    }
+    else if (!_reply.header().hasHeader(contentLength))
     {
-        _stream << "Content-Length: " << _reply.bodySize() << "\r\n";
+        out << "Content-Length: " << _reply.bodySize() << "\r\n";
     }
 
     if (!_reply.header().hasHeader(server))
     {
-        _stream << "Server: cxxtools-Http-Server " PACKAGE_VERSION "\r\n";
+        out << "Server: cxxtools-Http-Server " PACKAGE_VERSION "\r\n";
     }
 
     if (!_reply.header().hasHeader(connection))
     {
-        _stream << "Connection: "
-                << (_request.header().keepAlive() ? "keep-alive" : "close")
-                << "\r\n";
+        out << "Connection: "
+            << (_request.header().keepAlive() ? "keep-alive" : "close")
+            << "\r\n";
     }
 
     if (!_reply.header().hasHeader(date))
     {
         char buffer[50];
-        _stream << "Date: " << MessageHeader::htdateCurrent(buffer) << "\r\n";
+        out << "Date: " << MessageHeader::htdateCurrent(buffer) << "\r\n";
     }
 
-    _stream << "\r\n";
+    out << "\r\n";
+}
+
+void Socket::writeBody(const std::string& prefix, const BodyBuffer& body,
+                       const char* suffix)
+{
+    // data pending in the stream must go first
+    if (_stream.buffer().out_avail() > 0)
+        _stream.flush();
+
+    std::vector<iovec> iov;
+    iov.reserve(body.blocks() + 2);
+
+    if (!prefix.empty())
+    {
+        iovec v;
+        v.iov_base = const_cast<char*>(prefix.data());
+        v.iov_len = prefix.size();
+        iov.push_back(v);
+    }
 
-    _reply.sendBody(_stream);
+    for (unsigned n = 0; n < body.blocks(); ++n)
+    {
+        if (body.blockSize(n) == 0)
+            continue;
+
+        iovec v;
+        v.iov_base = const_cast<char*>(body.blockData(n));
+        v.iov_len = body.blockSize(n);
+        iov.push_back(v);
+    }
+
+    if (*suffix)
+    {
+        iovec v;
+        v.iov_base = const_cast<char*>(suffix);
+        v.iov_len = std::strlen(suffix);
+        iov.push_back(v);
+    }
+
+    if (!iov.empty())
+        writeBuffers(&iov[0], iov.size());
+}
+
+void Socket::writeBuffers(iovec* iov, unsigned count, bool more)
+{
+    assert(!_pendingWrite);
+
+    // data waiting for the socket must go first
+    if (!_pendingData.empty() || _pendingFd >= 0)
+    {
+        for ( ; count > 0; ++iov, --count)
+            _pendingData.append(static_cast<const char*>(iov->iov_base), iov->iov_len);
+        return;
+    }
+
+    log_debug("send " << count << " buffers to " << getPeerAddr());
+
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+#ifdef MSG_MORE
+    if (more)
+        flags |= MSG_MORE;
+#endif
+
+    while (count > 0)
+    {
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = std::min(count, maxIov);
+
+        ssize_t ret = ::sendmsg(getFd(), &msg, flags);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN)
+                throw IOError(getErrnoString("sendmsg"));
+
+            // the buffers may be released when we return, so the rest is copied
+            log_debug("socket would block; keep " << count << " buffers pending");
+            for ( ; count > 0; ++iov, --count)
+                _pendingData.append(static_cast<const char*>(iov->iov_base), iov->iov_len);
+            return;
+        }
+
+        std::size_t n = ret;
+        while (count > 0 && n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// Sends the pending data and body file. Returns true when everything is
+// sent; otherwise a write is started and onOutput is called again, when
+// the socket is writable.
+bool Socket::sendPending()
+{
+    while (true)
+    {
+        if (!_pendingData.empty())
+        {
+            beginWrite(_pendingData.data(), _pendingData.size());
+            _pendingWrite = true;
+            return false;
+        }
+
+        if (_pendingFd < 0)
+            return true;
+
+        sendFile();
+    }
+}
+
+// Sends pending data of a streamed reply, until less than pendingLowWater
+// bytes are left. The responder is blocked meanwhile, so that a slow
+// client does not make the server keep the whole body in memory.
+void Socket::drainPending()
+{
+    log_debug("wait for " << getPeerAddr() << " to receive " << _pendingData.size() << " pending bytes");
+
+    std::size_t timeout = _server.writeTimeout();
+
+    std::size_t sent = 0;
+    while (_pendingData.size() - sent > pendingLowWater)
+    {
+        pollfd pfd;
+        pfd.fd = getFd();
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        int p = ::poll(&pfd, 1, timeout == Selectable::WaitInfinite ? -1 : static_cast<int>(timeout));
+        if (p < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw IOError(getErrnoString("poll"));
+        }
+
+        if (p == 0)
+            throw IOTimeout();
+
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+#endif
+        ssize_t ret = ::send(getFd(), _pendingData.data() + sent, _pendingData.size() - sent, flags);
+        if (ret < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            throw IOError(getErrnoString("send"));
+        }
+
+        sent += ret;
+    }
+
+    _pendingData.erase(0, sent);
+}
+
+void Socket::discardPending()
+{
+    _pendingData.clear();
+    _pendingWrite = false;
+    _pendingFd = -1;
+    _pendingFileOffset = 0;
+    _pendingFileSize = 0;
+}
+
+// Sends the body file until the socket would block. The next part of the
+// file is then read into the pending data, which is written with beginWrite.
+void Socket::sendFile()
+{
+    log_debug("send " << _pendingFileSize << " bytes from file at offset "
+        << _pendingFileOffset << " to " << getPeerAddr());
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    while (_pendingFileSize > 0)
+    {
+        off_t off = _pendingFileOffset;
+        ssize_t ret = ::sendfile(getFd(), _pendingFd, &off, _pendingFileSize);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN)
+                throw IOError(getErrnoString("sendfile"));
+
+            break;
+        }
+
+        if (ret == 0)
+            throw IOError("unexpected end of file in sendfile");
+
+        _pendingFileOffset += ret;
+        _pendingFileSize -= ret;
+    }
+#endif
+
+    if (_pendingFileSize > 0)
+    {
+        _pendingData.resize(std::min(_pendingFileSize, fileChunkSize));
+
+        ssize_t n;
+        do
+        {
+            n = ::pread(_pendingFd, &_pendingData[0], _pendingData.size(), _pendingFileOffset);
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+            throw IOError(getErrnoString("pread"));
+
+        if (n == 0)
+            throw IOError("unexpected end of file");
+
+        _pendingData.resize(n);
+        _pendingFileOffset += n;
+        _pendingFileSize -= n;
+    }
 
+    if (_pendingFileSize == 0)
+        _pendingFd = -1;
 }
 
 } // namespace http
@@ -39,14 +39,16 @@
 #include <cxxtools/method.h>
 #include "parser.h"
 
+struct iovec;
+
 namespace cxxtools {
 
 namespace http {
 
-class ServerImpl;
+class ServerImplBase;
 class Responder;
 
-class Socket : public net::TcpSocket, public Connectable
+class Socket : public net::TcpSocket, public Connectable, private BodyBuffer::Sink
 {
         class ParseEvent : public HeaderParser::MessageHeaderEvent
         {
@@ -64,7 +66,7 @@ class Socket : public net::TcpSocket, public Connectable
         };
 
     public:
-        Socket(ServerImpl& server, net::TcpServer& tcpServer);
+        Socket(ServerImplBase& server, net::TcpServer& tcpServer);
         explicit Socket(Socket& socket);
         ~Socket();
 
@@ -98,8 +100,18 @@ class Socket : public net::TcpSocket, public Connectable
         Connection timeoutConnection;
 
     private:
+        void onBodyData(BodyBuffer& buffer);
+        void writeReplyHeader(std::ostream& out, bool chunked);
+        void writeBody(const std::string& prefix, const BodyBuffer& body,
+                       const char* suffix);
+        void writeBuffers(iovec* iov, unsigned count, bool more = false);
+        bool sendPending();
+        void drainPending();
+        void sendFile();
+        void discardPending();
+
         net::TcpServer& _tcpServer;
-        ServerImpl& _server;
+        ServerImplBase& _server;
 
         ParseEvent _parseEvent;
         HeaderParser _parser;
@@ -112,6 +124,17 @@ class Socket : public net::TcpSocket, public Connectable
         IOStream _stream;
 
         bool _accepted;
+        bool _chunkedReply;  // header and first chunks are sent already
+        bool _replyFailed;
+
+        // Data, which would block the socket, is kept here and sent with
+        // beginWrite, so that a slow client does not block the event loop.
+        // Streamed replies wait in drainPending, when too much is pending.
+        std::string _pendingData;
+        bool _pendingWrite;              // beginWrite of _pendingData is in progress
+        int _pendingFd;                  // body file to send after _pendingData or -1
+        std::size_t _pendingFileOffset;
+        std::size_t _pendingFileSize;
 };
 
 } // namespace http
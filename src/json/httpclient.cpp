@@ -162,6 +162,16 @@ void HttpClient::clearAuth()
     getImpl()->clearAuth();
 }
 
+void HttpClient::setConnectionPool(http::ConnectionPool& pool)
+{
+    getImpl()->setConnectionPool(pool);
+}
+
+void HttpClient::clearConnectionPool()
+{
+    getImpl()->clearConnectionPool();
+}
+
 void HttpClient::setSelector(SelectorBase& selector)
 {
     getImpl()->setSelector(selector);
@@ -82,6 +82,16 @@ namespace json
                 _client.clearAuth();
             }
 
+            void setConnectionPool(http::ConnectionPool& pool)
+            {
+                _client.setConnectionPool(pool);
+            }
+
+            void clearConnectionPool()
+            {
+                _client.clearConnectionPool();
+            }
+
             void setSelector(SelectorBase& selector)
             {
                 _client.setSelector(selector);
@@ -27,17 +27,20 @@
  */
 
 #include <cxxtools/jsondeserializer.h>
+#include "jsonutf8parser.h"
 
 namespace cxxtools
 {
     JsonDeserializer::JsonDeserializer(std::istream& in, TextCodec<Char, char>* codec)
         : _ts(new TextIStream(in, codec)),
-          _in(*_ts)
+          _in(*_ts),
+          _utf8in(dynamic_cast<Utf8Codec*>(codec) ? &in : 0)
     { }
 
     JsonDeserializer::JsonDeserializer(std::basic_istream<Char>& in)
         : _ts(0),
-          _in(in)
+          _in(in),
+          _utf8in(0)
     { }
 
     JsonDeserializer::~JsonDeserializer()
@@ -47,6 +50,18 @@ namespace cxxtools
 
     void JsonDeserializer::doDeserialize()
     {
+        if (_utf8in)
+        {
+            if (_utf8in->rdbuf() == 0)
+                SerializationError::doThrow("json deserialization failed");
+
+            JsonUtf8Parser parser(*_utf8in->rdbuf(), *this);
+            parser.parse();
+            if (parser.eof())
+                _utf8in->setstate(std::ios::eofbit);
+            return;
+        }
+
         JsonParser parser;
         parser.begin(*this);
         Char ch;
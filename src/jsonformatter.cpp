@@ -29,6 +29,7 @@
 
 #include <cxxtools/jsonformatter.h>
 #include <cxxtools/convert.h>
+#include <cxxtools/typenames.h>
 #include <cxxtools/log.h>
 #include <limits>
 
@@ -70,7 +71,8 @@ void JsonFormatter::addValueString(const std::string& name, const std::string& t
 {
     log_trace("addValueString name=\"" << name << "\", type=\"" << type << "\", value=\"" << value << '"');
 
-    if (type == "bool")
+    TypeNames::Id id = TypeNames::id(type);
+    if (id == TypeNames::Bool)
     {
         addValueBool(name, type, convert<bool>(value));
     }
@@ -78,11 +80,11 @@ void JsonFormatter::addValueString(const std::string& name, const std::string& t
     {
         beginValue(name);
 
-        if (type == "int" || type == "double")
+        if (id == TypeNames::Int || id == TypeNames::Double)
         {
             stringOut(value);
         }
-        else if (type == "null")
+        else if (id == TypeNames::Null)
         {
             *_ts << L"null";
         }
@@ -102,7 +104,8 @@ void JsonFormatter::addValueStdString(const std::string& name, const std::string
 {
     log_trace("addValueStdString name=\"" << name << "\", type=\"" << type << "\", \" value=\"" << value << '"');
 
-    if (type == "bool")
+    TypeNames::Id id = TypeNames::id(type);
+    if (id == TypeNames::Bool)
     {
         addValueBool(name, type, convert<bool>(value));
     }
@@ -110,11 +113,11 @@ void JsonFormatter::addValueStdString(const std::string& name, const std::string
     {
         beginValue(name);
 
-        if (type == "int" || type == "double")
+        if (id == TypeNames::Int || id == TypeNames::Double)
         {
             stringOut(value);
         }
-        else if (type == "null")
+        else if (id == TypeNames::Null)
         {
             *_ts << L"null";
         }
@@ -148,7 +151,7 @@ void JsonFormatter::addValueInt(const std::string& name, const std::string& type
 
     beginValue(name);
 
-    if (type == "bool")
+    if (TypeNames::id(type) == TypeNames::Bool)
         *_ts << (value ? L"true" : L"false");
     else
         *_ts << value;
@@ -163,7 +166,7 @@ void JsonFormatter::addValueUnsigned(const std::string& name, const std::string&
 
     beginValue(name);
 
-    if (type == "bool")
+    if (TypeNames::id(type) == TypeNames::Bool)
         *_ts << (value ? L"true" : L"false");
     else
         *_ts << value;
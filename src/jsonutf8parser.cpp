@@ -0,0 +1,607 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "jsonutf8parser.h"
+#include <cxxtools/deserializerbase.h>
+#include <cxxtools/jsonparser.h>
+#include <cxxtools/typenames.h>
+#include <cxxtools/utf8codec.h>
+#include <cxxtools/log.h>
+#include <streambuf>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+log_define("cxxtools.json.parser")
+
+namespace cxxtools
+{
+    namespace
+    {
+        // Gives access to the get area of a stream buffer.
+        class GetArea : public std::streambuf
+        {
+            public:
+                static const char* begin(std::streambuf& sb)
+                { return (sb.*(&GetArea::gptr))(); }
+
+                static const char* end(std::streambuf& sb)
+                { return (sb.*(&GetArea::egptr))(); }
+
+                static void consume(std::streambuf& sb, std::size_t n)
+                { (sb.*(&GetArea::gbump))(static_cast<int>(n)); }
+        };
+
+        inline bool isAlpha(int ch)
+        { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+
+        inline bool isDigit(int ch)
+        { return ch >= '0' && ch <= '9'; }
+
+        inline bool isSpace(int ch)
+        { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+
+        // Returns the first quote, backslash or control character in [b, e).
+        const char* scanString(const char* b, const char* e)
+        {
+#ifdef __SSE2__
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i ctrl = _mm_set1_epi8(0x1f);
+            for ( ; e - b >= 16; b += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                __m128i m = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                    _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+                int mask = _mm_movemask_epi8(m);
+                if (mask)
+                    return b + __builtin_ctz(mask);
+            }
+#endif
+            for ( ; b < e; ++b)
+            {
+                unsigned char ch = static_cast<unsigned char>(*b);
+                if (ch == '"' || ch == '\\' || ch < 0x20)
+                    break;
+            }
+            return b;
+        }
+
+        // Returns the first character in [b, e), which is not a blank, tab,
+        // cr or lf and counts the skipped line feeds.
+        const char* scanSpace(const char* b, const char* e, unsigned& lineNo)
+        {
+#ifdef __SSE2__
+            const __m128i blank = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i cr = _mm_set1_epi8('\r');
+            const __m128i lf = _mm_set1_epi8('\n');
+            for ( ; e - b >= 16; b += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                __m128i nl = _mm_cmpeq_epi8(v, lf);
+                __m128i sp = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, blank), _mm_cmpeq_epi8(v, tab)),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, cr), nl));
+                unsigned lines = _mm_movemask_epi8(nl);
+                unsigned other = ~_mm_movemask_epi8(sp) & 0xffff;
+                if (other)
+                {
+                    unsigned n = __builtin_ctz(other);
+                    lineNo += __builtin_popcount(lines & ((1u << n) - 1));
+                    return b + n;
+                }
+                lineNo += __builtin_popcount(lines);
+            }
+#endif
+            for ( ; b < e; ++b)
+            {
+                if (*b == '\n')
+                    ++lineNo;
+                else if (*b != ' ' && *b != '\t' && *b != '\r')
+                    break;
+            }
+            return b;
+        }
+
+        bool isAscii(const std::string& s)
+        {
+            const char* b = s.data();
+            const char* e = b + s.size();
+#ifdef __SSE2__
+            for ( ; e - b >= 16; b += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                if (_mm_movemask_epi8(v))
+                    return false;
+            }
+#endif
+            for ( ; b < e; ++b)
+                if (static_cast<unsigned char>(*b) >= 0x80)
+                    return false;
+            return true;
+        }
+
+        void appendUtf8(std::string& s, unsigned ch)
+        {
+            if (ch < 0x80)
+                s += static_cast<char>(ch);
+            else if (ch < 0x800)
+            {
+                s += static_cast<char>(0xc0 | (ch >> 6));
+                s += static_cast<char>(0x80 | (ch & 0x3f));
+            }
+            else if (ch < 0x10000)
+            {
+                s += static_cast<char>(0xe0 | (ch >> 12));
+                s += static_cast<char>(0x80 | ((ch >> 6) & 0x3f));
+                s += static_cast<char>(0x80 | (ch & 0x3f));
+            }
+            else
+            {
+                s += static_cast<char>(0xf0 | (ch >> 18));
+                s += static_cast<char>(0x80 | ((ch >> 12) & 0x3f));
+                s += static_cast<char>(0x80 | ((ch >> 6) & 0x3f));
+                s += static_cast<char>(0x80 | (ch & 0x3f));
+            }
+        }
+    }
+
+    JsonUtf8Parser::JsonUtf8Parser(std::streambuf& sb, DeserializerBase& deserializer)
+        : _sb(sb),
+          _deserializer(deserializer),
+          _base(0),
+          _p(0),
+          _e(0),
+          _ch(0),
+          _eof(false),
+          _lineNo(1)
+    { }
+
+    JsonUtf8Parser::~JsonUtf8Parser()
+    {
+        commit();
+    }
+
+    bool JsonUtf8Parser::more()
+    {
+        commit();
+
+        if (_eof || _sb.sgetc() == std::char_traits<char>::eof())
+        {
+            _eof = true;
+            return false;
+        }
+
+        _base = _p = GetArea::begin(_sb);
+        _e = GetArea::end(_sb);
+
+        if (_p == _e)
+        {
+            // stream buffer without get area; read byte by byte
+            _ch = std::char_traits<char>::to_char_type(_sb.sbumpc());
+            _base = 0;
+            _p = &_ch;
+            _e = _p + 1;
+        }
+
+        return true;
+    }
+
+    void JsonUtf8Parser::commit()
+    {
+        if (_base)
+            GetArea::consume(_sb, _p - _base);
+        else if (_p == &_ch)
+            _sb.sputbackc(_ch);
+
+        _base = _p = _e = 0;
+    }
+
+    void JsonUtf8Parser::parse()
+    {
+        _stack.clear();
+
+        int ch = skipSpace();
+        while (true)
+        {
+            // ch is the first character of the next value
+            switch (ch)
+            {
+                case '{':
+                    ++_p;
+                    _deserializer.setCategory(SerializationInfo::Object);
+                    ch = skipSpace();
+                    if (ch == '}')
+                    {
+                        ++_p;
+                        break;
+                    }
+
+                    parseName(ch);
+                    _stack.push_back('}');
+                    ch = skipSpace();
+                    continue;
+
+                case '[':
+                    ++_p;
+                    _deserializer.setCategory(SerializationInfo::Array);
+                    ch = skipSpace();
+                    if (ch == ']')
+                    {
+                        ++_p;
+                        break;
+                    }
+
+                    log_debug("begin array member");
+                    _deserializer.beginMember(std::string(), std::string(), SerializationInfo::Void);
+                    _stack.push_back(']');
+                    continue;
+
+                case '"':
+                    ++_p;
+                    _deserializer.setCategory(SerializationInfo::Value);
+                    parseString();
+                    setString();
+                    break;
+
+                default:
+                    if (isDigit(ch) || ch == '+' || ch == '-')
+                    {
+                        _deserializer.setCategory(SerializationInfo::Value);
+                        parseNumber(ch);
+
+                        // like the JsonParser consume a space after a number on top level
+                        if (_stack.empty() && isSpace(ch = peek()))
+                        {
+                            ++_p;
+                            if (ch == '\n')
+                                ++_lineNo;
+                        }
+                    }
+                    else
+                        parseToken(ch);
+            }
+
+            // the value is complete; close the finished objects and arrays
+            while (true)
+            {
+                if (_stack.empty())
+                {
+                    commit();
+                    return;
+                }
+
+                ch = skipSpace();
+                if (ch == ',')
+                {
+                    ++_p;
+                    log_debug("leave member");
+                    _deserializer.leaveMember();
+                    if (_stack.back() == '}')
+                        parseName(skipSpace());
+                    else
+                    {
+                        log_debug("begin array member");
+                        _deserializer.beginMember(std::string(), std::string(), SerializationInfo::Void);
+                    }
+
+                    ch = skipSpace();
+                    break;
+                }
+                else if (ch == _stack.back())
+                {
+                    ++_p;
+                    log_debug("leave member");
+                    _deserializer.leaveMember();
+                    _stack.pop_back();
+                }
+                else if (ch < 0)
+                    throwUnexpectedEnd();
+                else
+                    throwInvalidCharacter(ch);
+            }
+        }
+    }
+
+    int JsonUtf8Parser::skipSpace()
+    {
+        while (_p < _e || more())
+        {
+            int ch = static_cast<unsigned char>(*_p);
+            if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+                _p = scanSpace(_p, _e, _lineNo);
+            else if (ch == '/')
+            {
+                ++_p;
+                skipComment();
+            }
+            else if (isSpace(ch))
+                ++_p;
+            else
+                return ch;
+        }
+
+        return -1;
+    }
+
+    void JsonUtf8Parser::skipComment()
+    {
+        int ch = peek();
+        if (ch < 0)
+            throwUnexpectedEnd();
+
+        ++_p;
+        if (ch == '/')
+        {
+            // a line comment ends with the line or the input
+            while (_p < _e || more())
+            {
+                const char* nl = static_cast<const char*>(memchr(_p, '\n', _e - _p));
+                if (nl)
+                {
+                    _p = nl + 1;
+                    ++_lineNo;
+                    return;
+                }
+                _p = _e;
+            }
+        }
+        else if (ch == '*')
+        {
+            bool star = false;
+            while ((ch = peek()) >= 0)
+            {
+                ++_p;
+                if (star && ch == '/')
+                    return;
+                if (ch == '\n')
+                    ++_lineNo;
+                star = (ch == '*');
+            }
+
+            throwUnexpectedEnd();
+        }
+        else
+            throwInvalidCharacter(ch);
+    }
+
+    void JsonUtf8Parser::parseName(int ch)
+    {
+        if (ch == '"')
+        {
+            ++_p;
+            parseString();
+        }
+        else if (isAlpha(ch))
+        {
+            _str.clear();
+            do
+            {
+                _str += static_cast<char>(ch);
+                ++_p;
+                ch = peek();
+            } while (isAlpha(ch) || isDigit(ch));
+        }
+        else if (ch < 0)
+            throwUnexpectedEnd();
+        else
+            throwInvalidCharacter(ch);
+
+        ch = skipSpace();
+        if (ch != ':')
+        {
+            if (ch < 0)
+                throwUnexpectedEnd();
+            throwInvalidCharacter(ch);
+        }
+
+        ++_p;
+        log_debug("begin object member " << _str);
+        _deserializer.beginMember(_str, std::string(), SerializationInfo::Void);
+    }
+
+    void JsonUtf8Parser::parseString()
+    {
+        _str.clear();
+
+        while (true)
+        {
+            if (_p == _e && !more())
+                throwUnexpectedEnd();
+
+            const char* q = scanString(_p, _e);
+            _str.append(_p, q);
+            _p = q;
+            if (_p == _e)
+                continue;
+
+            char ch = *_p++;
+            if (ch == '"')
+                return;
+
+            if (ch != '\\')
+            {
+                // control characters are accepted as they are
+                if (ch == '\n')
+                    ++_lineNo;
+                _str += ch;
+                continue;
+            }
+
+            int esc = peek();
+            if (esc < 0)
+                throwUnexpectedEnd();
+            ++_p;
+
+            switch (esc)
+            {
+                case '"':
+                case '\\':
+                case '/': _str += static_cast<char>(esc); break;
+                case 'b': _str += '\b'; break;
+                case 'f': _str += '\f'; break;
+                case 'n': _str += '\n'; break;
+                case 'r': _str += '\r'; break;
+                case 't': _str += '\t'; break;
+
+                case 'u':
+                {
+                    unsigned value = parseHex();
+                    if (value >= 0xdc00 && value <= 0xdfff)
+                        doThrow("unpaired low surrogate in string");
+
+                    if (value >= 0xd800 && value <= 0xdbff)
+                    {
+                        // a high surrogate must be followed by an escaped low surrogate
+                        if (peek() != '\\')
+                            doThrow("unpaired high surrogate in string");
+                        ++_p;
+                        if (peek() != 'u')
+                            doThrow("unpaired high surrogate in string");
+                        ++_p;
+
+                        unsigned low = parseHex();
+                        if (low < 0xdc00 || low > 0xdfff)
+                            doThrow("unpaired high surrogate in string");
+
+                        value = 0x10000 + ((value - 0xd800) << 10) + (low - 0xdc00);
+                    }
+
+                    appendUtf8(_str, value);
+                    break;
+                }
+
+                default:
+                    doThrow(std::string("invalid character '") + static_cast<char>(esc) + "' in string");
+            }
+        }
+    }
+
+    unsigned JsonUtf8Parser::parseHex()
+    {
+        unsigned value = 0;
+        for (unsigned n = 0; n < 4; ++n)
+        {
+            int h = peek();
+            if (h < 0)
+                throwUnexpectedEnd();
+            ++_p;
+
+            if (h >= '0' && h <= '9')
+                value = (value << 4) | (h - '0');
+            else if (h >= 'a' && h <= 'f')
+                value = (value << 4) | (h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F')
+                value = (value << 4) | (h - 'A' + 10);
+            else
+                doThrow(std::string("invalid character '") + static_cast<char>(h) + "' in hex sequence");
+        }
+
+        return value;
+    }
+
+    void JsonUtf8Parser::parseNumber(int ch)
+    {
+        _str.assign(1, static_cast<char>(ch));
+        ++_p;
+
+        bool isFloat = false;
+        while (true)
+        {
+            ch = peek();
+            if (ch == '.' || ch == 'e' || ch == 'E')
+                isFloat = true;
+            else if (!isDigit(ch) && !(isFloat && (ch == '+' || ch == '-')))
+                break;
+
+            _str += static_cast<char>(ch);
+            ++_p;
+        }
+
+        _deserializer.setValue(_str);
+        _deserializer.setTypeName(TypeNames::name(isFloat ? TypeNames::Double : TypeNames::Int));
+    }
+
+    void JsonUtf8Parser::parseToken(int ch)
+    {
+        if (!isAlpha(ch))
+        {
+            if (ch < 0)
+                throwUnexpectedEnd();
+            throwInvalidCharacter(ch);
+        }
+
+        // like the JsonParser keep the first character and lower the rest
+        _str.assign(1, static_cast<char>(ch));
+        ++_p;
+        while (isAlpha(ch = peek()))
+        {
+            _str += static_cast<char>(ch | 0x20);
+            ++_p;
+        }
+
+        if (_str == "true" || _str == "false")
+        {
+            _deserializer.setValue(_str);
+            _deserializer.setTypeName(TypeNames::name(TypeNames::Bool));
+        }
+        else if (_str == "null")
+        {
+            _deserializer.setTypeName(TypeNames::name(TypeNames::Null));
+            _deserializer.setNull();
+        }
+    }
+
+    void JsonUtf8Parser::setString()
+    {
+        if (isAscii(_str))
+            _deserializer.setValue(_str);
+        else
+            _deserializer.setValue(Utf8Codec::decode(_str));
+
+        _deserializer.setTypeName(TypeNames::name(TypeNames::String));
+    }
+
+    void JsonUtf8Parser::doThrow(const std::string& msg)
+    {
+        throw JsonParserError(msg, _lineNo);
+    }
+
+    void JsonUtf8Parser::throwInvalidCharacter(int ch)
+    {
+        doThrow(std::string("invalid character '") + static_cast<char>(ch) + '\'');
+    }
+
+    void JsonUtf8Parser::throwUnexpectedEnd()
+    {
+        SerializationError::doThrow("unexpected end");
+    }
+}
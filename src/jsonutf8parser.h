@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CXXTOOLS_JSONUTF8PARSER_H
+#define CXXTOOLS_JSONUTF8PARSER_H
+
+#include <cxxtools/noncopyable.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace cxxtools
+{
+    class DeserializerBase;
+
+    /** @internal Parser for utf-8 encoded json, which reads the bytes directly
+        from the get area of a stream buffer.
+
+        It accepts the same syntax as the JsonParser and makes the same calls
+        to the DeserializerBase, but avoids decoding the input to Char. The
+        bytes of strings and whitespace are skipped 16 at a time using SSE2
+        when available. Strings containing only ascii characters are passed
+        as std::string, other strings are decoded to cxxtools::String.
+
+        Exactly one value is consumed from the stream buffer, so that multiple
+        values can be read one after another.
+     */
+    class JsonUtf8Parser : private NonCopyable
+    {
+        public:
+            JsonUtf8Parser(std::streambuf& sb, DeserializerBase& deserializer);
+            ~JsonUtf8Parser();
+
+            /// Reads one value and passes it to the deserializer.
+            void parse();
+
+            /// Returns true, when the end of the input was reached.
+            bool eof() const
+            { return _eof; }
+
+        private:
+            std::streambuf& _sb;
+            DeserializerBase& _deserializer;
+
+            const char* _base;
+            const char* _p;
+            const char* _e;
+            char _ch;
+            bool _eof;
+
+            unsigned _lineNo;
+            std::vector<char> _stack;
+            std::string _str;
+
+            bool more();
+            void commit();
+
+            int peek()
+            { return _p < _e || more() ? static_cast<unsigned char>(*_p) : -1; }
+
+            int skipSpace();
+            void skipComment();
+
+            void parseName(int ch);
+            void parseString();
+            unsigned parseHex();
+            void parseNumber(int ch);
+            void parseToken(int ch);
+
+            void setString();
+
+            void doThrow(const std::string& msg);
+            void throwInvalidCharacter(int ch);
+            void throwUnexpectedEnd();
+    };
+}
+
+#endif // CXXTOOLS_JSONUTF8PARSER_H
@@ -31,7 +31,10 @@
 #include <cxxtools/smartptr.h>
 #include <cxxtools/convert.h>
 #include <cxxtools/mutex.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/thread.h>
 #include <cxxtools/atomicity.h>
+#include <cxxtools/membar.h>
 #include <cxxtools/serializationinfo.h>
 #include <cxxtools/xml/xmldeserializer.h>
 #include <cxxtools/propertiesdeserializer.h>
@@ -39,22 +42,27 @@
 #include <cxxtools/net/udp.h>
 #include <cxxtools/fileinfo.h>
 #include <vector>
+#include <deque>
 #include <map>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <pthread.h>
+#include "snapshot.h"
 
 namespace cxxtools
 {
   namespace
   {
+    Mutex configMutex;
     Mutex loggersMutex;
     Mutex logMutex;
     Mutex poolMutex;
@@ -129,14 +137,41 @@ namespace cxxtools
         }
     };
 
-    void logentry(std::string& entry, const char* level, const std::string& category)
+    // Locks logMutex. The threads waiting for the mutex are counted, so
+    // that the holder may leave flushing the output to the next one.
+    class LogMutexLock
     {
-      struct timeval t;
-      gettimeofday(&t, 0);
+        MutexLock _lock;
+
+      public:
+        LogMutexLock()
+          : _lock(logMutex, false)
+        {
+          // the holder itself is not counted
+          ScopedAtomicIncrementer inc(mutexWaitCount);
+          _lock.lock();
+        }
+
+        bool othersWaiting() const
+        { return atomicGet(mutexWaitCount) > 0; }
+    };
+
+    // formatted date of the last log entry; the date is formatted only once per second
+    struct LogDate
+    {
+      char date[20];
+      time_t psec;
 
-      // format date only once per second:
-      static char date[20];
-      static time_t psec = 0;
+      LogDate()
+        : psec(0)
+      { }
+    };
+
+    void logentry(std::string& entry, const char* level, const std::string& category, LogDate& logDate,
+                  const struct timeval& t, unsigned long pid, unsigned long tid)
+    {
+      char* date = logDate.date;
+      time_t& psec = logDate.psec;
       time_t sec = static_cast<time_t>(t.tv_sec);
       if (sec != psec)
       {
@@ -178,10 +213,10 @@ namespace cxxtools
       entry += ' ';
       entry += '[';
       char str[64];
-      char* p = putInt(str, getpid());
+      char* p = putInt(str, pid);
       entry.append(str, p - str);
       entry += '.';
-      p = putInt(str, (unsigned long)pthread_self());
+      p = putInt(str, tid);
       entry.append(str, p - str);
       entry += "] ";
       entry += level;
@@ -190,12 +225,43 @@ namespace cxxtools
       entry += " - ";
     }
 
+    void logentry(std::string& entry, const char* level, const std::string& category, LogDate& logDate)
+    {
+      struct timeval t;
+      gettimeofday(&t, 0);
+      logentry(entry, level, category, logDate, t, getpid(), (unsigned long)pthread_self());
+    }
+
+    // date cache of the synchronous log, which is protected by logMutex
+    LogDate syncLogDate;
+
+    void logentry(std::string& entry, const char* level, const std::string& category)
+    {
+      logentry(entry, level, category, syncLogDate);
+    }
+
     class LogAppender : public RefCounted
     {
+      protected:
+        unsigned _generation;
+
       public:
+        LogAppender()
+          : _generation(0)
+        { }
+
         virtual ~LogAppender() { }
         virtual void putMessage(const std::string& msg) = 0;
         virtual void finish(bool flush) = 0;
+
+        // writes binary data without line feed
+        virtual void putRecord(const std::string& data) = 0;
+
+        // called before binary data of the given size is written; may start a new file
+        virtual void reserve(std::string::size_type /*size*/)  { }
+
+        // changes, when a new file is started
+        unsigned generation() const  { return _generation; }
     };
 
     //////////////////////////////////////////////////////////////////////
@@ -214,6 +280,7 @@ namespace cxxtools
 
         virtual void putMessage(const std::string& msg);
         virtual void finish(bool flush);
+        virtual void putRecord(const std::string& data);
     };
 
     void FdAppender::putMessage(const std::string& msg)
@@ -222,6 +289,11 @@ namespace cxxtools
       _msg += '\n';
     }
 
+    void FdAppender::putRecord(const std::string& data)
+    {
+      _msg += data;
+    }
+
     void FdAppender::finish(bool flush)
     {
       if (!flush && _msg.size() < 8192)
@@ -241,6 +313,7 @@ namespace cxxtools
       public:
         explicit FileAppender(const std::string& fname);
         virtual void putMessage(const std::string& msg);
+        virtual void reserve(std::string::size_type size);
 
         const std::string& fname() const  { return _fname; }
         void closeFile();
@@ -256,12 +329,20 @@ namespace cxxtools
     void FileAppender::openFile()
     {
       _fd = ::open( _fname.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC | O_CREAT, 0666);
+      ++_generation;
     }
 
     void FileAppender::closeFile()
     {
       if (_fd != -1)
       {
+        // buffered messages belong to the old file
+        if (!_msg.empty())
+        {
+          ::write(_fd, _msg.data(), _msg.size());
+          _msg.clear();
+        }
+
         ::close(_fd);
         _fd = -1;
       }
@@ -275,6 +356,12 @@ namespace cxxtools
       FdAppender::putMessage(msg);
     }
 
+    void FileAppender::reserve(std::string::size_type /*size*/)
+    {
+      if (_fd == -1)
+        openFile();
+    }
+
     //////////////////////////////////////////////////////////////////////
     // RollingFileAppender
     //
@@ -291,6 +378,7 @@ namespace cxxtools
       public:
         RollingFileAppender(const std::string& fname, unsigned maxfilesize, unsigned maxbackupindex);
         virtual void putMessage(const std::string& msg);
+        virtual void reserve(std::string::size_type size);
     };
 
     RollingFileAppender::RollingFileAppender(const std::string& fname, unsigned maxfilesize, unsigned maxbackupindex)
@@ -346,6 +434,14 @@ namespace cxxtools
       _fsize += msg.size() + 1;  // FileAppender adds line feed to the message
     }
 
+    void RollingFileAppender::reserve(std::string::size_type size)
+    {
+      if (_fsize >= _maxfilesize)
+        doRotate();
+      FileAppender::reserve(size);
+      _fsize += size;
+    }
+
     //////////////////////////////////////////////////////////////////////
     // UdpAppender
     //
@@ -361,6 +457,7 @@ namespace cxxtools
 
         virtual void putMessage(const std::string& msg);
         virtual void finish(bool flush);
+        virtual void putRecord(const std::string& data);
     };
 
     void UdpAppender::putMessage(const std::string& msg)
@@ -368,8 +465,16 @@ namespace cxxtools
       _msg = msg;
     }
 
+    void UdpAppender::putRecord(const std::string& data)
+    {
+      _msg = data;
+    }
+
     void UdpAppender::finish(bool flush)
     {
+      if (_msg.empty())
+        return;
+
       try
       {
         _loghost.send(_msg);
@@ -380,6 +485,700 @@ namespace cxxtools
       _msg.clear();
     }
 
+    //////////////////////////////////////////////////////////////////////
+    // binary log format
+    //
+    // The binary output is a sequence of frames. Each frame starts with its
+    // size (4 bytes in host byte order, not including the size itself) and
+    // a kind:
+    //
+    //   'H' header: magic string and version; starts a new stream, so all
+    //       sites known so far are forgotten
+    //   'S' site: id, line, level, file name and category of a log statement
+    //   'R' record: site id, seconds, microseconds, process id, thread id
+    //       and the arguments, each a type tag followed by the value
+    //   'T' text: a log line formatted by the caller
+    //
+    // Strings are stored as a 4 byte length followed by the characters.
+    //
+    enum {
+      ArgString = 's',
+      ArgInt = 'i',
+      ArgUnsigned = 'u',
+      ArgDouble = 'd',
+      ArgChar = 'c',
+      ArgBool = 'b',
+      ArgPointer = 'p'
+    };
+
+    const char binaryLogMagic[] = "cxxtools-log";
+    const uint32_t binaryLogVersion = 1;
+
+    template <typename T>
+    void putRaw(std::string& s, T value)
+    {
+      s.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void putRawString(std::string& s, const char* p, std::string::size_type len)
+    {
+      putRaw(s, static_cast<uint32_t>(len));
+      s.append(p, len);
+    }
+
+    class BinaryReader
+    {
+        const char* _p;
+        const char* _end;
+
+      public:
+        BinaryReader(const char* p, std::string::size_type size)
+          : _p(p),
+            _end(p + size)
+        { }
+
+        bool atEnd() const
+        { return _p >= _end; }
+
+        template <typename T>
+        T get()
+        {
+          T value = T();
+          if (_end - _p < static_cast<std::ptrdiff_t>(sizeof(value)))
+            throw std::runtime_error("binary log record truncated");
+          memcpy(&value, _p, sizeof(value));
+          _p += sizeof(value);
+          return value;
+        }
+
+        void getString(std::string& s)
+        {
+          uint32_t len = get<uint32_t>();
+          if (static_cast<uint32_t>(_end - _p) < len)
+            throw std::runtime_error("binary log record truncated");
+          s.append(_p, len);
+          _p += len;
+        }
+
+        std::string getString()
+        {
+          std::string s;
+          getString(s);
+          return s;
+        }
+    };
+
+    struct LogSiteInfo
+    {
+      std::string file;
+      unsigned line;
+      std::string level;
+      std::string category;
+    };
+
+    class LogSiteTable
+    {
+      public:
+        virtual ~LogSiteTable() { }
+        virtual const LogSiteInfo* find(uint32_t id) const = 0;
+    };
+
+    // log statements of this process; site ids start with 1
+    class LogSites : public LogSiteTable
+    {
+        mutable Mutex _mutex;
+        std::deque<LogSiteInfo> _sites;
+
+      public:
+        uint32_t registerSite(LogSite& site, const Logger& logger)
+        {
+          MutexLock lock(_mutex);
+          if (site.id == 0)
+          {
+            LogSiteInfo info;
+            info.file = site.file;
+            info.line = site.line;
+            info.level = site.level;
+            info.category = logger.getCategory();
+            _sites.push_back(info);
+            site.id = _sites.size();
+          }
+
+          return site.id;
+        }
+
+        const LogSiteInfo* find(uint32_t id) const
+        {
+          MutexLock lock(_mutex);
+          return id > 0 && id <= _sites.size() ? &_sites[id - 1] : 0;
+        }
+    };
+
+    LogSites logSites;
+
+    // formats a binary record as a text line
+    void renderRecord(const char* data, std::string::size_type size, const LogSiteTable& sites,
+                      LogDate& logDate, std::string& line)
+    {
+      BinaryReader in(data, size);
+
+      uint32_t id = in.get<uint32_t>();
+      struct timeval t;
+      t.tv_sec = static_cast<time_t>(in.get<int64_t>());
+      t.tv_usec = in.get<uint32_t>();
+      uint32_t pid = in.get<uint32_t>();
+      uint64_t tid = in.get<uint64_t>();
+
+      const LogSiteInfo* site = sites.find(id);
+      static const std::string unknown = "?";
+      logentry(line, site ? site->level.c_str() : "?", site ? site->category : unknown,
+               logDate, t, pid, static_cast<unsigned long>(tid));
+
+      char str[64];
+      while (!in.atEnd())
+      {
+        switch (in.get<char>())
+        {
+          case ArgString:
+            in.getString(line);
+            break;
+
+          case ArgInt:
+            line.append(str, putInt(str, in.get<int64_t>()) - str);
+            break;
+
+          case ArgUnsigned:
+            line.append(str, putInt(str, in.get<uint64_t>()) - str);
+            break;
+
+          case ArgDouble:
+            // same as the default format of std::ostream
+            line.append(str, snprintf(str, sizeof(str), "%g", in.get<double>()));
+            break;
+
+          case ArgChar:
+            line += in.get<char>();
+            break;
+
+          case ArgBool:
+            line += in.get<char>() ? '1' : '0';
+            break;
+
+          case ArgPointer:
+            line.append(str, snprintf(str, sizeof(str), "%p", reinterpret_cast<void*>(in.get<uint64_t>())));
+            break;
+
+          default:
+            throw std::runtime_error("invalid argument type in binary log record");
+        }
+      }
+    }
+
+    //////////////////////////////////////////////////////////////////////
+    // LogOutput - passes log lines and binary records to the appender
+    //             in text or binary format
+    //
+    class LogOutput : public RefCounted
+    {
+        SmartPtr<LogAppender> _appender;
+        bool _binary;
+
+        // state of the binary stream
+        unsigned _generation;
+        std::vector<bool> _sitesWritten;
+
+        LogDate _logDate;
+        std::string _msg;
+
+        void beginFrames(std::string::size_type size);
+        void putFrame(char kind, const char* data, std::string::size_type size);
+        void putSite(uint32_t id);
+
+      public:
+        LogOutput(const SmartPtr<LogAppender>& appender, bool binary)
+          : _appender(appender),
+            _binary(binary),
+            _generation(0)
+        { }
+
+        void putText(const std::string& line);
+        void putRecord(const std::string& data);
+
+        void finish(bool flush)
+        { _appender->finish(flush); }
+    };
+
+    void LogOutput::beginFrames(std::string::size_type size)
+    {
+      _msg.clear();
+      _appender->reserve(sizeof(uint32_t) + size);
+
+      // a new file or the first output starts with a header
+      if (_appender->generation() != _generation || _sitesWritten.empty())
+      {
+        _generation = _appender->generation();
+        _sitesWritten.assign(1, true);
+
+        std::string header;
+        putRawString(header, binaryLogMagic, sizeof(binaryLogMagic) - 1);
+        putRaw(header, binaryLogVersion);
+        putFrame('H', header.data(), header.size());
+      }
+    }
+
+    void LogOutput::putFrame(char kind, const char* data, std::string::size_type size)
+    {
+      putRaw(_msg, static_cast<uint32_t>(size + 1));
+      _msg += kind;
+      _msg.append(data, size);
+    }
+
+    void LogOutput::putSite(uint32_t id)
+    {
+      const LogSiteInfo* site = logSites.find(id);
+      if (site == 0)
+        return;
+
+      std::string frame;
+      putRaw(frame, id);
+      putRaw(frame, static_cast<uint32_t>(site->line));
+      putRawString(frame, site->level.data(), site->level.size());
+      putRawString(frame, site->file.data(), site->file.size());
+      putRawString(frame, site->category.data(), site->category.size());
+      putFrame('S', frame.data(), frame.size());
+
+      if (_sitesWritten.size() <= id)
+        _sitesWritten.resize(id + 1);
+      _sitesWritten[id] = true;
+    }
+
+    void LogOutput::putText(const std::string& line)
+    {
+      if (!_binary)
+      {
+        _appender->putMessage(line);
+        return;
+      }
+
+      beginFrames(line.size() + 1);
+      putFrame('T', line.data(), line.size());
+      _appender->putRecord(_msg);
+    }
+
+    void LogOutput::putRecord(const std::string& data)
+    {
+      if (!_binary)
+      {
+        _msg.clear();
+        renderRecord(data.data(), data.size(), logSites, _logDate, _msg);
+        _appender->putMessage(_msg);
+        return;
+      }
+
+      beginFrames(data.size() + 1);
+
+      uint32_t id;
+      memcpy(&id, data.data(), sizeof(id));
+      if (id >= _sitesWritten.size() || !_sitesWritten[id])
+        putSite(id);
+
+      // header, site and record are passed together, so that they end up
+      // in the same datagram when sent via udp
+      putFrame('R', data.data(), data.size());
+      _appender->putRecord(_msg);
+    }
+
+    //////////////////////////////////////////////////////////////////////
+    // LogRing - ring buffer of formatted log records of one thread
+    //
+    // The ring has a single producer, the owning thread, and a single
+    // consumer, the writer thread of AsyncLog. Each entry is a 4 byte
+    // length followed by the kind ('T' for a text line or 'R' for a binary
+    // record) and the data.
+    //
+    class LogRing
+    {
+        char* _data;
+        unsigned long _size;
+        volatile unsigned long _head;  // written by the producer
+        volatile unsigned long _tail;  // written by the consumer
+
+        LogRing(const LogRing&);
+        LogRing& operator=(const LogRing&);
+
+        void copyIn(unsigned long pos, const char* p, unsigned long n)
+        {
+          unsigned long off = pos & (_size - 1);
+          unsigned long first = std::min(n, _size - off);
+          memcpy(_data + off, p, first);
+          memcpy(_data, p + first, n - first);
+        }
+
+        void copyOut(unsigned long pos, char* p, unsigned long n) const
+        {
+          unsigned long off = pos & (_size - 1);
+          unsigned long first = std::min(n, _size - off);
+          memcpy(p, _data + off, first);
+          memcpy(p + first, _data, n - first);
+        }
+
+      public:
+        explicit LogRing(unsigned long size)
+          : _size(4096),
+            _head(0),
+            _tail(0),
+            closed(false),
+            dropped(0)
+        {
+          while (_size < size)
+            _size <<= 1;
+          _data = new char[_size];
+        }
+
+        ~LogRing()
+        { delete[] _data; }
+
+        unsigned long size() const
+        { return _size; }
+
+        unsigned long fill() const
+        { return _head - _tail; }
+
+        bool empty() const
+        { return _head == _tail; }
+
+        // maximum size of the data of an entry
+        unsigned long maxData() const
+        { return _size - sizeof(uint32_t) - 1; }
+
+        // append an entry; returns false if there is not enough space
+        bool put(char kind, const std::string& data)
+        {
+          uint32_t len = static_cast<uint32_t>(std::min(static_cast<unsigned long>(data.size()), maxData()));
+          unsigned long head = _head;
+          if (_size - (head - _tail) < sizeof(len) + 1 + len)
+            return false;
+
+          copyIn(head, reinterpret_cast<const char*>(&len), sizeof(len));
+          copyIn(head + sizeof(len), &kind, 1);
+          copyIn(head + sizeof(len) + 1, data.data(), len);
+          membar_write();
+          _head = head + sizeof(len) + 1 + len;
+          return true;
+        }
+
+        // pass all entries to the output; returns the number of entries
+        unsigned drain(LogOutput& output, std::string& data)
+        {
+          unsigned long head = _head;
+          membar_read();
+
+          unsigned long tail = _tail;
+          unsigned count = 0;
+          while (tail != head)
+          {
+            uint32_t len;
+            char kind;
+            copyOut(tail, reinterpret_cast<char*>(&len), sizeof(len));
+            copyOut(tail + sizeof(len), &kind, 1);
+            data.resize(len);
+            if (len > 0)
+              copyOut(tail + sizeof(len) + 1, &data[0], len);
+            tail += sizeof(len) + 1 + len;
+
+            if (kind == 'R')
+              output.putRecord(data);
+            else
+              output.putText(data);
+            output.finish(false);
+            ++count;
+          }
+
+          membar_rw();
+          _tail = tail;
+          return count;
+        }
+
+        // data used by the owning thread
+        LogDate logDate;
+        std::string msg;
+
+        // set when the owning thread terminates
+        volatile bool closed;
+        atomic_t dropped;
+    };
+
+    //////////////////////////////////////////////////////////////////////
+    // AsyncLog - drains the rings of all threads into the output
+    //
+    class AsyncLog
+    {
+        typedef std::vector<LogRing*> Rings;
+
+        pthread_key_t _ringKey;
+        Mutex _ringsMutex;
+        Rings _rings;
+
+        SmartPtr<LogOutput> _output;
+        unsigned long _ringSize;
+        bool _drop;
+        AttachedThread* _thread;
+        atomic_t _running;
+
+        // number of threads currently in put; stop waits for them, so that
+        // nothing is written into the rings after the final drain
+        atomic_t _producers;
+
+        // state of the writer thread and waiting producers
+        Mutex _mutex;
+        Condition _wakeup;
+        Condition _space;
+        volatile bool _idle;
+        bool _stop;
+        unsigned _waiting;
+
+        LogDate _logDate;
+
+        static void ringClosed(void* ring)
+        { static_cast<LogRing*>(ring)->closed = true; }
+
+        LogRing& ring();
+        void put(LogRing& r, char kind, const std::string& data);
+        unsigned drain(Rings& rings, std::string& msg);
+        void run();
+
+      public:
+        AsyncLog()
+          : _ringSize(0),
+            _drop(false),
+            _thread(0),
+            _running(0),
+            _producers(0),
+            _idle(false),
+            _stop(false),
+            _waiting(0)
+        {
+          pthread_key_create(&_ringKey, ringClosed);
+        }
+
+        ~AsyncLog()
+        { stop(); }
+
+        bool running()
+        { return atomicGet(_running) != 0; }
+
+        void start(const SmartPtr<LogOutput>& output, unsigned long ringSize, bool drop);
+        void stop();
+
+        // Returns false, when the writer is not running. The caller has to
+        // output the message itself then.
+        bool put(const char* level, const std::string& category, const std::string& msg);
+        bool putRecord(const std::string& data);
+    };
+
+    LogRing& AsyncLog::ring()
+    {
+      LogRing* ring = static_cast<LogRing*>(pthread_getspecific(_ringKey));
+      if (ring == 0)
+      {
+        ring = new LogRing(_ringSize);
+        pthread_setspecific(_ringKey, ring);
+
+        MutexLock lock(_ringsMutex);
+        _rings.push_back(ring);
+      }
+
+      return *ring;
+    }
+
+    void AsyncLog::start(const SmartPtr<LogOutput>& output, unsigned long ringSize, bool drop)
+    {
+      stop();
+
+      _output = output;
+      _ringSize = ringSize;
+      _drop = drop;
+      _stop = false;
+      _thread = new AttachedThread(callable(*this, &AsyncLog::run));
+      _thread->start();
+      atomicExchange(_running, 1);
+    }
+
+    void AsyncLog::stop()
+    {
+      if (_thread == 0)
+        return;
+
+      // new messages are output directly from now on; wait for the threads,
+      // which already passed the check
+      atomicExchange(_running, 0);
+      while (atomicGet(_producers) > 0)
+        Thread::yield();
+
+      {
+        MutexLock lock(_mutex);
+        _stop = true;
+        _wakeup.signal();
+        _space.broadcast();
+      }
+
+      _thread->join();
+      delete _thread;
+      _thread = 0;
+      _output = 0;
+    }
+
+    bool AsyncLog::put(const char* level, const std::string& category, const std::string& msg)
+    {
+      ScopedAtomicIncrementer inc(_producers);
+      if (atomicGet(_running) == 0)
+        return false;
+
+      LogRing& r = ring();
+
+      r.msg.clear();
+      logentry(r.msg, level, category, r.logDate);
+      r.msg += msg;
+
+      put(r, 'T', r.msg);
+      return true;
+    }
+
+    bool AsyncLog::putRecord(const std::string& data)
+    {
+      ScopedAtomicIncrementer inc(_producers);
+      if (atomicGet(_running) == 0)
+        return false;
+
+      LogRing& r = ring();
+
+      // a truncated record can't be decoded
+      if (data.size() > r.maxData())
+        atomicIncrement(r.dropped);
+      else
+        put(r, 'R', data);
+
+      return true;
+    }
+
+    void AsyncLog::put(LogRing& r, char kind, const std::string& data)
+    {
+      while (!r.put(kind, data))
+      {
+        if (_drop)
+        {
+          atomicIncrement(r.dropped);
+          return;
+        }
+
+        MutexLock lock(_mutex);
+        if (_stop)
+          return;
+
+        ++_waiting;
+        _wakeup.signal();
+        _space.wait(lock, 10);
+        --_waiting;
+      }
+
+      // The writer runs at least every 10 ms. Wake it up earlier, when the
+      // ring gets full.
+      if (_idle && r.fill() >= r.size() / 4)
+      {
+        MutexLock lock(_mutex);
+        _idle = false;
+        _wakeup.signal();
+      }
+    }
+
+    unsigned AsyncLog::drain(Rings& rings, std::string& msg)
+    {
+      {
+        MutexLock lock(_ringsMutex);
+
+        // remove rings of terminated threads, when they are empty
+        Rings::iterator it = _rings.begin();
+        while (it != _rings.end())
+        {
+          if ((*it)->closed && (*it)->empty())
+          {
+            delete *it;
+            it = _rings.erase(it);
+          }
+          else
+            ++it;
+        }
+
+        rings = _rings;
+      }
+
+      unsigned count = 0;
+      for (Rings::iterator it = rings.begin(); it != rings.end(); ++it)
+      {
+        count += (*it)->drain(*_output, msg);
+
+        atomic_t dropped = atomicExchange((*it)->dropped, 0);
+        if (dropped > 0)
+        {
+          msg.clear();
+          logentry(msg, "WARN", "cxxtools.log", _logDate);
+          msg += convert<std::string>(dropped);
+          msg += " log messages dropped";
+          _output->putText(msg);
+          _output->finish(false);
+        }
+      }
+
+      return count;
+    }
+
+    void AsyncLog::run()
+    {
+      Rings rings;
+      std::string msg;
+
+      while (true)
+      {
+        unsigned count = 0;
+        try
+        {
+          count = drain(rings, msg);
+          if (count > 0)
+            _output->finish(true);
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        MutexLock lock(_mutex);
+
+        if (_waiting > 0)
+          _space.broadcast();
+
+        if (_stop)
+          break;
+
+        if (count == 0)
+        {
+          _idle = true;
+          _wakeup.wait(lock, 10);
+          _idle = false;
+        }
+      }
+
+      // process messages, which were logged while stopping
+      try
+      {
+        if (drain(rings, msg) > 0)
+          _output->finish(true);
+      }
+      catch (const std::exception&)
+      {
+      }
+    }
+
+    AsyncLog asyncLog;
+
     //////////////////////////////////////////////////////////////////////
     Logger::log_level_type str2loglevel(const std::string& level, const std::string& category = std::string())
     {
@@ -407,6 +1206,38 @@ namespace cxxtools
                   }
       }
     }
+
+    // reads a number with an optional suffix 'k', 'm' or 'g'
+    unsigned str2size(const std::string& s, const char* what)
+    {
+      unsigned size;
+      bool ok = true;
+      std::string::const_iterator it = getInt(s.begin(), s.end(), ok, size);
+      if (!ok)
+        throw std::runtime_error(std::string("failed to read ") + what + " (\"" + s + "\")");
+      if (it != s.end())
+      {
+        switch (*it)
+        {
+          case 'k':
+          case 'K':
+            size *= 1024;
+            break;
+
+          case 'm':
+          case 'M':
+            size *= 1024 * 1024;
+            break;
+
+          case 'g':
+          case 'G':
+            size *= 1024 * 1024 * 1024;
+            break;
+        }
+      }
+
+      return size;
+    }
   }
 
   //////////////////////////////////////////////////////////////////////
@@ -432,6 +1263,10 @@ namespace cxxtools
       unsigned short _logport;
       bool _broadcast;
       bool _tostdout;  // flag for console output: true=stdout, false=stderr
+      bool _async;
+      unsigned _asyncBufferSize;
+      bool _asyncDrop;
+      bool _binary;
 
       Logger::log_level_type _rootLevel;
       LogLevels _logLevels;
@@ -444,6 +1279,11 @@ namespace cxxtools
           _maxbackupindex(0),
           _logport(0),
           _broadcast(true),
+          _tostdout(false),
+          _async(false),
+          _asyncBufferSize(65536),
+          _asyncDrop(false),
+          _binary(false),
           _rootLevel(Logger::FATAL)
       { }
 
@@ -454,6 +1294,10 @@ namespace cxxtools
       unsigned short logport() const            { return _logport; }
       bool broadcast() const                    { return _broadcast; }
       bool tostdout() const                     { return _tostdout; }
+      bool async() const                        { return _async; }
+      unsigned asyncBufferSize() const          { return _asyncBufferSize; }
+      bool asyncDrop() const                    { return _asyncDrop; }
+      bool binary() const                       { return _binary; }
 
       Logger::log_level_type rootLevel() const  { return _rootLevel; }
       Logger::log_level_type logLevel(const std::string& category) const;
@@ -503,6 +1347,31 @@ namespace cxxtools
         _tostdout = false;
       }
 
+      void setAsync(bool sw, unsigned bufferSize, bool drop)
+      {
+        _async = sw;
+        _asyncBufferSize = bufferSize;
+        _asyncDrop = drop;
+      }
+
+      void setBinary(bool sw)
+      { _binary = sw; }
+
+      // returns true, if both configurations write to the same appender in the same way
+      bool sameOutput(const Impl& other) const
+      {
+        return _fname == other._fname
+            && _maxfilesize == other._maxfilesize
+            && _maxbackupindex == other._maxbackupindex
+            && _loghost == other._loghost
+            && _logport == other._logport
+            && _broadcast == other._broadcast
+            && _tostdout == other._tostdout
+            && _async == other._async
+            && _asyncBufferSize == other._asyncBufferSize
+            && _asyncDrop == other._asyncDrop
+            && _binary == other._binary;
+      }
   };
 
   Logger::log_level_type LogConfiguration::Impl::logLevel(const std::string& category) const
@@ -538,31 +1407,7 @@ namespace cxxtools
       std::string s;
       if (si.getMember("maxfilesize", s))
       {
-        bool ok = true;
-        std::string::iterator it = getInt(s.begin(), s.end(), ok, impl._maxfilesize);
-        if (!ok)
-          throw std::runtime_error("failed to read maxfilesize (\"" + s + "\")");
-        if (it != s.end())
-        {
-          switch (*it)
-          {
-            case 'k':
-            case 'K':
-              impl._maxfilesize *= 1024;
-              break;
-
-            case 'm':
-            case 'M':
-              impl._maxfilesize *= 1024 * 1024;
-              break;
-
-            case 'g':
-            case 'G':
-              impl._maxfilesize *= 1024 * 1024 * 1024;
-              break;
-          }
-        }
-
+        impl._maxfilesize = str2size(s, "maxfilesize");
         si.getMember("maxbackupindex") >>= impl._maxbackupindex;
       }
     }
@@ -577,6 +1422,32 @@ namespace cxxtools
         impl._tostdout = false;
     }
 
+    if (!si.getMember("async", impl._async))
+      impl._async = false;
+
+    std::string s;
+    if (si.getMember("asyncbuffer", s))
+      impl._asyncBufferSize = str2size(s, "asyncbuffer");
+
+    if (si.getMember("asyncoverflow", s))
+    {
+      if (s == "drop")
+        impl._asyncDrop = true;
+      else if (s == "block")
+        impl._asyncDrop = false;
+      else
+        throw std::runtime_error("invalid value for asyncoverflow (\"" + s + "\"); expected \"block\" or \"drop\"");
+    }
+
+    impl._binary = false;
+    if (si.getMember("format", s))
+    {
+      if (s == "binary")
+        impl._binary = true;
+      else if (s != "text")
+        throw std::runtime_error("invalid log format \"" + s + "\"; expected \"text\" or \"binary\"");
+    }
+
     std::string rootLevel;
     if (!si.getMember("rootlogger", rootLevel))
       impl._rootLevel = Logger::FATAL;
@@ -672,6 +1543,16 @@ namespace cxxtools
     if (impl._tostdout)
       si.addMember("tostdout") <<= true;
 
+    if (impl._async)
+    {
+      si.addMember("async") <<= true;
+      si.addMember("asyncbuffer") <<= impl._asyncBufferSize;
+      si.addMember("asyncoverflow") <<= (impl._asyncDrop ? "drop" : "block");
+    }
+
+    if (impl._binary)
+      si.addMember("format") <<= "binary";
+
   }
 
   //////////////////////////////////////////////////////////////////////
@@ -746,6 +1627,26 @@ namespace cxxtools
     _impl->setStderr();
   }
 
+  bool LogConfiguration::async() const
+  {
+    return _impl->async();
+  }
+
+  void LogConfiguration::setAsync(bool sw, unsigned bufferSize, OverflowPolicy policy)
+  {
+    _impl->setAsync(sw, bufferSize, policy == Drop);
+  }
+
+  LogConfiguration::Format LogConfiguration::format() const
+  {
+    return _impl->binary() ? Binary : Text;
+  }
+
+  void LogConfiguration::setFormat(Format format)
+  {
+    _impl->setBinary(format == Binary);
+  }
+
   void operator>>= (const SerializationInfo& si, LogConfiguration& logConfiguration)
   {
     si >>= *logConfiguration.impl();
@@ -763,9 +1664,15 @@ namespace cxxtools
   class LogManager::Impl
   {
       SmartPtr<LogAppender> _appender;
-      LogConfiguration _config;
+      SmartPtr<LogOutput> _output;
       typedef std::map<std::string, Logger*> Loggers;  // map category => logger
-      Loggers _loggers;
+
+      // Configuration and loggers are read without locking; configure and
+      // the creation of new loggers publish new snapshots.
+      Snapshot<LogConfiguration> _config;
+      Snapshot<Loggers> _loggers;
+
+      void configureOutput(const LogConfiguration& config);
 
       Impl(const Impl&);
       Impl& operator=(const Impl&);
@@ -775,22 +1682,37 @@ namespace cxxtools
       ~Impl();
 
       void configure(const LogConfiguration& config);
-      const LogConfiguration& getLogConfiguration() const
-      { return _config; }
+      LogConfiguration getLogConfiguration()
+      { return *Snapshot<LogConfiguration>::Reader(_config); }
 
       Logger* getLogger(const std::string& category);
-      LogAppender& appender()
-      { return *_appender; }
+      LogOutput& output()
+      { return *_output; }
     
-      Logger::log_level_type rootLevel() const
-      { return _config.rootLevel(); }
+      Logger::log_level_type rootLevel()
+      { return Snapshot<LogConfiguration>::Reader(_config)->rootLevel(); }
 
-      Logger::log_level_type logLevel(const std::string& category) const
-      { return _config.logLevel(category); }
+      Logger::log_level_type logLevel(const std::string& category)
+      { return Snapshot<LogConfiguration>::Reader(_config)->logLevel(category); }
   };
 
   LogManager::Impl::Impl(const LogConfiguration& config)
+    : _config(new LogConfiguration(config)),
+      _loggers(new Loggers())
+  {
+    configureOutput(config);
+  }
+
+  void LogManager::Impl::configureOutput(const LogConfiguration& config)
   {
+    // flush and stop the writer thread before the appender is replaced
+    asyncLog.stop();
+
+    // the last writer may have left messages to a thread, which is still
+    // waiting for the mutex
+    if (_output)
+      _output->finish(true);
+
     if (config.impl()->fname().empty())
     {
       if (config.impl()->logport() != 0)
@@ -811,40 +1733,38 @@ namespace cxxtools
       _appender = new RollingFileAppender(config.impl()->fname(), config.impl()->maxfilesize(), config.impl()->maxbackupindex());
     }
 
-    _config = config;
+    _output = new LogOutput(_appender, config.impl()->binary());
+
+    if (config.impl()->async())
+      asyncLog.start(_output, config.impl()->asyncBufferSize(), config.impl()->asyncDrop());
   }
 
   void LogManager::Impl::configure(const LogConfiguration& config)
   {
-    if (config.impl()->fname().empty())
+    // A change of log levels only does not touch the appender, so that
+    // logging threads are not blocked.
+    if (!config.impl()->sameOutput(*_config.current().impl()))
     {
-      if (config.impl()->logport() != 0)
-      {
-        _appender = new UdpAppender(config.impl()->loghost(), config.impl()->logport(), config.impl()->broadcast());
-      }
-      else
-      {
-        _appender = new FdAppender(config.impl()->tostdout() ? STDOUT_FILENO : STDERR_FILENO);
-      }
-    }
-    else if (config.impl()->maxfilesize() == 0)
-    {
-      _appender = new FileAppender(config.impl()->fname());
-    }
-    else
-    {
-      _appender = new RollingFileAppender(config.impl()->fname(), config.impl()->maxfilesize(), config.impl()->maxbackupindex());
+      MutexLock lock(logMutex);
+      configureOutput(config);
     }
 
-    _config = config;
+    _config.publish(new LogConfiguration(config));
 
-    for (Loggers::iterator it = _loggers.begin(); it != _loggers.end(); ++it)
-      it->second->setLogLevel(logLevel(it->second->getCategory()));
+    // loggers created after publishing the configuration already got the
+    // new level; the others are updated here
+    MutexLock lock(loggersMutex);
+    const Loggers& loggers = _loggers.current();
+    for (Loggers::const_iterator it = loggers.begin(); it != loggers.end(); ++it)
+      it->second->setLogLevel(config.logLevel(it->second->getCategory()));
   }
 
   LogManager::Impl::~Impl()
   {
-    for (Loggers::iterator it = _loggers.begin(); it != _loggers.end(); ++it)
+    asyncLog.stop();
+
+    const Loggers& loggers = _loggers.current();
+    for (Loggers::const_iterator it = loggers.begin(); it != loggers.end(); ++it)
       delete it->second;
   }
 
@@ -945,12 +1865,13 @@ namespace cxxtools
 
   void LogManager::configure(const LogConfiguration& config)
   {
-    MutexLock lock(logMutex);
-
-    _enabled = false;
+    MutexLock lock(configMutex);
 
     if (_impl == 0)
+    {
+      MutexLock lock(logMutex);
       _impl = new Impl(config);
+    }
     else
       _impl->configure(config);
 
@@ -981,15 +1902,26 @@ namespace cxxtools
 
   Logger* LogManager::Impl::getLogger(const std::string& category)
   {
+    {
+      Snapshot<Loggers>::Reader loggers(_loggers);
+      Loggers::const_iterator it = loggers->find(category);
+      if (it != loggers->end())
+        return it->second;
+    }
+
     MutexLock lock(loggersMutex);
 
-    // check for existing loggers
-    Loggers::iterator it = _loggers.find(category);
-    if (it != _loggers.end())
+    // check again, since the logger may have been created in the meantime
+    const Loggers& loggers = _loggers.current();
+    Loggers::const_iterator it = loggers.find(category);
+    if (it != loggers.end())
       return it->second;
 
     Logger* ret = new Logger(category, logLevel(category));
-    _loggers[category] = ret;
+
+    Loggers* newLoggers = new Loggers(loggers);
+    (*newLoggers)[category] = ret;
+    _loggers.publish(newLoggers);
 
     return ret;
   }
@@ -1067,10 +1999,27 @@ namespace cxxtools
 
   void LogMessage::Impl::finish()
   {
+    if (asyncLog.running())
+    {
+      bool done = true;
+      try
+      {
+        done = asyncLog.put(_level, _logger->getCategory(), _msg.str());
+      }
+      catch (const std::exception&)
+      {
+      }
+
+      if (done)
+      {
+        clear();
+        return;
+      }
+    }
+
     try
     {
-      ScopedAtomicIncrementer inc(mutexWaitCount);
-      MutexLock lock(logMutex);
+      LogMutexLock lock;
 
       if (!LogManager::isEnabled())
         return;
@@ -1079,9 +2028,9 @@ namespace cxxtools
       logentry(msg, _level, _logger->getCategory());
       msg += _msg.str();
 
-      LogAppender& appender = LogManager::getInstance().impl()->appender();
-      appender.putMessage(msg);
-      appender.finish((atomicGet(mutexWaitCount) <= 1));
+      LogOutput& output = LogManager::getInstance().impl()->output();
+      output.putText(msg);
+      output.finish(!lock.othersWaiting());
     }
     catch (const std::exception&)
     {
@@ -1172,10 +2121,24 @@ namespace cxxtools
 
   void LogTracer::Impl::putmessage(const char* state) const
   {
+    if (asyncLog.running())
+    {
+      bool done = true;
+      try
+      {
+        done = asyncLog.put("TRACE", _logger->getCategory(), state + _msg.str());
+      }
+      catch (const std::exception&)
+      {
+      }
+
+      if (done)
+        return;
+    }
+
     try
     {
-      ScopedAtomicIncrementer inc(mutexWaitCount);
-      MutexLock lock(logMutex);
+      LogMutexLock lock;
 
       if (!LogManager::isEnabled())
         return;
@@ -1185,13 +2148,292 @@ namespace cxxtools
       msg += state;
       msg += _msg.str();
 
-      LogAppender& appender = LogManager::getInstance().impl()->appender();
-      appender.putMessage(msg);
-      appender.finish((atomicGet(mutexWaitCount) <= 1));
+      LogOutput& output = LogManager::getInstance().impl()->output();
+      output.putText(msg);
+      output.finish(!lock.othersWaiting());
+    }
+    catch (const std::exception&)
+    {
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // LogRecord
+  //
+  class LogRecord::Impl
+  {
+      std::string _data;
+
+      template <typename T>
+      void put(char type, T value)
+      {
+        _data += type;
+        putRaw(_data, value);
+      }
+
+    public:
+      void start(Logger* logger, LogSite& site)
+      {
+        uint32_t id = site.id;
+        if (id == 0)
+          id = logSites.registerSite(site, *logger);
+
+        struct timeval t;
+        gettimeofday(&t, 0);
+
+        _data.clear();
+        putRaw(_data, id);
+        putRaw(_data, static_cast<int64_t>(t.tv_sec));
+        putRaw(_data, static_cast<uint32_t>(t.tv_usec));
+        putRaw(_data, static_cast<uint32_t>(getpid()));
+        putRaw(_data, static_cast<uint64_t>(pthread_self()));
+      }
+
+      void putString(const char* s, std::string::size_type len)
+      {
+        _data += static_cast<char>(ArgString);
+        putRawString(_data, s, len);
+      }
+
+      void putInt(int64_t i)          { put(ArgInt, i); }
+      void putUnsigned(uint64_t i)    { put(ArgUnsigned, i); }
+      void putDouble(double d)        { put(ArgDouble, d); }
+      void putChar(char c)            { put(ArgChar, c); }
+      void putBool(bool b)            { put(ArgBool, static_cast<char>(b)); }
+      void putPointer(const void* p)  { put(ArgPointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p))); }
+
+      void finish();
+  };
+
+  namespace
+  {
+    LPool<LogRecord::Impl> logRecordImplPool;
+  }
+
+  void LogRecord::Impl::finish()
+  {
+    if (asyncLog.running())
+    {
+      bool done = true;
+      try
+      {
+        done = asyncLog.putRecord(_data);
+      }
+      catch (const std::exception&)
+      {
+      }
+
+      if (done)
+        return;
+    }
+
+    try
+    {
+      LogMutexLock lock;
+
+      if (!LogManager::isEnabled())
+        return;
+
+      LogOutput& output = LogManager::getInstance().impl()->output();
+      output.putRecord(_data);
+      output.finish(!lock.othersWaiting());
     }
     catch (const std::exception&)
     {
     }
   }
 
+  LogRecord::LogRecord(Logger* logger, LogSite& site)
+    : _impl(logRecordImplPool.getInstance())
+  {
+    _impl->start(logger, site);
+  }
+
+  LogRecord::~LogRecord()
+  {
+    if (_impl)
+    {
+      _impl->finish();
+      logRecordImplPool.releaseInstance(_impl);
+    }
+  }
+
+  void LogRecord::finish()
+  {
+    _impl->finish();
+    logRecordImplPool.releaseInstance(_impl);
+    _impl = 0;
+  }
+
+  LogRecord& LogRecord::operator<< (const std::string& s)
+  {
+    _impl->putString(s.data(), s.size());
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (const char* s)
+  {
+    _impl->putString(s, strlen(s));
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (char c)
+  {
+    _impl->putChar(c);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (bool b)
+  {
+    _impl->putBool(b);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (short i)
+  {
+    _impl->putInt(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (unsigned short i)
+  {
+    _impl->putUnsigned(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (int i)
+  {
+    _impl->putInt(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (unsigned i)
+  {
+    _impl->putUnsigned(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (long i)
+  {
+    _impl->putInt(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (unsigned long i)
+  {
+    _impl->putUnsigned(i);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (float d)
+  {
+    _impl->putDouble(d);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (double d)
+  {
+    _impl->putDouble(d);
+    return *this;
+  }
+
+  LogRecord& LogRecord::operator<< (const void* p)
+  {
+    _impl->putPointer(p);
+    return *this;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // BinaryLogDecoder
+  //
+  class BinaryLogDecoder::Impl : public LogSiteTable
+  {
+      std::istream& _in;
+      std::map<uint32_t, LogSiteInfo> _sites;
+      LogDate _logDate;
+      std::string _frame;
+
+    public:
+      explicit Impl(std::istream& in)
+        : _in(in)
+      { }
+
+      const LogSiteInfo* find(uint32_t id) const
+      {
+        std::map<uint32_t, LogSiteInfo>::const_iterator it = _sites.find(id);
+        return it == _sites.end() ? 0 : &it->second;
+      }
+
+      bool getLine(std::string& line);
+  };
+
+  bool BinaryLogDecoder::Impl::getLine(std::string& line)
+  {
+    while (true)
+    {
+      uint32_t size;
+      if (!_in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size == 0)
+        return false;
+
+      _frame.resize(size);
+      if (!_in.read(&_frame[0], size))
+        return false;
+
+      const char* data = _frame.data() + 1;
+      std::string::size_type len = size - 1;
+
+      switch (_frame[0])
+      {
+        case 'H':
+        {
+          BinaryReader in(data, len);
+          if (in.getString() != binaryLogMagic)
+            throw std::runtime_error("no binary log");
+          if (in.get<uint32_t>() != binaryLogVersion)
+            throw std::runtime_error("unsupported binary log version");
+          _sites.clear();
+          break;
+        }
+
+        case 'S':
+        {
+          BinaryReader in(data, len);
+          uint32_t id = in.get<uint32_t>();
+          LogSiteInfo& site = _sites[id];
+          site.line = in.get<uint32_t>();
+          site.level = in.getString();
+          site.file = in.getString();
+          site.category = in.getString();
+          break;
+        }
+
+        case 'R':
+          line.clear();
+          renderRecord(data, len, *this, _logDate, line);
+          return true;
+
+        case 'T':
+          line.assign(data, len);
+          return true;
+
+        // unknown frames are skipped
+      }
+    }
+  }
+
+  BinaryLogDecoder::BinaryLogDecoder(std::istream& in)
+    : _impl(new Impl(in))
+  {
+  }
+
+  BinaryLogDecoder::~BinaryLogDecoder()
+  {
+    delete _impl;
+  }
+
+  bool BinaryLogDecoder::getLine(std::string& line)
+  {
+    return _impl->getLine(line);
+  }
+
 }
@@ -75,6 +75,10 @@ void Selectable::close()
 {
     if( this->enabled() )
     {
+        // the selector has to release the descriptors while they are open
+        if (_parent)
+            _parent->onClose(*this);
+
         this->onClose();
         this->setEnabled(false);
     }
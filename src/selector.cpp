@@ -24,6 +24,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include "selectorimpl.h"
+#include "timerwheel.h"
 #include "cxxtools/selector.h"
 #include "cxxtools/timer.h"
 #include "cxxtools/clock.h"
@@ -34,11 +35,10 @@ const std::size_t SelectorBase::WaitInfinite;
 
 SelectorBase::~SelectorBase()
 {
-    while( _timers.size() )
-    {
-       Timer* timer = _timers.begin()->second;
+    while (Timer* timer = _timerWheel->any())
         timer->setSelector(0);
-    }
+
+    delete _timerWheel;
 }
 
 
@@ -68,79 +68,66 @@ void SelectorBase::remove( Timer& timer )
 }
 
 
+void SelectorBase::setTimerGranularity(const Milliseconds& granularity)
+{
+    _timerWheel->setGranularity(granularity);
+}
+
+
+Milliseconds SelectorBase::timerGranularity() const
+{
+    return _timerWheel->granularity();
+}
+
+
+void SelectorBase::onClose(Selectable&)
+{
+}
+
+
 void SelectorBase::onAddTimer(Timer& timer)
 {
     if( timer.active() )
-    {
-        TimerMap::value_type elem(timer.finished(), &timer);
-        _timers.insert(elem);
-        //_timers.insert( std::make_pair(timer.finished(), &timer) );
-    }
+        _timerWheel->add(timer);
 }
 
 
 void SelectorBase::onRemoveTimer( Timer& timer )
 {
-    std::multimap<Timespan, Timer*>::iterator it;
-    for(it = _timers.begin(); it != _timers.end(); ++it)
-    {
-        if(it->second == &timer)
-        {
-            _timers.erase(it);
-            return;
-        }
-    }
+    _timerWheel->remove(timer);
 }
 
 
 void SelectorBase::onTimerChanged(Timer& timer)
 {
     if( timer.active() )
-    {
-        TimerMap::value_type elem(timer.finished(), &timer);
-        _timers.insert(elem);
-        //_timers.insert( std::make_pair(timer.finished(), &timer) );
-    }
+        _timerWheel->add(timer);
     else
-    {
-        SelectorBase::onRemoveTimer(timer);
-    }
+        _timerWheel->remove(timer);
 }
 
 
 bool SelectorBase::updateTimer(std::size_t& lowestTimeout)
 {
-    if( _timers.empty() )
+    if( _timerWheel->empty() )
+    {
+        lowestTimeout = Selector::WaitInfinite;
         return false;
+    }
 
     Timespan now = Clock::getSystemTicks();
-    Timer* timer = _timers.begin()->second;
-    bool timerActive = now >= timer->finished();
+    _timerWheel->advance(now);
 
-    while( ! _timers.empty() )
+    // Timer::update reschedules the timer, so that it is not returned again
+    bool timerActive = false;
+    while (Timer* timer = _timerWheel->popExpired())
     {
-        timer = _timers.begin()->second;
-
-        if( now < timer->finished() )
-        {
-            int64_t remaining = (timer->finished() - now).totalUSecs();
-            lowestTimeout = (remaining / 1000);
-            if(remaining % 1000 > 0) ++lowestTimeout;
-            break;
-        }
-
         timer->update(now);
-
-        if( ! _timers.empty() )
-        {
-            timer = _timers.begin()->second;
-            _timers.erase( _timers.begin() );
-            TimerMap::value_type elem(timer->finished(), timer);
-            _timers.insert(elem);
-            //_timers.insert( std::make_pair(timer->finished(), timer) );
-        }
+        timerActive = true;
     }
 
+    lowestTimeout = _timerWheel->timeout(now);
+
     return timerActive;
 }
 
@@ -186,6 +173,7 @@ void SelectorBase::wake()
 
 
 SelectorBase::SelectorBase()
+: _timerWheel(new TimerWheel())
 {}
 
 
@@ -222,6 +210,13 @@ void Selector::onChanged(Selectable& s)
 
 void Selector::onReinit(Selectable& s)
 {
+    _impl->reinit(s);
+}
+
+
+void Selector::onClose(Selectable& s)
+{
+    _impl->closing(s);
 }
 
 
@@ -242,4 +237,10 @@ SelectorImpl& Selector::impl()
     return *_impl;
 }
 
+
+WakeCounters Selector::wakeCounters() const
+{
+    return _impl->wakeCounters();
+}
+
 }//namespace cxxtools
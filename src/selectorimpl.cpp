@@ -33,6 +33,8 @@
 #include "cxxtools/selector.h"
 #include "cxxtools/log.h"
 #include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
@@ -40,6 +42,10 @@
 #include <iostream>
 #include <limits>
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 log_define("cxxtools.selector.impl")
 
 namespace cxxtools
@@ -47,31 +53,152 @@ namespace cxxtools
 
 const short SelectorImpl::POLL_ERROR_MASK= POLLERR | POLLHUP | POLLNVAL;
 
+#ifdef HAVE_SYS_EPOLL_H
+namespace
+{
+    uint32_t pollToEpoll(short events)
+    {
+        uint32_t ret = 0;
+        if (events & POLLIN)
+            ret |= EPOLLIN;
+        if (events & POLLPRI)
+            ret |= EPOLLPRI;
+        if (events & POLLOUT)
+            ret |= EPOLLOUT;
+        return ret;
+    }
+
+    short epollToPoll(uint32_t events)
+    {
+        short ret = 0;
+        if (events & EPOLLIN)
+            ret |= POLLIN;
+        if (events & EPOLLPRI)
+            ret |= POLLPRI;
+        if (events & EPOLLOUT)
+            ret |= POLLOUT;
+        if (events & EPOLLERR)
+            ret |= POLLERR;
+        if (events & EPOLLHUP)
+            ret |= POLLHUP;
+        return ret;
+    }
+
+    bool pollForced()
+    {
+        const char* s = ::getenv("CXXTOOLS_SELECTOR");
+        return s != 0 && std::strcmp(s, "poll") == 0;
+    }
+}
+#endif
+
 SelectorImpl::SelectorImpl()
-: _isDirty(true)
+: _wakePending(0)
+, _wakeRequests(0)
+, _wakeSyscalls(0)
+, _isDirty(true)
+, _epollFd(-1)
+, _eventFd(-1)
+, _unpollable(0)
+, _dispatching(false)
 {
     _current = _devices.end();
-
-    //Open a pipe to send wake up message.
+    _wakePipe[0] = _wakePipe[1] = -1;
+
+    // The wake channel is an eventfd, where available, and a pipe otherwise.
+    // _eventFd is the end, which is monitored.
+#ifdef HAVE_SYS_EVENTFD_H
+    _eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_eventFd < 0)
+        throwSystemError("eventfd");
+#else
     if( ::pipe( _wakePipe ) )
         throwSystemError("pipe");
 
-    int flags = ::fcntl(_wakePipe[0], F_GETFL);
-    if(-1 == flags)
+    if (::fcntl(_wakePipe[0], F_SETFL, ::fcntl(_wakePipe[0], F_GETFL) | O_NONBLOCK) == -1
+      || ::fcntl(_wakePipe[1], F_SETFL, ::fcntl(_wakePipe[1], F_GETFL) | O_NONBLOCK) == -1)
+    {
+        ::close(_wakePipe[0]);
+        ::close(_wakePipe[1]);
         throwSystemError("fcntl");
+    }
 
-    int ret = ::fcntl(_wakePipe[0], F_SETFL, flags|O_NONBLOCK);
-    if(-1 == ret)
-        throwSystemError("fcntl");
+    _eventFd = _wakePipe[0];
+#endif
 
-    flags = ::fcntl(_wakePipe[1], F_GETFL);
-    if(-1 == flags)
-        throwSystemError("fcntl");
+#ifdef HAVE_SYS_EPOLL_H
+    if (!pollForced())
+    {
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFd < 0)
+            log_warn("epoll_create1 failed with errno " << errno << "; falling back to poll");
+    }
 
-    ret = ::fcntl(_wakePipe[1], F_SETFL, flags|O_NONBLOCK);
-    if(-1 == ret)
-        throwSystemError("fcntl");
+    if (_epollFd >= 0)
+    {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = _eventFd;
+        if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _eventFd, &ev) != 0)
+        {
+            ::close(_epollFd);
+            closeWakeChannel();
+            throwSystemError("epoll_ctl");
+        }
+
+        _events.resize(64);
 
+        log_debug("using epoll backend");
+    }
+#endif
+}
+
+
+void SelectorImpl::closeWakeChannel()
+{
+    if( _wakePipe[0] != -1 && _wakePipe[1] != -1 )
+    {
+        ::close(_wakePipe[0]);
+        ::close(_wakePipe[1]);
+    }
+    else if (_eventFd != -1)
+    {
+        ::close(_eventFd);
+    }
+}
+
+
+bool SelectorImpl::drainWakeChannel()
+{
+    static char buffer[1024];
+    bool woken = false;
+    while(true)
+    {
+        int ret = ::read(_eventFd, buffer, sizeof(buffer));
+        if(ret > 0)
+        {
+            woken = true;
+            continue;
+        }
+
+        if (ret == -1)
+        {
+            if(errno == EINTR)
+                continue;
+
+            if(errno == EAGAIN)
+                break;
+        }
+
+        throw IOError("Could not read from wake channel");
+    }
+
+    // Wakers, which came between draining and here, are served by this
+    // wakeup, since the selector returns now.
+    atomicExchange(_wakePending, 0);
+
+    return woken;
 }
 
 
@@ -84,16 +211,44 @@ SelectorImpl::~SelectorImpl()
         (*it)->setSelector(0);
     }
 
-    if( _wakePipe[0] != -1 && _wakePipe[1] != -1 )
+#ifdef HAVE_SYS_EPOLL_H
+    while( _registrations.size() )
     {
-        ::close(_wakePipe[0]);
-        ::close(_wakePipe[1]);
+        Selectable* dev = _registrations.begin()->first;
+        dev->setSelector(0);
+
+        Registrations::iterator it = _registrations.find(dev);
+        if (it != _registrations.end())
+            unregisterDevice(it);
     }
+
+    for (std::vector<Registration*>::iterator it = _removed.begin(); it != _removed.end(); ++it)
+        delete *it;
+
+    for (std::vector<Registration*>::iterator it = _pending.begin(); it != _pending.end(); ++it)
+        delete *it;
+#endif
+
+    closeWakeChannel();
+
+    if (_epollFd != -1)
+        ::close(_epollFd);
 }
 
 
 void SelectorImpl::add(Selectable& dev)
 {
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+    {
+        Registrations::iterator it = _registrations.find(&dev);
+        if (it != _registrations.end())
+            unregisterDevice(it);
+        registerDevice(dev);
+        return;
+    }
+#endif
+
     _devices.insert(&dev);
     _isDirty = true;
 }
@@ -101,6 +256,18 @@ void SelectorImpl::add(Selectable& dev)
 
 void SelectorImpl::remove(Selectable& dev)
 {
+    _avail.erase(&dev);
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+    {
+        Registrations::iterator it = _registrations.find(&dev);
+        if (it != _registrations.end())
+            unregisterDevice(it);
+        return;
+    }
+#endif
+
    std::set<Selectable*>::iterator it = _devices.find( &dev );
    if( it == _devices.end() )
         return;
@@ -122,6 +289,52 @@ void SelectorImpl::remove(Selectable& dev)
 }
 
 
+void SelectorImpl::reinit(Selectable& dev)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+    {
+        // the device may have a new file descriptor or a different
+        // number of descriptors, so we register it from scratch
+        Registrations::iterator it = _registrations.find(&dev);
+        if (it != _registrations.end())
+        {
+            unregisterDevice(it);
+            registerDevice(dev);
+        }
+        return;
+    }
+#endif
+
+    _isDirty = true;
+}
+
+
+void SelectorImpl::closing(Selectable& dev)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+    {
+        // A descriptor shared with another process, e.g. after fork, stays
+        // in the epoll set after close and can't be deleted any more, so it
+        // is deleted now. The poll entries are kept, since the device has
+        // pointers to them, but they must not be registered again.
+        Registrations::iterator it = _registrations.find(&dev);
+        if (it != _registrations.end() && it->second->initialized)
+        {
+            Registration& reg = *it->second;
+            for (std::size_t n = 0; n < reg.slots.size(); ++n)
+            {
+                resetSlot(reg.slots[n]);
+                reg.pfds[n].fd = -1;
+                reg.pfds[n].events = 0;
+            }
+        }
+    }
+#endif
+}
+
+
 void SelectorImpl::changed( Selectable& s )
 {
     if( s.avail() )
@@ -132,6 +345,19 @@ void SelectorImpl::changed( Selectable& s )
     {
         _avail.erase(&s);
     }
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+    {
+        Registrations::iterator it = _registrations.find(&s);
+        if (it != _registrations.end() && it->second->initialized)
+        {
+            Registration& reg = *it->second;
+            for (std::size_t n = 0; n < reg.slots.size(); ++n)
+                syncSlot(reg.slots[n], false);
+        }
+    }
+#endif
 }
 
 
@@ -148,6 +374,17 @@ bool SelectorImpl::wait(std::size_t umsecs)
         msecs = std::numeric_limits<int>::max();
     }
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epollFd >= 0)
+        return waitEpoll(umsecs, msecs);
+#endif
+
+    return waitPoll(umsecs, msecs);
+}
+
+
+bool SelectorImpl::waitPoll(std::size_t umsecs, int msecs)
+{
     if (_isDirty)
     {
         _pollfds.clear();
@@ -172,8 +409,8 @@ bool SelectorImpl::wait(std::size_t umsecs)
         // Eintraege einfuegen
         pollfd* pCurr= &_pollfds[0];
 
-        // Event Pipe einfuegen TODO cxxtools::Pipe verwenden
-        pCurr->fd = _wakePipe[0];
+        // wake channel
+        pCurr->fd = _eventFd;
         pCurr->events = POLLIN;
 
         ++pCurr;
@@ -235,61 +472,445 @@ bool SelectorImpl::wait(std::size_t umsecs)
                 throw IOError("poll error on event pipe");
             }
 
-            static char buffer[1024];
-            while(true)
+            if (drainWakeChannel())
+                avail = true;
+        }
+
+        for( _current = _devices.begin(); _current != _devices.end(); )
+        {
+            Selectable* dev = *_current;
+
+            if ( dev->enabled() && dev->simpl().checkPollEvent() )
             {
-                int ret = ::read(_wakePipe[0], buffer, sizeof(buffer));
-                if(ret > 0)
+                avail = true;
+            }
+
+            if (_current != _devices.end())
+            {
+                if (*_current == dev)
                 {
-                    avail = true;
-                    continue;
+                    ++_current;
                 }
+            }
+        }
+    }
+    catch (...)
+    {
+        _current= _devices.end();
+        throw;
+    }
+
+    return avail;
+}
+
 
-                if (ret == -1)
+#ifdef HAVE_SYS_EPOLL_H
+
+void SelectorImpl::registerDevice(Selectable& dev)
+{
+    // Like the poll backend the device is initialized in the next call to
+    // wait. Devices are added and removed again e.g. when a connect is
+    // cancelled and must not see a poll entry then.
+    Registration* reg = new Registration();
+    reg->dev = &dev;
+    reg->initialized = false;
+    reg->removed = false;
+    reg->ready = false;
+
+    try
+    {
+        _pending.push_back(reg);
+    }
+    catch (...)
+    {
+        delete reg;
+        throw;
+    }
+
+    _registrations[&dev] = reg;
+}
+
+
+void SelectorImpl::initializeDevice(Registration& reg)
+{
+    Selectable& dev = *reg.dev;
+    std::size_t pollSize = dev.simpl().pollSize();
+
+    pollfd pfd;
+    pfd.fd = -1;
+    pfd.events = 0;
+    pfd.revents = 0;
+    reg.pfds.assign(pollSize, pfd);
+
+    Slot slot;
+    slot.reg = &reg;
+    slot.fd = -1;
+    slot.events = 0;
+    slot.pollable = true;
+    slot.signalled = false;
+    reg.slots.assign(pollSize, slot);
+    for (std::size_t n = 0; n < pollSize; ++n)
+        reg.slots[n].n = n;
+
+    reg.initialized = true;
+
+    if (pollSize > 0)
+    {
+        dev.simpl().initializePoll(&reg.pfds[0], pollSize);
+        for (std::size_t n = 0; n < pollSize; ++n)
+            syncSlot(reg.slots[n], true);
+    }
+}
+
+
+void SelectorImpl::unregisterDevice(Registrations::iterator it)
+{
+    Registration* reg = it->second;
+    _registrations.erase(it);
+
+    reg->removed = true;
+
+    // not yet initialized registrations are released from the pending list
+    if (!reg->initialized)
+        return;
+
+    for (std::size_t n = 0; n < reg->slots.size(); ++n)
+        resetSlot(reg->slots[n]);
+
+    // events for this device may still be pending in the current dispatch
+    // loop, so the registration is released after the loop
+    if (_dispatching)
+        _removed.push_back(reg);
+    else
+        delete reg;
+}
+
+
+void SelectorImpl::syncSlot(Slot& slot, bool exact)
+{
+    const pollfd& pfd = slot.reg->pfds[slot.n];
+
+    if (pfd.fd != slot.fd)
+    {
+        resetSlot(slot);
+        if (pfd.fd < 0)
+            return;
+    }
+    else if (pfd.fd < 0 || !slot.pollable)
+    {
+        return;
+    }
+    else if (pfd.events == slot.events
+        || (!exact && (pfd.events & ~slot.events) == 0))
+    {
+        // Interest, which is no longer needed, is removed lazily: the kernel
+        // reports a superset, which is filtered in waitEpoll. This saves
+        // two epoll_ctl calls per request for the usual read/write cycle.
+        return;
+    }
+
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = pollToEpoll(pfd.events);
+    ev.data.fd = pfd.fd;
+
+    int op = slot.fd < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    int ret = ::epoll_ctl(_epollFd, op, pfd.fd, &ev);
+    if (ret != 0 && op == EPOLL_CTL_ADD && errno == EEXIST)
+        ret = ::epoll_ctl(_epollFd, EPOLL_CTL_MOD, pfd.fd, &ev);
+    else if (ret != 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+        ret = ::epoll_ctl(_epollFd, EPOLL_CTL_ADD, pfd.fd, &ev);
+
+    if (ret != 0)
+    {
+        if (errno != EPERM)
+            throwSystemError("epoll_ctl");
+
+        // regular files and some devices are not supported by epoll;
+        // like poll we report them as always ready
+        log_debug("fd " << pfd.fd << " not pollable by epoll");
+        slot.pollable = false;
+        ++_unpollable;
+    }
+    else
+    {
+        if (static_cast<std::size_t>(pfd.fd) >= _slotsByFd.size())
+            _slotsByFd.resize(pfd.fd + 1);
+        _slotsByFd[pfd.fd] = &slot;
+    }
+
+    slot.fd = pfd.fd;
+    slot.events = pfd.events;
+}
+
+
+void SelectorImpl::resetSlot(Slot& slot)
+{
+    if (slot.fd >= 0)
+    {
+        if (slot.pollable)
+        {
+            // Devices close their descriptors before they are removed, which
+            // removes them from the epoll set implicitly. The number may
+            // already be reused by another device, whose registration must
+            // not be deleted here.
+            if (_slotsByFd[slot.fd] == &slot)
+            {
+                _slotsByFd[slot.fd] = 0;
+                epoll_event ev;
+                std::memset(&ev, 0, sizeof(ev));
+                ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, slot.fd, &ev);
+            }
+        }
+        else
+        {
+            --_unpollable;
+        }
+    }
+
+    slot.fd = -1;
+    slot.events = 0;
+    slot.pollable = true;
+}
+
+
+bool SelectorImpl::waitEpoll(std::size_t umsecs, int msecs)
+{
+    for (std::vector<Registration*>::size_type n = 0; n < _pending.size(); ++n)
+    {
+        Registration* reg = _pending[n];
+        if (reg->removed)
+        {
+            delete reg;
+        }
+        else
+        {
+            try
+            {
+                initializeDevice(*reg);
+            }
+            catch (...)
+            {
+                _pending.erase(_pending.begin(), _pending.begin() + n + 1);
+                throw;
+            }
+        }
+    }
+
+    _pending.clear();
+
+    if (_unpollable > 0)
+        msecs = 0;
+
+    int ret = -1;
+    while( true )
+    {
+        if(umsecs != SelectorBase::WaitInfinite)
+        {
+            int64_t diff = _clock.stop().totalMSecs();
+            _clock.start();
+
+            if (diff < msecs)
+            {
+                msecs -= int(diff);
+            }
+            else
+            {
+                msecs = 0;
+            }
+        }
+
+        log_debug("epoll_wait with " << _registrations.size() << " devices, timeout=" << msecs << "ms");
+        ret = ::epoll_wait(_epollFd, &_events[0], _events.size(), msecs);
+        log_debug("epoll_wait returns " << ret);
+        if( ret != -1 )
+            break;
+
+        if( errno != EINTR )
+            throw IOError("Could not poll on file descriptors");
+    }
+
+    if( ret == 0 && _avail.empty() && _unpollable == 0 )
+        return false;
+
+    bool avail = false;
+
+    for (int e = 0; e < ret; ++e)
+    {
+        const epoll_event& ev = _events[e];
+        if (ev.data.fd == _eventFd)
+        {
+            if (ev.events & (EPOLLERR | EPOLLHUP))
+                throw IOError("poll error on event pipe");
+
+            drainWakeChannel();
+
+            avail = true;
+            continue;
+        }
+
+        // Events are looked up by descriptor, so that an event of a closed
+        // descriptor, which is still in the epoll set because it was shared
+        // with another process, is not delivered to a released slot.
+        if (static_cast<std::size_t>(ev.data.fd) >= _slotsByFd.size()
+            || _slotsByFd[ev.data.fd] == 0)
+            continue;
+
+        Slot& slot = *_slotsByFd[ev.data.fd];
+        Registration* reg = slot.reg;
+        pollfd& pfd = reg->pfds[slot.n];
+
+        pfd.revents = epollToPoll(ev.events) & (pfd.events | POLL_ERROR_MASK);
+        if (pfd.revents == 0)
+        {
+            // interest was removed lazily, so update the epoll set now
+            syncSlot(slot, true);
+            continue;
+        }
+
+        slot.signalled = true;
+        if (!reg->ready)
+        {
+            reg->ready = true;
+            _ready.push_back(reg);
+        }
+    }
+
+    if (_unpollable > 0)
+    {
+        for (Registrations::iterator it = _registrations.begin(); it != _registrations.end(); ++it)
+        {
+            Registration* reg = it->second;
+            for (std::size_t n = 0; n < reg->slots.size(); ++n)
+            {
+                if (!reg->slots[n].pollable)
                 {
-                    if(errno == EINTR)
+                    pollfd& pfd = reg->pfds[n];
+                    pfd.revents = pfd.events & (POLLIN | POLLOUT);
+                    if (pfd.revents == 0)
                         continue;
 
-                    if(errno == EAGAIN)
-                        break;
+                    reg->slots[n].signalled = true;
+                    if (!reg->ready)
+                    {
+                        reg->ready = true;
+                        _ready.push_back(reg);
+                    }
                 }
-
-                throw IOError("Could not read from pipe");
             }
         }
+    }
 
-        for( _current = _devices.begin(); _current != _devices.end(); )
+    for (std::set<Selectable*>::iterator it = _avail.begin(); it != _avail.end(); ++it)
+    {
+        Registrations::iterator r = _registrations.find(*it);
+        if (r != _registrations.end() && r->second->initialized && !r->second->ready)
         {
-            Selectable* dev = *_current;
+            r->second->ready = true;
+            _ready.push_back(r->second);
+        }
+    }
+
+    _dispatching = true;
+
+    std::vector<Registration*>::size_type n = 0;
+    try
+    {
+        for ( ; n < _ready.size(); ++n)
+        {
+            Registration* reg = _ready[n];
+            if (reg->removed)
+                continue;
 
+            Selectable* dev = reg->dev;
             if ( dev->enabled() && dev->simpl().checkPollEvent() )
             {
                 avail = true;
             }
 
-            if (_current != _devices.end())
+            if (reg->removed)
+                continue;
+
+            for (std::size_t i = 0; i < reg->pfds.size(); ++i)
             {
-                if (*_current == dev)
-                {
-                    ++_current;
-                }
+                Slot& slot = reg->slots[i];
+
+                // initializePoll resets revents; the device has set up its
+                // poll entry again e.g. with a new file descriptor after a
+                // failed connect, which may have the same number as the old
+                // one, so it is registered again
+                if (slot.signalled && reg->pfds[i].revents == 0)
+                    resetSlot(slot);
+
+                syncSlot(slot, false);
+                reg->pfds[i].revents = 0;
+                slot.signalled = false;
             }
+
+            reg->ready = false;
         }
     }
     catch (...)
     {
-        _current= _devices.end();
+        for ( ; n < _ready.size(); ++n)
+        {
+            Registration* reg = _ready[n];
+            reg->ready = false;
+            for (std::size_t i = 0; i < reg->pfds.size(); ++i)
+            {
+                reg->pfds[i].revents = 0;
+                reg->slots[i].signalled = false;
+            }
+        }
+
+        _ready.clear();
+        _dispatching = false;
+        for (std::vector<Registration*>::iterator it = _removed.begin(); it != _removed.end(); ++it)
+            delete *it;
+        _removed.clear();
         throw;
     }
 
+    _ready.clear();
+    _dispatching = false;
+    for (std::vector<Registration*>::iterator it = _removed.begin(); it != _removed.end(); ++it)
+        delete *it;
+    _removed.clear();
+
+    if (static_cast<std::size_t>(ret) == _events.size())
+        _events.resize(_events.size() * 2);
+
     return avail;
 }
 
+#endif
+
 
 void SelectorImpl::wake()
 {
-    ::write( _wakePipe[1], "W", 1);
-    ::fsync( _wakePipe[1] );
+    atomicIncrement(_wakeRequests);
+
+    // only the first waker since the last wakeup needs a system call
+    if (atomicExchange(_wakePending, 1) != 0)
+        return;
+
+    atomicIncrement(_wakeSyscalls);
+
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t one = 1;
+    ::write(_eventFd, &one, sizeof(one));
+#else
+    ::write(_wakePipe[1], "W", 1);
+#endif
+}
+
+
+WakeCounters SelectorImpl::wakeCounters() const
+{
+    WakeCounters counters;
+    counters.requests = atomicGet(const_cast<atomic_t&>(_wakeRequests));
+    counters.syscalls = atomicGet(const_cast<atomic_t&>(_wakeSyscalls));
+    return counters;
 }
 
 } //namespace cxxtools
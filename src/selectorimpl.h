@@ -32,12 +32,29 @@
 #include <cxxtools/api.h>
 #include <cxxtools/selectable.h>
 #include <cxxtools/clock.h>
+#include <cxxtools/selector.h>
+#include <cxxtools/atomicity.h>
 #include <sys/poll.h>
 #include <vector>
 #include <set>
+#include <map>
+#include "config.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 namespace cxxtools {
 
+/** @internal Selector backend
+
+    On systems with epoll(7) the registered devices are kept in a persistent
+    epoll interest set, which is updated incrementally when a device is added,
+    removed or changes the events it is interested in. A call to wait() then
+    costs O(ready devices). If epoll is not available or the environment
+    variable CXXTOOLS_SELECTOR is set to "poll", the pollfd array is rebuilt
+    and passed to ::poll as before.
+*/
 class SelectorImpl
 {
     public:
@@ -49,21 +66,89 @@ class SelectorImpl
 
         void remove( Selectable& dev );
 
+        void reinit( Selectable& dev );
+
         void changed( Selectable& dev );
 
+        // called before the device closes its file descriptors
+        void closing( Selectable& dev );
+
         bool wait(std::size_t msecs);
 
         void wake();
 
+        WakeCounters wakeCounters() const;
+
     private:
+        bool waitPoll(std::size_t umsecs, int msecs);
+
+        void closeWakeChannel();
+
+        bool drainWakeChannel();
+
         static const short POLL_ERROR_MASK;
         int _wakePipe[2];
+        atomic_t _wakePending;
+        atomic_t _wakeRequests;
+        atomic_t _wakeSyscalls;
         bool _isDirty;
         std::vector<pollfd> _pollfds;
         std::set<Selectable*>::iterator _current;
         std::set<Selectable*> _devices;
         std::set<Selectable*> _avail;
         Clock _clock;
+
+        // epoll backend
+        struct Registration;
+
+        struct Slot
+        {
+            Registration* reg;
+            std::size_t n;
+            int fd;         // file descriptor registered in the epoll set
+            short events;   // poll events registered in the epoll set
+            bool pollable;  // false if epoll refuses the fd (regular files)
+            bool signalled; // revents set by the current wait
+        };
+
+        struct Registration
+        {
+            Selectable* dev;
+            std::vector<pollfd> pfds;
+            std::vector<Slot> slots;
+            bool initialized;
+            bool removed;
+            bool ready;
+        };
+
+        typedef std::map<Selectable*, Registration*> Registrations;
+
+        int _epollFd;
+        int _eventFd;
+        Registrations _registrations;
+        std::vector<Registration*> _pending;
+        std::vector<Registration*> _ready;
+        std::vector<Registration*> _removed;
+        std::size_t _unpollable;
+        bool _dispatching;
+#ifdef HAVE_SYS_EPOLL_H
+        std::vector<epoll_event> _events;
+
+        // slots registered in the epoll set indexed by file descriptor
+        std::vector<Slot*> _slotsByFd;
+
+        bool waitEpoll(std::size_t umsecs, int msecs);
+
+        void registerDevice(Selectable& dev);
+
+        void initializeDevice(Registration& reg);
+
+        void unregisterDevice(Registrations::iterator it);
+
+        void syncSlot(Slot& slot, bool exact);
+
+        void resetSlot(Slot& slot);
+#endif
 };
 
 }//namespace xpr
@@ -28,24 +28,124 @@
  */
 
 #include <cxxtools/serializationinfo.h>
+#include <cxxtools/typenames.h>
+#include <cxxtools/atomicity.h>
 #include <stdexcept>
 #include <sstream>
 
 namespace cxxtools
 {
 
+namespace
+{
+    // objects with less members are searched linearly
+    const std::size_t indexThreshold = 32;
+
+    // FNV-1a
+    unsigned hashName(const std::string& name)
+    {
+        unsigned h = 2166136261u;
+        for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+        {
+            h ^= static_cast<unsigned char>(*it);
+            h *= 16777619u;
+        }
+        return h;
+    }
+}
+
+// Open addressing hash table of member positions. Only the first member
+// with a given name is indexed, since later ones are never found by name.
+class SerializationInfo::NameIndex
+{
+        struct Slot
+        {
+            unsigned hash;
+            unsigned pos;   // position + 1 or 0 for an empty slot
+        };
+
+        std::vector<Slot> _slots;
+        Nodes::size_type _count;
+
+        void insert(const Nodes& nodes, Nodes::size_type pos)
+        {
+            const std::string& name = nodes[pos].name();
+            unsigned hash = hashName(name);
+            Nodes::size_type mask = _slots.size() - 1;
+            for (Nodes::size_type i = hash & mask; ; i = (i + 1) & mask)
+            {
+                Slot& slot = _slots[i];
+                if (slot.pos == 0)
+                {
+                    slot.hash = hash;
+                    slot.pos = pos + 1;
+                    ++_count;
+                    return;
+                }
+
+                if (slot.hash == hash && nodes[slot.pos - 1].name() == name)
+                    return;
+            }
+        }
+
+        void rebuild(const Nodes& nodes, Nodes::size_type size)
+        {
+            Slot empty = { 0, 0 };
+            _slots.assign(size, empty);
+            _count = 0;
+            for (Nodes::size_type pos = 0; pos < nodes.size(); ++pos)
+                insert(nodes, pos);
+        }
+
+    public:
+        explicit NameIndex(const Nodes& nodes)
+        {
+            Nodes::size_type size = 32;
+            while (size < 2 * nodes.size())
+                size *= 2;
+            rebuild(nodes, size);
+        }
+
+        void add(const Nodes& nodes)
+        {
+            if (2 * (_count + 1) > _slots.size())
+                rebuild(nodes, 2 * _slots.size());
+            else
+                insert(nodes, nodes.size() - 1);
+        }
+
+        const SerializationInfo* find(const Nodes& nodes, const std::string& name) const
+        {
+            unsigned hash = hashName(name);
+            Nodes::size_type mask = _slots.size() - 1;
+            for (Nodes::size_type i = hash & mask; _slots[i].pos != 0; i = (i + 1) & mask)
+            {
+                const Slot& slot = _slots[i];
+                if (slot.hash == hash && nodes[slot.pos - 1].name() == name)
+                    return &nodes[slot.pos - 1];
+            }
+
+            return 0;
+        }
+};
+
 SerializationInfo::SerializationInfo()
 : _parent(0)
 , _category(Void)
+, _typeOwned(false)
+, _type(&TypeNames::name(TypeNames::Empty))
+, _index(0)
 , _t(t_none)
 { }
 
 
 SerializationInfo::SerializationInfo(const SerializationInfo& si)
-: _parent(si._parent)
+: _parent(0)
 , _category(si._category)
+, _typeOwned(si._typeOwned)
 , _name(si._name)
-, _type(si._type)
+, _type(si._typeOwned ? new std::string(*si._type) : si._type)
+, _index(0)
 , _u(si._u)
 , _t(si._t)
 , _nodes(si._nodes)
@@ -61,17 +161,25 @@ SerializationInfo::SerializationInfo(const SerializationInfo& si)
         default:
             ;
     }
+
+    _adoptNodes();
 }
 
 
 SerializationInfo& SerializationInfo::operator=(const SerializationInfo& si)
 {
-    _parent = si._parent;
+    if (this == &si)
+        return *this;
+
     _category = si._category;
     _name = si._name;
-    _type = si._type;
+    setTypeName(*si._type);
     _nodes = si._nodes;
 
+    if (_index)
+        _releaseIndex();
+    _nameChanged();
+
     if (si._t == t_string)
         _setString( si._String() );
     else if (si._t == t_string8)
@@ -83,21 +191,48 @@ SerializationInfo& SerializationInfo::operator=(const SerializationInfo& si)
         _t = si._t;
     }
 
+    _adoptNodes();
+
     return *this;
 }
 
 
+void SerializationInfo::setTypeName(const std::string& type)
+{
+    if (_type == &type)
+        return;
+
+    const std::string* t = TypeNames::intern(type);
+    bool owned = (t == 0);
+    if (owned)
+        t = new std::string(type);
+
+    if (_typeOwned)
+        delete _type;
+
+    _type = t;
+    _typeOwned = owned;
+}
+
+
 void SerializationInfo::reserve(size_t n)
 {
-    _nodes.reserve(n);
+    if (n > _nodes.capacity())
+        _reserveNodes(n);
 }
 
 
 SerializationInfo& SerializationInfo::addMember(const std::string& name)
 {
+    if (_nodes.size() == _nodes.capacity())
+        _reserveNodes(_nodes.empty() ? 4 : 2 * _nodes.size());
+
     _nodes.resize(_nodes.size() + 1);
     _nodes.back().setParent(*this);
-    _nodes.back().setName(name);
+    _nodes.back()._name = name;
+
+    if (_index)
+        static_cast<NameIndex*>(_index)->add(_nodes);
 
     // category Array overrides Object (is this a hack?)
     // This is needed for xmldeserialization. In the xml file the root node of a array
@@ -113,14 +248,10 @@ SerializationInfo& SerializationInfo::addMember(const std::string& name)
 
 const SerializationInfo& SerializationInfo::getMember(const std::string& name) const
 {
-    Nodes::const_iterator it = _nodes.begin();
-    for(; it != _nodes.end(); ++it)
-    {
-        if( it->name() == name )
-            return *it;
-    }
-
-    throw SerializationMemberNotFound(name);
+    const SerializationInfo* si = _findMember(name);
+    if (si == 0)
+        throw SerializationMemberNotFound(name);
+    return *si;
 }
 
 
@@ -139,6 +270,37 @@ const SerializationInfo& SerializationInfo::getMember(unsigned idx) const
 
 const SerializationInfo* SerializationInfo::findMember(const std::string& name) const
 {
+    return _findMember(name);
+}
+
+
+SerializationInfo* SerializationInfo::findMember(const std::string& name)
+{
+    return const_cast<SerializationInfo*>(_findMember(name));
+}
+
+
+const SerializationInfo* SerializationInfo::_findMember(const std::string& name) const
+{
+    if (_nodes.size() >= indexThreshold)
+    {
+        NameIndex* index = static_cast<NameIndex*>(_index);
+        if (index == 0)
+        {
+            // Concurrent readers may build the index at the same time;
+            // only the first one is published.
+            index = new NameIndex(_nodes);
+            void* other = atomicCompareExchange(_index, index, 0);
+            if (other)
+            {
+                delete index;
+                index = static_cast<NameIndex*>(other);
+            }
+        }
+
+        return index->find(_nodes, name);
+    }
+
     Nodes::const_iterator it = _nodes.begin();
     for(; it != _nodes.end(); ++it)
     {
@@ -150,24 +312,29 @@ const SerializationInfo* SerializationInfo::findMember(const std::string& name)
 }
 
 
-SerializationInfo* SerializationInfo::findMember(const std::string& name)
+void SerializationInfo::_releaseIndex() const
 {
-    Nodes::iterator it = _nodes.begin();
-    for(; it != _nodes.end(); ++it)
-    {
-        if( it->name() == name )
-            return &(*it);
-    }
+    delete static_cast<NameIndex*>(_index);
+    _index = 0;
+}
 
-    return 0;
+
+// The index of the parent uses our name, so it has to be rebuilt.
+void SerializationInfo::_nameChanged()
+{
+    if (_parent && _parent->_index)
+        _parent->_releaseIndex();
 }
 
 void SerializationInfo::clear()
 {
     _category = Void;
     _name.clear();
-    _type.clear();
+    setTypeName(TypeNames::name(TypeNames::Empty));
     _nodes.clear();
+    if (_index)
+        _releaseIndex();
+    _nameChanged();
     switch (_t)
     {
         case t_string: _String().clear(); break;
@@ -181,9 +348,9 @@ void SerializationInfo::swap(SerializationInfo& si)
     if (this == &si)
         return;
 
-    std::swap(_parent, si._parent);
     std::swap(_category, si._category);
     std::swap(_name, si._name);
+    std::swap(_typeOwned, si._typeOwned);
     std::swap(_type, si._type);
 
     if (_t == t_string)
@@ -272,6 +439,13 @@ void SerializationInfo::swap(SerializationInfo& si)
     }
 
     _nodes.swap(si._nodes);
+    void* index = _index;
+    _index = si._index;
+    si._index = index;
+    _adoptNodes();
+    si._adoptNodes();
+    _nameChanged();
+    si._nameChanged();
 }
 
 void SerializationInfo::dump(std::ostream& out, const std::string& praefix) const
@@ -307,8 +481,8 @@ void SerializationInfo::dump(std::ostream& out, const std::string& praefix) cons
         out << '\n';
     }
 
-    if (!_type.empty())
-        out << praefix << "typeName = " << _type << '\n';
+    if (!_type->empty())
+        out << praefix << "typeName = " << *_type << '\n';
     if (!_nodes.empty())
     {
         std::string p = praefix + '\t';
@@ -340,6 +514,55 @@ void SerializationInfo::_releaseValue()
     _t = t_none;
 }
 
+// Takes over the content of a node, which is about to be destroyed. The
+// default constructed node steals the strings and subnodes of the other
+// instead of copying them.
+void SerializationInfo::_relocate(SerializationInfo& si)
+{
+    _parent = si._parent;
+    _category = si._category;
+    _name.swap(si._name);
+    std::swap(_typeOwned, si._typeOwned);
+    std::swap(_type, si._type);
+    _nodes.swap(si._nodes);
+    _index = si._index;
+    si._index = 0;
+    _adoptNodes();
+
+    switch (si._t)
+    {
+        case t_string:  new (_StringPtr()) String();
+                        _String().swap(si._String());
+                        break;
+
+        case t_string8: new (_String8Ptr()) std::string();
+                        _String8().swap(si._String8());
+                        break;
+
+        default:        _u = si._u;
+    }
+
+    _t = si._t;
+}
+
+// Grows the storage of the subnodes. std::vector would copy the whole
+// subtrees into the new storage, so we move them by hand.
+void SerializationInfo::_reserveNodes(size_t n)
+{
+    Nodes nodes;
+    nodes.reserve(n);
+    nodes.resize(_nodes.size());
+    for (Nodes::size_type i = 0; i < _nodes.size(); ++i)
+        nodes[i]._relocate(_nodes[i]);
+    _nodes.swap(nodes);
+}
+
+void SerializationInfo::_adoptNodes()
+{
+    for (Nodes::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+        it->_parent = this;
+}
+
 void SerializationInfo::setNull()
 {
     _releaseValue();
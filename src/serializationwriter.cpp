@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/serializationwriter.h>
+#include <cxxtools/decomposer.h>
+#include <cxxtools/typenames.h>
+
+namespace cxxtools
+{
+
+void SerializationWriter::addBool(bool value)
+{
+    _formatter.addValueBool(_name, TypeNames::name(TypeNames::Bool), value);
+}
+
+void SerializationWriter::addInt(int_type value)
+{
+    _formatter.addValueInt(_name, TypeNames::name(TypeNames::Int), value);
+}
+
+void SerializationWriter::addUnsigned(unsigned_type value)
+{
+    _formatter.addValueUnsigned(_name, TypeNames::name(TypeNames::Int), value);
+}
+
+void SerializationWriter::addFloat(long double value)
+{
+    _formatter.addValueFloat(_name, TypeNames::name(TypeNames::Double), value);
+}
+
+void SerializationWriter::addString(const std::string& value)
+{
+    _formatter.addValueStdString(_name, TypeNames::name(TypeNames::String), value);
+}
+
+void SerializationWriter::addString(const String& value)
+{
+    _formatter.addValueString(_name, TypeNames::name(TypeNames::String), value);
+}
+
+void SerializationWriter::addNull()
+{
+    _formatter.addNull(_name, TypeNames::name(TypeNames::Empty));
+}
+
+void SerializationWriter::beginObject(const std::string& type)
+{
+    _formatter.beginObject(_name, type);
+}
+
+void SerializationWriter::beginArray(const std::string& type)
+{
+    _formatter.beginArray(_name, type);
+}
+
+void SerializationWriter::add(const SerializationInfo& si)
+{
+    if (si.name() == _name)
+    {
+        IDecomposer::formatEach(si, _formatter);
+    }
+    else
+    {
+        SerializationInfo named(si);
+        named.setName(_name);
+        IDecomposer::formatEach(named, _formatter);
+    }
+}
+
+}
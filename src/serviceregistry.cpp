@@ -27,34 +27,211 @@
  */
 
 #include <cxxtools/serviceregistry.h>
+#include <cxxtools/atomicity.h>
+#include <algorithm>
 
 namespace cxxtools
 {
 
+class ServiceRegistryEntry
+{
+    public:
+        // number of idle instances kept per procedure
+        enum { poolSize = 8 };
+
+        ServiceRegistryEntry(const std::string& name_, unsigned hash_, ServiceProcedure* proc_)
+            : name(name_),
+              hash(hash_),
+              proc(proc_),
+              retired(false),
+              next(0),
+              refs(1)
+        {
+            for (unsigned n = 0; n < poolSize; ++n)
+                pool[n] = 0;
+        }
+
+        ~ServiceRegistryEntry()
+        {
+            delete proc;
+            clearPool();
+        }
+
+        // Takes an idle instance from the pool or returns 0 if the pool is empty.
+        // The slots are taken and filled with atomic operations, so that
+        // concurrent calls of a procedure do not serialize on a lock.
+        ServiceProcedure* get()
+        {
+            for (unsigned n = 0; n < poolSize; ++n)
+            {
+                if (pool[n] != 0)
+                {
+                    void* p = atomicExchange(pool[n], 0);
+                    if (p)
+                        return static_cast<ServiceProcedure*>(p);
+                }
+            }
+
+            return 0;
+        }
+
+        // Puts an instance into a free slot; returns false if the pool is full.
+        bool put(ServiceProcedure* proc)
+        {
+            // Registering a procedure is not synchronized with calls anyway. An
+            // instance put into a retired entry is deleted with the entry.
+            if (retired)
+                return false;
+
+            for (unsigned n = 0; n < poolSize; ++n)
+            {
+                if (pool[n] == 0 && atomicCompareExchange(pool[n], proc, 0) == 0)
+                    return true;
+            }
+
+            return false;
+        }
+
+        void clearPool()
+        {
+            for (unsigned n = 0; n < poolSize; ++n)
+                delete static_cast<ServiceProcedure*>(atomicExchange(pool[n], 0));
+        }
+
+        // The registry holds one reference and each instance handed out by
+        // getProcedure another one, so that an entry outlives its registry
+        // until the last instance is released.
+        void addRef()
+        {
+            atomicIncrement(refs);
+        }
+
+        void release()
+        {
+            if (atomicDecrement(refs) == 0)
+                delete this;
+        }
+
+        // Called by the registry when the entry is replaced or the registry is destroyed.
+        void retire()
+        {
+            retired = true;
+            clearPool();
+            release();
+        }
+
+        std::string name;
+        unsigned hash;
+        ServiceProcedure* proc;
+        bool retired;
+        ServiceRegistryEntry* next;
+
+        void* volatile pool[poolSize];
+
+    private:
+        volatile atomic_t refs;
+};
+
+namespace
+{
+
+    // FNV-1a
+    unsigned hashName(const std::string& name)
+    {
+        unsigned h = 2166136261u;
+        for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+        {
+            h ^= static_cast<unsigned char>(*it);
+            h *= 16777619u;
+        }
+        return h;
+    }
+}
+
 ServiceRegistry::~ServiceRegistry()
 {
-    ProcedureMap::iterator it;
-    for(it = _procedures.begin(); it != _procedures.end(); ++it)
+    for (std::vector<ServiceRegistryEntry*>::iterator it = _buckets.begin(); it != _buckets.end(); ++it)
     {
-        delete it->second;
+        ServiceRegistryEntry* entry = *it;
+        while (entry)
+        {
+            ServiceRegistryEntry* next = entry->next;
+            entry->retire();
+            entry = next;
+        }
     }
 }
 
-ServiceProcedure* ServiceRegistry::getProcedure(const std::string& name) const
+ServiceRegistryEntry* ServiceRegistry::findEntry(const std::string& name, unsigned hash) const
 {
-    ProcedureMap::const_iterator it = _procedures.find( name );
-    if( it == _procedures.end() )
+    if (_buckets.empty())
+        return 0;
+
+    for (ServiceRegistryEntry* entry = _buckets[hash & (_buckets.size() - 1)]; entry; entry = entry->next)
     {
+        if (entry->hash == hash && entry->name == name)
+            return entry;
+    }
+
+    return 0;
+}
+
+void ServiceRegistry::rehash(std::size_t size)
+{
+    std::vector<ServiceRegistryEntry*> buckets(size);
+
+    for (std::vector<ServiceRegistryEntry*>::iterator it = _buckets.begin(); it != _buckets.end(); ++it)
+    {
+        ServiceRegistryEntry* entry = *it;
+        while (entry)
+        {
+            ServiceRegistryEntry* next = entry->next;
+            ServiceRegistryEntry*& bucket = buckets[entry->hash & (size - 1)];
+            entry->next = bucket;
+            bucket = entry;
+            entry = next;
+        }
+    }
+
+    _buckets.swap(buckets);
+}
+
+ServiceProcedure* ServiceRegistry::getProcedure(const std::string& name) const
+{
+    ServiceRegistryEntry* entry = findEntry(name, hashName(name));
+    if (entry == 0)
         return 0;
+
+    entry->addRef();
+
+    ServiceProcedure* proc = entry->get();
+    if (proc == 0)
+    {
+        proc = entry->proc->clone();
+        proc->_entry = entry;
     }
 
-    return it->second->clone();
+    return proc;
 }
 
 
 void ServiceRegistry::releaseProcedure(ServiceProcedure* proc) const
 {
-    delete proc;
+    if (proc == 0)
+        return;
+
+    ServiceRegistryEntry* entry = proc->_entry;
+    if (entry == 0)
+    {
+        delete proc;
+        return;
+    }
+
+    // only instances, which can be reset, are reused
+    if (!proc->reset() || !entry->put(proc))
+        delete proc;
+
+    entry->release();
 }
 
 
@@ -62,28 +239,51 @@ std::vector<std::string> ServiceRegistry::getProcedureNames() const
 {
     std::vector<std::string> procs;
 
-    for (ProcedureMap::const_iterator it = _procedures.begin(); it != _procedures.end(); ++it)
+    for (std::vector<ServiceRegistryEntry*>::const_iterator it = _buckets.begin(); it != _buckets.end(); ++it)
     {
-        procs.push_back(it->first);
+        for (ServiceRegistryEntry* entry = *it; entry; entry = entry->next)
+            procs.push_back(entry->name);
     }
 
+    std::sort(procs.begin(), procs.end());
+
     return procs;
 }
 
 
 void ServiceRegistry::registerProcedure(const std::string& name, ServiceProcedure* proc)
 {
-    ProcedureMap::iterator it = _procedures.find(name);
-    if (it == _procedures.end())
-    {
-        std::pair<const std::string, ServiceProcedure*> p( name, proc );
-        _procedures.insert( p );
-    }
-    else
+    unsigned hash = hashName(name);
+
+    // instances returned by getProcedure of another registry are owned by this one now
+    proc->_entry = 0;
+
+    if (_buckets.empty())
+        rehash(16);
+
+    ServiceRegistryEntry*& bucket = _buckets[hash & (_buckets.size() - 1)];
+    for (ServiceRegistryEntry** e = &bucket; *e; e = &(*e)->next)
     {
-        delete it->second;
-        it->second = proc;
+        ServiceRegistryEntry* entry = *e;
+        if (entry->hash == hash && entry->name == name)
+        {
+            // instances of the old procedure may still be in use, so the entry is freed with the last one
+            ServiceRegistryEntry* newEntry = new ServiceRegistryEntry(name, hash, proc);
+            newEntry->next = entry->next;
+            *e = newEntry;
+
+            entry->next = 0;
+            entry->retire();
+            return;
+        }
     }
+
+    ServiceRegistryEntry* entry = new ServiceRegistryEntry(name, hash, proc);
+    entry->next = bucket;
+    bucket = entry;
+
+    if (++_size > _buckets.size())
+        rehash(_buckets.size() * 2);
 }
 
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CXXTOOLS_SNAPSHOT_H
+#define CXXTOOLS_SNAPSHOT_H
+
+#include <cxxtools/atomicity.h>
+#include <cxxtools/thread.h>
+#include <stdint.h>
+
+namespace cxxtools
+{
+    /** @internal Holds an immutable object, which is read without locking.
+
+        Readers register in a counter of the current epoch while they access
+        the object. A writer publishes a replacement, switches the epoch and
+        waits until the readers of the previous epoch have left. New readers
+        use the other epoch, so the writer waits only for readers, which
+        were active at the switch, and steady reading cannot starve it. This
+        is done twice, since a reader may register with an epoch it read
+        before the switch. Then the old object is deleted. Writers must be
+        serialized by the caller.
+
+        The reader counters are spread over several cache lines, which are
+        chosen by the stack address of the reader, so that readers in
+        different threads do not contend for the same cache line.
+     */
+    template <typename T>
+    class Snapshot
+    {
+        enum { Slots = 16, CacheLine = 64 };
+
+        struct Counter
+        {
+            atomic_t readers;
+            char pad[CacheLine - sizeof(atomic_t)];
+        };
+
+        void* volatile _ptr;
+        atomic_t _epoch;
+        Counter _counters[2][Slots];
+
+        Snapshot(const Snapshot&);
+        Snapshot& operator=(const Snapshot&);
+
+        atomic_t& counter(const void* p)
+        {
+            uint32_t h = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p) >> 12) * 2654435761u;
+            return _counters[atomicGet(_epoch)][h >> 28].readers;
+        }
+
+        void waitForReaders(atomic_t epoch)
+        {
+          for (unsigned n = 0; n < Slots; ++n)
+            while (atomicGet(_counters[epoch][n].readers) > 0)
+              Thread::yield();
+        }
+
+      public:
+        class Reader
+        {
+            atomic_t& _counter;
+            const T* _ptr;
+
+            Reader(const Reader&);
+            Reader& operator=(const Reader&);
+
+          public:
+            explicit Reader(Snapshot& snapshot)
+              : _counter(snapshot.counter(this))
+            {
+              atomicIncrement(_counter);
+              _ptr = static_cast<const T*>(snapshot._ptr);
+            }
+
+            ~Reader()
+            { atomicDecrement(_counter); }
+
+            const T& operator*() const   { return *_ptr; }
+            const T* operator->() const  { return _ptr; }
+        };
+
+        explicit Snapshot(T* ptr)
+          : _ptr(ptr),
+            _epoch(0)
+        {
+          for (unsigned e = 0; e < 2; ++e)
+            for (unsigned n = 0; n < Slots; ++n)
+              _counters[e][n].readers = 0;
+        }
+
+        ~Snapshot()
+        { delete static_cast<T*>(_ptr); }
+
+        // Returns the current object. Must be called by a writer only.
+        const T& current() const
+        { return *static_cast<const T*>(_ptr); }
+
+        void publish(T* ptr)
+        {
+          T* old = static_cast<T*>(atomicExchange(_ptr, ptr));
+
+          // Readers, which registered in an epoch after the switch away
+          // from it, got the new object already.
+          for (unsigned n = 0; n < 2; ++n)
+          {
+            atomic_t epoch = atomicGet(_epoch);
+            atomicExchange(_epoch, 1 - epoch);
+            waitForReaders(epoch);
+          }
+
+          delete old;
+        }
+    };
+}
+
+#endif // CXXTOOLS_SNAPSHOT_H
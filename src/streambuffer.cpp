@@ -75,16 +75,16 @@ StreamBuffer::~StreamBuffer()
 
 void StreamBuffer::attach(IODevice& ioDevice)
 {
-    if( ioDevice.busy() )
+    if( ioDevice.reading() || ioDevice.writing() )
         throw IOPending("IODevice in use");
 
     if(_ioDevice)
     {
-        if( _ioDevice->busy() )
+        if( _ioDevice->reading() || _ioDevice->writing() )
             throw IOPending("IODevice in use");
 
-        disconnect(ioDevice.inputReady, *this, &StreamBuffer::onRead);
-        disconnect(ioDevice.outputReady, *this, &StreamBuffer::onWrite);
+        disconnect(_ioDevice->inputReady, *this, &StreamBuffer::onRead);
+        disconnect(_ioDevice->outputReady, *this, &StreamBuffer::onWrite);
     }
 
     _ioDevice = &ioDevice;
@@ -258,10 +258,10 @@ size_t StreamBuffer::endWrite()
         {
             traits_type::move(_obuffer, _obuffer + written, leftover);
         }
-    }
 
-    this->setp(_obuffer, _obuffer + _obufferSize);
-    this->pbump( leftover );
+        this->setp(_obuffer, _obuffer + _obufferSize);
+        this->pbump( leftover );
+    }
 
     return written;
 }
@@ -157,6 +157,21 @@ void TcpServerImpl::listen(const std::string& ipaddr, unsigned short int port, i
                 continue;
             }
 
+            if (flags & TcpServer::REUSEPORT)
+            {
+#ifdef SO_REUSEPORT
+                log_debug("setsockopt SO_REUSEPORT");
+                if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+                {
+                    log_debug("could not set socket option SO_REUSEPORT " << fd << ": " << getErrnoString());
+                    ::close(fd);
+                    continue;
+                }
+#else
+                log_warn("socket option SO_REUSEPORT not supported");
+#endif
+            }
+
 #ifdef HAVE_IPV6
             if (it->ai_family == AF_INET6)
             {
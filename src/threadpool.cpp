@@ -28,11 +28,22 @@
 
 #include <cxxtools/threadpool.h>
 #include "threadpoolimpl.h"
+#include "workstealingthreadpoolimpl.h"
 
 namespace cxxtools
 {
     ThreadPool::ThreadPool(unsigned size, bool doStart)
-        : _impl(new ThreadPoolImpl(size))
+        : _impl(new ThreadPoolImpl(size)),
+          _mode(SharedQueue)
+    {
+        if (doStart)
+            start();
+    }
+
+    ThreadPool::ThreadPool(unsigned size, Mode mode, bool doStart)
+        : _impl(mode == WorkStealing ? static_cast<ThreadPoolImplBase*>(new WorkStealingThreadPoolImpl(size))
+                                     : static_cast<ThreadPoolImplBase*>(new ThreadPoolImpl(size))),
+          _mode(mode)
     {
         if (doStart)
             start();
@@ -60,6 +71,21 @@ namespace cxxtools
         _impl->schedule(cb);
     }
 
+    void* ThreadPool::_allocTask()
+    {
+        return _impl->allocTask();
+    }
+
+    void ThreadPool::_scheduleTask(void* p, Callable<void>* cb)
+    {
+        _impl->scheduleTask(p, cb);
+    }
+
+    void ThreadPool::_freeTask(void* p)
+    {
+        _impl->freeTask(p);
+    }
+
     bool ThreadPool::running() const
     {
         return _impl->running();
@@ -29,13 +29,14 @@
 #ifndef CXXTOOLS_THREADPOOLIMPL_H
 #define CXXTOOLS_THREADPOOLIMPL_H
 
+#include "threadpoolimplbase.h"
 #include <cxxtools/queue.h>
 #include <cxxtools/thread.h>
 #include <vector>
 
 namespace cxxtools
 {
-    class ThreadPoolImpl
+    class ThreadPoolImpl : public ThreadPoolImplBase
     {
         public:
             explicit ThreadPoolImpl(unsigned size)
@@ -68,6 +68,10 @@ Timer::Timer(SelectorBase* selector)
 , _selector(0)
 , _active(false)
 , _finished(0)
+, _once(false)
+, _prevTimer(0)
+, _nextTimer(0)
+, _timerSlot(-1)
 {
     if (selector)
         setSelector(selector);
@@ -202,15 +206,19 @@ bool Timer::update(const Milliseconds& now)
     {
         _finished += _interval;
 
+        timeout.send();
+
         if( ! sentry )
             return hasElapsed;
 
-        timeout.send();
-
         if (_once)
             stop();
     }
 
+    // reschedule with the new finish time
+    if (_active && _selector)
+        _selector->onTimerChanged(*this);
+
     return hasElapsed;
 }
 
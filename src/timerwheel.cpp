@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "timerwheel.h"
+#include "cxxtools/timer.h"
+#include "cxxtools/clock.h"
+#include "cxxtools/selector.h"
+#include <stdexcept>
+
+namespace cxxtools
+{
+
+TimerWheel::TimerWheel(const Milliseconds& granularity)
+: _granularity(granularity)
+, _granularityUSecs(granularity.totalUSecs())
+, _count(0)
+, _expiredTail(0)
+{
+    if (_granularityUSecs <= 0)
+        throw std::invalid_argument("timer granularity must be positive");
+
+    _current = Clock::getSystemTicks().totalUSecs() / _granularityUSecs;
+
+    for (unsigned n = 0; n < Levels; ++n)
+        _levelCount[n] = 0;
+
+    for (unsigned n = 0; n <= ExpiredSlot; ++n)
+        _slots[n] = 0;
+}
+
+
+void TimerWheel::setGranularity(const Milliseconds& granularity)
+{
+    if (granularity.totalUSecs() <= 0)
+        throw std::invalid_argument("timer granularity must be positive");
+
+    Timer* timers = 0;
+    for (unsigned n = 0; n <= ExpiredSlot; ++n)
+    {
+        while (Timer* timer = _slots[n])
+        {
+            unlink(*timer);
+            timer->_nextTimer = timers;
+            timers = timer;
+        }
+    }
+
+    _granularity = granularity;
+    _granularityUSecs = granularity.totalUSecs();
+    _current = Clock::getSystemTicks().totalUSecs() / _granularityUSecs;
+
+    while (timers)
+    {
+        Timer* timer = timers;
+        timers = timer->_nextTimer;
+        place(*timer);
+    }
+}
+
+
+void TimerWheel::add(Timer& timer)
+{
+    if (contains(timer))
+        unlink(timer);
+
+    // the position of an empty wheel is outdated after a longer idle time
+    if (_count == 0)
+        _current = Clock::getSystemTicks().totalUSecs() / _granularityUSecs;
+
+    place(timer);
+}
+
+
+void TimerWheel::remove(Timer& timer)
+{
+    if (contains(timer))
+        unlink(timer);
+}
+
+
+bool TimerWheel::contains(const Timer& timer)
+{
+    return timer._timerSlot != NoSlot;
+}
+
+
+void TimerWheel::advance(const Timespan& now)
+{
+    uint64_t nowTick = now.totalUSecs() / _granularityUSecs;
+
+    while (_current < nowTick)
+    {
+        if (_levelCount[0] == 0)
+        {
+            // nothing on level 0; skip to the next cascade of a used level
+            unsigned level = 1;
+            while (level < Levels && _levelCount[level] == 0)
+                ++level;
+
+            uint64_t next = level < Levels
+                ? ((_current >> (SlotBits * level)) + 1) << (SlotBits * level)
+                : nowTick + 1;
+
+            if (next > nowTick)
+            {
+                _current = nowTick;
+                break;
+            }
+
+            _current = next - 1;
+        }
+
+        ++_current;
+
+        for (unsigned level = 1; level < Levels; ++level)
+        {
+            if (_current & ((uint64_t(1) << (SlotBits * level)) - 1))
+                break;
+            cascade(level, (_current >> (SlotBits * level)) & (Slots - 1));
+        }
+
+        unsigned slot = _current & (Slots - 1);
+        while (Timer* timer = _slots[slot])
+        {
+            unlink(*timer);
+            link(*timer, ExpiredSlot);
+        }
+    }
+}
+
+
+Timer* TimerWheel::popExpired()
+{
+    Timer* timer = _slots[ExpiredSlot];
+    if (timer)
+        unlink(*timer);
+    return timer;
+}
+
+
+Timer* TimerWheel::any() const
+{
+    if (_count > 0)
+    {
+        for (unsigned n = 0; n <= ExpiredSlot; ++n)
+            if (_slots[n])
+                return _slots[n];
+    }
+
+    return 0;
+}
+
+
+std::size_t TimerWheel::timeout(const Timespan& now) const
+{
+    if (_count == 0)
+        return SelectorBase::WaitInfinite;
+
+    if (_slots[ExpiredSlot])
+        return 0;
+
+    int64_t remaining = static_cast<int64_t>(nextTick()) * _granularityUSecs - now.totalUSecs();
+    if (remaining <= 0)
+        return 0;
+
+    return static_cast<std::size_t>((remaining + 999) / 1000);
+}
+
+
+void TimerWheel::link(Timer& timer, int slot)
+{
+    timer._timerSlot = slot;
+
+    if (slot == ExpiredSlot)
+    {
+        // append to keep the expiry order
+        timer._prevTimer = _expiredTail;
+        timer._nextTimer = 0;
+        if (_expiredTail)
+            _expiredTail->_nextTimer = &timer;
+        else
+            _slots[slot] = &timer;
+        _expiredTail = &timer;
+    }
+    else
+    {
+        timer._prevTimer = 0;
+        timer._nextTimer = _slots[slot];
+        if (timer._nextTimer)
+            timer._nextTimer->_prevTimer = &timer;
+        _slots[slot] = &timer;
+        ++_levelCount[slot / Slots];
+    }
+
+    ++_count;
+}
+
+
+void TimerWheel::unlink(Timer& timer)
+{
+    int slot = timer._timerSlot;
+
+    if (timer._prevTimer)
+        timer._prevTimer->_nextTimer = timer._nextTimer;
+    else
+        _slots[slot] = timer._nextTimer;
+
+    if (timer._nextTimer)
+        timer._nextTimer->_prevTimer = timer._prevTimer;
+    else if (slot == ExpiredSlot)
+        _expiredTail = timer._prevTimer;
+
+    timer._prevTimer = 0;
+    timer._nextTimer = 0;
+    timer._timerSlot = NoSlot;
+
+    --_count;
+    if (slot < ExpiredSlot)
+        --_levelCount[slot / Slots];
+}
+
+
+void TimerWheel::place(Timer& timer)
+{
+    uint64_t tick = tickOf(timer.finished());
+    if (tick <= _current)
+    {
+        link(timer, ExpiredSlot);
+        return;
+    }
+
+    uint64_t delta = tick - _current;
+    unsigned level = 0;
+    while (level < Levels - 1 && delta >= (uint64_t(1) << (SlotBits * (level + 1))))
+        ++level;
+
+    // timers beyond the range of the wheel are parked in the last slot of
+    // the top level and placed again, when it is cascaded
+    if (delta >= (uint64_t(1) << (SlotBits * Levels)))
+        tick = _current + (uint64_t(1) << (SlotBits * Levels)) - 1;
+
+    unsigned index = (tick >> (SlotBits * level)) & (Slots - 1);
+    link(timer, level * Slots + index);
+}
+
+
+void TimerWheel::cascade(unsigned level, unsigned index)
+{
+    int slot = level * Slots + index;
+    while (Timer* timer = _slots[slot])
+    {
+        unlink(*timer);
+        place(*timer);
+    }
+}
+
+
+uint64_t TimerWheel::tickOf(const Timespan& t) const
+{
+    int64_t usecs = t.totalUSecs();
+    if (usecs <= 0)
+        return 0;
+    return (usecs + _granularityUSecs - 1) / _granularityUSecs;
+}
+
+
+uint64_t TimerWheel::nextTick() const
+{
+    uint64_t next = static_cast<uint64_t>(-1);
+
+    // timers on level 0 expire exactly at their tick
+    if (_levelCount[0] > 0)
+    {
+        for (unsigned n = 1; n <= Slots; ++n)
+        {
+            if (_slots[(_current + n) & (Slots - 1)])
+            {
+                next = _current + n;
+                break;
+            }
+        }
+    }
+
+    // timers on higher levels need to be cascaded first
+    for (unsigned level = 1; level < Levels; ++level)
+    {
+        if (_levelCount[level] == 0)
+            continue;
+
+        uint64_t pos = _current >> (SlotBits * level);
+        for (unsigned n = 1; n <= Slots; ++n)
+        {
+            if (_slots[level * Slots + ((pos + n) & (Slots - 1))])
+            {
+                uint64_t tick = (pos + n) << (SlotBits * level);
+                if (tick < next)
+                    next = tick;
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+}
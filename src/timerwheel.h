@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CXXTOOLS_TIMERWHEEL_H
+#define CXXTOOLS_TIMERWHEEL_H
+
+#include <cxxtools/timespan.h>
+#include <cxxtools/noncopyable.h>
+#include <stdint.h>
+#include <cstddef>
+
+namespace cxxtools
+{
+    class Timer;
+
+    /** @internal Hierarchical timing wheel, which stores the timers of a selector
+
+        Time is divided into ticks of a configurable granularity. Level 0
+        holds the timers expiring within the next 64 ticks, one slot per tick.
+        Each further level covers a 64 times larger range with the same number
+        of slots. When level 0 wraps, the next slot of the level above is
+        cascaded, i.e. its timers are redistributed to the lower levels.
+
+        The timers are linked into the slots through pointers stored in the
+        Timer itself, so that adding, removing and restarting a timer is O(1).
+        Advancing the wheel touches only slots, which are due.
+     */
+    class TimerWheel : private NonCopyable
+    {
+        public:
+            enum {
+                SlotBits = 6,
+                Slots = 1 << SlotBits,
+                Levels = 5,
+                ExpiredSlot = Slots * Levels,
+                NoSlot = -1
+            };
+
+            explicit TimerWheel(const Milliseconds& granularity = Milliseconds(1));
+
+            const Milliseconds& granularity() const
+            { return _granularity; }
+
+            /// Changes the tick granularity. Stored timers are redistributed.
+            void setGranularity(const Milliseconds& granularity);
+
+            /// Adds an active timer using its finish time.
+            void add(Timer& timer);
+
+            /// Removes the timer, if it is stored in the wheel.
+            void remove(Timer& timer);
+
+            /// Returns true, if the timer is stored in the wheel.
+            static bool contains(const Timer& timer);
+
+            /// Moves all timers, which are due at the passed time to the expired list.
+            void advance(const Timespan& now);
+
+            /// Removes and returns the first expired timer or 0 if there is none.
+            Timer* popExpired();
+
+            /// Returns any stored timer or 0 if the wheel is empty.
+            Timer* any() const;
+
+            bool empty() const
+            { return _count == 0; }
+
+            std::size_t size() const
+            { return _count; }
+
+            /** Returns the time in milliseconds, after which the wheel needs
+                to be advanced or WaitInfinite when no timer is stored.
+
+                The result may be shorter than the time to the next expiry,
+                when timers of a higher level need to be cascaded first.
+             */
+            std::size_t timeout(const Timespan& now) const;
+
+        private:
+            void link(Timer& timer, int slot);
+            void unlink(Timer& timer);
+            void place(Timer& timer);
+            void cascade(unsigned level, unsigned index);
+            uint64_t tickOf(const Timespan& t) const;
+            uint64_t nextTick() const;
+
+            Milliseconds _granularity;
+            int64_t _granularityUSecs;
+            uint64_t _current;        // last processed tick
+            std::size_t _count;
+            std::size_t _levelCount[Levels];
+            Timer* _slots[ExpiredSlot + 1];
+            Timer* _expiredTail;      // expired timers are kept in expiry order
+    };
+
+}
+
+#endif // CXXTOOLS_TIMERWHEEL_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/typenames.h>
+#include <cxxtools/atomicity.h>
+#include <functional>
+#include <string.h>
+
+namespace cxxtools
+{
+
+namespace
+{
+    const std::string* predefinedNames()
+    {
+        static const std::string names[TypeNames::Other] = {
+            std::string(),
+            "bool",
+            "char",
+            "string",
+            "int",
+            "double",
+            "null",
+            "pair",
+            "array",
+            "list",
+            "deque",
+            "set",
+            "multiset",
+            "map",
+            "multimap"
+        };
+
+        return names;
+    }
+
+    bool equals(const std::string& type, const char* name, std::string::size_type size)
+    {
+        return memcmp(type.data(), name, size) == 0;
+    }
+
+    TypeNames::Id lookup(const std::string& type)
+    {
+        switch (type.size())
+        {
+            case 0: return TypeNames::Empty;
+            case 3: return equals(type, "int", 3) ? TypeNames::Int
+                         : equals(type, "set", 3) ? TypeNames::Set
+                         : equals(type, "map", 3) ? TypeNames::Map
+                         : TypeNames::Other;
+            case 4: return equals(type, "bool", 4) ? TypeNames::Bool
+                         : equals(type, "char", 4) ? TypeNames::Char
+                         : equals(type, "null", 4) ? TypeNames::Null
+                         : equals(type, "pair", 4) ? TypeNames::Pair
+                         : equals(type, "list", 4) ? TypeNames::List
+                         : TypeNames::Other;
+            case 5: return equals(type, "array", 5) ? TypeNames::Array
+                         : equals(type, "deque", 5) ? TypeNames::Deque
+                         : TypeNames::Other;
+            case 6: return equals(type, "string", 6) ? TypeNames::String
+                         : equals(type, "double", 6) ? TypeNames::Double
+                         : TypeNames::Other;
+            case 8: return equals(type, "multiset", 8) ? TypeNames::Multiset
+                         : equals(type, "multimap", 8) ? TypeNames::Multimap
+                         : TypeNames::Other;
+            default: return TypeNames::Other;
+        }
+    }
+
+    // Names, which are not predefined, are kept in a fixed size open
+    // addressing table. Slots are only ever set once, so readers do not
+    // need a lock.
+    const unsigned tableSize = 2048;
+    const atomic_t maxNames = tableSize / 2;
+    void* volatile table[tableSize];
+    volatile atomic_t tableCount = 0;
+
+    unsigned hashName(const std::string& name)
+    {
+        unsigned h = 2166136261u;
+        for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+        {
+            h ^= static_cast<unsigned char>(*it);
+            h *= 16777619u;
+        }
+        return h;
+    }
+}
+
+const std::string& TypeNames::name(Id id)
+{
+    return predefinedNames()[id];
+}
+
+TypeNames::Id TypeNames::id(const std::string& type)
+{
+    const std::string* names = predefinedNames();
+    std::less<const std::string*> less;
+    if (!less(&type, names) && less(&type, names + Other))
+        return static_cast<Id>(&type - names);
+
+    return lookup(type);
+}
+
+const std::string* TypeNames::intern(const std::string& type)
+{
+    Id i = lookup(type);
+    if (i != Other)
+        return predefinedNames() + i;
+
+    std::string* newName = 0;
+    unsigned hash = hashName(type);
+    for (unsigned n = 0; n < tableSize; ++n)
+    {
+        void* volatile& slot = table[(hash + n) % tableSize];
+        const std::string* s = static_cast<const std::string*>(slot);
+
+        if (s == 0)
+        {
+            if (atomicGet(tableCount) >= maxNames)
+                break;
+
+            if (newName == 0)
+                newName = new std::string(type);
+
+            s = static_cast<const std::string*>(atomicCompareExchange(slot, newName, 0));
+            if (s == 0)
+            {
+                atomicIncrement(tableCount);
+                return newName;
+            }
+        }
+
+        if (*s == type)
+        {
+            delete newName;
+            return s;
+        }
+    }
+
+    delete newName;
+    return 0;
+}
+
+}
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "workstealingthreadpoolimpl.h"
+#include <cxxtools/threadpool.h>
+#include <cxxtools/thread.h>
+#include <cxxtools/log.h>
+#include <stdexcept>
+#include <pthread.h>
+
+log_define("cxxtools.threadpool.workstealing")
+
+namespace cxxtools
+{
+    namespace
+    {
+        // Each pool thread stores a pointer to its worker in this key, so
+        // that schedule can push tasks to the local deque of the calling
+        // thread.
+        pthread_key_t workerKey;
+        pthread_once_t workerKeyOnce = PTHREAD_ONCE_INIT;
+
+        void createWorkerKey()
+        {
+            pthread_key_create(&workerKey, 0);
+        }
+
+        // number of unused tasks kept per worker
+        const unsigned maxFreeTasks = 256;
+    }
+
+    struct WorkStealingThreadPoolImpl::Task
+    {
+        typedef Callable<void> CallableType;
+
+        union
+        {
+            char data[ThreadPool::InlineTaskSize];
+            long double ld;
+            void* p;
+        } storage;
+
+        CallableType* cb;
+        bool inlined;
+        Task* next;
+
+        Task()
+            : cb(0),
+              inlined(false),
+              next(0)
+        { }
+
+        ~Task()
+        { clear(); }
+
+        void clear()
+        {
+            if (inlined)
+                cb->~CallableType();
+            else
+                delete cb;
+            cb = 0;
+            inlined = false;
+        }
+    };
+
+    class WorkStealingThreadPoolImpl::Worker
+    {
+        public:
+            Worker(WorkStealingThreadPoolImpl& pool_, unsigned index_)
+                : pool(pool_),
+                  index(index_),
+                  freeTasks(0),
+                  numFreeTasks(0),
+                  thread(callable(*this, &Worker::run))
+            { }
+
+            ~Worker()
+            {
+                while (freeTasks)
+                {
+                    Task* t = freeTasks;
+                    freeTasks = t->next;
+                    delete t;
+                }
+            }
+
+            void run()
+            {
+                pthread_setspecific(workerKey, this);
+                pool.run(*this);
+                pthread_setspecific(workerKey, 0);
+            }
+
+            WorkStealingThreadPoolImpl& pool;
+            unsigned index;
+
+            // the owner pushes and pops at the back, thieves take from the front
+            Mutex mutex;
+            TaskDeque tasks;
+
+            // accessed by the owner thread only
+            Task* freeTasks;
+            unsigned numFreeTasks;
+
+            AttachedThread thread;
+    };
+
+    WorkStealingThreadPoolImpl::WorkStealingThreadPoolImpl(unsigned size)
+        : _state(Stopped),
+          _size(size),
+          _pending(0),
+          _sleeping(0),
+          _notified(0)
+    {
+        pthread_once(&workerKeyOnce, createWorkerKey);
+    }
+
+    WorkStealingThreadPoolImpl::~WorkStealingThreadPoolImpl()
+    {
+        log_debug("delete " << _workers.size() << " workers");
+        for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+        {
+            discardTasks((*it)->tasks);
+            delete *it;
+        }
+
+        log_debug("delete " << _injector.size() << " left tasks");
+        discardTasks(_injector);
+    }
+
+    void WorkStealingThreadPoolImpl::start()
+    {
+        if (_state != Stopped)
+            throw std::logic_error("invalid state");
+
+        _state = Starting;
+
+        while (_workers.size() < _size)
+            _workers.push_back(new Worker(*this, _workers.size()));
+
+        _state = Running;
+
+        for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+        {
+            log_debug("start worker " << (*it)->index);
+            (*it)->thread.start();
+        }
+    }
+
+    void WorkStealingThreadPoolImpl::stop(bool cancel)
+    {
+        if (_state != Running)
+            throw std::logic_error("thread pool not running");
+
+        log_debug("stop " << _workers.size() << " workers");
+
+        if (cancel)
+        {
+            {
+                MutexLock lock(_injectorMutex);
+                discardTasks(_injector);
+            }
+
+            for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+            {
+                MutexLock lock((*it)->mutex);
+                discardTasks((*it)->tasks);
+            }
+        }
+
+        {
+            MutexLock lock(_sleepMutex);
+            _state = Stopping;
+            _wakeup.broadcast();
+        }
+
+        for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+        {
+            (*it)->thread.join();
+            log_debug("joined worker " << (*it)->index);
+        }
+
+        for (std::vector<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it)
+        {
+            discardTasks((*it)->tasks);
+            delete *it;
+        }
+
+        _workers.clear();
+
+        _state = Stopped;
+    }
+
+    void WorkStealingThreadPoolImpl::schedule(const Callable<void>& cb)
+    {
+        Worker* current = currentWorker();
+        if (current == 0)
+        {
+            Callable<void>* c = cb.clone();
+
+            {
+                MutexLock lock(_injectorMutex);
+                _injector.push_back(c);
+            }
+
+            notify();
+            return;
+        }
+
+        Task* task = newTask(*current);
+        try
+        {
+            task->cb = cb.clone();
+        }
+        catch (...)
+        {
+            releaseTask(*current, task);
+            throw;
+        }
+
+        push(*current, task);
+    }
+
+    void* WorkStealingThreadPoolImpl::allocTask()
+    {
+        // Tasks from other threads are cloned into the injector queue. The
+        // task pool is only used by the workers, so no lock is needed.
+        Worker* current = currentWorker();
+        return current ? newTask(*current)->storage.data : 0;
+    }
+
+    void WorkStealingThreadPoolImpl::scheduleTask(void* p, Callable<void>* cb)
+    {
+        // storage is the first member of task
+        Task* task = reinterpret_cast<Task*>(p);
+        task->cb = cb;
+        task->inlined = true;
+        push(*currentWorker(), task);
+    }
+
+    void WorkStealingThreadPoolImpl::freeTask(void* p)
+    {
+        releaseTask(*currentWorker(), reinterpret_cast<Task*>(p));
+    }
+
+    WorkStealingThreadPoolImpl::Worker* WorkStealingThreadPoolImpl::currentWorker() const
+    {
+        Worker* worker = static_cast<Worker*>(pthread_getspecific(workerKey));
+        return worker && &worker->pool == this ? worker : 0;
+    }
+
+    WorkStealingThreadPoolImpl::Task* WorkStealingThreadPoolImpl::newTask(Worker& current)
+    {
+        Task* task = current.freeTasks;
+        if (task == 0)
+            return new Task();
+
+        current.freeTasks = task->next;
+        --current.numFreeTasks;
+        return task;
+    }
+
+    void WorkStealingThreadPoolImpl::releaseTask(Worker& current, Task* task)
+    {
+        if (current.numFreeTasks >= maxFreeTasks)
+        {
+            delete task;
+            return;
+        }
+
+        task->clear();
+        task->next = current.freeTasks;
+        current.freeTasks = task;
+        ++current.numFreeTasks;
+    }
+
+    void WorkStealingThreadPoolImpl::push(Worker& current, Task* task)
+    {
+        {
+            MutexLock lock(current.mutex);
+            current.tasks.push_back(task);
+        }
+
+        notify();
+    }
+
+    void WorkStealingThreadPoolImpl::notify()
+    {
+        // The increment is a full barrier, so either we see the sleeping
+        // thread here or the thread sees the new task before it waits.
+        // Threads, which are already notified but not yet running, are not
+        // signaled again.
+        atomicIncrement(_pending);
+        if (_sleeping > 0)
+        {
+            MutexLock lock(_sleepMutex);
+            if (_sleeping > _notified)
+            {
+                ++_notified;
+                _wakeup.signal();
+            }
+        }
+    }
+
+    Callable<void>* WorkStealingThreadPoolImpl::findTask(Worker& worker, Task*& task)
+    {
+        Callable<void>* cb = 0;
+        task = 0;
+
+        {
+            MutexLock lock(worker.mutex);
+            if (!worker.tasks.empty())
+            {
+                task = worker.tasks.back();
+                worker.tasks.pop_back();
+            }
+        }
+
+        if (task == 0)
+        {
+            MutexLock lock(_injectorMutex);
+            if (!_injector.empty())
+            {
+                cb = _injector.front();
+                _injector.pop_front();
+            }
+        }
+
+        for (unsigned n = 1; task == 0 && cb == 0 && n < _workers.size(); ++n)
+        {
+            Worker& victim = *_workers[(worker.index + n) % _workers.size()];
+            MutexLock lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                log_debug("worker " << worker.index << " stole task from worker " << victim.index);
+            }
+        }
+
+        if (task)
+            cb = task->cb;
+
+        if (cb)
+            atomicDecrement(_pending);
+
+        return cb;
+    }
+
+    void WorkStealingThreadPoolImpl::discardTasks(TaskDeque& tasks)
+    {
+        for (TaskDeque::iterator it = tasks.begin(); it != tasks.end(); ++it)
+        {
+            atomicDecrement(_pending);
+            delete *it;
+        }
+
+        tasks.clear();
+    }
+
+    void WorkStealingThreadPoolImpl::discardTasks(CallableDeque& tasks)
+    {
+        for (CallableDeque::iterator it = tasks.begin(); it != tasks.end(); ++it)
+        {
+            atomicDecrement(_pending);
+            delete *it;
+        }
+
+        tasks.clear();
+    }
+
+    void WorkStealingThreadPoolImpl::run(Worker& worker)
+    {
+        while (true)
+        {
+            Task* task;
+            Callable<void>* cb = findTask(worker, task);
+            if (cb)
+            {
+                try
+                {
+                    (*cb)();
+                }
+                catch (const std::exception& e)
+                {
+                    log_error("task " << static_cast<void*>(cb) << " failed: " << e.what());
+                }
+                catch (...)
+                {
+                    log_error("task " << static_cast<void*>(cb) << " failed with unknown exception");
+                }
+
+                if (task)
+                    releaseTask(worker, task);
+                else
+                    delete cb;
+
+                continue;
+            }
+
+            MutexLock lock(_sleepMutex);
+            atomicIncrement(_sleeping);
+
+            while (_pending == 0 && _state != Stopping)
+            {
+                _wakeup.wait(lock);
+                if (_notified > 0)
+                    --_notified;
+            }
+
+            atomicDecrement(_sleeping);
+
+            if (_pending == 0 && _state == Stopping)
+                break;
+        }
+
+        log_debug("end worker " << worker.index);
+    }
+
+}
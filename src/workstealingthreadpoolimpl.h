@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef CXXTOOLS_WORKSTEALINGTHREADPOOLIMPL_H
+#define CXXTOOLS_WORKSTEALINGTHREADPOOLIMPL_H
+
+#include "threadpoolimplbase.h"
+#include <cxxtools/atomicity.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/mutex.h>
+#include <deque>
+#include <vector>
+
+namespace cxxtools
+{
+    class WorkStealingThreadPoolImpl : public ThreadPoolImplBase
+    {
+        public:
+            explicit WorkStealingThreadPoolImpl(unsigned size);
+
+            ~WorkStealingThreadPoolImpl();
+
+            void start();
+
+            void stop(bool cancel);
+
+            void schedule(const Callable<void>& cb);
+
+            void* allocTask();
+
+            void scheduleTask(void* p, Callable<void>* cb);
+
+            void freeTask(void* p);
+
+            bool running() const
+            { return _state == Running; }
+
+            bool stopped() const
+            { return _state == Stopped; }
+
+        private:
+            struct Task;
+            class Worker;
+
+            typedef std::deque<Task*> TaskDeque;
+            typedef std::deque<Callable<void>*> CallableDeque;
+
+            Worker* currentWorker() const;
+
+            Task* newTask(Worker& current);
+            void releaseTask(Worker& current, Task* task);
+            void push(Worker& current, Task* task);
+            void notify();
+            Callable<void>* findTask(Worker& worker, Task*& task);
+            void discardTasks(TaskDeque& tasks);
+            void discardTasks(CallableDeque& tasks);
+
+            void run(Worker& worker);
+
+            enum {
+                Stopped,
+                Starting,
+                Running,
+                Stopping
+            } _state;
+
+            unsigned _size;
+            std::vector<Worker*> _workers;
+
+            // injector queue for tasks scheduled from outside of the pool
+            Mutex _injectorMutex;
+            CallableDeque _injector;
+
+            // number of queued tasks, number of idle threads and number of
+            // idle threads, which are signaled but did not wake up yet
+            volatile atomic_t _pending;
+            volatile atomic_t _sleeping;
+            unsigned _notified;
+            Mutex _sleepMutex;
+            Condition _wakeup;
+    };
+}
+
+#endif // CXXTOOLS_WORKSTEALINGTHREADPOOLIMPL_H
@@ -52,6 +52,7 @@ XmlFormatter::XmlFormatter(std::ostream& os)
 XmlFormatter::XmlFormatter(XmlWriter* writer)
 : _writer(writer)
 , _deleter(0)
+, _useAttributes(true)
 {
 }
 
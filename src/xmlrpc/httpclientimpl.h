@@ -75,6 +75,16 @@ class HttpClientImpl : public RefCounted, public ClientImpl
             _client.clearAuth();
         }
 
+        void setConnectionPool(http::ConnectionPool& pool)
+        {
+            _client.setConnectionPool(pool);
+        }
+
+        void clearConnectionPool()
+        {
+            _client.clearConnectionPool();
+        }
+
         void setSelector(SelectorBase& selector)
         {
             _client.setSelector(selector);
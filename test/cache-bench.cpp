@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <map>
+#include <limits>
+#include <cxxtools/lrucache.h>
+#include <cxxtools/cache.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+
+// Compares the hashed LruCache and Cache with the former implementations,
+// which are kept here in reduced form. They held the elements in a std::map
+// with a serial number and searched the oldest element linearly.
+
+namespace
+{
+    template <typename Key, typename Value>
+    class MapLruCache
+    {
+            struct Data
+            {
+                unsigned serial;
+                Value value;
+                Data() { }
+                Data(unsigned serial_, const Value& value_)
+                    : serial(serial_),
+                      value(value_)
+                    { }
+            };
+
+            typedef std::map<Key, Data> DataType;
+            DataType data;
+            typename DataType::size_type maxElements;
+            unsigned serial;
+
+            typename DataType::iterator _getOldest()
+            {
+                typename DataType::iterator foundElement = data.begin();
+                typename DataType::iterator it = data.begin();
+                for (++it; it != data.end(); ++it)
+                    if (it->second.serial < foundElement->second.serial)
+                        foundElement = it;
+                return foundElement;
+            }
+
+        public:
+            explicit MapLruCache(unsigned maxElements_)
+                : maxElements(maxElements_),
+                  serial(0)
+                { }
+
+            void put(const Key& key, const Value& value)
+            {
+                typename DataType::iterator it = data.find(key);
+                if (it == data.end())
+                {
+                    if (data.size() >= maxElements)
+                        data.erase(_getOldest());
+                    data.insert(data.begin(), typename DataType::value_type(key, Data(serial++, value)));
+                }
+                else
+                    it->second.serial = serial++;
+            }
+
+            Value* getptr(const Key& key)
+            {
+                typename DataType::iterator it = data.find(key);
+                if (it == data.end())
+                    return 0;
+                it->second.serial = serial++;
+                return &it->second.value;
+            }
+    };
+
+    template <typename Key, typename Value>
+    class MapCache
+    {
+            struct Data
+            {
+                bool winner;
+                unsigned serial;
+                Value value;
+                Data() { }
+                Data(bool winner_, unsigned serial_, const Value& value_)
+                    : winner(winner_),
+                      serial(serial_),
+                      value(value_)
+                    { }
+            };
+
+            typedef std::map<Key, Data> DataType;
+            DataType data;
+            typename DataType::size_type maxElements;
+            unsigned serial;
+
+            typename DataType::iterator _getOldest(bool winner)
+            {
+                typename DataType::iterator foundElement = data.begin();
+                typename DataType::iterator it = data.begin();
+                for (++it; it != data.end(); ++it)
+                    if (it->second.winner == winner
+                        && (foundElement->second.winner != winner || it->second.serial < foundElement->second.serial))
+                        foundElement = it;
+                return foundElement;
+            }
+
+            void _makeLooser()
+            {
+                typename DataType::iterator it = _getOldest(true);
+                it->second.winner = false;
+                it->second.serial = serial++;
+            }
+
+        public:
+            explicit MapCache(unsigned maxElements_)
+                : maxElements(maxElements_ + (maxElements_ & 1)),
+                  serial(0)
+                { }
+
+            void put(const Key& key, const Value& value)
+            {
+                typename DataType::iterator it = data.find(key);
+                if (it == data.end())
+                {
+                    if (data.size() < maxElements)
+                    {
+                        data.insert(data.begin(), typename DataType::value_type(key,
+                            Data(data.size() < maxElements / 2, serial++, value)));
+                    }
+                    else
+                    {
+                        data.erase(_getOldest(false));
+                        data.insert(data.begin(), typename DataType::value_type(key,
+                            Data(false, serial++, value)));
+                    }
+                }
+                else
+                {
+                    it->second.serial = serial++;
+                    if (!it->second.winner)
+                    {
+                        it->second.winner = true;
+                        _makeLooser();
+                    }
+                    it->second.value = value;
+                }
+            }
+
+            Value* getptr(const Key& key)
+            {
+                typename DataType::iterator it = data.find(key);
+                if (it == data.end())
+                    return 0;
+                it->second.serial = serial++;
+                if (!it->second.winner)
+                {
+                    it->second.winner = true;
+                    _makeLooser();
+                }
+                return &it->second.value;
+            }
+    };
+
+    // simple deterministic pseudo random numbers
+    unsigned nextRandom(unsigned& state)
+    {
+        state = state * 1103515245 + 12345;
+        return state >> 8;
+    }
+
+    template <typename CacheType>
+    void bench(const char* name, unsigned size, unsigned count)
+    {
+        CacheType cache(size);
+
+        for (unsigned n = 0; n < size; ++n)
+            cache.put(n, n);
+
+        cxxtools::Clock clock;
+
+        // each put of a new key drops an element
+        clock.start();
+        for (unsigned n = 0; n < count; ++n)
+            cache.put(size + n, n);
+        cxxtools::Timespan tput = clock.stop();
+
+        // lookups of keys, which are about half in the cache
+        unsigned state = 1;
+        unsigned found = 0;
+        clock.start();
+        for (unsigned n = 0; n < count; ++n)
+            if (cache.getptr(nextRandom(state) % (size * 2) + count - size / 2))
+                ++found;
+        cxxtools::Timespan tget = clock.stop();
+
+        std::cout << name << " size " << size << ":\t"
+                     "put " << (tput.totalUSecs() * 1000 / count) << " nsec\t"
+                     "get " << (tget.totalUSecs() * 1000 / count) << " nsec\t"
+                     "(" << count << " operations, " << found << " hits)" << std::endl;
+    }
+
+    void benchSize(unsigned size, unsigned count, unsigned mapCount)
+    {
+        bench<cxxtools::LruCache<unsigned, unsigned> >("LruCache   ", size, count);
+        bench<MapLruCache<unsigned, unsigned> >       ("map LruCache", size, mapCount);
+        bench<cxxtools::Cache<unsigned, unsigned> >   ("Cache      ", size, count);
+        bench<MapCache<unsigned, unsigned> >          ("map Cache  ", size, mapCount);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        cxxtools::Arg<unsigned> count(argc, argv, 'n', 1000000);
+        cxxtools::Arg<unsigned> mapWork(argc, argv, 'm', 100000000);
+
+        std::cout << "benchmark cache implementations\n\n"
+                     "options:\n"
+                     "   -n <number>       number of operations for the hashed caches\n"
+                     "   -m <number>       limit of elements visited by the map based caches;\n"
+                     "                     the number of operations is this divided by the size\n" << std::endl;
+
+        static const unsigned sizes[] = { 1000, 100000, 1000000 };
+        for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            unsigned mapCount = mapWork / sizes[s];
+            if (mapCount < 10)
+                mapCount = 10;
+            if (mapCount > count)
+                mapCount = count;
+            benchSize(sizes[s], count, mapCount);
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -29,8 +29,26 @@
 #define DEBUG
 #include "cxxtools/cache.h"
 #include "cxxtools/unit/testsuite.h"
+#include <string>
 #include "cxxtools/unit/registertest.h"
 
+namespace
+{
+    // key type without hash function and ==-operator
+    struct Name
+    {
+        std::string first;
+        std::string last;
+
+        Name(const std::string& first_, const std::string& last_)
+            : first(first_), last(last_)
+            { }
+
+        bool operator< (const Name& other) const
+        { return last < other.last || (last == other.last && first < other.first); }
+    };
+}
+
 class CacheTest : public cxxtools::unit::TestSuite
 {
     public:
@@ -41,6 +59,7 @@ class CacheTest : public cxxtools::unit::TestSuite
             registerMethod("erase", *this, &CacheTest::erase);
             registerMethod("resize", *this, &CacheTest::resize);
             registerMethod("stats", *this, &CacheTest::stats);
+            registerMethod("orderedKey", *this, &CacheTest::orderedKey);
         }
 
         void cacheTest()
@@ -176,6 +195,23 @@ class CacheTest : public cxxtools::unit::TestSuite
           CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getMisses(), 1);
         }
 
+        void orderedKey()
+        {
+          cxxtools::Cache<Name, int> cache(2);
+
+          cache.put(Name("Tommi", "Maekitalo"), 1);
+          cache.put(Name("Marc", "Maekitalo"), 2);
+          cache.put(Name("Tommi", "Maekitalo"), 1);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 2);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getx(Name("Tommi", "Maekitalo")).second, 1);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getx(Name("Marc", "Maekitalo")).second, 2);
+
+          CXXTOOLS_UNIT_ASSERT(cache.erase(Name("Marc", "Maekitalo")));
+          CXXTOOLS_UNIT_ASSERT(!cache.getx(Name("Marc", "Maekitalo")).first);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 1);
+        }
+
 };
 
 cxxtools::unit::RegisterTest<CacheTest> register_CacheTest;
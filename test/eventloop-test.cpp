@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/eventloop.h"
+#include "cxxtools/event.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/connectable.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <vector>
+#include <stdexcept>
+#include <string.h>
+
+namespace
+{
+  class NumberEvent : public cxxtools::BasicEvent<NumberEvent>
+  {
+    public:
+      unsigned producer;
+      unsigned seq;
+
+      NumberEvent(unsigned producer_, unsigned seq_)
+        : producer(producer_),
+          seq(seq_)
+      { }
+  };
+
+  // larger than the events stored in the queue itself
+  class BigEvent : public cxxtools::BasicEvent<BigEvent>
+  {
+    public:
+      unsigned producer;
+      unsigned seq;
+      char data[20000];
+
+      BigEvent(unsigned producer_, unsigned seq_)
+        : producer(producer_),
+          seq(seq_)
+      { memset(data, seq_ & 0xff, sizeof(data)); }
+  };
+
+  // The payload looks like ready record headers of the next generations of
+  // a queue segment.
+  class PatternEvent : public cxxtools::BasicEvent<PatternEvent>
+  {
+    public:
+      unsigned producer;
+      unsigned seq;
+      unsigned words[30];
+
+      PatternEvent(unsigned producer_, unsigned seq_)
+        : producer(producer_),
+          seq(seq_)
+      {
+        for (unsigned n = 0; n < 30; ++n)
+          words[n] = (((seq_ + n) % 16 + 1) << 2) | 1;
+      }
+  };
+
+  class CountedEvent : public cxxtools::BasicEvent<CountedEvent>
+  {
+    public:
+      static int live;
+
+      CountedEvent()
+      { ++live; }
+
+      CountedEvent(const CountedEvent&)
+        : cxxtools::BasicEvent<CountedEvent>()
+      { ++live; }
+
+      ~CountedEvent()
+      { --live; }
+  };
+
+  int CountedEvent::live = 0;
+
+  class Receiver : public cxxtools::Connectable
+  {
+      cxxtools::EventLoop& _loop;
+
+    public:
+      std::vector<unsigned> next;   // next expected sequence per producer
+      unsigned count;
+      unsigned expected;
+      bool ordered;
+      bool throwOnce;
+
+      explicit Receiver(cxxtools::EventLoop& loop)
+        : _loop(loop),
+          count(0),
+          expected(0),
+          ordered(true),
+          throwOnce(false)
+      { }
+
+      void onEvent(const cxxtools::Event& ev)
+      {
+        if (throwOnce)
+        {
+          throwOnce = false;
+          throw std::runtime_error("handler failed");
+        }
+
+        unsigned producer = 0;
+        unsigned seq = count;
+
+        if (ev.typeInfo() == typeid(NumberEvent))
+        {
+          const NumberEvent& ne = static_cast<const NumberEvent&>(ev);
+          producer = ne.producer;
+          seq = ne.seq;
+        }
+        else if (ev.typeInfo() == typeid(PatternEvent))
+        {
+          const PatternEvent& pe = static_cast<const PatternEvent&>(ev);
+          producer = pe.producer;
+          seq = pe.seq;
+        }
+        else if (ev.typeInfo() == typeid(BigEvent))
+        {
+          const BigEvent& be = static_cast<const BigEvent&>(ev);
+          producer = be.producer;
+          seq = be.seq;
+          if (be.data[0] != char(seq & 0xff) || be.data[sizeof(be.data) - 1] != char(seq & 0xff))
+            ordered = false;
+        }
+
+        if (next.size() <= producer)
+          next.resize(producer + 1);
+        if (seq != next[producer])
+          ordered = false;
+        next[producer] = seq + 1;
+
+        if (++count == expected)
+          _loop.exit();
+      }
+
+      void onTimeout()
+      { _loop.exit(); }
+  };
+
+  class Producer
+  {
+      cxxtools::EventLoop& _loop;
+      unsigned _id;
+      unsigned _count;
+
+    public:
+      Producer(cxxtools::EventLoop& loop, unsigned id, unsigned count)
+        : _loop(loop),
+          _id(id),
+          _count(count)
+      { }
+
+      void runPattern()
+      {
+        for (unsigned n = 0; n < _count; ++n)
+        {
+          if (n % 3 == 0)
+            _loop.commitEvent(NumberEvent(_id, n));
+          else
+            _loop.commitEvent(PatternEvent(_id, n));
+        }
+      }
+
+      void run()
+      {
+        for (unsigned n = 0; n < _count; ++n)
+        {
+          if (n % 1000 == 999)
+            _loop.commitEvent(BigEvent(_id, n));
+          else
+            _loop.commitEvent(NumberEvent(_id, n));
+        }
+      }
+  };
+}
+
+class EventLoopTest : public cxxtools::unit::TestSuite
+{
+  public:
+    EventLoopTest()
+      : cxxtools::unit::TestSuite("eventloop")
+    {
+      registerMethod("commitFromThreads", *this, &EventLoopTest::commitFromThreads);
+      registerMethod("mixedSizes", *this, &EventLoopTest::mixedSizes);
+      registerMethod("reuseSegments", *this, &EventLoopTest::reuseSegments);
+      registerMethod("destroyPending", *this, &EventLoopTest::destroyPending);
+      registerMethod("throwingHandler", *this, &EventLoopTest::throwingHandler);
+    }
+
+    void commitFromThreads()
+    {
+      cxxtools::EventLoop loop;
+      Receiver receiver(loop);
+      cxxtools::connect(loop.event, receiver, &Receiver::onEvent);
+      cxxtools::connect(loop.timeout, receiver, &Receiver::onTimeout);
+      loop.setIdleTimeout(cxxtools::Milliseconds(10000));
+
+      const unsigned producers = 4;
+      const unsigned count = 20000;
+      receiver.expected = producers * count;
+
+      std::vector<Producer*> p;
+      std::vector<cxxtools::AttachedThread*> threads;
+      for (unsigned n = 0; n < producers; ++n)
+      {
+        p.push_back(new Producer(loop, n, count));
+        threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*p.back(), &Producer::run)));
+        threads.back()->start();
+      }
+
+      loop.run();
+
+      for (unsigned n = 0; n < producers; ++n)
+      {
+        threads[n]->join();
+        delete threads[n];
+        delete p[n];
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(receiver.count, producers * count);
+      CXXTOOLS_UNIT_ASSERT(receiver.ordered);
+
+      // events are committed in batches, so there are fewer wakeups than events
+      cxxtools::WakeCounters counters = loop.wakeCounters();
+      CXXTOOLS_UNIT_ASSERT(counters.requests < producers * count);
+      CXXTOOLS_UNIT_ASSERT(counters.syscalls <= counters.requests);
+    }
+
+    void reuseSegments()
+    {
+      cxxtools::EventLoop loop;
+      Receiver receiver(loop);
+      cxxtools::connect(loop.event, receiver, &Receiver::onEvent);
+      cxxtools::connect(loop.timeout, receiver, &Receiver::onTimeout);
+      loop.setIdleTimeout(cxxtools::Milliseconds(10000));
+
+      // Producers and the consumer run concurrently, so that segments are
+      // reused many times while records are still being written.
+      const unsigned producers = 4;
+      const unsigned count = 50000;
+      receiver.expected = producers * count;
+
+      std::vector<Producer*> p;
+      std::vector<cxxtools::AttachedThread*> threads;
+      for (unsigned n = 0; n < producers; ++n)
+      {
+        p.push_back(new Producer(loop, n, count));
+        threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*p.back(), &Producer::runPattern)));
+        threads.back()->start();
+      }
+
+      loop.run();
+
+      for (unsigned n = 0; n < producers; ++n)
+      {
+        threads[n]->join();
+        delete threads[n];
+        delete p[n];
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(receiver.count, producers * count);
+      CXXTOOLS_UNIT_ASSERT(receiver.ordered);
+    }
+
+    void mixedSizes()
+    {
+      cxxtools::EventLoop loop;
+      Receiver receiver(loop);
+      cxxtools::connect(loop.event, receiver, &Receiver::onEvent);
+
+      // enough events to fill several segments of the queue
+      for (unsigned n = 0; n < 10000; ++n)
+      {
+        if (n % 7 == 0)
+          loop.commitEvent(BigEvent(0, n));
+        else
+          loop.commitEvent(NumberEvent(0, n));
+      }
+
+      loop.processEvents();
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(receiver.count, 10000);
+      CXXTOOLS_UNIT_ASSERT(receiver.ordered);
+
+      // the queue is reusable after draining
+      loop.commitEvent(NumberEvent(0, 10000));
+      loop.processEvents();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(receiver.count, 10001);
+      CXXTOOLS_UNIT_ASSERT(receiver.ordered);
+    }
+
+    void destroyPending()
+    {
+      {
+        cxxtools::EventLoop loop;
+        for (unsigned n = 0; n < 5000; ++n)
+          loop.commitEvent(CountedEvent());
+        CXXTOOLS_UNIT_ASSERT_EQUALS(CountedEvent::live, 5000);
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(CountedEvent::live, 0);
+    }
+
+    void throwingHandler()
+    {
+      cxxtools::EventLoop loop;
+      Receiver receiver(loop);
+      cxxtools::connect(loop.event, receiver, &Receiver::onEvent);
+
+      for (unsigned n = 0; n < 3; ++n)
+        loop.commitEvent(CountedEvent());
+
+      receiver.throwOnce = true;
+      CXXTOOLS_UNIT_ASSERT_THROW(loop.processEvents(), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(CountedEvent::live, 2);
+
+      loop.processEvents();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(receiver.count, 2);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(CountedEvent::live, 0);
+    }
+};
+
+cxxtools::unit::RegisterTest<EventLoopTest> register_EventLoopTest;
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cxxtools/http/server.h>
+#include <cxxtools/http/client.h>
+#include <cxxtools/http/service.h>
+#include <cxxtools/http/responder.h>
+#include <cxxtools/http/fileservice.h>
+#include <cxxtools/http/request.h>
+#include <cxxtools/http/reply.h>
+#include <cxxtools/eventloop.h>
+#include <cxxtools/thread.h>
+#include <cxxtools/fileinfo.h>
+#include <cxxtools/regex.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Compares the throughput of serving a static file with the FileService,
+// which uses sendfile, with a responder copying the file into the reply body.
+
+namespace
+{
+    const char* fileName = "fileservice-bench.dat";
+
+    class CopyResponder : public cxxtools::http::Responder
+    {
+        public:
+            explicit CopyResponder(cxxtools::http::Service& service)
+                : cxxtools::http::Responder(service)
+                { }
+
+            void reply(std::ostream& out, cxxtools::http::Request& request, cxxtools::http::Reply& reply)
+            {
+                std::ifstream f(fileName);
+                out << f.rdbuf();
+            }
+    };
+
+    typedef cxxtools::http::CachedService<CopyResponder> CopyService;
+
+    void bench(const char* title, unsigned short port, const std::string& url,
+               unsigned requests, std::size_t size)
+    {
+        cxxtools::http::Client client("", port);
+
+        // warm up
+        client.get(url);
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned n = 0; n < requests; ++n)
+        {
+            std::string body = client.get(url);
+            if (body.size() != size)
+                throw std::runtime_error("unexpected body size");
+        }
+
+        cxxtools::Timespan t = clock.stop();
+
+        std::cout << title << ":\n"
+                     "\ttime: " << t << " sec\n"
+                     "\trequests per second: " << (requests / t.totalSeconds()) << "\n"
+                     "\tMB per second: " << (static_cast<double>(size) * requests / t.totalSeconds() / 1024 / 1024)
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> size(argc, argv, 's', 16 * 1024 * 1024);
+        cxxtools::Arg<unsigned> requests(argc, argv, 'n', 100);
+        cxxtools::Arg<unsigned short> port(argc, argv, 'p', 8005);
+
+        std::cout << "benchmark file service with " << size.getValue() << " bytes file and "
+                  << requests.getValue() << " requests\n\n"
+                     "options:\n"
+                     "   -s <number>       specify file size\n"
+                     "   -n <number>       specify number of requests\n"
+                     "   -p <number>       specify port\n" << std::endl;
+
+        {
+            std::ofstream f(fileName);
+            for (unsigned n = 0; n < size; ++n)
+                f.put(static_cast<char>('a' + n % 26));
+        }
+
+        cxxtools::EventLoop loop;
+        cxxtools::http::Server server(loop, port);
+
+        cxxtools::http::FileService fileService(".", "/file");
+        CopyService copyService;
+        server.addService(cxxtools::Regex("^/file/"), fileService);
+        server.addService("/copy", copyService);
+
+        cxxtools::AttachedThread thread(cxxtools::callable(loop, &cxxtools::EventLoop::run));
+        thread.start();
+
+        bench("body copy", port, "/copy", requests, size);
+        bench("sendfile", port, std::string("/file/") + fileName, requests, size);
+
+        loop.exit();
+        thread.join();
+
+        cxxtools::FileInfo(fileName).remove();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,890 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include "cxxtools/http/server.h"
+#include "cxxtools/http/client.h"
+#include "cxxtools/http/service.h"
+#include "cxxtools/http/responder.h"
+#include "cxxtools/http/request.h"
+#include "cxxtools/http/reply.h"
+#include "cxxtools/http/replyheader.h"
+#include "cxxtools/http/fileservice.h"
+#include "cxxtools/http/connectionpool.h"
+#include "cxxtools/net/tcpstream.h"
+#include "cxxtools/ioerror.h"
+#include "cxxtools/regex.h"
+#include "cxxtools/fileinfo.h"
+#include "cxxtools/eventloop.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/log.h"
+#include "http/parser.h"
+#include <stdlib.h>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+
+log_define("cxxtools.test.http")
+
+namespace
+{
+    std::string line(unsigned n)
+    {
+        std::ostringstream s;
+        s << "line " << n << ' ' << std::string(n % 97, char('a' + n % 26)) << '\n';
+        return s.str();
+    }
+
+    std::string content(unsigned lines)
+    {
+        std::string ret;
+        for (unsigned n = 0; n < lines; ++n)
+            ret += line(n);
+        return ret;
+    }
+
+    class BodyResponder : public cxxtools::http::Responder
+    {
+        public:
+            explicit BodyResponder(cxxtools::http::Service& service)
+                : cxxtools::http::Responder(service)
+                { }
+
+            void reply(std::ostream& out, cxxtools::http::Request& request, cxxtools::http::Reply& reply)
+            {
+                std::istringstream q(request.qparams());
+                unsigned lines = 0;
+                q >> lines;
+
+                reply.setHeader("Content-Type", "text/plain");
+
+                bool chunked = request.url() == "/chunked";
+                if (chunked)
+                    reply.setChunkedTransfer();
+
+                for (unsigned n = 0; n < lines; ++n)
+                {
+                    out << line(n);
+                    if (chunked && n % 500 == 0)
+                        out.flush();
+                }
+            }
+    };
+
+    typedef cxxtools::http::CachedService<BodyResponder> BodyService;
+
+    class ParamResponder : public cxxtools::http::Responder
+    {
+        public:
+            explicit ParamResponder(cxxtools::http::Service& service)
+                : cxxtools::http::Responder(service)
+                { }
+
+            void reply(std::ostream& out, cxxtools::http::Request& request, cxxtools::http::Reply& reply)
+            {
+                out << request.url();
+                const cxxtools::http::Request::PathParams& params = request.pathParams();
+                for (unsigned n = 0; n < params.size(); ++n)
+                    out << ' ' << params[n].first << '=' << params[n].second;
+            }
+    };
+
+    typedef cxxtools::http::CachedService<ParamResponder> ParamService;
+
+    // replies with the query string and closes every third connection
+    class CloseResponder : public cxxtools::http::Responder
+    {
+            unsigned& _count;
+
+        public:
+            CloseResponder(cxxtools::http::Service& service, unsigned& count)
+                : cxxtools::http::Responder(service),
+                  _count(count)
+                { }
+
+            void reply(std::ostream& out, cxxtools::http::Request& request, cxxtools::http::Reply& reply)
+            {
+                if (++_count % 3 == 0)
+                    reply.setHeader("Connection", "close");
+                out << request.qparams();
+            }
+    };
+
+    class CloseService : public cxxtools::http::Service
+    {
+            unsigned _count;
+
+        public:
+            CloseService()
+                : _count(0)
+                { }
+
+            cxxtools::http::Responder* createResponder(const cxxtools::http::Request&)
+            { return new CloseResponder(*this, _count); }
+
+            void releaseResponder(cxxtools::http::Responder* r)
+            { delete r; }
+    };
+
+    const char* testFile = "http-test.dat";
+
+    // Parses a request and returns the header fields as "key=value" lines.
+    // With bytewise set the characters are fed one by one, which bypasses
+    // the fast path of the parser.
+    std::string parsedFields(const std::string& msg, bool bytewise)
+    {
+        cxxtools::http::MessageHeader header;
+        cxxtools::http::HeaderParser::MessageHeaderEvent event(header);
+        cxxtools::http::HeaderParser parser(event, false);
+
+        if (bytewise)
+        {
+            for (unsigned n = 0; n < msg.size() && !parser.parse(msg[n]); ++n)
+                ;
+        }
+        else
+        {
+            std::stringbuf sb(msg);
+            parser.advance(sb);
+        }
+
+        if (parser.fail() || !parser.end())
+            return "failed";
+
+        std::string ret;
+        for (cxxtools::http::MessageHeader::const_iterator it = header.begin(); it != header.end(); ++it)
+        {
+            ret += it->first;
+            ret += '=';
+            ret += it->second;
+            ret += '\n';
+        }
+        return ret;
+    }
+}
+
+class HttpTest : public cxxtools::unit::TestSuite
+{
+        cxxtools::EventLoop _loop;
+        cxxtools::http::Server* _server;
+        cxxtools::AttachedThread* _thread;
+        BodyService _service;
+        CloseService _closeService;
+        std::vector<std::string> _replies;
+        cxxtools::http::FileService _fileService;
+        unsigned short _port;
+
+    public:
+        HttpTest()
+            : cxxtools::unit::TestSuite("http"),
+              _server(0),
+              _thread(0),
+              _fileService(".", "/files"),
+              _port(8003)
+        {
+            registerMethod("parseHeader", *this, &HttpTest::parseHeader);
+            registerMethod("parseFoldedHeader", *this, &HttpTest::parseFoldedHeader);
+            registerMethod("parseInvalidHeader", *this, &HttpTest::parseInvalidHeader);
+            registerMethod("parseControlCharacters", *this, &HttpTest::parseControlCharacters);
+            registerMethod("headerIndex", *this, &HttpTest::headerIndex);
+            registerMethod("manyHeaders", *this, &HttpTest::manyHeaders);
+            registerMethod("bodyBuffer", *this, &HttpTest::bodyBuffer);
+            registerMethod("clearBodyBuffer", *this, &HttpTest::clearBodyBuffer);
+            registerMethod("smallReply", *this, &HttpTest::smallReply);
+            registerMethod("bigReply", *this, &HttpTest::bigReply);
+            registerMethod("slowClient", *this, &HttpTest::slowClient);
+            registerMethod("slowChunkedClient", *this, &HttpTest::slowChunkedClient);
+            registerMethod("chunkedReply", *this, &HttpTest::chunkedReply);
+            registerMethod("pipeline", *this, &HttpTest::pipeline);
+            registerMethod("pipelineClose", *this, &HttpTest::pipelineClose);
+            registerMethod("pipelineFailure", *this, &HttpTest::pipelineFailure);
+            registerMethod("routes", *this, &HttpTest::routes);
+            registerMethod("connectionPool", *this, &HttpTest::connectionPool);
+            registerMethod("connectionPoolLimit", *this, &HttpTest::connectionPoolLimit);
+            registerMethod("connectionPoolIdleTimeout", *this, &HttpTest::connectionPoolIdleTimeout);
+            registerMethod("fileGet", *this, &HttpTest::fileGet);
+            registerMethod("fileRange", *this, &HttpTest::fileRange);
+            registerMethod("fileNotModified", *this, &HttpTest::fileNotModified);
+            registerMethod("fileNotFound", *this, &HttpTest::fileNotFound);
+
+            char* PORT = getenv("UTEST_PORT");
+            if (PORT)
+            {
+                std::istringstream s(PORT);
+                s >> _port;
+            }
+        }
+
+        void setUp()
+        {
+            _server = new cxxtools::http::Server(_loop, _port);
+            _server->addService("/big", _service);
+            _server->addService("/chunked", _service);
+            _server->addService("/close", _closeService);
+            _server->addService(cxxtools::Regex("^/files/"), _fileService);
+            _thread = new cxxtools::AttachedThread(cxxtools::callable(_loop, &cxxtools::EventLoop::run));
+            _thread->start();
+        }
+
+        void tearDown()
+        {
+            _loop.exit();
+            _thread->join();
+            delete _thread;
+            delete _server;
+
+            if (cxxtools::FileInfo::exists(testFile))
+                cxxtools::FileInfo(testFile).remove();
+        }
+
+        void createTestFile(unsigned lines)
+        {
+            std::ofstream f(testFile);
+            f << content(lines);
+        }
+
+        void parseHeader()
+        {
+            std::string msg =
+                "GET /index.html HTTP/1.1\r\n"
+                "Host: localhost\r\n"
+                "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:24.0) Gecko/20100101 Firefox/24.0\r\n"
+                "Accept-Language:de-de,de;q=0.8,en-us;q=0.5\r\n"
+                "X-Trailing: value  \r\n"
+                "X-Lf: unix line end\n"
+                "Cookie:\t session=0123456789abcdef\r\n"
+                "\r\n"
+                "body";
+
+            std::string expected =
+                "Host=localhost\n"
+                "User-Agent=Mozilla/5.0 (X11; Linux x86_64; rv:24.0) Gecko/20100101 Firefox/24.0\n"
+                "Accept-Language=de-de,de;q=0.8,en-us;q=0.5\n"
+                "X-Trailing=value  \n"
+                "X-Lf=unix line end\n"
+                "Cookie=session=0123456789abcdef\n";
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(msg, false), expected);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(msg, true), expected);
+        }
+
+        void parseFoldedHeader()
+        {
+            std::string msg =
+                "GET / HTTP/1.1\r\n"
+                "Host: localhost\r\n"
+                "X-Folded: first\r\n"
+                "\tsecond\r\n"
+                "X-Space : value\r\n"
+                "Connection: close\r\n"
+                "\r\n";
+
+            std::string expected = parsedFields(msg, true);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(msg, false), expected);
+            CXXTOOLS_UNIT_ASSERT(expected.find("X-Folded=first\tsecond\n") != std::string::npos);
+            CXXTOOLS_UNIT_ASSERT(expected.find("X-Space=value\n") != std::string::npos);
+            CXXTOOLS_UNIT_ASSERT(expected.find("Connection=close\n") != std::string::npos);
+        }
+
+        void parseInvalidHeader()
+        {
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields("GET / HTTP/1.1\r\nHo\x01st: x\r\n\r\n", false), "failed");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields("GET / HTTP/1.1\r\nHost: x\rY\r\n\r\n", false), "failed");
+        }
+
+        void parseControlCharacters()
+        {
+            // a null character must not truncate the value, so that the field
+            // is seen differently by a proxy and the server
+            std::string nul = "GET / HTTP/1.1\r\nX-Long-Value: 0123456789abcdef";
+            nul += '\0';
+            nul += "\r\nHost: x\r\n\r\n";
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(nul, false), "failed");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(nul, true), "failed");
+
+            std::string ctl = "GET / HTTP/1.1\r\nX-Value: a\x01" "b\r\n\r\n";
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(ctl, false), "failed");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(ctl, true), "failed");
+
+            std::string vt = "GET / HTTP/1.1\r\nX-Value:\vvalue\r\n\r\n";
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(vt, false), "failed");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(vt, true), "failed");
+
+            std::string tab = "GET / HTTP/1.1\r\nX-Value: 0123456789\tabcdefghijklmnop\r\n\r\n";
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(tab, false), "X-Value=0123456789\tabcdefghijklmnop\n");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(parsedFields(tab, true), "X-Value=0123456789\tabcdefghijklmnop\n");
+
+            cxxtools::http::MessageHeader header;
+            CXXTOOLS_UNIT_ASSERT_THROW(header.addHeader("X-Value", 7, "a\0b", 3), std::runtime_error);
+        }
+
+        void headerIndex()
+        {
+            cxxtools::http::MessageHeader header;
+            header.addHeader("Content-Length", "42");
+            header.addHeader("X-First", "1");
+            header.addHeader("x-first", "2");
+            header.setHeader("Connection", "close");
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(header.contentLength(), 42);
+            CXXTOOLS_UNIT_ASSERT(!header.keepAlive());
+            CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(header.getHeader("CONTENT-length")), "42");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(header.getHeader("X-FIRST")), "1");
+            CXXTOOLS_UNIT_ASSERT(header.getHeader("X-Second") == 0);
+            CXXTOOLS_UNIT_ASSERT(header.isHeaderValue("connection", "Close"));
+
+            header.removeHeader("X-First");
+            CXXTOOLS_UNIT_ASSERT(header.getHeader("x-first") == 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(header.getHeader("Connection")), "close");
+
+            header.setHeader("Content-Length", "17");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(header.contentLength(), 17);
+
+            cxxtools::http::MessageHeader copy(header);
+            header.clear();
+            CXXTOOLS_UNIT_ASSERT(header.getHeader("Content-Length") == 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(copy.contentLength(), 17);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(copy.getHeader("connection")), "close");
+        }
+
+        void manyHeaders()
+        {
+            cxxtools::http::MessageHeader header;
+
+            for (unsigned n = 0; n < 100; ++n)
+            {
+                std::ostringstream k;
+                k << "X-Header-" << n;
+                header.setHeader(k.str().c_str(), k.str().c_str() + 2);   // value "Header-<n>"
+            }
+
+            for (unsigned n = 0; n < 100; ++n)
+            {
+                std::ostringstream k;
+                k << "x-header-" << n;
+                const char* v = header.getHeader(k.str().c_str());
+                CXXTOOLS_UNIT_ASSERT(v != 0);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(v).substr(6), k.str().substr(8));
+            }
+
+            for (unsigned n = 0; n < 90; ++n)
+            {
+                std::ostringstream k;
+                k << "X-Header-" << n;
+                header.removeHeader(k.str().c_str());
+            }
+
+            CXXTOOLS_UNIT_ASSERT(header.getHeader("X-Header-0") == 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(std::string(header.getHeader("X-HEADER-99")), "Header-99");
+        }
+
+        void bodyBuffer()
+        {
+            cxxtools::http::BodyStream body;
+            std::string expected;
+
+            for (unsigned n = 0; n < 10000; ++n)
+            {
+                std::string l = line(n);
+                if (n % 2)
+                    body << l;
+                else
+                    for (unsigned i = 0; i < l.size(); ++i)
+                        body << l[i];
+                expected += l;
+                CXXTOOLS_UNIT_ASSERT_EQUALS(body.size(), expected.size());
+            }
+
+            const cxxtools::http::BodyBuffer& buffer = body.buffer();
+            CXXTOOLS_UNIT_ASSERT(buffer.blocks() > 1);
+
+            std::size_t size = 0;
+            for (unsigned n = 0; n < buffer.blocks(); ++n)
+            {
+                CXXTOOLS_UNIT_ASSERT(expected.compare(size, buffer.blockSize(n),
+                    buffer.blockData(n), buffer.blockSize(n)) == 0);
+                size += buffer.blockSize(n);
+            }
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(size, expected.size());
+            CXXTOOLS_UNIT_ASSERT(body.str() == expected);
+
+            std::ostringstream out;
+            body.send(out);
+            CXXTOOLS_UNIT_ASSERT(out.str() == expected);
+        }
+
+        void clearBodyBuffer()
+        {
+            cxxtools::http::BodyStream body;
+            body << content(5000);
+            CXXTOOLS_UNIT_ASSERT(body.buffer().blocks() > 1);
+
+            body.reset();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body.size(), 0);
+            CXXTOOLS_UNIT_ASSERT(body.buffer().empty());
+
+            body << "hello";
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body.size(), 5);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body.buffer().blocks(), 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body.str(), "hello");
+        }
+
+        void smallReply()
+        {
+            cxxtools::http::Client client("", _port);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+            CXXTOOLS_UNIT_ASSERT(!client.header().chunkedTransferEncoding());
+        }
+
+        void bigReply()
+        {
+            cxxtools::http::Client client("", _port);
+
+            std::string body = client.get("/big?30000", 10000);
+            CXXTOOLS_UNIT_ASSERT(!client.header().chunkedTransferEncoding());
+            CXXTOOLS_UNIT_ASSERT(body == content(30000));
+
+            // the connection is kept alive
+            body = client.get("/big?20000", 10000);
+            CXXTOOLS_UNIT_ASSERT(body == content(20000));
+        }
+
+        // A client, which does not read the reply, must not block the server.
+        void slowClient()
+        {
+            createTestFile(100000);
+
+            const char* urls[] = { "/big?100000", "/chunked?100000", "/files/http-test.dat" };
+            for (unsigned n = 0; n < sizeof(urls) / sizeof(urls[0]); ++n)
+            {
+                cxxtools::net::TcpStream slow("", _port);
+                slow << "GET " << urls[n] << " HTTP/1.0\r\n\r\n" << std::flush;
+
+                cxxtools::Thread::sleep(100);
+
+                cxxtools::http::Client client("", _port);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 2000), content(10));
+
+                std::ostringstream reply;
+                reply << slow.rdbuf();
+                std::string r = reply.str();
+                std::string::size_type e = r.find("\r\n\r\n");
+                CXXTOOLS_UNIT_ASSERT(e != std::string::npos);
+                CXXTOOLS_UNIT_ASSERT(r.substr(e + 4) == content(100000));
+            }
+        }
+
+        void slowChunkedClient()
+        {
+            // the streamed reply is larger than the server buffers for a
+            // client, which does not read
+            cxxtools::net::TcpStream slow("", _port);
+            slow << "GET /chunked?100000 HTTP/1.1\r\n"
+                    "Host: localhost\r\n"
+                    "Connection: close\r\n\r\n" << std::flush;
+
+            cxxtools::Thread::sleep(100);
+
+            std::ostringstream reply;
+            reply << slow.rdbuf();
+            std::string r = reply.str();
+            std::string::size_type e = r.find("\r\n\r\n");
+            CXXTOOLS_UNIT_ASSERT(e != std::string::npos);
+
+            std::string body;
+            std::istringstream chunks(r.substr(e + 4));
+            std::size_t size;
+            while (chunks >> std::hex >> size && size > 0)
+            {
+                chunks.ignore(2);
+                std::string chunk(size, '\0');
+                chunks.read(&chunk[0], size);
+                body += chunk;
+            }
+
+            CXXTOOLS_UNIT_ASSERT(body == content(100000));
+        }
+
+        void connectionPool()
+        {
+            cxxtools::http::ConnectionPool pool;
+
+            for (unsigned n = 0; n < 5; ++n)
+            {
+                cxxtools::http::Client client("", _port);
+                client.setConnectionPool(pool);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+            }
+
+            cxxtools::http::ConnectionPool::Statistics s = pool.statistics();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.connects, 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.hits, 4);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.idle, 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.active, 0);
+
+            // after clearing the pool the client connects again
+            pool.clear();
+            cxxtools::http::Client client("", _port);
+            client.setConnectionPool(pool);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(pool.statistics().connects, 2);
+
+            // a failed request does not keep the connection active
+            cxxtools::http::Client failing("", _port + 1);
+            failing.setConnectionPool(pool);
+            CXXTOOLS_UNIT_ASSERT_THROW(failing.get("/big?10", 10000), std::exception);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(pool.statistics().active, 0);
+        }
+
+        void connectionPoolLimit()
+        {
+            cxxtools::http::ConnectionPool pool(2);
+
+            cxxtools::http::Client c1("", _port);
+            cxxtools::http::Client c2("", _port);
+            cxxtools::http::Client c3("", _port);
+            c1.setConnectionPool(pool);
+            c2.setConnectionPool(pool);
+            c3.setConnectionPool(pool);
+
+            // the clients keep their connections until the body is read
+            cxxtools::http::Request request("/big?10");
+            c1.execute(request, 10000);
+            c2.execute(request, 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(pool.statistics().active, 2);
+
+            CXXTOOLS_UNIT_ASSERT_THROW(c3.get("/big?10", 10000, 100), cxxtools::IOError);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(c1.readBody(), content(10));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(c3.get("/big?10", 10000, 100), content(10));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(c2.readBody(), content(10));
+
+            cxxtools::http::ConnectionPool::Statistics s = pool.statistics();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.connects, 2);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.hits, 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.idle, 2);
+        }
+
+        void connectionPoolIdleTimeout()
+        {
+            cxxtools::http::ConnectionPool pool(8, 100);
+
+            cxxtools::http::Client client("", _port);
+            client.setConnectionPool(pool);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+
+            cxxtools::Thread::sleep(200);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+
+            cxxtools::http::ConnectionPool::Statistics s = pool.statistics();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.connects, 2);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.hits, 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(s.evictions, 1);
+        }
+
+        void onReply(cxxtools::http::Client& client)
+        {
+            // skip the body of every fifth reply
+            if (_replies.size() % 5 == 4)
+                _replies.push_back("skipped");
+            else
+                _replies.push_back(client.readBody());
+        }
+
+        void pipeline()
+        {
+            cxxtools::http::Client client("", _port);
+            client.pipelineDepth(4);
+
+            cxxtools::http::Request requests[20];
+            _replies.clear();
+            for (unsigned n = 0; n < 20; ++n)
+            {
+                std::ostringstream url;
+                url << (n % 2 ? "/chunked?" : "/big?") << n * 100;
+                requests[n].url(url.str());
+                client.pipelineRequest(requests[n], cxxtools::callable(*this, &HttpTest::onReply));
+            }
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.pipelinedRequests(), 20);
+            client.executePipeline(10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.pipelinedRequests(), 0);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(_replies.size(), 20);
+            for (unsigned n = 0; n < 20; ++n)
+            {
+                if (n % 5 == 4)
+                    CXXTOOLS_UNIT_ASSERT_EQUALS(_replies[n], "skipped");
+                else
+                    CXXTOOLS_UNIT_ASSERT(_replies[n] == content(n * 100));
+            }
+
+            // the connection is still usable
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/big?10", 10000), content(10));
+        }
+
+        void pipelineClose()
+        {
+            cxxtools::http::Client client("", _port);
+
+            cxxtools::http::Request requests[10];
+            _replies.clear();
+            for (unsigned n = 0; n < 10; ++n)
+            {
+                std::ostringstream url;
+                url << "/close?" << n;
+                requests[n].url(url.str());
+                client.pipelineRequest(requests[n], cxxtools::callable(*this, &HttpTest::onReply));
+            }
+
+            client.executePipeline(10000);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(_replies.size(), 10);
+            for (unsigned n = 0; n < 10; ++n)
+            {
+                std::ostringstream expected;
+                expected << n;
+                std::string e = n % 5 == 4 ? "skipped" : expected.str();
+                CXXTOOLS_UNIT_ASSERT_EQUALS(_replies[n], e);
+            }
+        }
+
+        void onFailingReply(cxxtools::http::Client&)
+        {
+            throw std::runtime_error("reply rejected");
+        }
+
+        void pipelineFailure()
+        {
+            cxxtools::http::ConnectionPool pool(1);
+
+            cxxtools::http::Client client("", _port);
+            client.setConnectionPool(pool);
+
+            cxxtools::http::Request requests[3];
+            for (unsigned n = 0; n < 3; ++n)
+            {
+                requests[n].url("/big?10");
+                client.pipelineRequest(requests[n], cxxtools::callable(*this, &HttpTest::onFailingReply));
+            }
+
+            CXXTOOLS_UNIT_ASSERT_THROW(client.executePipeline(10000), std::runtime_error);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.pipelinedRequests(), 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(pool.statistics().active, 0);
+
+            // the failed connection does not count against the limit
+            cxxtools::http::Client other("", _port);
+            other.setConnectionPool(pool);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(other.get("/big?10", 10000, 100), content(10));
+        }
+
+        void chunkedReply()
+        {
+            cxxtools::http::Client client("", _port);
+
+            std::string body = client.get("/chunked?30000", 10000);
+            CXXTOOLS_UNIT_ASSERT(client.header().chunkedTransferEncoding());
+            CXXTOOLS_UNIT_ASSERT(body == content(30000));
+
+            body = client.get("/chunked?1", 10000);
+            CXXTOOLS_UNIT_ASSERT(client.header().chunkedTransferEncoding());
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body, content(1));
+
+            // without flush the reply is sent as usual
+            body = client.get("/chunked?0", 10000);
+            CXXTOOLS_UNIT_ASSERT(!client.header().chunkedTransferEncoding());
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body, std::string());
+        }
+
+        void routes()
+        {
+            ParamService user;
+            ParamService userFile;
+            ParamService admin;
+            ParamService rest;
+            ParamService regex;
+            ParamService literal;
+
+            _server->addService("/user/admin", admin);
+            _server->addService("/user/{id}", user);
+            _server->addService("/user/{id}/file/{name}", userFile);
+            _server->addService("/rest/*", rest);
+            _server->addService(cxxtools::Regex("^/re"), regex);
+            _server->addService("/lit/\\{id}/\\*", literal);
+
+            cxxtools::http::Client client("", _port);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/user/admin", 10000), "/user/admin");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/user/42", 10000), "/user/42 id=42");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/user/42/file/a.txt", 10000),
+                "/user/42/file/a.txt id=42 name=a.txt");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/rest/", 10000), "/rest/");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/rest/a/b", 10000), "/rest/a/b");
+
+            // escaped segments are literals
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/lit/{id}/*", 10000), "/lit/{id}/*");
+            client.get("/lit/42/a", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+
+            // the regular expression is the fallback
+            client.get("/rest", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 200);
+
+            // parameters do not match empty segments
+            client.get("/user/", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+
+            client.get("/user/42/file", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+
+            _server->removeService(user);
+            client.get("/user/42", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.get("/user/admin", 10000), "/user/admin");
+
+            _server->removeService(admin);
+            _server->removeService(userFile);
+            _server->removeService(rest);
+            _server->removeService(regex);
+            _server->removeService(literal);
+        }
+
+        void fileGet()
+        {
+            createTestFile(30000);
+
+            cxxtools::http::Client client("", _port);
+
+            std::string body = client.get("/files/http-test.dat", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 200);
+            CXXTOOLS_UNIT_ASSERT(body == content(30000));
+            CXXTOOLS_UNIT_ASSERT(client.header().hasHeader("ETag"));
+            CXXTOOLS_UNIT_ASSERT(client.header().hasHeader("Last-Modified"));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().getHeader("Content-Type"),
+                std::string("application/octet-stream"));
+
+            // served from the open file cache
+            body = client.get("/files/./http-test.dat", 10000);
+            CXXTOOLS_UNIT_ASSERT(body == content(30000));
+
+            // a changed file is reopened
+            createTestFile(10);
+            body = client.get("/files/http-test.dat", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(body, content(10));
+        }
+
+        void fileRange()
+        {
+            createTestFile(1000);
+            std::string c = content(1000);
+
+            cxxtools::http::Client client("", _port);
+            cxxtools::http::Request request("/files/http-test.dat");
+
+            request.setHeader("Range", "bytes=100-199");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 206);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.readBody(), c.substr(100, 100));
+
+            std::ostringstream contentRange;
+            contentRange << "bytes 100-199/" << c.size();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().getHeader("Content-Range"), contentRange.str());
+
+            request.setHeader("Range", "bytes=-10");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 206);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.readBody(), c.substr(c.size() - 10));
+
+            request.setHeader("Range", "bytes=500-");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 206);
+            CXXTOOLS_UNIT_ASSERT(client.readBody() == c.substr(500));
+
+            request.setHeader("Range", "bytes=1000000-");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 416);
+            client.readBody();
+
+            // multiple ranges are not supported, so the whole file is sent
+            request.setHeader("Range", "bytes=0-1,5-6");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 200);
+            CXXTOOLS_UNIT_ASSERT(client.readBody() == c);
+        }
+
+        void fileNotModified()
+        {
+            createTestFile(100);
+
+            cxxtools::http::Client client("", _port);
+            client.get("/files/http-test.dat", 10000);
+            std::string etag = client.header().getHeader("ETag");
+            std::string lastModified = client.header().getHeader("Last-Modified");
+
+            cxxtools::http::Request request("/files/http-test.dat");
+            request.setHeader("If-None-Match", etag.c_str());
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 304);
+            client.readBody();
+
+            request.removeHeader("If-None-Match");
+            request.setHeader("If-Modified-Since", lastModified.c_str());
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 304);
+            client.readBody();
+
+            // a later date is compared as a date and not as a string
+            request.setHeader("If-Modified-Since", "Fri, 01 Jan 2100 00:00:00 GMT");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 304);
+            client.readBody();
+
+            request.setHeader("If-Modified-Since", "Thu, 01 Jan 1970 00:00:00 GMT");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 200);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.readBody(), content(100));
+
+            // an invalid date is ignored
+            request.setHeader("If-Modified-Since", "yesterday");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.execute(request, 10000).httpReturnCode(), 200);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.readBody(), content(100));
+        }
+
+        void fileNotFound()
+        {
+            createTestFile(1);
+
+            cxxtools::http::Client client("", _port);
+
+            client.get("/files/no-such-file", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+
+            client.get("/files/../test/http-test.dat", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+
+            client.get("/files/", 10000);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(client.header().httpReturnCode(), 404);
+        }
+};
+
+cxxtools::unit::RegisterTest<HttpTest> register_HttpTest;
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "http/parser.h"
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Measures the http header parser with a typical browser request. The
+// request is parsed from a stream buffer, which lets the parser scan
+// complete header lines, and character by character through the state
+// machine.
+
+namespace
+{
+    const char request[] =
+        "GET /app/index.html?lang=de HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:24.0) Gecko/20100101 Firefox/24.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: de-de,de;q=0.8,en-us;q=0.5,en;q=0.3\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Referer: http://www.example.com/app/start.html\r\n"
+        "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=de\r\n"
+        "Connection: keep-alive\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "If-Modified-Since: Mon, 07 Oct 2013 10:11:12 GMT\r\n"
+        "If-None-Match: \"5f2a-4e8b1c2d\"\r\n"
+        "\r\n";
+
+    void bench(const char* name, bool bytewise, unsigned rounds)
+    {
+        std::string msg(request);
+        cxxtools::http::MessageHeader header;
+        cxxtools::http::HeaderParser::MessageHeaderEvent event(header);
+        cxxtools::http::HeaderParser parser(event, false);
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            header.clear();
+            parser.reset(false);
+
+            if (bytewise)
+            {
+                for (unsigned n = 0; n < msg.size() && !parser.parse(msg[n]); ++n)
+                    ;
+            }
+            else
+            {
+                std::stringbuf sb(msg);
+                parser.advance(sb);
+            }
+
+            if (parser.fail())
+                throw std::runtime_error("parse error");
+        }
+
+        cxxtools::Timespan t = clock.stop();
+
+        std::cout << name << ":\n"
+                     "\ttime: " << t << " sec\n"
+                     "\trequests per second: " << (rounds / t.totalSeconds()) << "\n"
+                     "\tMB per second: " << (rounds * msg.size() / t.totalSeconds() / 1024 / 1024) << "\n"
+                     "\tnsecs per request: " << (t.totalUSecs() * 1000 / rounds) << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> rounds(argc, argv, 'n', 200000);
+
+        std::cout << "benchmark http header parser with " << rounds.getValue() << " requests\n\n"
+                     "options:\n"
+                     "   -n <number>       specify number of requests\n" << std::endl;
+
+        bench("streambuf", false, rounds);
+        bench("bytewise", true, rounds);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
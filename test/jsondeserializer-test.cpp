@@ -29,7 +29,10 @@
 #include "cxxtools/unit/testsuite.h"
 #include "cxxtools/unit/registertest.h"
 #include "cxxtools/jsondeserializer.h"
+#include "cxxtools/iso8859_1codec.h"
 #include "cxxtools/log.h"
+#include <algorithm>
+#include <string.h>
 
 //log_define("cxxtools.test.jsondeserializer")
 //
@@ -88,6 +91,35 @@ namespace
     {
     }
 
+    // Delivers the data in small pieces, so that values cross the
+    // boundaries of the get area.
+    class ChunkedBuffer : public std::streambuf
+    {
+            std::string _data;
+            std::string::size_type _pos;
+            std::string::size_type _chunk;
+
+        public:
+            ChunkedBuffer(const std::string& data, unsigned chunk)
+                : _data(data),
+                  _pos(0),
+                  _chunk(chunk)
+                { }
+
+        protected:
+            int_type underflow()
+            {
+                if (_pos >= _data.size())
+                    return traits_type::eof();
+
+                std::string::size_type n = std::min(_chunk, _data.size() - _pos);
+                char* p = &_data[_pos];
+                setg(p, p, p + n);
+                _pos += n;
+                return traits_type::to_int_type(*p);
+            }
+    };
+
 }
 
 class JsonDeserializerTest : public cxxtools::unit::TestSuite
@@ -106,6 +138,12 @@ class JsonDeserializerTest : public cxxtools::unit::TestSuite
             registerMethod("testComplexObject", *this, &JsonDeserializerTest::testComplexObject);
             registerMethod("testCommentLine", *this, &JsonDeserializerTest::testCommentLine);
             registerMethod("testCommentMultiline", *this, &JsonDeserializerTest::testCommentMultiline);
+            registerMethod("testUtf8", *this, &JsonDeserializerTest::testUtf8);
+            registerMethod("testSurrogates", *this, &JsonDeserializerTest::testSurrogates);
+            registerMethod("testMultipleValues", *this, &JsonDeserializerTest::testMultipleValues);
+            registerMethod("testChunkedInput", *this, &JsonDeserializerTest::testChunkedInput);
+            registerMethod("testCharStream", *this, &JsonDeserializerTest::testCharStream);
+            registerMethod("testLineNumber", *this, &JsonDeserializerTest::testLineNumber);
         }
 
         void testInt()
@@ -302,6 +340,181 @@ class JsonDeserializerTest : public cxxtools::unit::TestSuite
             CXXTOOLS_UNIT_ASSERT_EQUALS(data.boolValue, true);
             CXXTOOLS_UNIT_ASSERT_EQUALS(data.nullValue, true);
         }
+
+        void testUtf8()
+        {
+            std::vector<cxxtools::String> data;
+
+            std::istringstream in("[ \"\xc3\xa4" "bc\", \"\\u00e4\", \"x\\u20ac\xe2\x82\xac\"]");
+
+            cxxtools::JsonDeserializer deserializer(in);
+            deserializer.deserialize(data);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.size(), 3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[0].size(), 3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[0][0].value(), 0xe4);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[0][1], 'b');
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[1].size(), 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[1][0].value(), 0xe4);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[2].size(), 3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[2][1].value(), 0x20ac);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[2][2].value(), 0x20ac);
+
+            std::istringstream in2("{ \"\xc3\xa4\": 1, \"\\u00e4\\u00e4\": 2 }");
+            cxxtools::JsonDeserializer deserializer2(in2);
+            deserializer2.deserialize();
+
+            int value = 0;
+            deserializer2.si()->getMember("\xc3\xa4") >>= value;
+            CXXTOOLS_UNIT_ASSERT_EQUALS(value, 1);
+            deserializer2.si()->getMember("\xc3\xa4\xc3\xa4") >>= value;
+            CXXTOOLS_UNIT_ASSERT_EQUALS(value, 2);
+        }
+
+        void testSurrogates()
+        {
+            cxxtools::String data;
+
+            // emoji as written by python's json.dumps
+            std::istringstream in("\"a\\ud83d\\ude00b\"");
+            cxxtools::JsonDeserializer deserializer(in);
+            deserializer.deserialize(data);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.size(), 3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data[1].value(), 0x1f600);
+
+            std::istringstream in2("\"\\ud83d\"");
+            cxxtools::JsonDeserializer deserializer2(in2);
+            CXXTOOLS_UNIT_ASSERT_THROW(deserializer2.deserialize(data), cxxtools::JsonParserError);
+
+            std::istringstream in3("\"\\ude00\\ud83d\"");
+            cxxtools::JsonDeserializer deserializer3(in3);
+            CXXTOOLS_UNIT_ASSERT_THROW(deserializer3.deserialize(data), cxxtools::JsonParserError);
+
+            std::istringstream in4("\"\\ud83d\\u0041\"");
+            cxxtools::JsonDeserializer deserializer4(in4);
+            CXXTOOLS_UNIT_ASSERT_THROW(deserializer4.deserialize(data), cxxtools::JsonParserError);
+        }
+
+        void testMultipleValues()
+        {
+            // each deserializer reads exactly one value from the stream
+            std::istringstream in("17 [1,2]\"foo\"{\"a\":-3}true -4");
+
+            int i = 0;
+            std::vector<int> v;
+            std::string s;
+            bool b = false;
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(i);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(i, 17);
+            }
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(v);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(v.size(), 2);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(v[1], 2);
+            }
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(s);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(s, "foo");
+            }
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(i, "a");
+                CXXTOOLS_UNIT_ASSERT_EQUALS(i, -3);
+            }
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(b);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(b, true);
+                CXXTOOLS_UNIT_ASSERT(!in.eof());
+            }
+
+            {
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(i);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(i, -4);
+                CXXTOOLS_UNIT_ASSERT(in.eof());
+            }
+        }
+
+        void testChunkedInput()
+        {
+            std::string json = "// TestObject2\n{"
+                "\"intValue\": 17, "
+                "stringValue:  \"foo \\\"bar\\\" \\u00e4 with some more text\","
+                "\"doubleValue\": 1.5e+3, /* a comment with * and / */"
+                "\"boolValue\"  :    true,"
+                "\"nullValue\"  :  null,"
+                "\"setValue\":[5,7,8],"
+                "\"structValue\" : { \"n\":3,\"s\":\"\xc3\xa4\xc3\xb6\xc3\xbc\"}"
+            "}";
+
+            for (unsigned chunk = 1; chunk <= 17; ++chunk)
+            {
+                ChunkedBuffer buffer(json, chunk);
+                std::istream in(&buffer);
+
+                TestObject2 data;
+                cxxtools::JsonDeserializer deserializer(in);
+                deserializer.deserialize(data);
+
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.intValue, 17);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.stringValue, "foo \"bar\" \xe4 with some more text");
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.doubleValue, 1500.0);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.boolValue, true);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.nullValue, true);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.setValue.size(), 3);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.structValue.n, 3);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.structValue.s.size(), 3);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(data.structValue.s[2].value(), 0xfc);
+            }
+        }
+
+        void testCharStream()
+        {
+            TestObject data;
+
+            std::istringstream in("{"
+                "\"intValue\": 17, "
+                "\"stringValue\":  \"foo\\u00e4\xe4\","
+                "\"doubleValue\": 1.5, "
+                "\"boolValue\"  :    true"
+            "}");
+
+            // other codecs use the JsonParser
+            cxxtools::JsonDeserializer deserializer(in, new cxxtools::Iso8859_1Codec());
+            deserializer.deserialize(data);
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.intValue, 17);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.stringValue, "foo\xe4\xe4");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.doubleValue, 1.5);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(data.boolValue, true);
+        }
+
+        void testLineNumber()
+        {
+            std::istringstream in("{\n\"a\": \"x\ny\",\n\"b\" 2 }");
+
+            cxxtools::JsonDeserializer deserializer(in);
+            try
+            {
+                deserializer.deserialize();
+                CXXTOOLS_UNIT_FAIL("JsonParserError expected");
+            }
+            catch (const cxxtools::JsonParserError& e)
+            {
+                CXXTOOLS_UNIT_ASSERT(strstr(e.what(), "line 4") != 0);
+            }
+        }
 };
 
 cxxtools::unit::RegisterTest<JsonDeserializerTest> register_JsonDeserializerTest;
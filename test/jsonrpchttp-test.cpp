@@ -111,6 +111,7 @@ class JsonRpcHttpTest : public cxxtools::unit::TestSuite
             registerMethod("PrepareConnect", *this, &JsonRpcHttpTest::PrepareConnect);
             registerMethod("Connect", *this, &JsonRpcHttpTest::Connect);
             registerMethod("Multiple", *this, &JsonRpcHttpTest::Multiple);
+            registerMethod("Reactor", *this, &JsonRpcHttpTest::Reactor);
 
             char* PORT = getenv("UTEST_PORT");
             if (PORT)
@@ -831,6 +832,50 @@ class JsonRpcHttpTest : public cxxtools::unit::TestSuite
 
         }
 
+        ////////////////////////////////////////////////////////////
+        // Reactor
+        //
+        void Reactor()
+        {
+            cxxtools::http::Server server(_loop, cxxtools::http::Server::Reactor);
+            server.reactorThreads(2);
+            server.listen("", _port + 2);
+
+            cxxtools::json::HttpService service;
+            service.registerMethod("multiply", *this, &JsonRpcHttpTest::multiplyDouble);
+            server.addService("/rpc", service);
+
+            typedef cxxtools::RemoteProcedure<double, double, double> Multiply;
+
+            // keep alive connection
+            cxxtools::json::HttpClient client(_loop, "", _port + 2, "/rpc");
+            Multiply multiply(client, "multiply");
+            for (unsigned i = 0; i < 10; ++i)
+            {
+                multiply.begin(i, 2);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(multiply.end(2000), i*2);
+            }
+
+            // parallel connections
+            std::vector<cxxtools::json::HttpClient> clients;
+            std::vector<Multiply> procs;
+
+            clients.reserve(16);
+            procs.reserve(16);
+
+            for (unsigned i = 0; i < 16; ++i)
+            {
+                clients.push_back(cxxtools::json::HttpClient(_loop, "", _port + 2, "/rpc"));
+                procs.push_back(Multiply(clients.back(), "multiply"));
+                procs.back().begin(i, i);
+            }
+
+            for (unsigned i = 0; i < 16; ++i)
+            {
+                CXXTOOLS_UNIT_ASSERT_EQUALS(procs[i].end(2000), i*i);
+            }
+        }
+
 };
 
 cxxtools::unit::RegisterTest<JsonRpcHttpTest> register_JsonRpcHttpTest;
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/lockfreequeue.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/atomicity.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <vector>
+
+class LockFreeQueueTest : public cxxtools::unit::TestSuite
+{
+        enum { Threads = 4, Elements = 20000 };
+
+        cxxtools::LockFreeQueue<int>* _queue;
+        volatile cxxtools::atomic_t _nextProducer;
+        std::vector<cxxtools::atomic_t> _seen;
+        int _received;
+
+        void producer()
+        {
+          int p = cxxtools::atomicIncrement(_nextProducer) - 1;
+          for (int n = 0; n < Elements; ++n)
+            _queue->put(p * Elements + n);
+        }
+
+        void consumer()
+        {
+          for (int n = 0; n < Elements; ++n)
+          {
+            int value = _queue->get();
+            if (value >= 0 && value < Threads * Elements)
+              cxxtools::atomicIncrement(_seen[value]);
+          }
+        }
+
+        void getOne()
+        {
+          _received = _queue->get();
+        }
+
+    public:
+        LockFreeQueueTest()
+        : cxxtools::unit::TestSuite("lockfreequeue")
+        {
+            registerMethod("putGet", *this, &LockFreeQueueTest::putGet);
+            registerMethod("fullEmpty", *this, &LockFreeQueueTest::fullEmpty);
+            registerMethod("wakeConsumer", *this, &LockFreeQueueTest::wakeConsumer);
+            registerMethod("threads", *this, &LockFreeQueueTest::threads);
+        }
+
+        void putGet()
+        {
+          cxxtools::LockFreeQueue<int> queue(8);
+          CXXTOOLS_UNIT_ASSERT(queue.empty());
+
+          queue.put(1);
+          queue.put(2);
+          CXXTOOLS_UNIT_ASSERT(queue.tryPut(3));
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.size(), 3);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.get(), 1);
+
+          std::pair<int, bool> result = queue.tryGet();
+          CXXTOOLS_UNIT_ASSERT(result.second);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(result.first, 2);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.get(), 3);
+          CXXTOOLS_UNIT_ASSERT(queue.empty());
+        }
+
+        void fullEmpty()
+        {
+          // the capacity is rounded up to the next power of 2
+          cxxtools::LockFreeQueue<int> queue(5);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.maxSize(), 8);
+
+          std::pair<int, bool> result = queue.tryGet();
+          CXXTOOLS_UNIT_ASSERT(!result.second);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(result.first, 0);
+
+          // fill and drain the ring a few times, so that the positions wrap
+          for (int r = 0; r < 3; ++r)
+          {
+            for (int n = 0; n < 8; ++n)
+              CXXTOOLS_UNIT_ASSERT(queue.tryPut(r * 8 + n));
+
+            CXXTOOLS_UNIT_ASSERT(!queue.tryPut(99));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(queue.size(), 8);
+
+            for (int n = 0; n < 8; ++n)
+            {
+              result = queue.tryGet();
+              CXXTOOLS_UNIT_ASSERT(result.second);
+              CXXTOOLS_UNIT_ASSERT_EQUALS(result.first, r * 8 + n);
+            }
+
+            CXXTOOLS_UNIT_ASSERT(!queue.tryGet().second);
+            CXXTOOLS_UNIT_ASSERT(queue.empty());
+          }
+        }
+
+        void wakeConsumer()
+        {
+          cxxtools::LockFreeQueue<int> queue(4);
+          _queue = &queue;
+          _received = 0;
+
+          cxxtools::AttachedThread thread(cxxtools::callable(*this, &LockFreeQueueTest::getOne));
+          thread.start();
+
+          for (unsigned n = 0; n < 1000 && queue.numWaiting() == 0; ++n)
+            cxxtools::Thread::sleep(1);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.numWaiting(), 1);
+
+          queue.put(42);
+          thread.join();
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(_received, 42);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(queue.numWaiting(), 0);
+        }
+
+        void threads()
+        {
+          // a small queue, so that producers and consumers block
+          cxxtools::LockFreeQueue<int> queue(16);
+          _queue = &queue;
+          _nextProducer = 0;
+          _seen.assign(Threads * Elements, 0);
+
+          std::vector<cxxtools::AttachedThread*> threads;
+          for (unsigned n = 0; n < Threads; ++n)
+          {
+            threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*this, &LockFreeQueueTest::consumer)));
+            threads.back()->start();
+            threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*this, &LockFreeQueueTest::producer)));
+            threads.back()->start();
+          }
+
+          for (unsigned n = 0; n < threads.size(); ++n)
+          {
+            threads[n]->join();
+            delete threads[n];
+          }
+
+          CXXTOOLS_UNIT_ASSERT(queue.empty());
+
+          // every element arrived exactly once
+          unsigned wrong = 0;
+          for (unsigned n = 0; n < _seen.size(); ++n)
+            if (_seen[n] != 1)
+              ++wrong;
+          CXXTOOLS_UNIT_ASSERT_EQUALS(wrong, 0);
+        }
+};
+
+cxxtools::unit::RegisterTest<LockFreeQueueTest> register_LockFreeQueueTest;
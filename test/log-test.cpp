@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/log.h"
+#include "cxxtools/fileinfo.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/timespan.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <fstream>
+#include <vector>
+
+log_define("cxxtools.test.log")
+
+namespace
+{
+  class LogWorker
+  {
+      const volatile bool& _stop;
+      unsigned _count;
+
+    public:
+      explicit LogWorker(const volatile bool& stop)
+        : _stop(stop),
+          _count(0)
+      { }
+
+      unsigned count() const
+      { return _count; }
+
+      void run()
+      {
+        while (!_stop)
+        {
+          log_warn("warn " << _count);
+          ++_count;
+          log_debug("debug " << _count);
+          if (_count % 4 == 0)
+            cxxtools::Thread::sleep(cxxtools::Milliseconds(1));
+        }
+      }
+  };
+}
+
+class LogTest : public cxxtools::unit::TestSuite
+{
+    cxxtools::LogConfiguration _savedConfiguration;
+    std::string _fname;
+
+    void configure(cxxtools::LogConfiguration::Format format, bool async)
+    {
+      cxxtools::LogConfiguration config;
+      config.setFile(_fname);
+      config.setLogLevel("cxxtools.test.log", cxxtools::Logger::INFO);
+      config.setFormat(format);
+      if (async)
+        config.setAsync();
+      cxxtools::LogManager::getInstance().configure(config);
+    }
+
+    void logMessages()
+    {
+      std::string s = "abc";
+      log_info_s("value " << 42 << ' ' << -17 << ' ' << 3.5 << " text " << s << ' ' << true);
+      log_info("plain " << 7);
+      log_debug_s("disabled " << 1);
+      log_warn_s("unsigned " << 42u << ' ' << 1e20);
+    }
+
+    // returns the message part of the log lines
+    std::vector<std::string> messages(const std::vector<std::string>& lines)
+    {
+      std::vector<std::string> result;
+      for (unsigned n = 0; n < lines.size(); ++n)
+      {
+        std::string::size_type p = lines[n].find("] ");
+        result.push_back(p == std::string::npos ? lines[n] : lines[n].substr(p + 2));
+      }
+      return result;
+    }
+
+    std::vector<std::string> readText()
+    {
+      std::ifstream in(_fname.c_str());
+      std::vector<std::string> lines;
+      std::string line;
+      while (std::getline(in, line))
+        lines.push_back(line);
+      return messages(lines);
+    }
+
+    std::vector<std::string> readBinary()
+    {
+      std::ifstream in(_fname.c_str());
+      cxxtools::BinaryLogDecoder decoder(in);
+      std::vector<std::string> lines;
+      std::string line;
+      while (decoder.getLine(line))
+        lines.push_back(line);
+      return messages(lines);
+    }
+
+    void checkMessages(const std::vector<std::string>& m)
+    {
+      CXXTOOLS_UNIT_ASSERT_EQUALS(m.size(), 3);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(m[0], "INFO cxxtools.test.log - value 42 -17 3.5 text abc 1");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(m[1], "INFO cxxtools.test.log - plain 7");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(m[2], "WARN cxxtools.test.log - unsigned 42 1e+20");
+    }
+
+  public:
+    LogTest()
+      : cxxtools::unit::TestSuite("log"),
+        _fname("log-test.log")
+    {
+      registerMethod("textFormat", *this, &LogTest::textFormat);
+      registerMethod("binaryFormat", *this, &LogTest::binaryFormat);
+      registerMethod("asyncText", *this, &LogTest::asyncText);
+      registerMethod("asyncBinary", *this, &LogTest::asyncBinary);
+      registerMethod("reconfigure", *this, &LogTest::reconfigure);
+    }
+
+    void setUp()
+    {
+      _savedConfiguration = cxxtools::LogManager::getInstance().getLogConfiguration();
+      if (cxxtools::FileInfo::exists(_fname))
+        cxxtools::FileInfo(_fname).remove();
+    }
+
+    void tearDown()
+    {
+      cxxtools::LogManager::getInstance().configure(_savedConfiguration);
+      if (cxxtools::FileInfo::exists(_fname))
+        cxxtools::FileInfo(_fname).remove();
+    }
+
+    void textFormat()
+    {
+      configure(cxxtools::LogConfiguration::Text, false);
+      logMessages();
+      checkMessages(readText());
+    }
+
+    void binaryFormat()
+    {
+      configure(cxxtools::LogConfiguration::Binary, false);
+      logMessages();
+      checkMessages(readBinary());
+    }
+
+    void asyncText()
+    {
+      configure(cxxtools::LogConfiguration::Text, true);
+      logMessages();
+      cxxtools::LogManager::getInstance().configure(_savedConfiguration);  // flushes
+      checkMessages(readText());
+    }
+
+    void asyncBinary()
+    {
+      configure(cxxtools::LogConfiguration::Binary, true);
+      logMessages();
+      cxxtools::LogManager::getInstance().configure(_savedConfiguration);
+      checkMessages(readBinary());
+    }
+
+    void reconfigure()
+    {
+      // change the log level every millisecond while 16 threads are logging;
+      // no message of the always enabled level may get lost
+      cxxtools::LogConfiguration config;
+      config.setFile(_fname);
+      config.setLogLevel("cxxtools.test.log", cxxtools::Logger::WARN);
+      cxxtools::LogManager::getInstance().configure(config);
+
+      volatile bool stop = false;
+      std::vector<LogWorker*> workers;
+      std::vector<cxxtools::AttachedThread*> threads;
+      for (unsigned n = 0; n < 16; ++n)
+      {
+        workers.push_back(new LogWorker(stop));
+        threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*workers.back(), &LogWorker::run)));
+        threads.back()->start();
+      }
+
+      for (unsigned n = 0; n < 1000; ++n)
+      {
+        config.setLogLevel("cxxtools.test.log", n % 2 == 0 ? cxxtools::Logger::DEBUG : cxxtools::Logger::WARN);
+        cxxtools::LogManager::getInstance().configure(config);
+        cxxtools::Thread::sleep(cxxtools::Milliseconds(1));
+      }
+
+      stop = true;
+
+      unsigned count = 0;
+      for (unsigned n = 0; n < threads.size(); ++n)
+      {
+        threads[n]->join();
+        delete threads[n];
+        count += workers[n]->count();
+        delete workers[n];
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::LogManager::getInstance().logLevel("cxxtools.test.log"), cxxtools::Logger::WARN);
+
+      cxxtools::LogManager::getInstance().configure(_savedConfiguration);
+
+      std::vector<std::string> m = readText();
+      unsigned warnings = 0;
+      for (unsigned n = 0; n < m.size(); ++n)
+        if (m[n].compare(0, 30, "WARN cxxtools.test.log - warn ") == 0)
+          ++warnings;
+
+      CXXTOOLS_UNIT_ASSERT(count > 0);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(warnings, count);
+    }
+};
+
+cxxtools::unit::RegisterTest<LogTest> register_LogTest;
@@ -28,8 +28,26 @@
 
 #include "cxxtools/lrucache.h"
 #include "cxxtools/unit/testsuite.h"
+#include <string>
 #include "cxxtools/unit/registertest.h"
 
+namespace
+{
+    // key type without hash function and ==-operator
+    struct Name
+    {
+        std::string first;
+        std::string last;
+
+        Name(const std::string& first_, const std::string& last_)
+            : first(first_), last(last_)
+            { }
+
+        bool operator< (const Name& other) const
+        { return last < other.last || (last == other.last && first < other.first); }
+    };
+}
+
 class LruCacheTest : public cxxtools::unit::TestSuite
 {
     public:
@@ -40,6 +58,7 @@ class LruCacheTest : public cxxtools::unit::TestSuite
             registerMethod("erase", *this, &LruCacheTest::erase);
             registerMethod("resize", *this, &LruCacheTest::resize);
             registerMethod("stats", *this, &LruCacheTest::stats);
+            registerMethod("orderedKey", *this, &LruCacheTest::orderedKey);
         }
 
         void cacheTest()
@@ -158,6 +177,23 @@ class LruCacheTest : public cxxtools::unit::TestSuite
           CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getMisses(), 1);
         }
 
+        void orderedKey()
+        {
+          cxxtools::LruCache<Name, int> cache(2);
+
+          cache.put(Name("Tommi", "Maekitalo"), 1);
+          cache.put(Name("Marc", "Maekitalo"), 2);
+          cache.put(Name("Tommi", "Maekitalo"), 1);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 2);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getx(Name("Tommi", "Maekitalo")).second, 1);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getx(Name("Marc", "Maekitalo")).second, 2);
+
+          CXXTOOLS_UNIT_ASSERT(cache.erase(Name("Marc", "Maekitalo")));
+          CXXTOOLS_UNIT_ASSERT(!cache.getx(Name("Marc", "Maekitalo")).first);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 1);
+        }
+
 };
 
 cxxtools::unit::RegisterTest<LruCacheTest> register_LruCacheTest;
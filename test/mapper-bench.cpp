@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include "http/mapper.h"
+#include <cxxtools/http/service.h>
+#include <cxxtools/http/responder.h>
+#include <cxxtools/http/request.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Measures the lookup of services in the url mapper of the http server
+// with literal urls, url patterns and regular expressions.
+
+namespace
+{
+    class NullResponder : public cxxtools::http::Responder
+    {
+        public:
+            explicit NullResponder(cxxtools::http::Service& service)
+                : cxxtools::http::Responder(service)
+                { }
+
+            void reply(std::ostream&, cxxtools::http::Request&, cxxtools::http::Reply&)
+                { }
+    };
+
+    class NullService : public cxxtools::http::Service
+    {
+            NullResponder _responder;
+
+        public:
+            NullService()
+                : _responder(*this)
+                { }
+
+        protected:
+            cxxtools::http::Responder* createResponder(const cxxtools::http::Request&)
+                { return &_responder; }
+
+            void releaseResponder(cxxtools::http::Responder*)
+                { }
+    };
+
+    enum Kind
+    {
+        Literal,
+        Pattern,
+        RegularExpression
+    };
+
+    std::string url(unsigned n, Kind kind)
+    {
+        std::ostringstream s;
+        s << "/api/service" << n;
+        if (kind == Pattern)
+            s << "/item/4711";
+        return s.str();
+    }
+
+    void bench(const char* title, unsigned routes, Kind kind, unsigned lookups)
+    {
+        cxxtools::http::Mapper mapper;
+        NullService service;
+
+        for (unsigned n = 0; n < routes; ++n)
+        {
+            std::ostringstream s;
+            switch (kind)
+            {
+                case Literal:
+                    mapper.addService(url(n, kind), service);
+                    break;
+
+                case Pattern:
+                    s << "/api/service" << n << "/item/{id}";
+                    mapper.addService(s.str(), service);
+                    break;
+
+                case RegularExpression:
+                    s << "^/api/service" << n << '$';
+                    mapper.addService(cxxtools::Regex(s.str()), service);
+                    break;
+            }
+        }
+
+        std::vector<std::string> urls;
+        for (unsigned n = 0; n < 1024; ++n)
+            urls.push_back(url(rand() % routes, kind));
+
+        cxxtools::http::Request request;
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned n = 0; n < lookups; ++n)
+        {
+            request.url(urls[n % urls.size()]);
+            cxxtools::http::Responder* responder = mapper.getResponder(request);
+            responder->release();
+        }
+
+        cxxtools::Timespan t = clock.stop();
+
+        std::cout << title << " with " << routes << " routes:\t"
+                  << (t.totalUSecs() * 1000 / lookups) << " nsecs per lookup" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> lookups(argc, argv, 'n', 100000);
+
+        std::cout << "benchmark url mapper with " << lookups.getValue() << " lookups\n\n"
+                     "options:\n"
+                     "   -n <number>       specify number of lookups\n" << std::endl;
+
+        static const unsigned routes[] = { 10, 100, 1000 };
+        for (unsigned n = 0; n < sizeof(routes) / sizeof(routes[0]); ++n)
+        {
+            bench("literal", routes[n], Literal, lookups);
+            bench("pattern", routes[n], Pattern, lookups);
+            bench("regex", routes[n], RegularExpression, lookups);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
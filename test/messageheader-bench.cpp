@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <cxxtools/http/messageheader.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Measures header lookups in messages with a typical number of header
+// fields. The lookups with the header index of MessageHeader are compared
+// to a linear search over all fields.
+
+namespace
+{
+    const char* wellKnown[] = {
+        "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+        "Referer", "Cookie", "Connection", "Cache-Control", "If-Modified-Since",
+        "If-None-Match", "Content-Type", "Content-Length", "Authorization"
+    };
+
+    const unsigned wellKnownCount = sizeof(wellKnown) / sizeof(wellKnown[0]);
+
+    // the keys, which the server looks up for each request
+    const char* lookups[] = {
+        "Content-Length", "Connection", "Keep-Alive", "Authorization",
+        "Content-Type", "Transfer-Encoding", "Host", "If-None-Match"
+    };
+
+    const unsigned lookupCount = sizeof(lookups) / sizeof(lookups[0]);
+
+    const char* linearGetHeader(const cxxtools::http::MessageHeader& header, const char* key)
+    {
+        for (cxxtools::http::MessageHeader::const_iterator it = header.begin(); it != header.end(); ++it)
+            if (strcasecmp(key, it->first) == 0)
+                return it->second;
+        return 0;
+    }
+
+    void bench(unsigned fields, unsigned rounds)
+    {
+        cxxtools::http::MessageHeader header;
+        for (unsigned n = 0; n < fields; ++n)
+        {
+            if (n < wellKnownCount)
+                header.addHeader(wellKnown[n], "some value");
+            else
+            {
+                std::ostringstream k;
+                k << "X-Custom-Header-" << n;
+                header.addHeader(k.str().c_str(), "some value");
+            }
+        }
+
+        unsigned found = 0;
+
+        cxxtools::Clock clock;
+        clock.start();
+        for (unsigned r = 0; r < rounds; ++r)
+            for (unsigned n = 0; n < lookupCount; ++n)
+                if (header.getHeader(lookups[n]))
+                    ++found;
+        cxxtools::Timespan ti = clock.stop();
+
+        clock.start();
+        for (unsigned r = 0; r < rounds; ++r)
+            for (unsigned n = 0; n < lookupCount; ++n)
+                if (linearGetHeader(header, lookups[n]))
+                    ++found;
+        cxxtools::Timespan tl = clock.stop();
+
+        std::cout << fields << " fields:\n"
+                     "\tindexed: " << (ti.totalUSecs() * 1000 / rounds / lookupCount) << " nsecs per lookup\n"
+                     "\tlinear:  " << (tl.totalUSecs() * 1000 / rounds / lookupCount) << " nsecs per lookup\n"
+                     "\t(" << found << " found)" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> rounds(argc, argv, 'n', 200000);
+
+        std::cout << "benchmark http header lookups, " << rounds.getValue() << " rounds\n\n"
+                     "options:\n"
+                     "   -n <number>       specify number of rounds\n" << std::endl;
+
+        bench(10, rounds);
+        bench(20, rounds);
+        bench(40, rounds);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cxxtools/http/server.h>
+#include <cxxtools/http/client.h>
+#include <cxxtools/http/service.h>
+#include <cxxtools/http/responder.h>
+#include <cxxtools/http/request.h>
+#include <cxxtools/http/reply.h>
+#include <cxxtools/net/tcpserver.h>
+#include <cxxtools/net/tcpsocket.h>
+#include <cxxtools/eventloop.h>
+#include <cxxtools/thread.h>
+#include <cxxtools/queue.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+#include <sys/socket.h>
+
+// Compares sequential requests with pipelined requests over a link with
+// latency. The latency is simulated by a proxy, which delays all data
+// passing through it.
+
+namespace
+{
+    class HelloResponder : public cxxtools::http::Responder
+    {
+        public:
+            explicit HelloResponder(cxxtools::http::Service& service)
+                : cxxtools::http::Responder(service)
+                { }
+
+            void reply(std::ostream& out, cxxtools::http::Request& request, cxxtools::http::Reply& reply)
+            {
+                out << "Hello World!";
+            }
+    };
+
+    typedef cxxtools::http::CachedService<HelloResponder> HelloService;
+
+    struct Chunk
+    {
+        cxxtools::Timespan due;
+        std::string data;
+    };
+
+    // One direction of a proxied connection. The reader passes the data
+    // with a due time to the writer, so that chunks are delayed but not
+    // serialized by the latency.
+    class Link
+    {
+            cxxtools::net::TcpSocket& _in;
+            cxxtools::net::TcpSocket& _out;
+            cxxtools::Milliseconds _latency;
+            cxxtools::Queue<Chunk> _queue;
+
+        public:
+            Link(cxxtools::net::TcpSocket& in, cxxtools::net::TcpSocket& out, cxxtools::Milliseconds latency)
+                : _in(in),
+                  _out(out),
+                  _latency(latency)
+            { }
+
+            void read()
+            {
+                char buffer[8192];
+                Chunk chunk;
+                try
+                {
+                    std::size_t n;
+                    while ((n = _in.read(buffer, sizeof(buffer))) > 0)
+                    {
+                        chunk.due = cxxtools::Clock::getSystemTicks() + _latency;
+                        chunk.data.assign(buffer, n);
+                        _queue.put(chunk);
+                    }
+                }
+                catch (const std::exception&)
+                {
+                }
+
+                chunk.data.clear();
+                _queue.put(chunk);
+            }
+
+            void write()
+            {
+                try
+                {
+                    while (true)
+                    {
+                        Chunk chunk = _queue.get();
+                        if (chunk.data.empty())
+                            break;
+
+                        cxxtools::Timespan now = cxxtools::Clock::getSystemTicks();
+                        if (chunk.due > now)
+                            cxxtools::Thread::sleep(chunk.due - now);
+
+                        for (std::size_t n = 0; n < chunk.data.size(); )
+                            n += _out.write(chunk.data.data() + n, chunk.data.size() - n);
+                    }
+                }
+                catch (const std::exception&)
+                {
+                }
+
+                ::shutdown(_out.getFd(), SHUT_WR);
+            }
+    };
+
+    class Pump : public cxxtools::DetachedThread
+    {
+            Link& _link;
+            bool _reader;
+
+        public:
+            Pump(Link& link, bool reader)
+                : _link(link),
+                  _reader(reader)
+            { }
+
+        protected:
+            void run()
+            {
+                if (_reader)
+                    _link.read();
+                else
+                    _link.write();
+            }
+    };
+
+    // Accepts connections and forwards them to the server. The objects of
+    // the connections are not released; the proxy runs until the program
+    // exits.
+    class Proxy : public cxxtools::DetachedThread
+    {
+            cxxtools::net::TcpServer _server;
+            unsigned short _serverPort;
+            cxxtools::Milliseconds _latency;
+
+            void startLink(cxxtools::net::TcpSocket& in, cxxtools::net::TcpSocket& out)
+            {
+                Link* link = new Link(in, out, _latency);
+                (new Pump(*link, true))->start();
+                (new Pump(*link, false))->start();
+            }
+
+        public:
+            Proxy(unsigned short port, unsigned short serverPort, cxxtools::Milliseconds latency)
+                : _server("", port),
+                  _serverPort(serverPort),
+                  _latency(latency)
+            { }
+
+        protected:
+            void run()
+            {
+                while (true)
+                {
+                    cxxtools::net::TcpSocket* client = new cxxtools::net::TcpSocket(_server);
+                    cxxtools::net::TcpSocket* server = new cxxtools::net::TcpSocket("127.0.0.1", _serverPort);
+                    startLink(*client, *server);
+                    startLink(*server, *client);
+                }
+            }
+    };
+
+    void report(const char* title, unsigned requests, const cxxtools::Timespan& t)
+    {
+        std::cout << title << ":\n"
+                     "\ttime: " << t << " sec\n"
+                     "\trequests per second: " << (requests / t.totalSeconds()) << "\n"
+                     "\tmsecs per request: " << (t.totalMSecs() / requests) << std::endl;
+    }
+
+    unsigned replies;
+
+    void onReply(cxxtools::http::Client& client)
+    {
+        if (client.readBody() != "Hello World!")
+            throw std::runtime_error("unexpected reply");
+        ++replies;
+    }
+
+    void benchSequential(unsigned short port, unsigned requests)
+    {
+        cxxtools::http::Client client("", port);
+        client.get("/hello");
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned n = 0; n < requests; ++n)
+            if (client.get("/hello") != "Hello World!")
+                throw std::runtime_error("unexpected reply");
+
+        report("sequential", requests, clock.stop());
+    }
+
+    void benchPipelined(unsigned short port, unsigned requests, unsigned depth)
+    {
+        cxxtools::http::Client client("", port);
+        client.get("/hello");
+        client.pipelineDepth(depth);
+
+        std::vector<cxxtools::http::Request*> r;
+        for (unsigned n = 0; n < requests; ++n)
+            r.push_back(new cxxtools::http::Request("/hello"));
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        replies = 0;
+        for (unsigned n = 0; n < requests; ++n)
+            client.pipelineRequest(*r[n], cxxtools::callable(onReply));
+        client.executePipeline();
+
+        std::ostringstream title;
+        title << "pipelined (depth " << depth << ')';
+        report(title.str().c_str(), replies, clock.stop());
+
+        for (unsigned n = 0; n < requests; ++n)
+            delete r[n];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> requests(argc, argv, 'n', 200);
+        cxxtools::Arg<unsigned> depth(argc, argv, 'd', 16);
+        cxxtools::Arg<unsigned> latency(argc, argv, 'l', 5);
+        cxxtools::Arg<unsigned short> port(argc, argv, 'p', 8006);
+
+        std::cout << "benchmark " << requests.getValue() << " http requests with "
+                  << latency.getValue() << " ms latency in each direction\n\n"
+                     "options:\n"
+                     "   -n <number>       specify number of requests\n"
+                     "   -d <number>       specify pipeline depth\n"
+                     "   -l <number>       specify latency in ms\n"
+                     "   -p <number>       specify port (port + 1 is used for the proxy)\n" << std::endl;
+
+        cxxtools::EventLoop loop;
+        cxxtools::http::Server server(loop, port);
+
+        HelloService service;
+        server.addService("/hello", service);
+
+        cxxtools::AttachedThread thread(cxxtools::callable(loop, &cxxtools::EventLoop::run));
+        thread.start();
+
+        (new Proxy(port + 1, port, cxxtools::Milliseconds(latency)))->start();
+
+        benchSequential(port + 1, requests);
+        benchPipelined(port + 1, requests, depth);
+
+        loop.exit();
+        thread.join();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
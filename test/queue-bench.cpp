@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <vector>
+#include <cxxtools/queue.h>
+#include <cxxtools/lockfreequeue.h>
+#include <cxxtools/thread.h>
+#include <cxxtools/atomicity.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+
+// Compares Queue with LockFreeQueue. Each producer puts its share of the
+// elements and each consumer gets its share, so the total number of
+// transferred elements is the same for all numbers of threads. The sum of
+// the received values is checked.
+
+namespace
+{
+    template <typename QueueType>
+    class Bench
+    {
+            QueueType& _queue;
+            unsigned _perThread;
+            cxxtools::atomic_t _sum;
+
+            void produce()
+            {
+                for (unsigned n = 1; n <= _perThread; ++n)
+                    _queue.put(n);
+            }
+
+            void consume()
+            {
+                cxxtools::atomic_t sum = 0;
+                for (unsigned n = 0; n < _perThread; ++n)
+                    sum += _queue.get();
+                cxxtools::atomicExchangeAdd(_sum, sum);
+            }
+
+        public:
+            Bench(QueueType& queue, unsigned perThread)
+                : _queue(queue),
+                  _perThread(perThread),
+                  _sum(0)
+                { }
+
+            cxxtools::Timespan run(unsigned threads)
+            {
+                std::vector<cxxtools::AttachedThread*> t;
+
+                cxxtools::Clock clock;
+                clock.start();
+
+                for (unsigned n = 0; n < threads; ++n)
+                {
+                    t.push_back(new cxxtools::AttachedThread(cxxtools::callable(*this, &Bench::consume)));
+                    t.back()->start();
+                    t.push_back(new cxxtools::AttachedThread(cxxtools::callable(*this, &Bench::produce)));
+                    t.back()->start();
+                }
+
+                for (unsigned n = 0; n < t.size(); ++n)
+                {
+                    t[n]->join();
+                    delete t[n];
+                }
+
+                cxxtools::Timespan ret = clock.stop();
+
+                cxxtools::atomic_t expected = static_cast<cxxtools::atomic_t>(threads) * _perThread * (_perThread + 1) / 2;
+                if (_sum != expected)
+                    std::cerr << "error: sum of received values " << _sum << " expected " << expected << std::endl;
+
+                return ret;
+            }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        cxxtools::Arg<unsigned> count(argc, argv, 'n', 1000000);
+        cxxtools::Arg<unsigned> capacity(argc, argv, 'c', 1024);
+        cxxtools::Arg<unsigned> maxThreads(argc, argv, 't', 64);
+
+        std::cout << "benchmark queues with " << count.getValue() << " elements\n\n"
+                     "options:\n"
+                     "   -n <number>       number of elements\n"
+                     "   -c <number>       capacity of the queues\n"
+                     "   -t <number>       maximum number of producers and consumers\n" << std::endl;
+
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            unsigned perThread = count / threads;
+
+            cxxtools::Queue<unsigned> queue;
+            queue.maxSize(capacity);
+            cxxtools::Timespan tq = Bench<cxxtools::Queue<unsigned> >(queue, perThread).run(threads);
+
+            cxxtools::LockFreeQueue<unsigned> lfqueue(capacity);
+            cxxtools::Timespan tl = Bench<cxxtools::LockFreeQueue<unsigned> >(lfqueue, perThread).run(threads);
+
+            unsigned total = perThread * threads;
+            std::cout << threads << " producers/consumers:\t"
+                         "Queue " << (tq.totalUSecs() * 1000 / total) << " nsec/element\t"
+                         "LockFreeQueue " << (tl.totalUSecs() * 1000 / total) << " nsec/element" << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
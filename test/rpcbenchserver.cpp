@@ -28,8 +28,10 @@
 
 #include <iostream>
 #include <vector>
+#include <map>
 #include <cxxtools/log.h>
 #include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
 #include <cxxtools/eventloop.h>
 #include <cxxtools/http/server.h>
 #include <cxxtools/xmlrpc/service.h>
@@ -50,6 +52,53 @@ std::vector<int> seq(int from, int to)
     return ret;
 }
 
+// Measures the overhead of looking up a procedure for a call. The first
+// variant looks up the procedure in a std::map and clones it for each call
+// as the registry did before instances were pooled; the second uses
+// getProcedure and releaseProcedure, which reuse the instance.
+void benchDispatch(unsigned count)
+{
+  static const char* names[] = { "echo", "seq", "add", "sub", "multiply",
+    "divide", "getUser", "setUser", "listUsers", "deleteUser" };
+  const unsigned numNames = sizeof(names) / sizeof(names[0]);
+
+  cxxtools::xmlrpc::Service registry;
+  std::map<std::string, cxxtools::ServiceProcedure*> procedures;
+  for (unsigned n = 0; n < numNames; ++n)
+  {
+    registry.registerFunction(names[n], echo);
+    procedures[names[n]] = registry.getProcedure(names[n]);
+  }
+
+  std::string name = "echo";
+  cxxtools::Clock clock;
+
+  clock.start();
+  for (unsigned n = 0; n < count; ++n)
+  {
+    cxxtools::ServiceProcedure* proc = procedures.find(name)->second->clone();
+    proc->beginCall();
+    delete proc;
+  }
+  cxxtools::Timespan tclone = clock.stop();
+
+  clock.start();
+  for (unsigned n = 0; n < count; ++n)
+  {
+    cxxtools::ServiceProcedure* proc = registry.getProcedure(name);
+    proc->beginCall();
+    registry.releaseProcedure(proc);
+  }
+  cxxtools::Timespan tpool = clock.stop();
+
+  for (unsigned n = 0; n < numNames; ++n)
+    registry.releaseProcedure(procedures[names[n]]);
+
+  std::cout << "dispatch " << count << " calls\n"
+               "\tmap lookup and clone: " << (tclone.totalUSecs() * 1000 / count) << " nsec/call\n"
+               "\tpooled:               " << (tpool.totalUSecs() * 1000 / count) << " nsec/call" << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
   try
@@ -62,6 +111,7 @@ int main(int argc, char* argv[])
     cxxtools::Arg<unsigned short> jport(argc, argv, 'j', 7004);
     cxxtools::Arg<unsigned> threads(argc, argv, 't', 4);
     cxxtools::Arg<unsigned> maxThreads(argc, argv, 'T', 200);
+    cxxtools::Arg<unsigned> dispatch(argc, argv, 'D', 0);
 
     std::cout << "rpc echo server running on port " << port.getValue() << "\n\n"
                  "options:\n\n"
@@ -71,8 +121,15 @@ int main(int argc, char* argv[])
                  "   -j number  set port number run json rpc server (default: 7004)\n"
                  "   -t number  set minimum number of threads (default: 4)\n"
                  "   -T number  set maximum number of threads (default: 200)\n"
+                 "   -D number  measure procedure dispatch with number calls and exit\n"
               << std::endl;
 
+    if (dispatch.isSet())
+    {
+      benchDispatch(dispatch);
+      return 0;
+    }
+
     cxxtools::EventLoop loop;
 
     cxxtools::http::Server server(loop, ip, port);
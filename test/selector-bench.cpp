@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <cxxtools/selector.h>
+#include <cxxtools/pipe.h>
+#include <cxxtools/connectable.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Measures the cost of a selector wait with many idle and some active
+// devices. The benchmark is run with the poll and the epoll backend of
+// the selector. The backend is chosen by the environment variable
+// CXXTOOLS_SELECTOR.
+
+namespace
+{
+    class Reader : public cxxtools::Connectable
+    {
+            cxxtools::IODevice& _dev;
+            unsigned& _count;
+            char _ch;
+
+        public:
+            Reader(cxxtools::IODevice& dev, unsigned& count)
+                : _dev(dev),
+                  _count(count)
+            {
+                cxxtools::connect(_dev.inputReady, *this, &Reader::onInput);
+                _dev.beginRead(&_ch, 1);
+            }
+
+            void onInput(cxxtools::IODevice&)
+            {
+                _dev.endRead();
+                ++_count;
+                _dev.beginRead(&_ch, 1);
+            }
+    };
+
+    unsigned adjustFileLimit(unsigned pipes)
+    {
+        rlimit rl;
+        getrlimit(RLIMIT_NOFILE, &rl);
+
+        rlim_t needed = 2 * pipes + 16;
+        if (rl.rlim_cur >= needed)
+            return pipes;
+
+        rl.rlim_cur = needed;
+        if (rl.rlim_max < needed)
+            rl.rlim_max = needed;
+
+        if (setrlimit(RLIMIT_NOFILE, &rl) == 0)
+            return pipes;
+
+        getrlimit(RLIMIT_NOFILE, &rl);
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+
+        unsigned maxPipes = (rl.rlim_cur - 16) / 2;
+        std::cerr << "warning: file descriptor limit " << rl.rlim_cur
+                  << " allows only " << maxPipes << " pipes" << std::endl;
+        return maxPipes;
+    }
+
+    void bench(const char* backend, unsigned idle, unsigned active, unsigned rounds)
+    {
+        setenv("CXXTOOLS_SELECTOR", backend, 1);
+
+        cxxtools::Selector selector;
+        std::vector<cxxtools::Pipe*> pipes;
+        std::vector<Reader*> readers;
+        unsigned count = 0;
+
+        for (unsigned n = 0; n < idle + active; ++n)
+        {
+            cxxtools::Pipe* pipe = new cxxtools::Pipe(cxxtools::Pipe::Async);
+            pipes.push_back(pipe);
+            selector.add(pipe->out());
+            readers.push_back(new Reader(pipe->out(), count));
+        }
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            count = 0;
+            for (unsigned n = idle; n < idle + active; ++n)
+                pipes[n]->write('a');
+
+            while (count < active)
+                selector.wait();
+        }
+
+        cxxtools::Timespan t = clock.stop();
+
+        std::cout << backend << ":\n"
+                     "\ttime: " << t << " sec\n"
+                     "\trounds per second: " << (rounds / t.totalSeconds()) << "\n"
+                     "\tusecs per round: " << (t.totalUSecs() / rounds) << std::endl;
+
+        for (unsigned n = 0; n < readers.size(); ++n)
+            delete readers[n];
+        for (unsigned n = 0; n < pipes.size(); ++n)
+            delete pipes[n];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> idle(argc, argv, 'i', 10000);
+        cxxtools::Arg<unsigned> active(argc, argv, 'a', 100);
+        cxxtools::Arg<unsigned> rounds(argc, argv, 'n', 1000);
+
+        std::cout << "benchmark selector with " << idle.getValue() << " idle and "
+                  << active.getValue() << " active devices, " << rounds.getValue() << " rounds\n\n"
+                     "options:\n"
+                     "   -i <number>       specify number of idle devices\n"
+                     "   -a <number>       specify number of active devices\n"
+                     "   -n <number>       specify number of rounds\n" << std::endl;
+
+        unsigned pipes = adjustFileLimit(idle + active);
+        unsigned i = pipes < idle.getValue() + active.getValue() ? pipes - active : idle.getValue();
+
+        bench("poll", i, active, rounds);
+        bench("epoll", i, active, rounds);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
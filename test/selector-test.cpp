@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/selector.h"
+#include "cxxtools/pipe.h"
+#include "cxxtools/connectable.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace
+{
+  struct InputCounter : public cxxtools::Connectable
+  {
+    unsigned count;
+
+    InputCounter()
+      : count(0)
+    { }
+
+    void onInput(cxxtools::IODevice&)
+    { ++count; }
+  };
+}
+
+class SelectorTest : public cxxtools::unit::TestSuite
+{
+    void checkWake()
+    {
+      cxxtools::Selector selector;
+
+      CXXTOOLS_UNIT_ASSERT(!selector.wait(0));
+
+      // wakeups before the selector waits are coalesced
+      for (unsigned n = 0; n < 100; ++n)
+        selector.wake();
+
+      cxxtools::WakeCounters counters = selector.wakeCounters();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(counters.requests, 100);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(counters.syscalls, 1);
+
+      CXXTOOLS_UNIT_ASSERT(selector.wait(1000));
+      CXXTOOLS_UNIT_ASSERT(!selector.wait(0));
+
+      // after the wakeup was processed the next wake needs a system call again
+      selector.wake();
+      selector.wake();
+      counters = selector.wakeCounters();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(counters.requests, 102);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(counters.syscalls, 2);
+
+      CXXTOOLS_UNIT_ASSERT(selector.wait(1000));
+      CXXTOOLS_UNIT_ASSERT(!selector.wait(0));
+    }
+
+  public:
+    SelectorTest()
+      : cxxtools::unit::TestSuite("selector")
+    {
+      registerMethod("wakePoll", *this, &SelectorTest::wakePoll);
+      registerMethod("wakeEpoll", *this, &SelectorTest::wakeEpoll);
+      registerMethod("closeShared", *this, &SelectorTest::closeShared);
+    }
+
+    void wakePoll()
+    {
+      setenv("CXXTOOLS_SELECTOR", "poll", 1);
+      try
+      {
+        checkWake();
+      }
+      catch (...)
+      {
+        unsetenv("CXXTOOLS_SELECTOR");
+        throw;
+      }
+
+      unsetenv("CXXTOOLS_SELECTOR");
+    }
+
+    void wakeEpoll()
+    {
+      checkWake();
+    }
+
+    void closeShared()
+    {
+      cxxtools::Selector selector;
+      char buffer[16];
+
+      // a readable pipe, which is waited for
+      cxxtools::Pipe* p1 = new cxxtools::Pipe(cxxtools::IODevice::Async);
+      selector.add(p1->out());
+      p1->out().beginRead(buffer, sizeof(buffer));
+      selector.wait(0);
+      p1->in().write("x", 1);
+
+      // a child process keeps the descriptors open after they are closed here
+      pid_t pid = ::fork();
+      if (pid == 0)
+      {
+        ::sleep(5);
+        ::_exit(0);
+      }
+
+      CXXTOOLS_UNIT_ASSERT(pid > 0);
+
+      delete p1;
+
+      // the new pipe gets the same descriptor numbers
+      cxxtools::Pipe p2(cxxtools::IODevice::Async);
+      InputCounter counter;
+      cxxtools::connect(p2.out().inputReady, counter, &InputCounter::onInput);
+      selector.add(p2.out());
+      p2.out().beginRead(buffer, sizeof(buffer));
+
+      bool signalled = selector.wait(100);
+
+      ::kill(pid, SIGKILL);
+      ::waitpid(pid, 0, 0);
+
+      CXXTOOLS_UNIT_ASSERT(!signalled);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(counter.count, 0);
+    }
+};
+
+cxxtools::unit::RegisterTest<SelectorTest> register_SelectorTest;
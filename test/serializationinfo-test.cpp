@@ -28,6 +28,10 @@
 
 #include <iostream>
 #include "cxxtools/serializationinfo.h"
+#include "cxxtools/serializationerror.h"
+#include "cxxtools/convert.h"
+#include "cxxtools/typenames.h"
+#include "cxxtools/thread.h"
 #include "cxxtools/unit/testsuite.h"
 #include "cxxtools/unit/registertest.h"
 
@@ -58,6 +62,10 @@ class SerializationInfoTest : public cxxtools::unit::TestSuite
             registerMethod("testSiSwap", *this, &SerializationInfoTest::testSiSwap);
             registerMethod("testStringToBool", *this, &SerializationInfoTest::testStringToBool);
             registerMethod("testRangeCheck", *this, &SerializationInfoTest::testRangeCheck);
+            registerMethod("testSiGrow", *this, &SerializationInfoTest::testSiGrow);
+            registerMethod("testMemberIndex", *this, &SerializationInfoTest::testMemberIndex);
+            registerMethod("testConcurrentLookup", *this, &SerializationInfoTest::testConcurrentLookup);
+            registerMethod("testTypeNames", *this, &SerializationInfoTest::testTypeNames);
         }
 
         void testSiSet()
@@ -441,6 +449,162 @@ class SerializationInfoTest : public cxxtools::unit::TestSuite
             CXXTOOLS_UNIT_ASSERT_NOTHROW(siValue<long>(si));
         }
 
+        void testSiGrow()
+        {
+            cxxtools::SerializationInfo si;
+            for (unsigned n = 0; n < 100; ++n)
+            {
+                cxxtools::SerializationInfo& m = si.addMember("m");
+                m.addMember("string8").setValue(std::string(40, 'a' + n % 26));
+                m.addMember("string").setValue(cxxtools::String(40, L'A' + n % 26));
+                m.addMember("int").setValue(n);
+            }
+
+            // the subnodes survive relocation and point to their moved parents
+            CXXTOOLS_UNIT_ASSERT_EQUALS(si.memberCount(), 100);
+            for (unsigned n = 0; n < 100; ++n)
+            {
+                const cxxtools::SerializationInfo& m = si.getMember(n);
+                CXXTOOLS_UNIT_ASSERT(m.parent() == &si);
+                CXXTOOLS_UNIT_ASSERT(m.getMember(0).parent() == &m);
+                CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<std::string>(m.getMember("string8")), std::string(40, 'a' + n % 26));
+                CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<cxxtools::String>(m.getMember("string")), cxxtools::String(40, L'A' + n % 26));
+                CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(m.getMember("int")), n);
+            }
+
+            cxxtools::SerializationInfo copy(si);
+            CXXTOOLS_UNIT_ASSERT(copy.getMember(7).parent() == &copy);
+            CXXTOOLS_UNIT_ASSERT(copy.getMember(7).getMember(1).parent() == &copy.getMember(7));
+
+            copy.reserve(1000);
+            CXXTOOLS_UNIT_ASSERT(copy.getMember(7).parent() == &copy);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<std::string>(copy.getMember(7).getMember(0)), std::string(40, 'h'));
+        }
+
+        void testMemberIndex()
+        {
+            cxxtools::SerializationInfo si;
+            for (unsigned n = 0; n < 100; ++n)
+                si.addMember("m" + cxxtools::convert<std::string>(n)) <<= n;
+            si.addMember("m17") <<= 1717;
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m0")), 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m99")), 99);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m17")), 17);
+            CXXTOOLS_UNIT_ASSERT(si.findMember("m100") == 0);
+            CXXTOOLS_UNIT_ASSERT_THROW(si.getMember("foo"), cxxtools::SerializationMemberNotFound);
+
+            // members added after the index was built
+            for (unsigned n = 100; n < 1000; ++n)
+                si.addMember("m" + cxxtools::convert<std::string>(n)) <<= n;
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m100")), 100);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m999")), 999);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m17")), 17);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember(100u)), 1717);
+
+            // renamed members
+            si.findMember("m5")->setName("five");
+            CXXTOOLS_UNIT_ASSERT(si.findMember("m5") == 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("five")), 5);
+
+            si.findMember("m17")->setName("m1");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m1")), 1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(si.getMember("m17")), 1717);
+
+            cxxtools::SerializationInfo copy(si);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(copy.getMember("m999")), 999);
+            copy.getMember(0u);
+            copy.findMember("m3")->swap(*copy.findMember("m4"));
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(copy.getMember("m3")), 3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(siValue<unsigned>(copy.getMember(3u)), 4);
+        }
+
+
+        class Lookup
+        {
+                const cxxtools::SerializationInfo& _si;
+                unsigned _found;
+
+            public:
+                explicit Lookup(const cxxtools::SerializationInfo& si)
+                    : _si(si),
+                      _found(0)
+                    { }
+
+                void run()
+                {
+                    for (unsigned n = 0; n < 200; ++n)
+                        if (_si.findMember("m" + cxxtools::convert<std::string>(n)) != 0)
+                            ++_found;
+                }
+
+                unsigned found() const
+                { return _found; }
+        };
+
+        void testConcurrentLookup()
+        {
+            // the index is built by the first lookup, which may happen in
+            // several threads at the same time
+            cxxtools::SerializationInfo si;
+            for (unsigned n = 0; n < 100; ++n)
+                si.addMember("m" + cxxtools::convert<std::string>(n)) <<= n;
+
+            std::vector<Lookup*> lookups;
+            std::vector<cxxtools::AttachedThread*> threads;
+            for (unsigned n = 0; n < 4; ++n)
+            {
+                lookups.push_back(new Lookup(si));
+                threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*lookups.back(), &Lookup::run)));
+            }
+
+            for (unsigned n = 0; n < threads.size(); ++n)
+                threads[n]->start();
+
+            for (unsigned n = 0; n < threads.size(); ++n)
+            {
+                threads[n]->join();
+                CXXTOOLS_UNIT_ASSERT_EQUALS(lookups[n]->found(), 100);
+                delete threads[n];
+                delete lookups[n];
+            }
+        }
+        void testTypeNames()
+        {
+            // predefined names are recognized by address and by content
+            const std::string& array = cxxtools::TypeNames::name(cxxtools::TypeNames::Array);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(array, "array");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::TypeNames::id(array), cxxtools::TypeNames::Array);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::TypeNames::id(std::string("multimap")), cxxtools::TypeNames::Multimap);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::TypeNames::id(std::string()), cxxtools::TypeNames::Empty);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::TypeNames::id(std::string("ints")), cxxtools::TypeNames::Other);
+            CXXTOOLS_UNIT_ASSERT(cxxtools::TypeNames::intern("array") == &array);
+
+            const std::string* myType = cxxtools::TypeNames::intern("MyType");
+            CXXTOOLS_UNIT_ASSERT(myType != 0);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(*myType, "MyType");
+            CXXTOOLS_UNIT_ASSERT(cxxtools::TypeNames::intern(std::string("My") + "Type") == myType);
+
+            cxxtools::SerializationInfo si;
+            CXXTOOLS_UNIT_ASSERT_EQUALS(si.typeName(), "");
+            si <<= 42;
+            CXXTOOLS_UNIT_ASSERT(&si.typeName() == &cxxtools::TypeNames::name(cxxtools::TypeNames::Int));
+
+            si.setTypeName("MyType");
+            CXXTOOLS_UNIT_ASSERT(&si.typeName() == myType);
+
+            // names are still stored when the table is full
+            for (unsigned n = 0; n < 1100; ++n)
+                si.addMember().setTypeName("T" + cxxtools::convert<std::string>(n));
+
+            cxxtools::SerializationInfo copy;
+            copy = si;
+            si.clear();
+            CXXTOOLS_UNIT_ASSERT_EQUALS(si.typeName(), "");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(copy.typeName(), "MyType");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(copy.getMember(1099u).typeName(), "T1099");
+        }
+
 };
 
 cxxtools::unit::RegisterTest<SerializationInfoTest> register_SerializationInfoTest;
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include "cxxtools/serializationwriter.h"
+#include "cxxtools/jsonserializer.h"
+#include "cxxtools/xml/xmlserializer.h"
+#include "cxxtools/bin/serializer.h"
+#include <sstream>
+
+namespace
+{
+    // serialized through the SerializationInfo only
+    struct Legacy
+    {
+        int intValue;
+        std::string stringValue;
+    };
+
+    void operator<<= (cxxtools::SerializationInfo& si, const Legacy& obj)
+    {
+        si.addMember("intValue") <<= obj.intValue;
+        si.addMember("stringValue") <<= obj.stringValue;
+        si.setTypeName("Legacy");
+    }
+
+    // serialized through the SerializationInfo or directly
+    struct Streamed
+    {
+        int intValue;
+        double doubleValue;
+        bool boolValue;
+        std::vector<Legacy> legacy;
+        std::map<std::string, unsigned> counts;
+    };
+
+    void operator<<= (cxxtools::SerializationInfo& si, const Streamed& obj)
+    {
+        si.addMember("intValue") <<= obj.intValue;
+        si.addMember("doubleValue") <<= obj.doubleValue;
+        si.addMember("boolValue") <<= obj.boolValue;
+        si.addMember("legacy") <<= obj.legacy;
+        si.addMember("counts") <<= obj.counts;
+        si.setTypeName("Streamed");
+    }
+
+    void operator<<= (cxxtools::SerializationWriter& w, const Streamed& obj)
+    {
+        w.beginObject("Streamed");
+        w.addMember("intValue", obj.intValue);
+        w.addMember("doubleValue", obj.doubleValue);
+        w.addMember("boolValue", obj.boolValue);
+        w.addMember("legacy", obj.legacy);
+        w.addMember("counts", obj.counts);
+        w.finishObject();
+    }
+
+    Streamed makeStreamed()
+    {
+        Streamed s;
+        s.intValue = -17;
+        s.doubleValue = 2.5;
+        s.boolValue = true;
+
+        Legacy l;
+        l.intValue = 4;
+        l.stringValue = "four";
+        s.legacy.push_back(l);
+        l.intValue = 5;
+        l.stringValue = "five";
+        s.legacy.push_back(l);
+
+        s.counts["a"] = 1;
+        s.counts["b"] = 2;
+        return s;
+    }
+
+    struct Tag
+    {
+        int value;
+    };
+
+    void operator<<= (cxxtools::SerializationInfo& si, const Tag& obj)
+    {
+        si <<= obj.value;
+    }
+
+    // an operator of the application for a specific container type
+    void operator<<= (cxxtools::SerializationInfo& si, const std::vector<Tag>& tags)
+    {
+        si.addMember("count") <<= tags.size();
+        si.setTypeName("Tags");
+    }
+
+    template <typename T>
+    cxxtools::SerializationInfo tree(const T& v)
+    {
+        cxxtools::SerializationInfo si;
+        si <<= v;
+        return si;
+    }
+
+    template <typename T>
+    std::string toJson(const T& v)
+    {
+        std::ostringstream out;
+        cxxtools::JsonSerializer serializer(out);
+        serializer.serialize(v, "value").finish();
+        return out.str();
+    }
+
+    template <typename T>
+    std::string toBin(const T& v)
+    {
+        std::ostringstream out;
+        cxxtools::bin::Serializer serializer(out);
+        serializer.serialize(v, "value").finish();
+        return out.str();
+    }
+}
+
+class SerializationWriterTest : public cxxtools::unit::TestSuite
+{
+    public:
+        SerializationWriterTest()
+            : cxxtools::unit::TestSuite("serializationwriter")
+        {
+            registerMethod("testJson", *this, &SerializationWriterTest::testJson);
+            registerMethod("testXml", *this, &SerializationWriterTest::testXml);
+            registerMethod("testBin", *this, &SerializationWriterTest::testBin);
+            registerMethod("testContainers", *this, &SerializationWriterTest::testContainers);
+        }
+
+        void testJson()
+        {
+            Streamed s = makeStreamed();
+
+            std::string json = toJson(s);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(json, "{\"value\":{"
+                "\"intValue\":-17,"
+                "\"doubleValue\":2.5,"
+                "\"boolValue\":true,"
+                "\"legacy\":[{\"intValue\":4,\"stringValue\":\"four\"},{\"intValue\":5,\"stringValue\":\"five\"}],"
+                "\"counts\":[{\"first\":\"a\",\"second\":1},{\"first\":\"b\",\"second\":2}]"
+                "}}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(json, toJson(tree(s)));
+        }
+
+        void testXml()
+        {
+            Streamed s = makeStreamed();
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(
+                cxxtools::xml::XmlSerializer::toString(s, "value"),
+                cxxtools::xml::XmlSerializer::toString(tree(s), "value"));
+        }
+
+        void testBin()
+        {
+            Streamed s = makeStreamed();
+
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(s), toBin(tree(s)));
+        }
+
+        void testContainers()
+        {
+            std::list<std::string> l;
+            l.push_back("foo");
+            l.push_back("bar");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toJson(l), "{\"value\":[\"foo\",\"bar\"]}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(l), toBin(tree(l)));
+
+            std::set<long> s;
+            s.insert(-3);
+            s.insert(7);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toJson(s), "{\"value\":[-3,7]}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(s), toBin(tree(s)));
+
+            std::pair<unsigned short, const char*> p(42, "answer");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toJson(p), "{\"value\":{\"first\":42,\"second\":\"answer\"}}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(p), toBin(tree(p)));
+
+            std::vector<std::vector<int> > v(2);
+            v[1].push_back(1);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toJson(v), "{\"value\":[[],[1]]}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(v), toBin(tree(v)));
+
+            std::vector<Tag> tags(3);
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toJson(tags), "{\"value\":{\"count\":3}}");
+            CXXTOOLS_UNIT_ASSERT_EQUALS(toBin(tags), toBin(tree(tags)));
+        }
+};
+
+cxxtools::unit::RegisterTest<SerializationWriterTest> register_SerializationWriterTest;
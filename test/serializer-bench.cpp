@@ -28,7 +28,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <new>
 #include <math.h>
+#include <stdlib.h>
 #include <cxxtools/xml/xmlserializer.h>
 #include <cxxtools/xml/xmldeserializer.h>
 #include <cxxtools/jsonserializer.h>
@@ -39,8 +41,39 @@
 #include <cxxtools/clock.h>
 #include <cxxtools/convert.h>
 #include <cxxtools/tee.h>
+#include <cxxtools/textstream.h>
+#include <cxxtools/utf8codec.h>
 #include <cxxtools/log.h>
 
+namespace
+{
+    unsigned long allocations = 0;
+}
+
+// dynamic exception specifications are ill-formed since C++17
+#if __cplusplus >= 201103L
+#  define BENCH_THROW_BAD_ALLOC
+#  define BENCH_NOTHROW noexcept
+#else
+#  define BENCH_THROW_BAD_ALLOC throw (std::bad_alloc)
+#  define BENCH_NOTHROW throw ()
+#endif
+
+// count allocations to see the cost of building SerializationInfo trees
+void* operator new(std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+    ++allocations;
+    void* p = malloc(size);
+    if (p == 0)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) BENCH_NOTHROW
+{
+    free(p);
+}
+
 namespace
 {
     struct TestObject
@@ -68,6 +101,70 @@ namespace
         si.setTypeName("TestObject");
     }
 
+    void operator<<= (cxxtools::SerializationWriter& w, const TestObject& obj)
+    {
+        w.beginObject("TestObject");
+        w.addMember("intValue", obj.intValue);
+        w.addMember("stringValue", obj.stringValue);
+        w.addMember("doubleValue", obj.doubleValue);
+        w.addMember("boolValue", obj.boolValue);
+        w.finishObject();
+    }
+
+    // record of the large json document
+    struct Record
+    {
+        unsigned id;
+        std::string name;
+        cxxtools::String text;
+        double score;
+        std::vector<int> tags;
+        TestObject object;
+    };
+
+    void operator>>= (const cxxtools::SerializationInfo& si, Record& r)
+    {
+        si.getMember("id") >>= r.id;
+        si.getMember("name") >>= r.name;
+        si.getMember("text") >>= r.text;
+        si.getMember("score") >>= r.score;
+        si.getMember("tags") >>= r.tags;
+        si.getMember("object") >>= r.object;
+    }
+
+    void operator<<= (cxxtools::SerializationWriter& w, const Record& r)
+    {
+        w.beginObject("Record");
+        w.addMember("id", r.id);
+        w.addMember("name", r.name);
+        w.addMember("text", r.text);
+        w.addMember("score", r.score);
+        w.addMember("tags", r.tags);
+        w.addMember("object", r.object);
+        w.finishObject();
+    }
+
+    // containers of application types are written directly only with a
+    // writer operator for the container
+    template <typename T>
+    void writeVector(cxxtools::SerializationWriter& w, const std::vector<T>& v)
+    {
+        w.beginArray(cxxtools::TypeNames::name(cxxtools::TypeNames::Array));
+        for (typename std::vector<T>::const_iterator it = v.begin(); it != v.end(); ++it)
+            w.addElement(*it);
+        w.finishArray();
+    }
+
+    void operator<<= (cxxtools::SerializationWriter& w, const std::vector<TestObject>& v)
+    {
+        writeVector(w, v);
+    }
+
+    void operator<<= (cxxtools::SerializationWriter& w, const std::vector<Record>& v)
+    {
+        writeVector(w, v);
+    }
+
     class JsonSerializer2 : public cxxtools::JsonSerializer
     {
         public:
@@ -88,21 +185,49 @@ namespace
                 cxxtools::JsonSerializer::serialize(v);
                 return *this;
             }
+
+            JsonSerializer2& serialize(cxxtools::SerializationInfo& si, const std::string& name)
+            {
+                si.setName(std::string());
+                cxxtools::JsonSerializer::serialize(si);
+                return *this;
+            }
     };
 }
 
 template <typename T, typename Serializer, typename Deserializer>
 void benchSerialization(const T& d, const char* fname = 0)
 {
+    cxxtools::Clock clock;
+
+    // serialize through a SerializationInfo tree first
+    {
+        std::stringstream data;
+        Serializer serializer(data);
+
+        unsigned long a = allocations;
+        clock.start();
+        cxxtools::SerializationInfo si;
+        si.setName("d");
+        si <<= d;
+        serializer.serialize(si, "d");
+        serializer.finish();
+        cxxtools::Timespan ts = clock.stop();
+        a = allocations - a;
+
+        std::cout << "\tserialization through tree: " << ts << " sec, " << a << " allocations" << std::endl;
+    }
+
     std::stringstream data;
     Serializer serializer(data);
     Deserializer deserializer(data);
 
-    cxxtools::Clock clock;
+    unsigned long as = allocations;
     clock.start();
     serializer.serialize(d, "d");
     serializer.finish();
     cxxtools::Timespan ts = clock.stop();
+    as = allocations - as;
     if (fname)
     {
         std::ofstream f(fname);
@@ -110,12 +235,14 @@ void benchSerialization(const T& d, const char* fname = 0)
     }
 
     T v2;
+    unsigned long ad = allocations;
     clock.start();
     deserializer.deserialize(v2);
     cxxtools::Timespan td = clock.stop();
+    ad = allocations - ad;
 
-    std::cout << "\tserialization: " << ts << " sec\n"
-                 "\tdeserialization: " << td << " sec\n"
+    std::cout << "\tstreaming serialization: " << ts << " sec, " << as << " allocations\n"
+                 "\tdeserialization: " << td << " sec, " << ad << " allocations\n"
                  "\tsize: " << data.str().size() << " bytes" << std::endl;
 }
 
@@ -137,6 +264,63 @@ void benchBinSerialization(const T& d, const char* fname = 0)
     benchSerialization<T, cxxtools::bin::Serializer, cxxtools::bin::Deserializer>(d, fname);
 }
 
+// Reads a large beautified json document once with the utf-8 byte parser
+// and once decoded to cxxtools::Char with the JsonParser.
+void benchLargeJson(unsigned N)
+{
+    std::cout << "large json document with " << N << " records:" << std::endl;
+
+    std::vector<Record> v(N);
+    for (unsigned n = 0; n < N; ++n)
+    {
+        Record& r = v[n];
+        r.id = n;
+        r.name = "record " + cxxtools::convert<std::string>(n);
+        r.text = cxxtools::Utf8Codec::decode("Gr\xc3\xbc\xc3\x9f" "e, \"quoted\" text\nwith a second line and some more words");
+        r.score = sqrt(static_cast<double>(n));
+        for (unsigned t = 0; t < 5; ++t)
+            r.tags.push_back(n + t);
+        r.object.intValue = n;
+        r.object.stringValue = "foo bar baz";
+        r.object.doubleValue = n * 0.5;
+        r.object.boolValue = n & 1;
+    }
+
+    std::ostringstream out;
+    cxxtools::JsonSerializer serializer(out);
+    serializer.beautify(true);
+    serializer.serialize(v);
+    serializer.finish();
+    std::string doc = out.str();
+    double mb = doc.size() / 1048576.0;
+
+    cxxtools::Clock clock;
+
+    std::istringstream in1(doc);
+    cxxtools::JsonDeserializer d1(in1);
+    clock.start();
+    d1.deserialize();
+    cxxtools::Timespan t1 = clock.stop();
+
+    std::istringstream in2(doc);
+    cxxtools::TextIStream ts(in2, new cxxtools::Utf8Codec());
+    cxxtools::JsonDeserializer d2(ts);
+    clock.start();
+    d2.deserialize();
+    cxxtools::Timespan t2 = clock.stop();
+
+    std::vector<Record> v2;
+    clock.start();
+    *d1.si() >>= v2;
+    cxxtools::Timespan tc = clock.stop();
+
+    std::cout << "\tsize: " << doc.size() << " bytes\n"
+                 "\tutf-8 byte parser: " << t1 << " sec, " << (mb / t1.totalSeconds()) << " MB/s\n"
+                 "\tcharacter parser: " << t2 << " sec, " << (mb / t2.totalSeconds()) << " MB/s\n"
+                 "\tspeedup: " << (t2.totalSeconds() / t1.totalSeconds()) << "\n"
+                 "\tconversion to objects: " << tc << " sec" << std::endl;
+}
+
 template <typename T>
 void benchVector(const char* typeName, unsigned N, T increment, bool fileoutput)
 {
@@ -167,14 +351,16 @@ int main(int argc, char* argv[])
         cxxtools::Arg<unsigned> I(argc, argv, 'I', nn);
         cxxtools::Arg<unsigned> D(argc, argv, 'D', nn);
         cxxtools::Arg<unsigned> C(argc, argv, 'C', nn);
+        cxxtools::Arg<unsigned> L(argc, argv, 'L', nn);
         cxxtools::Arg<bool> fileoutput(argc, argv, 'f');
 
-        std::cout << "benchmark serializer with " << I.getValue() << " int vector " << D.getValue() << " double vector and " << C.getValue() << " custom vector iterations\n\n"
+        std::cout << "benchmark serializer with " << I.getValue() << " int vector " << D.getValue() << " double vector and " << C.getValue() << " custom vector iterations and a json document with " << L.getValue() << " records\n\n"
                      "options:\n"
                      "   -n <number>       specify number of default iterations\n"
                      "   -I <number>       specify number of iterations for int vector\n"
                      "   -D <number>       specify number of iterations for double vector\n"
                      "   -C <number>       specify number of iterations for custom object\n"
+                     "   -L <number>       specify number of records in large json document\n"
                      "   -f                write serialized output to files\n" << std::endl;
 
         if (I.getValue() > 0)
@@ -208,6 +394,9 @@ int main(int argc, char* argv[])
             benchBinSerialization(v, fileoutput ? "custobject.bin" : 0);
         }
 
+        if (L.getValue() > 0)
+            benchLargeJson(L);
+
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "cxxtools/shardedlrucache.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <vector>
+
+namespace
+{
+  // a key type with the <-operator only, no hash function
+  struct Name
+  {
+    int id;
+
+    explicit Name(int id_ = 0)
+      : id(id_)
+      { }
+
+    bool operator< (const Name& other) const
+    { return id < other.id; }
+  };
+}
+
+class ShardedLruCacheTest : public cxxtools::unit::TestSuite
+{
+        cxxtools::ShardedLruCache<int, int>* _cache;
+        bool _fail;
+
+        void worker()
+        {
+          for (int n = 0; n < 20000; ++n)
+          {
+            int key = n % 500;
+            std::pair<bool, int> result = _cache->getx(key);
+            if (result.first && result.second != key * 10)
+              _fail = true;
+            _cache->put(key, key * 10);
+            if (n % 7 == 0)
+              _cache->erase(key);
+          }
+        }
+
+    public:
+        ShardedLruCacheTest()
+        : cxxtools::unit::TestSuite("shardedlrucache")
+        {
+            registerMethod("cacheTest", *this, &ShardedLruCacheTest::cacheTest);
+            registerMethod("stats", *this, &ShardedLruCacheTest::stats);
+            registerMethod("sampling", *this, &ShardedLruCacheTest::sampling);
+            registerMethod("threads", *this, &ShardedLruCacheTest::threads);
+            registerMethod("orderedKey", *this, &ShardedLruCacheTest::orderedKey);
+        }
+
+        void cacheTest()
+        {
+          // a single shard behaves like a LruCache
+          cxxtools::ShardedLruCache<int, int> cache(6, 1);
+
+          cache.put(1, 10);
+          cache.put(2, 20);
+          cache.put(3, 30);
+          cache.put(4, 40);
+          cache.put(5, 50);
+          cache.put(6, 60);
+          cache.put(7, 70);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 6);
+          CXXTOOLS_UNIT_ASSERT(!cache.getx(1).first);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.get(2), 20);
+
+          cache.put(8, 80);
+          CXXTOOLS_UNIT_ASSERT(cache.getx(2).first);
+          CXXTOOLS_UNIT_ASSERT(!cache.getx(3).first);
+
+          CXXTOOLS_UNIT_ASSERT(cache.erase(2));
+          CXXTOOLS_UNIT_ASSERT(!cache.erase(2));
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 5);
+        }
+
+        void stats()
+        {
+          cxxtools::ShardedLruCache<int, int> cache(100, 4);
+
+          for (int n = 0; n < 10; ++n)
+            cache.put(n, n);
+
+          for (int n = 0; n < 15; ++n)
+            cache.getx(n);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.shards(), 4);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getHits(), 10);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getMisses(), 5);
+
+          unsigned hits = 0;
+          unsigned misses = 0;
+          for (unsigned n = 0; n < cache.shards(); ++n)
+          {
+            hits += cache.getHits(n);
+            misses += cache.getMisses(n);
+          }
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(hits, 10);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(misses, 5);
+
+          cache.clear(true);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 0);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getHits(), 0);
+        }
+
+        void sampling()
+        {
+          cxxtools::ShardedLruCache<int, int> cache(100, 4, 8);
+
+          for (int n = 0; n < 10; ++n)
+            cache.put(n, n);
+
+          for (int r = 0; r < 10; ++r)
+            for (int n = 0; n < 15; ++n)
+              cache.getx(n);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getHits(), 100);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getMisses(), 50);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.get(3), 3);
+        }
+
+        void threads()
+        {
+          cxxtools::ShardedLruCache<int, int> cache(200, 8, 4);
+          _cache = &cache;
+          _fail = false;
+
+          std::vector<cxxtools::AttachedThread*> threads;
+          for (unsigned n = 0; n < 8; ++n)
+          {
+            threads.push_back(new cxxtools::AttachedThread(cxxtools::callable(*this, &ShardedLruCacheTest::worker)));
+            threads.back()->start();
+          }
+
+          for (unsigned n = 0; n < threads.size(); ++n)
+          {
+            threads[n]->join();
+            delete threads[n];
+          }
+
+          CXXTOOLS_UNIT_ASSERT(!_fail);
+          CXXTOOLS_UNIT_ASSERT(cache.size() <= cache.getMaxElements());
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getHits() + cache.getMisses(), 8 * 20000);
+        }
+
+        void orderedKey()
+        {
+          // all keys would go to the same shard; the capacity is not reduced
+          cxxtools::ShardedLruCache<Name, int> cache(100, 16);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.shards(), 1);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getMaxElements(), 100);
+
+          for (int n = 0; n < 100; ++n)
+            cache.put(Name(n), n);
+
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 100);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.get(Name(0)), 0);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.get(Name(99)), 99);
+
+          cache.put(Name(100), 100);
+          CXXTOOLS_UNIT_ASSERT_EQUALS(cache.size(), 100);
+          CXXTOOLS_UNIT_ASSERT(!cache.getx(Name(1)).first);
+        }
+};
+
+cxxtools::unit::RegisterTest<ShardedLruCacheTest> register_ShardedLruCacheTest;
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <iostream>
+#include <cxxtools/threadpool.h>
+#include <cxxtools/atomicity.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Compares the shared queue and the work stealing mode of the thread pool.
+// The first benchmark schedules many tiny tasks from the main thread, the
+// second runs a recursive fork/join computation, where every task schedules
+// its subtasks from a pool thread.
+
+namespace
+{
+    // counts outstanding tasks and wakes up the main thread, when all are done
+    class Latch
+    {
+            volatile cxxtools::atomic_t _count;
+            cxxtools::Mutex _mutex;
+            cxxtools::Condition _done;
+
+        public:
+            explicit Latch(cxxtools::atomic_t count = 0)
+                : _count(count)
+            { }
+
+            void add()
+            { cxxtools::atomicIncrement(_count); }
+
+            void countDown()
+            {
+                if (cxxtools::atomicDecrement(_count) == 0)
+                {
+                    cxxtools::MutexLock lock(_mutex);
+                    _done.broadcast();
+                }
+            }
+
+            void wait()
+            {
+                cxxtools::MutexLock lock(_mutex);
+                while (cxxtools::atomicGet(_count) > 0)
+                    _done.wait(lock);
+            }
+    };
+
+    class TinyTask : public cxxtools::Callable<void>
+    {
+            Latch* _latch;
+
+        public:
+            explicit TinyTask(Latch& latch)
+                : _latch(&latch)
+            { }
+
+            void operator()() const
+            { _latch->countDown(); }
+
+            TinyTask* clone() const
+            { return new TinyTask(*this); }
+    };
+
+    class FibTask : public cxxtools::Callable<void>
+    {
+            cxxtools::ThreadPool* _pool;
+            Latch* _latch;
+            unsigned _n;
+
+        public:
+            FibTask(cxxtools::ThreadPool& pool, Latch& latch, unsigned n)
+                : _pool(&pool),
+                  _latch(&latch),
+                  _n(n)
+            { }
+
+            void operator()() const
+            {
+                if (_n >= 2)
+                {
+                    _latch->add();
+                    _pool->schedule(FibTask(*_pool, *_latch, _n - 1));
+                    _latch->add();
+                    _pool->schedule(FibTask(*_pool, *_latch, _n - 2));
+                }
+
+                _latch->countDown();
+            }
+
+            FibTask* clone() const
+            { return new FibTask(*this); }
+    };
+
+    unsigned long fibTasks(unsigned n)
+    {
+        return n < 2 ? 1 : 1 + fibTasks(n - 1) + fibTasks(n - 2);
+    }
+
+    const char* modeName(cxxtools::ThreadPool::Mode mode)
+    {
+        return mode == cxxtools::ThreadPool::WorkStealing ? "work stealing" : "shared queue";
+    }
+
+    void report(const char* name, cxxtools::ThreadPool::Mode mode, unsigned long tasks, cxxtools::Timespan t)
+    {
+        std::cout << name << " (" << modeName(mode) << "):\n"
+                     "\ttime: " << t << " sec\n"
+                     "\ttasks per second: " << (tasks / t.totalSeconds()) << "\n"
+                     "\tnsecs per task: " << (t.totalUSecs() * 1000.0 / tasks) << std::endl;
+    }
+
+    void benchTiny(cxxtools::ThreadPool::Mode mode, unsigned threads, unsigned tasks)
+    {
+        cxxtools::ThreadPool pool(threads, mode);
+        Latch latch(tasks);
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        for (unsigned n = 0; n < tasks; ++n)
+            pool.schedule(TinyTask(latch));
+
+        latch.wait();
+
+        report("tiny tasks", mode, tasks, clock.stop());
+    }
+
+    void benchFib(cxxtools::ThreadPool::Mode mode, unsigned threads, unsigned n)
+    {
+        cxxtools::ThreadPool pool(threads, mode);
+        Latch latch(1);
+
+        cxxtools::Clock clock;
+        clock.start();
+
+        pool.schedule(FibTask(pool, latch, n));
+        latch.wait();
+
+        report("fork/join", mode, fibTasks(n), clock.stop());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> threads(argc, argv, 't', 4);
+        cxxtools::Arg<unsigned> tasks(argc, argv, 'n', 1000000);
+        cxxtools::Arg<unsigned> fib(argc, argv, 'f', 25);
+
+        std::cout << "benchmark thread pool with " << threads.getValue() << " threads\n\n"
+                     "options:\n"
+                     "   -t <number>       specify number of threads\n"
+                     "   -n <number>       specify number of tiny tasks\n"
+                     "   -f <number>       specify depth of fork/join recursion\n" << std::endl;
+
+        benchTiny(cxxtools::ThreadPool::SharedQueue, threads, tasks);
+        benchTiny(cxxtools::ThreadPool::WorkStealing, threads, tasks);
+
+        benchFib(cxxtools::ThreadPool::SharedQueue, threads, fib);
+        benchFib(cxxtools::ThreadPool::WorkStealing, threads, fib);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
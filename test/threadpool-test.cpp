@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/threadpool.h"
+#include "cxxtools/atomicity.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+
+namespace
+{
+  class CountTask : public cxxtools::Callable<void>
+  {
+      volatile cxxtools::atomic_t* _count;
+
+    public:
+      explicit CountTask(volatile cxxtools::atomic_t& count)
+        : _count(&count)
+      { }
+
+      void operator()() const
+      { cxxtools::atomicIncrement(*_count); }
+
+      CountTask* clone() const
+      { return new CountTask(*this); }
+  };
+
+  class TreeTask : public cxxtools::Callable<void>
+  {
+      cxxtools::ThreadPool* _pool;
+      volatile cxxtools::atomic_t* _count;
+      unsigned _depth;
+
+    public:
+      TreeTask(cxxtools::ThreadPool& pool, volatile cxxtools::atomic_t& count, unsigned depth)
+        : _pool(&pool),
+          _count(&count),
+          _depth(depth)
+      { }
+
+      void operator()() const
+      {
+        cxxtools::atomicIncrement(*_count);
+        if (_depth > 0)
+        {
+          _pool->schedule(TreeTask(*_pool, *_count, _depth - 1));
+          _pool->schedule(TreeTask(*_pool, *_count, _depth - 1));
+        }
+      }
+
+      TreeTask* clone() const
+      { return new TreeTask(*this); }
+  };
+}
+
+class ThreadPoolTest : public cxxtools::unit::TestSuite
+{
+    void runTasks(cxxtools::ThreadPool::Mode mode)
+    {
+      volatile cxxtools::atomic_t count = 0;
+
+      {
+        cxxtools::ThreadPool pool(4, mode);
+        CXXTOOLS_UNIT_ASSERT(pool.running());
+        CXXTOOLS_UNIT_ASSERT_EQUALS(pool.mode(), mode);
+
+        for (unsigned n = 0; n < 1000; ++n)
+          pool.schedule(CountTask(count));
+
+        // clone path
+        for (unsigned n = 0; n < 1000; ++n)
+          pool.schedule(static_cast<const cxxtools::Callable<void>&>(CountTask(count)));
+
+        pool.stop();
+        CXXTOOLS_UNIT_ASSERT(pool.stopped());
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::atomicGet(count), 2000);
+    }
+
+    void runTree(cxxtools::ThreadPool::Mode mode)
+    {
+      volatile cxxtools::atomic_t count = 0;
+
+      {
+        cxxtools::ThreadPool pool(3, mode);
+        pool.schedule(TreeTask(pool, count, 10));
+      }
+
+      // the destructor processes all jobs including the ones scheduled by jobs
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::atomicGet(count), 2047);
+    }
+
+  public:
+    ThreadPoolTest()
+      : cxxtools::unit::TestSuite("threadpool")
+    {
+      registerMethod("sharedQueue", *this, &ThreadPoolTest::sharedQueue);
+      registerMethod("workStealing", *this, &ThreadPoolTest::workStealing);
+      registerMethod("forkJoin", *this, &ThreadPoolTest::forkJoin);
+      registerMethod("restart", *this, &ThreadPoolTest::restart);
+    }
+
+    void sharedQueue()
+    {
+      runTasks(cxxtools::ThreadPool::SharedQueue);
+    }
+
+    void workStealing()
+    {
+      runTasks(cxxtools::ThreadPool::WorkStealing);
+    }
+
+    void forkJoin()
+    {
+      runTree(cxxtools::ThreadPool::WorkStealing);
+    }
+
+    void restart()
+    {
+      volatile cxxtools::atomic_t count = 0;
+
+      cxxtools::ThreadPool pool(2, cxxtools::ThreadPool::WorkStealing, false);
+      CXXTOOLS_UNIT_ASSERT(pool.stopped());
+
+      for (unsigned r = 0; r < 3; ++r)
+      {
+        pool.start();
+        for (unsigned n = 0; n < 100; ++n)
+          pool.schedule(CountTask(count));
+        pool.stop();
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cxxtools::atomicGet(count), 300);
+    }
+};
+
+cxxtools::unit::RegisterTest<ThreadPoolTest> register_ThreadPoolTest;
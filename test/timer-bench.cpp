@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <cxxtools/selector.h>
+#include <cxxtools/timer.h>
+#include <cxxtools/connectable.h>
+#include <cxxtools/arg.h>
+#include <cxxtools/clock.h>
+#include <cxxtools/log.h>
+
+// Measures the cost of restarting timers of a selector, as done with the
+// keep-alive timers of many connections. Each restart moves a timer to a
+// new position in the timer store of the selector.
+
+namespace
+{
+    class Counter : public cxxtools::Connectable
+    {
+        public:
+            unsigned count;
+
+            Counter()
+                : count(0)
+            { }
+
+            void onTimeout()
+            { ++count; }
+    };
+
+    cxxtools::Timespan cpuTime()
+    {
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        return cxxtools::Timespan(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec,
+                                  ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+    }
+
+    class Bench
+    {
+            cxxtools::Selector _selector;
+            std::vector<cxxtools::Timer*> _timers;
+            Counter _counter;
+            unsigned _next;
+
+        public:
+            Bench(unsigned timers, unsigned granularity)
+                : _next(0)
+            {
+                _selector.setTimerGranularity(cxxtools::Milliseconds(granularity));
+
+                for (unsigned n = 0; n < timers; ++n)
+                {
+                    cxxtools::Timer* timer = new cxxtools::Timer(&_selector);
+                    cxxtools::connect(timer->timeout, _counter, &Counter::onTimeout);
+                    timer->after(cxxtools::Milliseconds(30000 + n % 1000));
+                    _timers.push_back(timer);
+                }
+            }
+
+            ~Bench()
+            {
+                for (unsigned n = 0; n < _timers.size(); ++n)
+                    delete _timers[n];
+            }
+
+            void restart(unsigned count)
+            {
+                for (unsigned n = 0; n < count; ++n)
+                {
+                    // every 16th timer gets a short timeout, so that timers expire too
+                    unsigned idx = _next++ % _timers.size();
+                    _timers[idx]->after(cxxtools::Milliseconds(idx % 16 == 0 ? 1 + idx % 50 : 30000 + idx % 1000));
+                }
+            }
+
+            // restarts timers as fast as possible
+            void maxRate(const cxxtools::Timespan& duration)
+            {
+                _counter.count = 0;
+                unsigned restarts = 0;
+
+                cxxtools::Clock clock;
+                clock.start();
+                cxxtools::Timespan end = cxxtools::Clock::getSystemTicks() + duration;
+
+                while (cxxtools::Clock::getSystemTicks() < end)
+                {
+                    restart(1000);
+                    restarts += 1000;
+                    _selector.wait(0);
+                }
+
+                cxxtools::Timespan t = clock.stop();
+
+                std::cout << "max rate:\n"
+                             "\trestarts: " << restarts << "\n"
+                             "\ttimeouts: " << _counter.count << "\n"
+                             "\trestarts per second: " << (restarts / t.totalSeconds()) << "\n"
+                             "\tnsecs per restart: " << (t.totalUSecs() * 1000.0 / restarts) << std::endl;
+            }
+
+            // restarts timers at a fixed rate and measures the cpu usage
+            void fixedRate(unsigned rate, const cxxtools::Timespan& duration)
+            {
+                _counter.count = 0;
+                unsigned restarts = 0;
+                unsigned perMSec = rate / 1000;
+
+                cxxtools::Timespan cpuStart = cpuTime();
+                cxxtools::Timespan start = cxxtools::Clock::getSystemTicks();
+                cxxtools::Timespan end = start + duration;
+                cxxtools::Timespan next = start;
+
+                cxxtools::Timespan now;
+                while ((now = cxxtools::Clock::getSystemTicks()) < end)
+                {
+                    if (now >= next)
+                    {
+                        restart(perMSec);
+                        restarts += perMSec;
+                        next += cxxtools::Milliseconds(1);
+                    }
+
+                    int64_t wait = (next - cxxtools::Clock::getSystemTicks()).totalUSecs();
+                    _selector.wait(wait > 0 ? (wait + 999) / 1000 : 0);
+                }
+
+                cxxtools::Timespan t = cxxtools::Clock::getSystemTicks() - start;
+                cxxtools::Timespan cpu = cpuTime() - cpuStart;
+
+                std::cout << "fixed rate of " << rate << " restarts per second:\n"
+                             "\trestarts: " << restarts << "\n"
+                             "\ttimeouts: " << _counter.count << "\n"
+                             "\tcpu usage: " << (cpu.totalUSecs() * 100.0 / t.totalUSecs()) << "%" << std::endl;
+            }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        log_init();
+
+        cxxtools::Arg<unsigned> timers(argc, argv, 'n', 100000);
+        cxxtools::Arg<unsigned> rate(argc, argv, 'r', 100000);
+        cxxtools::Arg<unsigned> seconds(argc, argv, 's', 2);
+        cxxtools::Arg<unsigned> granularity(argc, argv, 'g', 1);
+
+        std::cout << "benchmark restarting " << timers.getValue() << " timers\n\n"
+                     "options:\n"
+                     "   -n <number>       specify number of timers\n"
+                     "   -r <number>       specify restarts per second of the fixed rate test\n"
+                     "   -s <number>       specify duration of each test in seconds\n"
+                     "   -g <number>       specify timer granularity in milliseconds\n" << std::endl;
+
+        Bench bench(timers, granularity);
+        bench.maxRate(cxxtools::Seconds(seconds.getValue()));
+        bench.fixedRate(rate, cxxtools::Seconds(seconds.getValue()));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2013 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include "cxxtools/timer.h"
+#include "cxxtools/selector.h"
+#include "cxxtools/clock.h"
+#include "cxxtools/connectable.h"
+#include "cxxtools/thread.h"
+#include "cxxtools/unit/testsuite.h"
+#include "cxxtools/unit/registertest.h"
+#include <vector>
+#include <stdexcept>
+
+namespace
+{
+  class TimerSink : public cxxtools::Connectable
+  {
+      std::vector<unsigned>& _fired;
+      unsigned _id;
+
+    public:
+      cxxtools::Timer* other;
+      bool deleteOther;
+
+      TimerSink(std::vector<unsigned>& fired, unsigned id)
+        : _fired(fired),
+          _id(id),
+          other(0),
+          deleteOther(false)
+      { }
+
+      void onTimeout()
+      {
+        _fired.push_back(_id);
+
+        if (other && deleteOther)
+        {
+          delete other;
+          other = 0;
+        }
+      }
+  };
+
+  class SelfDeleter : public cxxtools::Connectable
+  {
+    public:
+      cxxtools::Timer* timer;
+      unsigned count;
+
+      SelfDeleter()
+        : timer(0),
+          count(0)
+      { }
+
+      void onTimeout()
+      {
+        ++count;
+        delete timer;
+        timer = 0;
+      }
+  };
+
+  // waits until the given number of timeouts are seen or the limit is reached
+  void waitFor(cxxtools::Selector& selector, const std::vector<unsigned>& fired,
+      unsigned count, const cxxtools::Milliseconds& limit = cxxtools::Milliseconds(2000))
+  {
+    cxxtools::Timespan end = cxxtools::Clock::getSystemTicks() + limit;
+    while (fired.size() < count && cxxtools::Clock::getSystemTicks() < end)
+      selector.wait(100);
+  }
+}
+
+class TimerTest : public cxxtools::unit::TestSuite
+{
+  public:
+    TimerTest()
+      : cxxtools::unit::TestSuite("timer")
+    {
+      registerMethod("order", *this, &TimerTest::order);
+      registerMethod("periodic", *this, &TimerTest::periodic);
+      registerMethod("restart", *this, &TimerTest::restart);
+      registerMethod("stop", *this, &TimerTest::stop);
+      registerMethod("deleteInCallback", *this, &TimerTest::deleteInCallback);
+      registerMethod("longInterval", *this, &TimerTest::longInterval);
+      registerMethod("granularity", *this, &TimerTest::granularity);
+    }
+
+    void order()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      std::vector<TimerSink*> sinks;
+      std::vector<cxxtools::Timer*> timers;
+
+      for (unsigned n = 0; n < 20; ++n)
+      {
+        unsigned id = 19 - n;
+        sinks.push_back(new TimerSink(fired, id));
+        timers.push_back(new cxxtools::Timer(&selector));
+        cxxtools::connect(timers.back()->timeout, *sinks.back(), &TimerSink::onTimeout);
+        timers.back()->after(cxxtools::Milliseconds(id * 3 + 1));
+      }
+
+      waitFor(selector, fired, 20);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 20);
+      for (unsigned n = 0; n < fired.size(); ++n)
+        CXXTOOLS_UNIT_ASSERT_EQUALS(fired[n], n);
+
+      for (unsigned n = 0; n < timers.size(); ++n)
+      {
+        delete timers[n];
+        delete sinks[n];
+      }
+    }
+
+    void periodic()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      TimerSink sink(fired, 1);
+
+      cxxtools::Timer timer(&selector);
+      cxxtools::connect(timer.timeout, sink, &TimerSink::onTimeout);
+      timer.start(cxxtools::Milliseconds(2));
+
+      // a late wait may fire the timer more than once
+      waitFor(selector, fired, 5);
+      CXXTOOLS_UNIT_ASSERT(fired.size() >= 5);
+      CXXTOOLS_UNIT_ASSERT(timer.active());
+    }
+
+    void restart()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      TimerSink sink(fired, 1);
+
+      cxxtools::Timer timer(&selector);
+      cxxtools::connect(timer.timeout, sink, &TimerSink::onTimeout);
+
+      // restarting the timer before it expires postpones the timeout
+      cxxtools::Timespan start = cxxtools::Clock::getSystemTicks();
+      for (unsigned n = 0; n < 10; ++n)
+      {
+        timer.after(cxxtools::Milliseconds(20));
+        selector.wait(2);
+      }
+
+      CXXTOOLS_UNIT_ASSERT(fired.empty());
+
+      waitFor(selector, fired, 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 1);
+      CXXTOOLS_UNIT_ASSERT(cxxtools::Clock::getSystemTicks() - start >= cxxtools::Milliseconds(20));
+      CXXTOOLS_UNIT_ASSERT(!timer.active());
+    }
+
+    void stop()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      TimerSink sink1(fired, 1);
+      TimerSink sink2(fired, 2);
+
+      cxxtools::Timer timer1(&selector);
+      cxxtools::Timer timer2(&selector);
+      cxxtools::connect(timer1.timeout, sink1, &TimerSink::onTimeout);
+      cxxtools::connect(timer2.timeout, sink2, &TimerSink::onTimeout);
+      timer1.after(cxxtools::Milliseconds(5));
+      timer2.after(cxxtools::Milliseconds(10));
+      timer1.stop();
+
+      waitFor(selector, fired, 1);
+      selector.wait(10);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired[0], 2);
+    }
+
+    void deleteInCallback()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      TimerSink sink1(fired, 1);
+      TimerSink sink2(fired, 2);
+
+      // both timers expire in the same pass; the first deletes the other
+      cxxtools::Timer* timer1 = new cxxtools::Timer(&selector);
+      cxxtools::Timer* timer2 = new cxxtools::Timer(&selector);
+      cxxtools::connect(timer1->timeout, sink1, &TimerSink::onTimeout);
+      cxxtools::connect(timer2->timeout, sink2, &TimerSink::onTimeout);
+      sink1.other = timer2;
+      sink1.deleteOther = true;
+      sink2.other = timer1;
+      sink2.deleteOther = true;
+      timer1->after(cxxtools::Milliseconds(1));
+      timer2->after(cxxtools::Milliseconds(1));
+      cxxtools::Thread::sleep(cxxtools::Milliseconds(3));
+
+      SelfDeleter selfDeleter;
+      selfDeleter.timer = new cxxtools::Timer(&selector);
+      cxxtools::connect(selfDeleter.timer->timeout, selfDeleter, &SelfDeleter::onTimeout);
+      selfDeleter.timer->start(cxxtools::Milliseconds(1));
+
+      waitFor(selector, fired, 1);
+      while (selfDeleter.timer)
+        selector.wait(10);
+      selector.wait(5);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(selfDeleter.count, 1);
+
+      delete (fired[0] == 1 ? timer1 : timer2);
+    }
+
+    void longInterval()
+    {
+      cxxtools::Selector selector;
+      std::vector<unsigned> fired;
+      TimerSink sink1(fired, 1);
+      TimerSink sink2(fired, 2);
+      TimerSink sink3(fired, 3);
+
+      // timers beyond the range of the lower levels and of the whole wheel
+      cxxtools::Timer timer1(&selector);
+      cxxtools::Timer timer2(&selector);
+      cxxtools::Timer timer3(&selector);
+      cxxtools::connect(timer1.timeout, sink1, &TimerSink::onTimeout);
+      cxxtools::connect(timer2.timeout, sink2, &TimerSink::onTimeout);
+      cxxtools::connect(timer3.timeout, sink3, &TimerSink::onTimeout);
+      timer1.after(cxxtools::Milliseconds(3600 * 1000));
+      timer2.after(cxxtools::Milliseconds(100LL * 24 * 3600 * 1000));
+      timer3.after(cxxtools::Milliseconds(70));
+
+      waitFor(selector, fired, 1);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired[0], 3);
+      CXXTOOLS_UNIT_ASSERT(timer1.active());
+      CXXTOOLS_UNIT_ASSERT(timer2.active());
+    }
+
+    void granularity()
+    {
+      cxxtools::Selector selector;
+      selector.setTimerGranularity(cxxtools::Milliseconds(10));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(selector.timerGranularity(), cxxtools::Milliseconds(10));
+
+      std::vector<unsigned> fired;
+      TimerSink sink(fired, 1);
+      cxxtools::Timer timer(&selector);
+      cxxtools::connect(timer.timeout, sink, &TimerSink::onTimeout);
+
+      cxxtools::Timespan start = cxxtools::Clock::getSystemTicks();
+      timer.after(cxxtools::Milliseconds(15));
+
+      waitFor(selector, fired, 1);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(fired.size(), 1);
+      CXXTOOLS_UNIT_ASSERT(cxxtools::Clock::getSystemTicks() - start >= cxxtools::Milliseconds(15));
+
+      CXXTOOLS_UNIT_ASSERT_THROW(selector.setTimerGranularity(cxxtools::Milliseconds(0)), std::invalid_argument);
+    }
+};
+
+cxxtools::unit::RegisterTest<TimerTest> register_TimerTest;